@@ -28,6 +28,12 @@
 
 #cmakedefine01 DBUS_CXX_HAS_PROP_CONST
 
+#cmakedefine01 DBUS_CXX_HAS_EPOLL
+
+#cmakedefine01 DBUS_CXX_HAS_EVENTFD
+
+#cmakedefine01 DBUS_CXX_HAS_IO_URING
+
 #if DBUS_CXX_HAS_PROP_CONST
 #include <experimental/propagate_const>
 #define DBUS_CXX_PROPAGATE_CONST(T) std::experimental::propagate_const<T>
@@ -35,4 +41,15 @@
 #define DBUS_CXX_PROPAGATE_CONST(T) T
 #endif
 
+/* Coroutines depend on how the code using us is compiled, not on how we were built */
+#if defined( __cpp_impl_coroutine ) && defined( __has_include )
+#if __has_include( <coroutine> )
+#define DBUS_CXX_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifndef DBUS_CXX_HAS_COROUTINES
+#define DBUS_CXX_HAS_COROUTINES 0
+#endif
+
 #endif /* DBUSCXX_CONFIG_H */
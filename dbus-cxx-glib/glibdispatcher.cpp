@@ -26,15 +26,22 @@
 #include <dbus-cxx/dbus-cxx-private.h>
 #include <vector>
 #include <map>
+#include <set>
 #include <glib.h>
 
 static const char* LOGGER_NAME = "DBus.GLib.GLibDispatcher";
 
+/* The most messages that are processed for each call to Connection::dispatch */
+#define DISPATCH_BUDGET 64
+
 using DBus::GLib::GLibDispatcher;
 
 class GLibDispatcher::priv_data {
 public:
     std::map<GIOChannel*, std::shared_ptr<Connection>> m_channelToConnection;
+    /* Connections with messages left over after their last dispatch */
+    std::set<std::shared_ptr<Connection>> m_dataRemains;
+    guint m_idleSourceId = 0;
 };
 
 GLibDispatcher::GLibDispatcher() :
@@ -43,6 +50,10 @@ GLibDispatcher::GLibDispatcher() :
 }
 
 GLibDispatcher::~GLibDispatcher(){
+    if( m_priv->m_idleSourceId != 0 ){
+        g_source_remove( m_priv->m_idleSourceId );
+    }
+
     for( auto const& [key,val] : m_priv->m_channelToConnection ){
         g_io_channel_unref( key );
     }
@@ -91,13 +102,51 @@ gboolean GLibDispatcher::channel_has_data(GIOChannel* channel, GIOCondition cond
         return FALSE;
     }
 
-    do{
-        status = conn->dispatch();
-    }while( status != DBus::DispatchStatus::COMPLETE );
+    // Only dispatch one budget's worth at a time, so that a busy connection
+    // doesn't keep the rest of the main loop from running
+    status = conn->dispatch( DISPATCH_BUDGET ).status;
+    if( status != DBus::DispatchStatus::COMPLETE ){
+        schedule_dispatch( conn );
+    }
 
     return TRUE;
 }
 
+void GLibDispatcher::schedule_dispatch( std::shared_ptr<Connection> conn ){
+    m_priv->m_dataRemains.insert( conn );
+
+    if( m_priv->m_idleSourceId == 0 ){
+        m_priv->m_idleSourceId = g_idle_add( &GLibDispatcher::idle_cb, this );
+    }
+}
+
+gboolean GLibDispatcher::dispatch_remaining(){
+    std::set<std::shared_ptr<Connection>>::iterator it = m_priv->m_dataRemains.begin();
+
+    SIMPLELOGGER_TRACE( LOGGER_NAME, "dispatching remaining data" );
+
+    while( it != m_priv->m_dataRemains.end() ){
+        if( (*it)->dispatch( DISPATCH_BUDGET ).status == DBus::DispatchStatus::COMPLETE ){
+            it = m_priv->m_dataRemains.erase( it );
+        }else{
+            it++;
+        }
+    }
+
+    if( m_priv->m_dataRemains.empty() ){
+        m_priv->m_idleSourceId = 0;
+        return G_SOURCE_REMOVE;
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+gboolean GLibDispatcher::idle_cb( gpointer data ){
+    GLibDispatcher* disp = static_cast<GLibDispatcher*>( data );
+
+    return disp->dispatch_remaining();
+}
+
 gboolean GLibDispatcher::channel_data_cb(GIOChannel* channel, GIOCondition condition, gpointer data ){
     GLibDispatcher* disp = static_cast<GLibDispatcher*>( data );
 
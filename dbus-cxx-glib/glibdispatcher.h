@@ -40,6 +40,14 @@ private:
     gboolean channel_has_data(GIOChannel* channel, GIOCondition condition );
     static gboolean channel_data_cb(GIOChannel* channel, GIOCondition condition, gpointer data );
 
+    /**
+     * Dispatch conn again from an idle callback, once everything else in
+     * the main context has had a chance to run.
+     */
+    void schedule_dispatch( std::shared_ptr<Connection> conn );
+    gboolean dispatch_remaining();
+    static gboolean idle_cb( gpointer data );
+
 private:
     class priv_data;
 
@@ -19,12 +19,16 @@
  *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
  ***************************************************************************/
 #include <QMap>
+#include <QMetaObject>
 #include <QVector>
 #include <QSocketNotifier>
 #include <dbus-cxx/connection.h>
 
 #include "qtdispatcher.h"
 
+/* The most messages that are processed for each call to Connection::dispatch */
+#define DISPATCH_BUDGET 64
+
 using DBus::Qt::QtDispatcher;
 
 class QtDispatcher::priv_data {
@@ -90,7 +94,10 @@ void QtDispatcher::activated( int fd ){
         return;
     }
 
-    do{
-        status = conn->dispatch();
-    }while( status != DBus::DispatchStatus::COMPLETE );
+    // Only dispatch one budget's worth at a time, and queue up the rest
+    // behind whatever else the event loop has to do
+    status = conn->dispatch( DISPATCH_BUDGET ).status;
+    if( status != DBus::DispatchStatus::COMPLETE ){
+        QMetaObject::invokeMethod( this, "activated", ::Qt::QueuedConnection, Q_ARG( int, fd ) );
+    }
 }
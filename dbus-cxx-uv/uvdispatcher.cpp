@@ -29,6 +29,9 @@
 
 static const char* LOGGER_NAME = "DBus.Uv.UvDispatcher";
 
+/* The most messages that are processed for each call to Connection::dispatch */
+#define DISPATCH_BUDGET 64
+
 using DBus::Uv::UvDispatcher;
 
 static void
@@ -131,19 +134,18 @@ poll_cb(uv_poll_t* h, int status, int event)
         SIMPLELOGGER_DEBUG( LOGGER_NAME, "polled FD went bad, assmuming pipeline shutdown" );
     } else if (status < 0) {
         SIMPLELOGGER_ERROR( LOGGER_NAME, "poll_cb called with bad status: " << std::strerror(-status) << ", " << status);
-    } else if (event & UV_WRITABLE) {
-         // if we were polling for write-ability, we need to restart
-         // the poll handle after dispatching to stop (the
-         // signal_needs_dispatch handler will restart for write)
-         while (uvpc->connection->dispatch() != DBus::DispatchStatus::COMPLETE) {
-         }
-         uvpc->restart();
-     } else if (event & UV_READABLE) {
-         // if there is no write-able event then there is no need to
-         // restart to poll handle
-         while (uvpc->connection->dispatch() != DBus::DispatchStatus::COMPLETE) {
-         }
-     }
+    } else if (event & (UV_READABLE | UV_WRITABLE)) {
+        // Only dispatch one budget's worth at a time so that the rest of
+        // the loop gets to run.  If anything is left, poll for
+        // write-ability as well: the socket is almost always writable,
+        // so that brings us back here on the next loop iteration.  Once
+        // everything is done, go back to only polling for reading.
+        if (uvpc->connection->dispatch( DISPATCH_BUDGET ).status != DBus::DispatchStatus::COMPLETE) {
+            uvpc->restart_writeable();
+        } else if (event & UV_WRITABLE) {
+            uvpc->restart();
+        }
+    }
 }
 
 class UvDispatcher::priv_data {
@@ -41,8 +41,11 @@
 #include <dbus-cxx/filedescriptor.h>
 #include <dbus-cxx/simplelogger_defs.h>
 #include <dbus-cxx/standalonedispatcher.h>
+#include <dbus-cxx/server.h>
+#include <dbus-cxx/connectiongroup.h>
 #include <dbus-cxx/propertyproxy.h>
 #include <dbus-cxx/property.h>
 #include <dbus-cxx/multiplereturn.h>
+#include <dbus-cxx/arrayview.h>
 
 #endif
@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ ***************************************************************************/
+#ifndef DBUSCXX_ARRAYVIEW_H
+#define DBUSCXX_ARRAYVIEW_H
+
+#include <stddef.h>
+#include <vector>
+
+namespace DBus {
+
+/**
+ * A read-only view of an array of fixed-size elements that lives somewhere
+ * else, normally in the body of a Message.  Nothing is copied; the view is
+ * only valid for as long as the data that it points at.
+ *
+ * This is a small stand-in for C++20's std::span<const T>.
+ */
+template <typename T>
+class ArrayView {
+public:
+    typedef T value_type;
+    typedef const T* const_iterator;
+
+    ArrayView() :
+        m_data( nullptr ),
+        m_size( 0 ) {}
+
+    ArrayView( const T* data, size_t size ) :
+        m_data( data ),
+        m_size( size ) {}
+
+    const T* data() const { return m_data; }
+
+    size_t size() const { return m_size; }
+
+    bool empty() const { return m_size == 0; }
+
+    const_iterator begin() const { return m_data; }
+
+    const_iterator end() const { return m_data + m_size; }
+
+    const T& operator[]( size_t index ) const { return m_data[ index ]; }
+
+    /** Copy the elements of this view into a new vector */
+    std::vector<T> to_vector() const {
+        return std::vector<T>( begin(), end() );
+    }
+
+private:
+    const T* m_data;
+    size_t m_size;
+};
+
+} /* namespace DBus */
+
+#endif /* DBUSCXX_ARRAYVIEW_H */
@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ ***************************************************************************/
+#ifndef DBUSCXX_AWAITABLECALL_H
+#define DBUSCXX_AWAITABLECALL_H
+
+#include <dbus-cxx/dbus-cxx-config.h>
+#include <dbus-cxx/pendingcall.h>
+
+#include <functional>
+#include <memory>
+
+#if DBUS_CXX_HAS_COROUTINES
+#include <coroutine>
+#endif
+
+namespace DBus {
+
+class Message;
+
+/**
+ * Runs a function somewhere else, e.g. on an event loop or a thread pool.
+ * Used to say where a coroutine resumes once the reply to its call comes in.
+ */
+typedef std::function<void( std::function<void()> )> CallExecutor;
+
+#if DBUS_CXX_HAS_COROUTINES
+
+/**
+ * The result of MethodProxy::async(); co_await it to send the call and
+ * suspend until the reply comes in.
+ *
+ * The coroutine is resumed on the dispatching thread, unless an executor
+ * was given, in which case the executor is asked to resume it.  If the
+ * reply is an error, co_await throws the error.
+ *
+ * The MethodProxy that this came from must still exist when this is awaited.
+ *
+ * @param T_return What co_await evaluates to
+ */
+template <typename T_return>
+class AwaitableCall {
+public:
+    /* Sends the call, with the slot to call with the reply */
+    typedef std::function<std::shared_ptr<PendingCall>( PendingCall::CompletedSlot )> Sender;
+    /* Turns the reply into what co_await evaluates to, or throws */
+    typedef T_return ( *Converter )( std::shared_ptr<Message> );
+
+    AwaitableCall( Sender sender, Converter converter, CallExecutor executor = CallExecutor() ) :
+        m_sender( std::move( sender ) ),
+        m_converter( converter ),
+        m_executor( std::move( executor ) ) {}
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    bool await_suspend( std::coroutine_handle<> handle ) {
+        // We may be resumed, and so destroyed, before the sender returns;
+        // don't look at ourselves once the call is sent
+        Sender sender = std::move( m_sender );
+        std::shared_ptr<Message>* reply = &m_reply;
+        CallExecutor executor = m_executor;
+
+        std::shared_ptr<PendingCall> pending = sender( [reply, executor, handle]( std::shared_ptr<Message> msg ) {
+            *reply = msg;
+
+            if( executor ) {
+                executor( [handle]() {
+                    handle.resume();
+                } );
+            } else {
+                handle.resume();
+            }
+        } );
+
+        // Nothing was sent, so nothing will resume us; carry on with no reply
+        return static_cast<bool>( pending );
+    }
+
+    T_return await_resume() {
+        return m_converter( m_reply );
+    }
+
+private:
+    Sender m_sender;
+    Converter m_converter;
+    CallExecutor m_executor;
+    std::shared_ptr<Message> m_reply;
+};
+
+#endif /* DBUS_CXX_HAS_COROUTINES */
+
+} /* namespace DBus */
+
+#endif /* DBUSCXX_AWAITABLECALL_H */
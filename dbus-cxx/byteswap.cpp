@@ -0,0 +1,238 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ ***************************************************************************/
+#include "byteswap.h"
+
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <stdlib.h>
+#endif
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define DBUSCXX_BYTESWAP_X86 1
+#include <immintrin.h>
+#elif defined( __ARM_NEON )
+#define DBUSCXX_BYTESWAP_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace DBus {
+namespace priv {
+
+typedef void ( *byteswap_function )( uint8_t* dest, const uint8_t* src, size_t count, int element_size );
+
+/*
+ * Reverse the bytes of a single value, using whatever the compiler gives us
+ * for it, or plain shifts if it gives us nothing.
+ */
+static inline uint16_t swap16( uint16_t value ) {
+#if defined( _MSC_VER )
+    return _byteswap_ushort( value );
+#elif defined( __GNUC__ )
+    return __builtin_bswap16( value );
+#else
+    return static_cast<uint16_t>( ( value >> 8 ) | ( value << 8 ) );
+#endif
+}
+
+static inline uint32_t swap32( uint32_t value ) {
+#if defined( _MSC_VER )
+    return _byteswap_ulong( value );
+#elif defined( __GNUC__ )
+    return __builtin_bswap32( value );
+#else
+    return ( value >> 24 ) |
+           ( ( value >> 8 ) & 0x0000FF00u ) |
+           ( ( value << 8 ) & 0x00FF0000u ) |
+           ( value << 24 );
+#endif
+}
+
+static inline uint64_t swap64( uint64_t value ) {
+#if defined( _MSC_VER )
+    return _byteswap_uint64( value );
+#elif defined( __GNUC__ )
+    return __builtin_bswap64( value );
+#else
+    return ( static_cast<uint64_t>( swap32( static_cast<uint32_t>( value ) ) ) << 32 ) |
+           swap32( static_cast<uint32_t>( value >> 32 ) );
+#endif
+}
+
+static void byteswap_copy_scalar( uint8_t* dest, const uint8_t* src, size_t count, int element_size ) {
+    switch( element_size ) {
+    case 2:
+        for( size_t x = 0; x < count; x++ ) {
+            uint16_t value;
+            std::memcpy( &value, src + x * 2, 2 );
+            value = swap16( value );
+            std::memcpy( dest + x * 2, &value, 2 );
+        }
+        break;
+
+    case 4:
+        for( size_t x = 0; x < count; x++ ) {
+            uint32_t value;
+            std::memcpy( &value, src + x * 4, 4 );
+            value = swap32( value );
+            std::memcpy( dest + x * 4, &value, 4 );
+        }
+        break;
+
+    case 8:
+        for( size_t x = 0; x < count; x++ ) {
+            uint64_t value;
+            std::memcpy( &value, src + x * 8, 8 );
+            value = swap64( value );
+            std::memcpy( dest + x * 8, &value, 8 );
+        }
+        break;
+
+    default:
+        std::memcpy( dest, src, count * element_size );
+        break;
+    }
+}
+
+#if DBUSCXX_BYTESWAP_X86
+/*
+ * Shuffle masks that reverse every 2, 4 or 8 bytes of a 16-byte lane.
+ * AVX2 shuffles each 16-byte lane on its own, so the same mask is used twice.
+ */
+alignas( 32 ) static const uint8_t swap_masks[ 3 ][ 32 ] = {
+    { 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+      1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 },
+    { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+      3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 },
+    { 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+      7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8 },
+};
+
+static const uint8_t* swap_mask( int element_size ) {
+    switch( element_size ) {
+    case 2: return swap_masks[ 0 ];
+    case 4: return swap_masks[ 1 ];
+    default: return swap_masks[ 2 ];
+    }
+}
+
+__attribute__(( target( "ssse3" ) ))
+static void byteswap_copy_ssse3( uint8_t* dest, const uint8_t* src, size_t count, int element_size ) {
+    size_t num_bytes = count * element_size;
+    size_t x = 0;
+
+    if( element_size == 1 ) {
+        std::memcpy( dest, src, num_bytes );
+        return;
+    }
+
+    const __m128i mask = _mm_load_si128( reinterpret_cast<const __m128i*>( swap_mask( element_size ) ) );
+
+    for( ; x + 16 <= num_bytes; x += 16 ) {
+        __m128i value = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + x ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( dest + x ), _mm_shuffle_epi8( value, mask ) );
+    }
+
+    byteswap_copy_scalar( dest + x, src + x, ( num_bytes - x ) / element_size, element_size );
+}
+
+__attribute__(( target( "avx2" ) ))
+static void byteswap_copy_avx2( uint8_t* dest, const uint8_t* src, size_t count, int element_size ) {
+    size_t num_bytes = count * element_size;
+    size_t x = 0;
+
+    if( element_size == 1 ) {
+        std::memcpy( dest, src, num_bytes );
+        return;
+    }
+
+    const __m256i mask = _mm256_load_si256( reinterpret_cast<const __m256i*>( swap_mask( element_size ) ) );
+
+    for( ; x + 32 <= num_bytes; x += 32 ) {
+        __m256i value = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( src + x ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( dest + x ), _mm256_shuffle_epi8( value, mask ) );
+    }
+
+    byteswap_copy_scalar( dest + x, src + x, ( num_bytes - x ) / element_size, element_size );
+}
+#endif
+
+#if DBUSCXX_BYTESWAP_NEON
+static void byteswap_copy_neon( uint8_t* dest, const uint8_t* src, size_t count, int element_size ) {
+    size_t num_bytes = count * element_size;
+    size_t x = 0;
+
+    switch( element_size ) {
+    case 2:
+        for( ; x + 16 <= num_bytes; x += 16 ) {
+            vst1q_u8( dest + x, vrev16q_u8( vld1q_u8( src + x ) ) );
+        }
+        break;
+
+    case 4:
+        for( ; x + 16 <= num_bytes; x += 16 ) {
+            vst1q_u8( dest + x, vrev32q_u8( vld1q_u8( src + x ) ) );
+        }
+        break;
+
+    case 8:
+        for( ; x + 16 <= num_bytes; x += 16 ) {
+            vst1q_u8( dest + x, vrev64q_u8( vld1q_u8( src + x ) ) );
+        }
+        break;
+    }
+
+    byteswap_copy_scalar( dest + x, src + x, ( num_bytes - x ) / element_size, element_size );
+}
+#endif
+
+/*
+ * Pick the fastest implementation that this CPU supports.  This only
+ * happens once, the first time that anything is swapped.
+ */
+static byteswap_function select_byteswap_function() {
+#if DBUSCXX_BYTESWAP_X86
+    __builtin_cpu_init();
+
+    if( __builtin_cpu_supports( "avx2" ) ) {
+        return byteswap_copy_avx2;
+    }
+
+    if( __builtin_cpu_supports( "ssse3" ) ) {
+        return byteswap_copy_ssse3;
+    }
+#elif DBUSCXX_BYTESWAP_NEON
+    return byteswap_copy_neon;
+#endif
+
+    return byteswap_copy_scalar;
+}
+
+void byteswap_copy( uint8_t* dest, const uint8_t* src, size_t count, int element_size ) {
+    static const byteswap_function swap = select_byteswap_function();
+
+    swap( dest, src, count, element_size );
+}
+
+void copy_fixed_array( uint8_t* dest, Endianess dest_endian,
+                       const uint8_t* src, Endianess src_endian,
+                       size_t count, int element_size ) {
+    if( count == 0 ) {
+        return;
+    }
+
+    if( dest_endian == src_endian || element_size == 1 ) {
+        std::memcpy( dest, src, count * element_size );
+        return;
+    }
+
+    byteswap_copy( dest, src, count, element_size );
+}
+
+} /* namespace priv */
+} /* namespace DBus */
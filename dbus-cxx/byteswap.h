@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ ***************************************************************************/
+#ifndef DBUSCXX_BYTESWAP_H
+#define DBUSCXX_BYTESWAP_H
+
+#include <dbus-cxx/enums.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace DBus {
+namespace priv {
+
+/**
+ * The byte order of the machine that we are running on.
+ */
+constexpr Endianess host_endianess() {
+#if defined( __BYTE_ORDER__ ) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return Endianess::Big;
+#else
+    return Endianess::Little;
+#endif
+}
+
+/**
+ * Copy an array of fixed-size elements from src to dest, reversing the
+ * bytes of each element.  This uses SSSE3 or AVX2 on x86 and NEON on ARM,
+ * depending on what the CPU supports.
+ *
+ * @param dest Where to copy the elements to
+ * @param src Where to copy the elements from; may not overlap dest
+ * @param count The number of elements to copy
+ * @param element_size The size of each element: 1, 2, 4 or 8 bytes
+ */
+void byteswap_copy( uint8_t* dest, const uint8_t* src, size_t count, int element_size );
+
+/**
+ * Copy an array of fixed-size elements from src to dest, converting them
+ * from one byte order to the other if needed.  When both byte orders are
+ * the same this is a plain memcpy.
+ */
+void copy_fixed_array( uint8_t* dest, Endianess dest_endian,
+                       const uint8_t* src, Endianess src_endian,
+                       size_t count, int element_size );
+
+} /* namespace priv */
+} /* namespace DBus */
+
+#endif /* DBUSCXX_BYTESWAP_H */
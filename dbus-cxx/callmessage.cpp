@@ -10,6 +10,7 @@
 #include "enums.h"
 #include "error.h"
 #include "message.h"
+#include "messagepool.h"
 #include "path.h"
 #include "variant.h"
 #include "returnmessage.h"
@@ -45,19 +46,19 @@ CallMessage::CallMessage( const std::string& path, const std::string& method ) {
 }
 
 std::shared_ptr<CallMessage> CallMessage::create() {
-    return std::shared_ptr<CallMessage>( new CallMessage() );
+    return priv::create_pooled_message<CallMessage>();
 }
 
 std::shared_ptr<CallMessage> CallMessage::create( const std::string& dest, const std::string& path, const std::string& iface, const std::string& method ) {
-    return std::shared_ptr<CallMessage>( new CallMessage( dest, path, iface, method ) );
+    return priv::create_pooled_message<CallMessage>( dest, path, iface, method );
 }
 
 std::shared_ptr<CallMessage> CallMessage::create( const std::string& path, const std::string& iface, const std::string& method ) {
-    return std::shared_ptr<CallMessage>( new CallMessage( path, iface, method ) );
+    return priv::create_pooled_message<CallMessage>( path, iface, method );
 }
 
 std::shared_ptr<CallMessage> CallMessage::create( const std::string& path, const std::string& method ) {
-    return std::shared_ptr<CallMessage>( new CallMessage( path, method ) );
+    return priv::create_pooled_message<CallMessage>( path, method );
 }
 
 std::shared_ptr<ReturnMessage> CallMessage::create_reply() const {
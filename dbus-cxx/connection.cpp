@@ -10,17 +10,23 @@
 #include <dbus-cxx/signalmessage.h>
 #include <dbus-cxx/errormessage.h>
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <memory>
+#include <optional>
 #include <utility>
 #include "callmessage.h"
 #include "dbus-cxx-private.h"
 #include "error.h"
 #include "message.h"
+#include "messageiterator.h"
 #include "object.h"
 #include "objectproxy.h"
+#include "outgoingqueue.h"
 #include "path.h"
 #include "pendingcall.h"
+#include "replytable.h"
 #include "returnmessage.h"
 #include <sigc++/sigc++.h>
 #include "signalproxy.h"
@@ -61,18 +67,41 @@ namespace sigc { template <typename T_return, typename ...T_arg> class slot; }
 
 static const char* LOGGER_NAME = "DBus.Connection";
 
+#define DEFAULT_OUTGOING_HIGH_WATERMARK ( 8 * 1024 * 1024 )
+#define DEFAULT_OUTGOING_LOW_WATERMARK  ( 2 * 1024 * 1024 )
+
+/*
+ * How long a blocking caller that is reading for itself waits on the socket
+ * at a time, before checking if the dispatching thread needs to read instead
+ */
+#define READ_FOR_REPLY_SLICE_MS 10
+
 namespace DBus {
 
-struct ExpectingResponse {
-    std::mutex cv_lock;
-    std::condition_variable cv;
-    std::shared_ptr<Message> reply;
-};
+/**
+ * Create a call to a method on the bus itself.
+ */
+static std::shared_ptr<CallMessage> daemon_call_message( const std::string& method ) {
+    return CallMessage::create( "org.freedesktop.DBus", "/org/freedesktop/DBus", "org.freedesktop.DBus", method );
+}
 
-struct OutgoingMessage {
-    std::shared_ptr<const Message> msg;
-    uint32_t serial;
-};
+/**
+ * @return The serial of the call that msg is a reply to, or 0 if it is not a reply
+ */
+static uint32_t reply_serial_of( const std::shared_ptr<Message>& msg ) {
+    if( msg->type() == MessageType::RETURN ) {
+        return std::static_pointer_cast<ReturnMessage>( msg )->reply_serial();
+    } else if( msg->type() == MessageType::ERROR ) {
+        return std::static_pointer_cast<ErrorMessage>( msg )->reply_serial();
+    }
+
+    return 0;
+}
+
+/* When each call sent with send_with_reply_async() times out */
+typedef std::multimap<std::chrono::steady_clock::time_point, uint32_t> PendingCallDeadlines;
+
+using priv::OutgoingMessage;
 
 struct ObjectProxyThreadInfo {
     std::weak_ptr<ObjectProxy> handler;
@@ -89,20 +118,105 @@ public:
     priv_data() :
         m_currentSerial( 1 ),
         m_dispatchingThread( std::this_thread::get_id() ),
+        m_readLockWanted( false ),
+        m_hasHandedOffMessages( false ),
+        m_leaderFollowerReads( false ),
+        m_nonblockingWrites( false ),
+        m_outgoingHighWatermark( DEFAULT_OUTGOING_HIGH_WATERMARK ),
+        m_outgoingLowWatermark( DEFAULT_OUTGOING_LOW_WATERMARK ),
+        m_outgoingCongested( false ),
+        m_peerToPeer( false ),
         m_dispatchStatus( DispatchStatus::COMPLETE )
     {}
 
+    /**
+     * Get the serial to send the next message with.  May be called from any thread.
+     */
+    uint32_t next_serial() {
+        uint32_t serial = m_currentSerial.fetch_add( 1, std::memory_order_relaxed );
+
+        if( serial == 0 ) {
+            // 0 is not a valid serial; we have wrapped around
+            serial = m_currentSerial.fetch_add( 1, std::memory_order_relaxed );
+        }
+
+        return serial;
+    }
+
+    /**
+     * Put the messages that a blocking caller read for us onto the
+     * incoming queue, in front of anything that we read after them.
+     * Only the dispatching thread may call this.
+     */
+    void take_handed_off_messages() {
+        if( !m_hasHandedOffMessages.load( std::memory_order_acquire ) ) {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock( m_incomingLock );
+
+        for( std::shared_ptr<Message>& incoming : m_handedOffMessages ) {
+            m_incomingMessages.push( std::move( incoming ) );
+        }
+
+        m_handedOffMessages.clear();
+        m_hasHandedOffMessages.store( false, std::memory_order_release );
+    }
+
+    /**
+     * Take m_readLock from the dispatching thread when we have to read,
+     * asking a blocking caller that is reading for itself to stop.
+     */
+    std::unique_lock<std::mutex> lock_reading() {
+        m_readLockWanted = true;
+        std::unique_lock<std::mutex> lock( m_readLock );
+        m_readLockWanted = false;
+
+        take_handed_off_messages();
+
+        return lock;
+    }
+
     std::vector<uint8_t> m_sendBuffer;
-    uint32_t m_currentSerial;
+    std::atomic<uint32_t> m_currentSerial;
     std::shared_ptr<priv::Transport> m_transport;
     std::string m_uniqueName;
     std::thread::id m_dispatchingThread;
     std::mutex m_incomingLock;
     std::queue<std::shared_ptr<Message>> m_incomingMessages;
+    /* Messages read from the transport, before they go onto m_incomingMessages */
+    std::vector<std::shared_ptr<Message>> m_incomingBatch;
+    /* Held by whoever is reading from the transport */
+    std::mutex m_readLock;
+    /* Set while the dispatching thread is waiting for m_readLock */
+    std::atomic<bool> m_readLockWanted;
+    /* Read by a blocking caller for the dispatching thread; protected by m_incomingLock */
+    std::vector<std::shared_ptr<Message>> m_handedOffMessages;
+    std::atomic<bool> m_hasHandedOffMessages;
+    /* True if blocking callers may read their own replies */
+    std::atomic<bool> m_leaderFollowerReads;
+    /* Held by whoever is writing to the transport; senders don't need it */
     std::mutex m_outgoingLock;
-    std::queue<OutgoingMessage> m_outgoingMessages;
-    std::mutex m_expectingResponsesLock;
-    std::map<uint32_t, std::shared_ptr<ExpectingResponse>> m_expectingResponses;
+    priv::OutgoingQueue m_outgoingMessages;
+    /* Messages pulled off of m_outgoingMessages to be written in one go */
+    std::vector<OutgoingMessage> m_outgoingBatch;
+    std::atomic<bool> m_nonblockingWrites;
+    std::atomic<size_t> m_outgoingHighWatermark;
+    std::atomic<size_t> m_outgoingLowWatermark;
+    std::atomic<bool> m_outgoingCongested;
+    sigc::signal<void(bool)> m_outgoingCongestion;
+    /* True if there is no bus between us and the other end */
+    bool m_peerToPeer;
+    /* The calls that we are waiting on a reply to, whether blocking or async */
+    priv::ReplyTable m_replies;
+    /*
+     * Every call sent with send_with_reply_async() that is still pending is
+     * in m_pendingCallDeadlineOf; only the ones with a timeout are also in
+     * m_pendingCallDeadlines, the others point at its end().
+     */
+    mutable std::mutex m_pendingCallDeadlinesLock;
+    PendingCallDeadlines m_pendingCallDeadlines;
+    std::map<uint32_t, PendingCallDeadlines::iterator> m_pendingCallDeadlineOf;
     DispatchStatus m_dispatchStatus;
     std::mutex m_rootObjectsLock;
     std::shared_ptr<Object> m_rootObject;
@@ -116,6 +230,8 @@ public:
     std::vector<ObjectProxyThreadInfo> m_objectProxies;
     std::mutex m_listeningSignalsLock;
     std::map<std::string,int> m_listeningSignals;
+    /* The thread creating m_daemonProxy; its signals' rules are not sent */
+    std::thread::id m_daemonProxyCreator;
 };
 
 Connection::Connection( BusType type ) {
@@ -177,6 +293,17 @@ Connection::Connection( std::string address ) {
     }
 }
 
+Connection::Connection( std::shared_ptr<priv::Transport> transport ) {
+    m_priv = std::make_unique<priv_data>();
+    m_priv->m_transport = transport;
+    m_priv->m_peerToPeer = true;
+
+    if( !m_priv->m_transport || !m_priv->m_transport->is_valid() ) {
+        SIMPLELOGGER_ERROR( LOGGER_NAME, "Unable to open transport" );
+        return;
+    }
+}
+
 std::shared_ptr<Connection> Connection::create( BusType type ) {
     std::shared_ptr<Connection> p( new Connection( type ) );
 
@@ -196,7 +323,22 @@ std::shared_ptr<Connection> Connection::create( std::string address ) {
 
 }
 
+std::shared_ptr<Connection> Connection::create_peer( std::string address ) {
+    return create_for_peer( priv::Transport::open_transport( address ) );
+}
+
+std::shared_ptr<Connection> Connection::create_for_peer( std::shared_ptr<priv::Transport> transport ) {
+    std::shared_ptr<Connection> p( new Connection( transport ) );
+
+    p->m_priv->m_rootObject = Object::create_lightweight( "/" );
+    p->m_priv->m_rootObject->set_connection( p );
+
+    return p;
+}
+
 Connection::~Connection() {
+    // Nobody is going to read the replies to these anymore
+    fail_pending_calls();
 }
 
 Connection::operator bool() const {
@@ -212,19 +354,133 @@ bool Connection::bus_register() {
         return false;
     }
 
+    bus_register( std::vector<std::string>() );
+
+    return is_registered();
+}
+
+std::vector<RequestNameResponse> Connection::bus_register( const std::vector<std::string>& names, unsigned int flags ) {
+    std::vector<std::shared_ptr<const CallMessage>> startupMessages;
+    std::vector<std::shared_ptr<Message>> replies;
+    std::vector<RequestNameResponse> nameResponses;
+    std::vector<std::string> matchRules;
+
+    if( !is_valid() ) {
+        throw ErrorDisconnected();
+    }
+
+    if( m_priv->m_peerToPeer ) {
+        if( !names.empty() ) {
+            throw ErrorNotSupported( "Bus names can't be used without a bus" );
+        }
+
+        return nameResponses;
+    }
+
     if( is_registered() ) {
-        return true;
+        for( const std::string& name : names ) {
+            nameResponses.push_back( request_name( name, flags ) );
+        }
+
+        return nameResponses;
+    }
+
+    /*
+     * The daemon proxy has signal proxies of its own, but we have never asked
+     * the bus for those signals.  Create it before anything goes out so that
+     * add_match() can tell its rules apart and leave them out.
+     */
+    std::shared_ptr<DBus::DBusDaemonProxy> daemonProxy;
+    {
+        std::unique_lock<std::mutex> lock( m_priv->m_listeningSignalsLock );
+        m_priv->m_daemonProxyCreator = std::this_thread::get_id();
     }
 
-    m_priv->m_daemonProxy = DBus::DBusDaemonProxy::create( shared_from_this() );
+    daemonProxy = DBus::DBusDaemonProxy::create( shared_from_this() );
 
-    m_priv->m_uniqueName = m_priv->m_daemonProxy->Hello();
+    {
+        // Any match rules that were added before we were registered still need to be sent
+        std::unique_lock<std::mutex> lock( m_priv->m_listeningSignalsLock );
+        m_priv->m_daemonProxyCreator = std::thread::id();
 
-    return true;
+        for( const std::pair<const std::string, int>& rule : m_priv->m_listeningSignals ) {
+            matchRules.push_back( rule.first );
+        }
+    }
+
+    /*
+     * Send everything that we need to do to start up at once, and then wait
+     * for all of the replies.  The bus handles the messages in order, so this
+     * only takes one round trip instead of one for each message.
+     */
+    startupMessages.push_back( daemon_call_message( "Hello" ) );
+
+    for( const std::string& name : names ) {
+        std::shared_ptr<CallMessage> msg = daemon_call_message( "RequestName" );
+        *msg << name << static_cast<uint32_t>( flags );
+        startupMessages.push_back( msg );
+    }
+
+    for( const std::string& rule : matchRules ) {
+        std::shared_ptr<CallMessage> msg = daemon_call_message( "AddMatch" );
+        *msg << rule;
+        startupMessages.push_back( msg );
+    }
+
+    SIMPLELOGGER_DEBUG( LOGGER_NAME, "Registering with " << names.size() << " names and "
+        << matchRules.size() << " match rules" );
+
+    replies = send_with_replies_blocking( startupMessages, -1 );
+
+    if( replies[ 0 ]->type() == MessageType::ERROR ) {
+        std::static_pointer_cast<ErrorMessage>( replies[ 0 ] )->throw_error();
+    }
+
+    {
+        std::string uniqueName;
+        MessageIterator it = replies[ 0 ]->begin();
+        it >> uniqueName;
+
+        std::unique_lock<std::mutex> lock( m_priv->m_listeningSignalsLock );
+        m_priv->m_uniqueName = uniqueName;
+        m_priv->m_daemonProxy = daemonProxy;
+
+        // Match rules that were added while we were waiting haven't been sent yet
+        for( const std::pair<const std::string, int>& rule : m_priv->m_listeningSignals ) {
+            if( std::find( matchRules.begin(), matchRules.end(), rule.first ) == matchRules.end() ) {
+                m_priv->m_daemonProxy->AddMatch( rule.first );
+            }
+        }
+    }
+
+    for( size_t x = 1 + names.size(); x < replies.size(); x++ ) {
+        if( replies[ x ]->type() == MessageType::ERROR ) {
+            SIMPLELOGGER_WARN( LOGGER_NAME, "Unable to add match rule " << matchRules[ x - 1 - names.size() ]
+                << ": " << std::static_pointer_cast<ErrorMessage>( replies[ x ] )->message() );
+        }
+    }
+
+    for( size_t x = 1; x < 1 + names.size(); x++ ) {
+        uint32_t retval = 0;
+
+        if( replies[ x ]->type() == MessageType::ERROR ) {
+            std::static_pointer_cast<ErrorMessage>( replies[ x ] )->throw_error();
+        }
+
+        replies[ x ]->begin() >> retval;
+        nameResponses.push_back( request_name_response( retval ) );
+    }
+
+    return nameResponses;
 }
 
 bool Connection::is_registered() const {
-    return !m_priv->m_uniqueName.empty();
+    // There is nothing to register with if we are talking directly to a peer
+    return m_priv->m_peerToPeer || !m_priv->m_uniqueName.empty();
+}
+
+bool Connection::is_peer_to_peer() const {
+    return m_priv->m_peerToPeer;
 }
 
 std::string Connection::unique_name() const {
@@ -238,8 +494,16 @@ RequestNameResponse Connection::request_name( const std::string& name, unsigned
         throw ErrorDisconnected();
     }
 
+    if( !m_priv->m_daemonProxy ) {
+        throw ErrorNotSupported( "Bus names can't be used without a bus" );
+    }
+
     uint32_t retval = m_priv->m_daemonProxy->RequestName( name, flags );
 
+    return request_name_response( retval );
+}
+
+RequestNameResponse Connection::request_name_response( uint32_t retval ) {
     switch( retval ) {
     case DBUSCXX_REQUEST_NAME_REPLY_PRIMARY_OWNER:
         return RequestNameResponse::PrimaryOwner;
@@ -262,6 +526,10 @@ RequestNameResponse Connection::request_name( const std::string& name, unsigned
 }
 
 ReleaseNameResponse Connection::release_name( const std::string& name ) {
+    if( !m_priv->m_daemonProxy ) {
+        throw ErrorNotSupported( "Bus names can't be used without a bus" );
+    }
+
     uint32_t retval = m_priv->m_daemonProxy->ReleaseName( name );
 
     switch( retval ) {
@@ -282,10 +550,18 @@ ReleaseNameResponse Connection::release_name( const std::string& name ) {
 }
 
 bool Connection::name_has_owner( const std::string& name ) const {
+    if( !m_priv->m_daemonProxy ) {
+        throw ErrorNotSupported( "Bus names can't be used without a bus" );
+    }
+
     return m_priv->m_daemonProxy->NameHasOwner( name );
 }
 
 StartReply Connection::start_service( const std::string& name, uint32_t flags ) const {
+    if( !m_priv->m_daemonProxy ) {
+        throw ErrorNotSupported( "Bus names can't be used without a bus" );
+    }
+
     uint32_t retval = m_priv->m_daemonProxy->StartServiceByName( name, flags );
 
     switch( retval ) {
@@ -310,18 +586,26 @@ bool Connection::add_match( const std::string& rule ) {
         throw ErrorDisconnected();
     }
 
-    if( m_priv->m_daemonProxy ) {
-        std::map<std::string,int>::iterator it =
-                m_priv->m_listeningSignals.find( rule );
-        if( it == m_priv->m_listeningSignals.end() ){
-            SIMPLELOGGER_DEBUG( LOGGER_NAME, "Adding the following match: " << rule );
-            m_priv->m_listeningSignals[ rule ] = 1;
+    if( std::this_thread::get_id() == m_priv->m_daemonProxyCreator ) {
+        // Only the daemon proxy's own signals, which we don't listen for
+        return true;
+    }
+
+    // Rules are remembered even before we are registered, so that
+    // bus_register() can send them along with the Hello
+    std::map<std::string,int>::iterator it =
+            m_priv->m_listeningSignals.find( rule );
+    if( it == m_priv->m_listeningSignals.end() ){
+        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Adding the following match: " << rule );
+        m_priv->m_listeningSignals[ rule ] = 1;
+
+        if( m_priv->m_daemonProxy ) {
             m_priv->m_daemonProxy->AddMatch( rule );
-        }else{
-            int count = m_priv->m_listeningSignals[ rule ];
-            m_priv->m_listeningSignals[ rule ] = count + 1;
-            SIMPLELOGGER_DEBUG( LOGGER_NAME, "Adding match rule: " << rule << " count: " << count + 1 );
         }
+    }else{
+        int count = m_priv->m_listeningSignals[ rule ];
+        m_priv->m_listeningSignals[ rule ] = count + 1;
+        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Adding match rule: " << rule << " count: " << count + 1 );
     }
 
     return true;
@@ -336,20 +620,20 @@ bool Connection::remove_match( const std::string& rule ) {
     std::unique_lock<std::mutex> lock(
         m_priv->m_listeningSignalsLock);
 
-    if( m_priv->m_daemonProxy ){
-        std::map<std::string,int>::iterator it =
-                m_priv->m_listeningSignals.find( rule );
-        if( it != m_priv->m_listeningSignals.end() ){
-            int count = m_priv->m_listeningSignals[ rule ];
-            count--;
-            m_priv->m_listeningSignals[ rule ] = count;
+    std::map<std::string,int>::iterator it =
+            m_priv->m_listeningSignals.find( rule );
+    if( it != m_priv->m_listeningSignals.end() ){
+        int count = m_priv->m_listeningSignals[ rule ];
+        count--;
+        m_priv->m_listeningSignals[ rule ] = count;
 
-            SIMPLELOGGER_DEBUG( LOGGER_NAME, "Match rule: " << rule << " count: " << count );
+        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Match rule: " << rule << " count: " << count );
 
-            if( count == 0 ){
+        if( count == 0 ){
+            if( m_priv->m_daemonProxy ){
                 m_priv->m_daemonProxy->RemoveMatch( rule );
-                m_priv->m_listeningSignals.erase(it);
             }
+            m_priv->m_listeningSignals.erase(it);
         }
     }
 
@@ -385,19 +669,15 @@ uint32_t Connection::send( std::shared_ptr<const Message> msg ) {
 
     if( !msg ) { return 0; }
 
-    if( m_priv->m_currentSerial == 0 ) { m_priv->m_currentSerial = 1; }
+    uint32_t serial = m_priv->next_serial();
 
-    OutgoingMessage outgoing;
-    {
-        std::unique_lock<std::mutex> lock( m_priv->m_outgoingLock );
-        outgoing.msg = msg;
-        outgoing.serial = m_priv->m_currentSerial++;
-        m_priv->m_outgoingMessages.push( outgoing );
+    // The dispatcher only needs to be told when the queue stops being empty
+    if( m_priv->m_outgoingMessages.push( OutgoingMessage{ msg, serial } ) ||
+        std::this_thread::get_id() == m_priv->m_dispatchingThread ) {
+        notify_dispatcher_or_dispatch();
     }
 
-    notify_dispatcher_or_dispatch();
-
-    return outgoing.serial;
+    return serial;
 }
 
 Connection& Connection::operator <<( std::shared_ptr<const Message> msg ) {
@@ -435,10 +715,62 @@ std::shared_ptr<ReturnMessage> Connection::send_with_reply_blocking_impl( std::s
         /*
          * Read messages until we find the one with the serial that we are expecting
          */
+        std::unique_lock<std::mutex> readLock = m_priv->lock_reading();
         std::vector<int> fds;
         fds.push_back( m_priv->m_transport->fd() );
+        std::vector<std::shared_ptr<Message>> incomingMessages;
+        std::shared_ptr<ErrorMessage> errorReply;
+
+        while( true ) {
+            // The transport may already have our reply buffered up, so check
+            // for it before waiting on the FD.
+            incomingMessages.clear();
+            m_priv->m_transport->readMessages( &incomingMessages );
+
+            if( !incomingMessages.empty() ) {
+                std::unique_lock<std::mutex> lock(
+                    m_priv->m_incomingLock);
+
+                for( std::shared_ptr<Message>& incoming : incomingMessages ) {
+                    SIMPLELOGGER_DEBUG( LOGGER_NAME, "Got incoming " << incoming.get() );
+
+                    // Check to see what type of message we have, and if it might be a reply to our
+                    // method call.
+                    if( !gotReply && !errorReply ) {
+                        if( incoming->type() == MessageType::ERROR ) {
+                            std::shared_ptr<ErrorMessage> errmsg = std::static_pointer_cast<ErrorMessage>( incoming );
+
+                            if( errmsg->reply_serial() == replySerialExpceted ) {
+                                errorReply = errmsg;
+                                continue;
+                            }
+                        } else if( incoming->type() == MessageType::RETURN ) {
+                            std::shared_ptr<ReturnMessage> returnmsg = std::static_pointer_cast<ReturnMessage>( incoming );
+
+                            if( returnmsg->reply_serial() == replySerialExpceted ) {
+                                retmsg = returnmsg;
+                                gotReply = true;
+                                continue;
+                            }
+                        }
+                    }
+
+                    m_priv->m_incomingMessages.push( incoming );
+                }
+            }
+
+            if( errorReply ) {
+                errorReply->throw_error();
+            }
+
+            if( gotReply ) {
+                break;
+            }
+
+            if( !m_priv->m_transport->is_valid() ) {
+                throw ErrorDisconnected();
+            }
 
-        do {
             std::tuple<bool, int, std::vector<int>, std::chrono::milliseconds> fdResponse;
             if ( disable_timeout ) {
                 fdResponse = DBus::priv::wait_for_fd_activity( fds, -1 );
@@ -452,128 +784,439 @@ std::shared_ptr<ReturnMessage> Connection::send_with_reply_blocking_impl( std::s
                     throw ErrorNoReply( "Did not receive a response in the alotted time" );
                 }
             }
+        }
 
-            if( !m_priv->m_transport->is_valid() ) {
-                throw ErrorDisconnected();
-            }
+    } else {
+        /*
+         * We are trying to do a blocking method call in a thread that is not the dispatcher thread.
+         * Queue up the message and notify the dispatcher thread, unless we
+         * can send it and read the reply ourselves.
+         */
+        uint32_t serial = m_priv->next_serial();
+        std::shared_ptr<Message> gotMessage;
+        std::chrono::steady_clock::time_point deadline =
+            std::chrono::steady_clock::now() + std::chrono::milliseconds( msToWait );
+        const std::chrono::steady_clock::time_point* waitUntil = disable_timeout ? nullptr : &deadline;
+        bool disconnected = false;
 
-            std::shared_ptr<Message> incoming = m_priv->m_transport->readMessage();
-            {
-                std::ostringstream str;
-                str << incoming.get();
-                SIMPLELOGGER_DEBUG( LOGGER_NAME, "Got incoming " << str.str() );
-            }
+        // Expect the reply before it can possibly come in
+        m_priv->m_replies.add( serial, std::shared_ptr<PendingCall>() );
 
-            if( incoming ) {
-                // Check to see what type of message we have, and if it might be a reply to our
-                // method call.
-                if( incoming->type() == MessageType::ERROR ) {
-                    std::shared_ptr<ErrorMessage> errmsg = std::static_pointer_cast<ErrorMessage>( incoming );
+        std::unique_lock<std::mutex> readLock( m_priv->m_readLock, std::defer_lock );
 
-                    if( errmsg->reply_serial() == replySerialExpceted ) {
-                        errmsg->throw_error();
-                    }
-                } else if( incoming->type() == MessageType::RETURN ) {
-                    retmsg = std::static_pointer_cast<ReturnMessage>( incoming );
+        if( m_priv->m_leaderFollowerReads ) {
+            readLock.try_lock();
+        }
+
+        if( readLock.owns_lock() ) {
+            // Nobody is reading right now, so we don't need the dispatcher
+            m_priv->m_outgoingMessages.push( OutgoingMessage{ message, serial } );
+            flush();
+            disconnected = !read_for_reply( serial, waitUntil );
+            readLock.unlock();
+
+            /*
+             * More data may have come in after our last read.  The dispatcher
+             * was woken up for it already but couldn't read while we held the
+             * lock, and won't be woken up again for the same data.
+             */
+            m_priv->m_dispatchStatus = DispatchStatus::DATA_REMAINS;
+            m_priv->m_needsDispatching();
+        } else if( m_priv->m_outgoingMessages.push( OutgoingMessage{ message, serial } ) ) {
+            notify_dispatcher_or_dispatch();
+        }
+
+        /*
+         * Either we already have the reply, or the dispatching thread hands
+         * it to us when it comes in
+         */
+        if( disconnected ) {
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            m_priv->m_replies.wait( serial, &now );
+            throw ErrorDisconnected();
+        }
+
+        gotMessage = m_priv->m_replies.wait( serial, waitUntil );
+
+        if( !gotMessage ) {
+            throw ErrorNoReply( "Did not receive a response in the alotted time" );
+        }
+
+        if( gotMessage->type() == MessageType::RETURN ) {
+            retmsg = std::static_pointer_cast<ReturnMessage>( gotMessage );
+        } else if( gotMessage->type() == MessageType::ERROR ) {
+            std::shared_ptr<ErrorMessage> errmsg = std::static_pointer_cast<ErrorMessage>( gotMessage );
+            errmsg->throw_error();
+        } else {
+            throw ErrorUnexpectedResponse();
+        }
+    }
+
+    return retmsg;
+}
+
+std::vector<std::shared_ptr<Message>> Connection::send_with_replies_blocking( const std::vector<std::shared_ptr<const CallMessage>>& messages, int timeout_milliseconds ) {
+    if( !this->is_valid() ) { throw ErrorDisconnected(); }
+
+    std::vector<std::shared_ptr<Message>> replies( messages.size() );
+    size_t numReplies = 0;
+    int msToWait = timeout_milliseconds;
+
+    if( msToWait == -1 ) {
+        // Use a sane default value
+        msToWait = 20000;
+    }
+
+    std::chrono::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( msToWait );
+
+    if( m_priv->m_dispatchingThread == std::this_thread::get_id() ) {
+        /*
+         * Nobody else is going to read the replies for us, so write everything
+         * out now and read until all of the replies have come in.  The calls
+         * go through the outgoing queue so that they are sent after anything
+         * that was already queued up.
+         */
+        std::map<uint32_t, size_t> expectedSerials;
 
-                    if( retmsg->reply_serial() == replySerialExpceted ) {
-                        gotReply = true;
+        for( size_t x = 0; x < messages.size(); x++ ) {
+            uint32_t serial = m_priv->next_serial();
+            expectedSerials[ serial ] = x;
+            m_priv->m_outgoingMessages.push( OutgoingMessage{ messages[ x ], serial } );
+        }
+
+        flush();
+
+        std::unique_lock<std::mutex> readLock = m_priv->lock_reading();
+        std::vector<int> fds;
+        fds.push_back( m_priv->m_transport->fd() );
+        std::vector<std::shared_ptr<Message>> incomingMessages;
+
+        while( numReplies < messages.size() ) {
+            incomingMessages.clear();
+            m_priv->m_transport->readMessages( &incomingMessages );
+
+            if( !incomingMessages.empty() ) {
+                std::unique_lock<std::mutex> lock( m_priv->m_incomingLock );
+
+                for( std::shared_ptr<Message>& incoming : incomingMessages ) {
+                    uint32_t replySerial = 0;
+
+                    if( incoming->type() == MessageType::RETURN ) {
+                        replySerial = std::static_pointer_cast<ReturnMessage>( incoming )->reply_serial();
+                    } else if( incoming->type() == MessageType::ERROR ) {
+                        replySerial = std::static_pointer_cast<ErrorMessage>( incoming )->reply_serial();
                     }
-                }
 
-                if( !gotReply ) {
-                    std::unique_lock<std::mutex> lock(
-                        m_priv->m_incomingLock);
+                    std::map<uint32_t, size_t>::iterator it = expectedSerials.find( replySerial );
+
+                    if( it != expectedSerials.end() && !replies[ it->second ] ) {
+                        replies[ it->second ] = incoming;
+                        numReplies++;
+                        continue;
+                    }
 
                     m_priv->m_incomingMessages.push( incoming );
                 }
+            }
 
+            if( numReplies == messages.size() ) {
+                break;
             }
-        } while( !gotReply );
 
-    } else {
-        /*
-         * We are trying to do a blocking method call in a thread that is not the dispatcher thread.
-         * Queue up the message and notify the dispatcher thread.
-         */
-        uint32_t serial;
-        std::shared_ptr<ExpectingResponse> ex;
+            if( !m_priv->m_transport->is_valid() ) {
+                throw ErrorDisconnected();
+            }
 
-        {
-            OutgoingMessage outgoing;
-            std::scoped_lock<std::mutex, std::mutex> lock( m_priv->m_outgoingLock, m_priv->m_expectingResponsesLock );
-            outgoing.msg = message;
-            outgoing.serial = m_priv->m_currentSerial++;
-            m_priv->m_outgoingMessages.push( outgoing );
-            serial = outgoing.serial;
+            int msLeft = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - std::chrono::steady_clock::now() ).count();
+
+            if( msLeft <= 0 ) {
+                throw ErrorNoReply( "Did not receive a response in the alotted time" );
+            }
 
-            // Add this to our expecting responses
-            ex = std::make_shared<ExpectingResponse>();
-            m_priv->m_expectingResponses[ serial ] = ex;
+            DBus::priv::wait_for_fd_activity( fds, msLeft );
         }
 
+        return replies;
+    }
+
+    /*
+     * Queue up all of the messages, and let the dispatcher thread hand
+     * us the replies as they come in.
+     */
+    std::vector<uint32_t> serials;
+    bool needsNotify = false;
+
+    for( const std::shared_ptr<const CallMessage>& message : messages ) {
+        uint32_t serial = m_priv->next_serial();
+
+        // Expect the reply before it can possibly come in
+        m_priv->m_replies.add( serial, std::shared_ptr<PendingCall>() );
+        serials.push_back( serial );
+
+        if( m_priv->m_outgoingMessages.push( OutgoingMessage{ message, serial } ) ) {
+            needsNotify = true;
+        }
+    }
+
+    if( needsNotify ) {
         notify_dispatcher_or_dispatch();
+    }
 
-        {
-            /*
-             * Lock on the expecting response; when the response comes in, we will notify from
-             * the dispatching thread
-             */
-            std::chrono::time_point now = std::chrono::steady_clock::now();
-            std::unique_lock<std::mutex> lock( ex->cv_lock );
-            bool status;
-            auto predicate = [this, serial] {
-                std::unique_lock<std::mutex> lock( m_priv->m_expectingResponsesLock );
-                std::map<uint32_t, std::shared_ptr<ExpectingResponse>>::iterator it =
-                    m_priv->m_expectingResponses.find( serial );
-
-                // return false if the waiting should be continued
-                return ( *it ).second->reply.get() != nullptr;
-            };
-            if ( disable_timeout ) {
-                ex->cv.wait( lock, predicate );
-                status = true;
-            }
-            else {
-                status = ex->cv.wait_until( lock, now + std::chrono::milliseconds( msToWait ), predicate );
+    bool timedOut = false;
+
+    // Once we have timed out, this only picks up the replies that are already in
+    for( size_t x = 0; x < serials.size(); x++ ) {
+        replies[ x ] = m_priv->m_replies.wait( serials[ x ], &deadline );
+
+        if( !replies[ x ] ) {
+            timedOut = true;
+        }
+    }
+
+    if( timedOut ) {
+        throw ErrorNoReply( "Did not receive a response in the alotted time" );
+    }
+
+    return replies;
+}
+
+bool Connection::read_for_reply( uint32_t serial, const std::chrono::steady_clock::time_point* deadline ) {
+    std::vector<int> fds;
+    fds.push_back( m_priv->m_transport->fd() );
+    std::vector<std::shared_ptr<Message>> incomingMessages;
+    std::vector<std::shared_ptr<Message>> handOff;
+
+    // If the dispatching thread has to read, it will hand us our reply instead
+    while( !m_priv->m_readLockWanted ) {
+        bool gotReply = false;
+        size_t numRead;
+
+        incomingMessages.clear();
+        handOff.clear();
+
+        do {
+            numRead = incomingMessages.size();
+            m_priv->m_transport->readMessages( &incomingMessages );
+        } while( incomingMessages.size() > numRead );
+
+        for( std::shared_ptr<Message>& incoming : incomingMessages ) {
+            if( !gotReply && reply_serial_of( incoming ) == serial ) {
+                std::shared_ptr<PendingCall> pending;
+                m_priv->m_replies.deliver( serial, incoming, &pending );
+                gotReply = true;
+                continue;
             }
-            std::shared_ptr<ExpectingResponse> resp;
 
+            handOff.push_back( std::move( incoming ) );
+        }
+
+        if( !handOff.empty() ) {
             {
-                /*
-                 * Now remove our expecting response to free up memory
-                 */
-                std::unique_lock<std::mutex> lock( m_priv->m_expectingResponsesLock );
-                std::map<uint32_t, std::shared_ptr<ExpectingResponse>>::iterator it =
-                        m_priv->m_expectingResponses.find( serial );
-                resp = ( *it ).second;
-
-                m_priv->m_expectingResponses.erase( it );
-            }
+                std::unique_lock<std::mutex> lock( m_priv->m_incomingLock );
 
-            if( !resp ) {
-                throw ErrorUnexpectedResponse();
+                for( std::shared_ptr<Message>& incoming : handOff ) {
+                    m_priv->m_handedOffMessages.push_back( std::move( incoming ) );
+                }
+
+                m_priv->m_hasHandedOffMessages.store( true, std::memory_order_release );
             }
 
-            if( status ) {
-                std::shared_ptr<Message> gotMessage = resp->reply;
-
-                if( gotMessage->type() == MessageType::RETURN ) {
-                    retmsg = std::static_pointer_cast<ReturnMessage>( gotMessage );
-                } else if( gotMessage->type() == MessageType::ERROR ) {
-                    std::shared_ptr<ErrorMessage> errmsg = std::static_pointer_cast<ErrorMessage>( gotMessage );
-                    errmsg->throw_error();
-                } else if( gotMessage->type() == MessageType::SIGNAL ) {
-                } else {
-                    throw ErrorUnknown( "Why are we here" );
-                }
-            } else {
-                throw ErrorNoReply( "Did not receive a response in the alotted time" );
+            m_priv->m_dispatchStatus = DispatchStatus::DATA_REMAINS;
+            m_priv->m_needsDispatching();
+        }
+
+        if( gotReply ) {
+            return true;
+        }
+
+        if( !m_priv->m_transport->is_valid() ) {
+            return false;
+        }
+
+        int msToWait = READ_FOR_REPLY_SLICE_MS;
+
+        if( deadline ) {
+            std::chrono::steady_clock::duration left = *deadline - std::chrono::steady_clock::now();
+
+            if( left <= std::chrono::steady_clock::duration::zero() ) {
+                return true;
             }
+
+            msToWait = std::min<int>( msToWait, std::chrono::ceil<std::chrono::milliseconds>( left ).count() );
         }
+
+        DBus::priv::wait_for_fd_activity( fds, msToWait );
     }
 
-    return retmsg;
+    return true;
+}
+
+std::shared_ptr<PendingCall> Connection::send_with_reply_async_impl( std::shared_ptr<const CallMessage> message,
+                                                                     PendingCall::CompletedSlot slot,
+                                                                     int timeout_milliseconds,
+                                                                     bool disable_timeout ) {
+    if( !this->is_valid() ) { throw ErrorDisconnected(); }
+
+    if( !message ) { return std::shared_ptr<PendingCall>(); }
+
+    int msToWait = timeout_milliseconds;
+
+    if( !disable_timeout && msToWait == -1 ) {
+        // Use a sane default value
+        msToWait = 20000;
+    }
+
+    uint32_t serial = m_priv->next_serial();
+    std::shared_ptr<PendingCall> pending = PendingCall::create( weak_from_this(), serial, slot );
+
+    // Expect the reply before it can possibly come in
+    m_priv->m_replies.add( serial, pending );
+
+    {
+        std::unique_lock<std::mutex> lock( m_priv->m_pendingCallDeadlinesLock );
+
+        if( disable_timeout ) {
+            m_priv->m_pendingCallDeadlineOf[ serial ] = m_priv->m_pendingCallDeadlines.end();
+        } else {
+            m_priv->m_pendingCallDeadlineOf[ serial ] = m_priv->m_pendingCallDeadlines.emplace(
+                std::chrono::steady_clock::now() + std::chrono::milliseconds( msToWait ), serial );
+        }
+    }
+
+    if( m_priv->m_outgoingMessages.push( OutgoingMessage{ message, serial } ) ||
+        std::this_thread::get_id() == m_priv->m_dispatchingThread ) {
+        // Don't dispatch from here even on the dispatching thread: the caller
+        // may be the slot of another call, and we would recurse for every
+        // reply that is waiting to be processed
+        m_priv->m_dispatchStatus = DispatchStatus::DATA_REMAINS;
+        m_priv->m_needsDispatching();
+    }
+
+    return pending;
+}
+
+std::shared_ptr<PendingCall> Connection::send_with_reply_async( std::shared_ptr<const CallMessage> message,
+                                                                PendingCall::CompletedSlot slot,
+                                                                int timeout_milliseconds ) {
+    return this->send_with_reply_async_impl( std::move( message ), slot, timeout_milliseconds, false );
+}
+
+std::shared_ptr<PendingCall> Connection::send_with_reply_async_notimeout( std::shared_ptr<const CallMessage> message,
+                                                                          PendingCall::CompletedSlot slot ) {
+    return this->send_with_reply_async_impl( std::move( message ), slot, -1, true );
+}
+
+int Connection::milliseconds_until_timeout() const {
+    std::unique_lock<std::mutex> lock( m_priv->m_pendingCallDeadlinesLock );
+
+    if( m_priv->m_pendingCallDeadlines.empty() ) {
+        return -1;
+    }
+
+    std::chrono::steady_clock::duration left =
+        m_priv->m_pendingCallDeadlines.begin()->first - std::chrono::steady_clock::now();
+
+    if( left <= std::chrono::steady_clock::duration::zero() ) {
+        return 0;
+    }
+
+    // Round up, so that we don't wake up just before the deadline
+    return std::chrono::ceil<std::chrono::milliseconds>( left ).count();
+}
+
+void Connection::remove_pending_call( uint32_t serial ) {
+    if( m_priv->m_replies.remove( serial ) ) {
+        forget_pending_call_deadline( serial );
+    }
+}
+
+void Connection::forget_pending_call_deadline( uint32_t serial ) {
+    std::unique_lock<std::mutex> lock( m_priv->m_pendingCallDeadlinesLock );
+    std::map<uint32_t, PendingCallDeadlines::iterator>::iterator it =
+        m_priv->m_pendingCallDeadlineOf.find( serial );
+
+    if( it == m_priv->m_pendingCallDeadlineOf.end() ) {
+        return;
+    }
+
+    if( it->second != m_priv->m_pendingCallDeadlines.end() ) {
+        m_priv->m_pendingCallDeadlines.erase( it->second );
+    }
+
+    m_priv->m_pendingCallDeadlineOf.erase( it );
+}
+
+void Connection::expire_pending_calls() {
+    std::vector<uint32_t> expiredSerials;
+    std::vector<std::shared_ptr<PendingCall>> expired;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    {
+        std::unique_lock<std::mutex> lock( m_priv->m_pendingCallDeadlinesLock );
+
+        while( !m_priv->m_pendingCallDeadlines.empty() &&
+            m_priv->m_pendingCallDeadlines.begin()->first <= now ) {
+            uint32_t serial = m_priv->m_pendingCallDeadlines.begin()->second;
+
+            m_priv->m_pendingCallDeadlines.erase( m_priv->m_pendingCallDeadlines.begin() );
+            m_priv->m_pendingCallDeadlineOf.erase( serial );
+            expiredSerials.push_back( serial );
+        }
+    }
+
+    for( uint32_t serial : expiredSerials ) {
+        // If the reply made it in after all, it has already been delivered
+        std::shared_ptr<PendingCall> pending = m_priv->m_replies.remove( serial );
+
+        if( pending ) {
+            expired.push_back( pending );
+        }
+    }
+
+    for( std::shared_ptr<PendingCall>& pending : expired ) {
+        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Call with serial " << pending->serial() << " timed out" );
+
+        std::shared_ptr<ErrorMessage> errmsg = ErrorMessage::create();
+        errmsg->set_name( DBUSCXX_ERROR_NO_REPLY );
+        errmsg->set_message( "Did not receive a response in the alotted time" );
+        errmsg->set_reply_serial( pending->serial() );
+        pending->complete( errmsg );
+    }
+}
+
+void Connection::fail_pending_calls() {
+    std::vector<uint32_t> serials;
+    std::vector<std::shared_ptr<PendingCall>> failed;
+
+    {
+        std::unique_lock<std::mutex> lock( m_priv->m_pendingCallDeadlinesLock );
+
+        for( const std::pair<const uint32_t, PendingCallDeadlines::iterator>& entry : m_priv->m_pendingCallDeadlineOf ) {
+            serials.push_back( entry.first );
+        }
+
+        m_priv->m_pendingCallDeadlines.clear();
+        m_priv->m_pendingCallDeadlineOf.clear();
+    }
+
+    for( uint32_t serial : serials ) {
+        std::shared_ptr<PendingCall> pending = m_priv->m_replies.remove( serial );
+
+        if( pending ) {
+            failed.push_back( pending );
+        }
+    }
+
+    for( std::shared_ptr<PendingCall>& pending : failed ) {
+        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Call with serial " << pending->serial() << " failed: disconnected" );
+
+        std::shared_ptr<ErrorMessage> errmsg = ErrorMessage::create();
+        errmsg->set_name( DBUSCXX_ERROR_DISCONNECTED );
+        errmsg->set_message( "Connection was closed before the reply came in" );
+        errmsg->set_reply_serial( pending->serial() );
+        pending->complete( errmsg );
+    }
 }
 
 std::shared_ptr<ReturnMessage> Connection::send_with_reply_blocking( std::shared_ptr<const CallMessage> message, int timeout_milliseconds ) {
@@ -587,22 +1230,80 @@ std::shared_ptr<ReturnMessage> Connection::send_with_reply_blocking_notimeout( s
 void Connection::flush() {
     if( !this->is_valid() ) { return; }
 
-    {
+    write_queued_messages();
+
+    // Wait for anything that the bus would not take yet, without
+    // keeping anybody else from writing while we wait
+    while( this->is_valid() && m_priv->m_transport->pendingBytes() > 0 ) {
+        DBus::priv::wait_for_fd_writable( m_priv->m_transport->fd(), -1 );
+
         std::unique_lock lock( m_priv->m_outgoingLock );
+        m_priv->m_transport->writePending();
+
+        if( update_outgoing_congestion() ) {
+            bool congested = m_priv->m_outgoingCongested;
+            lock.unlock();
+            m_priv->m_outgoingCongestion.emit( congested );
+        }
+    }
+}
+
+void Connection::write_queued_messages() {
+    std::unique_lock lock( m_priv->m_outgoingLock );
 
-        while( !m_priv->m_outgoingMessages.empty() ) {
-            OutgoingMessage outgoing = m_priv->m_outgoingMessages.front();
-            m_priv->m_outgoingMessages.pop();
+    OutgoingMessage outgoing;
+
+    // Hand everything that is queued to the transport at once, so that
+    // it can coalesce the messages into as few writes as possible
+    while( m_priv->m_outgoingMessages.pop( &outgoing ) ) {
+        m_priv->m_outgoingBatch.push_back( std::move( outgoing ) );
+    }
 
-            m_priv->m_transport->writeMessage( outgoing.msg, outgoing.serial );
+    if( !m_priv->m_outgoingBatch.empty() ) {
+        m_priv->m_transport->writeMessages( m_priv->m_outgoingBatch );
+        m_priv->m_outgoingBatch.clear();
+    } else if( m_priv->m_transport->pendingBytes() > 0 ) {
+        m_priv->m_transport->writePending();
+    }
+
+    if( !m_priv->m_nonblockingWrites ) {
+        while( m_priv->m_transport->is_valid() &&
+            m_priv->m_transport->pendingBytes() > 0 ) {
+            DBus::priv::wait_for_fd_writable( m_priv->m_transport->fd(), -1 );
+            m_priv->m_transport->writePending();
         }
     }
+
+    // Slots may well send something, which needs the lock
+    if( update_outgoing_congestion() ) {
+        bool congested = m_priv->m_outgoingCongested;
+        lock.unlock();
+        m_priv->m_outgoingCongestion.emit( congested );
+    }
+}
+
+bool Connection::update_outgoing_congestion() {
+    size_t pending = m_priv->m_transport->pendingBytes();
+    bool congested = m_priv->m_outgoingCongested;
+
+    if( !congested && pending >= m_priv->m_outgoingHighWatermark ) {
+        congested = true;
+    } else if( congested && pending <= m_priv->m_outgoingLowWatermark ) {
+        congested = false;
+    } else {
+        return false;
+    }
+
+    SIMPLELOGGER_DEBUG( LOGGER_NAME, "Outgoing congestion: " << congested << "(" << pending << " bytes pending)" );
+    m_priv->m_outgoingCongested = congested;
+
+    return true;
 }
 
 uint32_t Connection::write_single_message( std::shared_ptr<const Message> msg ) {
-    uint32_t retval = m_priv->m_currentSerial;
-    m_priv->m_transport->writeMessage( msg, m_priv->m_currentSerial++ );
-    return retval;
+    uint32_t serial = m_priv->next_serial();
+    m_priv->m_transport->writeMessage( msg, serial );
+    return serial;
 }
 
 DispatchStatus Connection::dispatch_status( ) const {
@@ -612,42 +1313,97 @@ DispatchStatus Connection::dispatch_status( ) const {
 }
 
 DispatchStatus Connection::dispatch( ) {
+    return dispatch( 1 ).status;
+}
+
+DispatchResult Connection::dispatch( uint32_t budget ) {
+    DispatchResult result{ DispatchStatus::COMPLETE, 0, 0 };
+    // Set if the budget stopped us from reading everything the transport had
+    bool readCutShort = false;
+
     if( std::this_thread::get_id() != m_priv->m_dispatchingThread ) {
         throw ErrorIncorrectDispatchThread( "Calling Connection::dispatch from non-dispatching thread" );
     }
 
     if( !this->is_valid() ) {
+        fail_pending_calls();
         m_priv->m_dispatchStatus = DispatchStatus::COMPLETE;
-        return DispatchStatus::COMPLETE;
+        return result;
     }
 
+    expire_pending_calls();
+
     // Write out any messages we have waiting to be written
-    flush();
+    if( !m_priv->m_outgoingMessages.empty() ||
+        m_priv->m_transport->pendingBytes() > 0 ) {
+        write_queued_messages();
+    }
 
-    // Try to read a message
-    {
-        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Try to read a message" );
-        std::shared_ptr<Message> incoming = m_priv->m_transport->readMessage();
+    // Once we don't have enough to use up our budget, read all of the
+    // messages that are available.  Some transports only hand over what
+    // came in with one read, so keep going while there is more.
+    if( m_priv->m_incomingMessages.size() < budget ) {
+        // If a blocking caller is reading for itself, it hands us
+        // everything else that it reads instead
+        std::unique_lock<std::mutex> readLock( m_priv->m_readLock, std::try_to_lock );
+        size_t numRead;
+
+        m_priv->take_handed_off_messages();
 
-        if( incoming ) {
+        if( readLock.owns_lock() ) {
+            SIMPLELOGGER_DEBUG( LOGGER_NAME, "Try to read messages" );
+
+            do {
+                numRead = m_priv->m_incomingBatch.size();
+                m_priv->m_transport->readMessages( &m_priv->m_incomingBatch );
+            } while( m_priv->m_incomingBatch.size() > numRead &&
+                m_priv->m_incomingMessages.size() + m_priv->m_incomingBatch.size() < budget );
+
+            readCutShort = m_priv->m_incomingBatch.size() > numRead;
+        }
+
+        if( !m_priv->m_incomingBatch.empty() ) {
             std::unique_lock<std::mutex> lock(
                 m_priv->m_incomingLock);
 
-            m_priv->m_incomingMessages.push( incoming );
+            for( std::shared_ptr<Message>& incoming : m_priv->m_incomingBatch ) {
+                m_priv->m_incomingMessages.push( std::move( incoming ) );
+            }
         }
+
+        m_priv->m_incomingBatch.clear();
+    } else {
+        readCutShort = true;
     }
 
     // Process any messages that we need to
-    process_single_message();
+    while( result.processed < budget &&
+        !m_priv->m_incomingMessages.empty() ) {
+        process_single_message();
+        result.processed++;
+    }
+
+    // Once everything that came in before the connection dropped is
+    // processed, no more replies are coming
+    if( m_priv->m_incomingMessages.empty() &&
+        !this->is_valid() ) {
+        fail_pending_calls();
+    }
 
+    // The transport may well have more for us if we stopped reading early,
+    // and it won't tell us about it again
     if( m_priv->m_outgoingMessages.empty() &&
-        m_priv->m_incomingMessages.empty() ) {
+        m_priv->m_incomingMessages.empty() &&
+        !readCutShort ) {
         m_priv->m_dispatchStatus = DispatchStatus::COMPLETE;
     } else {
         m_priv->m_dispatchStatus = DispatchStatus::DATA_REMAINS;
     }
 
-    return m_priv->m_dispatchStatus;
+    result.status = m_priv->m_dispatchStatus;
+    result.remaining = m_priv->m_incomingMessages.size();
+
+    return result;
 }
 
 void Connection::process_single_message() {
@@ -668,15 +1424,16 @@ void Connection::process_single_message() {
             reply_serial = std::static_pointer_cast<ErrorMessage>( msgToProcess )->reply_serial();
         }
 
-        {
-            std::unique_lock<std::mutex> lock( m_priv->m_expectingResponsesLock );
-            if( m_priv->m_expectingResponses.find( reply_serial ) != m_priv->m_expectingResponses.end() ) {
-                // This is a response to something that a different thread is waiting for.
-                // Update the data and notify the thread!
-                m_priv->m_expectingResponses[ reply_serial ]->reply = msgToProcess;
-                m_priv->m_expectingResponses[ reply_serial ]->cv.notify_one();
-                return;
+        std::shared_ptr<PendingCall> pending;
+
+        // A different thread may be waiting for this; if so, it gets woken up
+        if( m_priv->m_replies.deliver( reply_serial, msgToProcess, &pending ) ) {
+            if( pending ) {
+                forget_pending_call_deadline( reply_serial );
+                pending->complete( msgToProcess );
             }
+
+            return;
         }
     }
 
@@ -896,7 +1653,33 @@ int Connection::socket() const {
 bool Connection::has_messages_to_send() {
     if( !this->is_valid() ) { return false; }
 
-    return !m_priv->m_outgoingMessages.empty();
+    return !m_priv->m_outgoingMessages.empty() ||
+        m_priv->m_transport->pendingBytes() > 0;
+}
+
+void Connection::set_nonblocking_writes( bool nonblocking ) {
+    m_priv->m_nonblockingWrites = nonblocking;
+}
+
+void Connection::set_leader_follower_reads( bool enabled ) {
+    m_priv->m_leaderFollowerReads = enabled;
+}
+
+void Connection::set_outgoing_watermarks( size_t high, size_t low ) {
+    if( low > high ) {
+        low = high;
+    }
+
+    m_priv->m_outgoingHighWatermark = high;
+    m_priv->m_outgoingLowWatermark = low;
+}
+
+bool Connection::is_outgoing_congested() const {
+    return m_priv->m_outgoingCongested;
+}
+
+sigc::signal<void(bool)>& Connection::signal_outgoing_congestion() {
+    return m_priv->m_outgoingCongestion;
 }
 
 sigc::signal< void() >& Connection::signal_needs_dispatch() {
@@ -1206,7 +1989,12 @@ void Connection::notify_dispatcher_or_dispatch() {
     m_priv->m_dispatchStatus = DispatchStatus::DATA_REMAINS;
 
     if( std::this_thread::get_id() == m_priv->m_dispatchingThread ) {
-        dispatch();
+        // Only write: we may be in the middle of processing a message, and
+        // processing the next one from here would recurse for each message
+        // that is waiting
+        if( this->is_valid() ) {
+            write_queued_messages();
+        }
     } else {
         m_priv->m_needsDispatching();
     }
@@ -8,10 +8,12 @@
  *   This file is part of the dbus-cxx library.                            *
  ***************************************************************************/
 #include <stdint.h>
+#include <chrono>
 #include <dbus-cxx/signal.h>
 #include <dbus-cxx/signalproxy.h>
 #include <dbus-cxx/threaddispatcher.h>
 #include <dbus-cxx/errormessage.h>
+#include <dbus-cxx/pendingcall.h>
 #include <dbus-cxx/dbus-cxx-config.h>
 #include <deque>
 #include <map>
@@ -58,11 +60,24 @@ class Watch;
 class ThreadDispatcher;
 class ErrorMessage;
 class DBusDaemonProxy;
+class Server;
 
 namespace priv {
 class Transport;
 }
 
+/**
+ * What a call to Connection::dispatch( budget ) did.
+ */
+struct DispatchResult {
+    /** COMPLETE if there is nothing left to do */
+    DispatchStatus status;
+    /** How many messages were processed */
+    uint32_t processed;
+    /** How many messages have been read, but not processed yet */
+    size_t remaining;
+};
+
 /**
  * Connection point to the DBus
  *
@@ -77,6 +92,16 @@ private:
 
     Connection( std::string address );
 
+    Connection( std::shared_ptr<priv::Transport> transport );
+
+    /**
+     * Create a connection to a peer over an already authenticated transport.
+     */
+    static std::shared_ptr<Connection> create_for_peer( std::shared_ptr<priv::Transport> transport );
+
+    friend class Server;
+    friend class PendingCall;
+
 public:
     /**
      * Connects to a bus daemon.  The returned Connection will have authenticated
@@ -99,6 +124,18 @@ public:
      */
     static std::shared_ptr<Connection> create( std::string address );
 
+    /**
+     * Create a new connection directly to a peer that is listening with a
+     * Server at the specified address, instead of to a bus.  There is no
+     * bus to register with, so this connection does not have a unique name
+     * and can't request names.
+     *
+     * @param address The address of the server, in DBus transport format
+     * (e.g. unix:path=/tmp/dbus-test)
+     * @return
+     */
+    static std::shared_ptr<Connection> create_peer( std::string address );
+
     ~Connection();
 
     /** True if this is a valid connection; false otherwise */
@@ -110,12 +147,34 @@ public:
     /** True if this connection is already registered */
     bool is_registered() const;
 
+    /** True if this connection is directly to a peer, instead of to a bus */
+    bool is_peer_to_peer() const;
+
     /**
      * Registers this connection with the bus.  It is safe to call this
      * method multiple times.
      */
     bool bus_register();
 
+    /**
+     * Registers this connection with the bus, and requests the given names
+     * at the same time.  Any match rules that have been added before
+     * registering are added to the bus as well.
+     *
+     * Instead of waiting for a reply to each request before sending the next
+     * one, everything is sent at once and then all of the replies are
+     * collected.  This is a lot faster than calling bus_register(),
+     * request_name() and add_match() one after the other, especially
+     * when starting up while the bus is busy.
+     *
+     * If this connection is already registered, the names are simply requested.
+     *
+     * @param names The names to request, e.g. "com.example.foo"
+     * @param flags Any flags for the names; see DBUSCXX_NAME_FLAG_XXX macros
+     * @return The response to each name request, in the same order as the names
+     */
+    std::vector<RequestNameResponse> bus_register( const std::vector<std::string>& names, unsigned int flags = 0 );
+
     /** Gets the unique name of the connection as assigned by the message bus. */
     std::string unique_name() const;
 
@@ -205,10 +264,47 @@ public:
      */
     std::shared_ptr<ReturnMessage> send_with_reply_blocking_notimeout( std::shared_ptr<const CallMessage> msg );
 
+    /**
+     * Send a CallMessage without waiting for the reply.  Any number of calls
+     * may be outstanding at once; the replies are matched up to their calls
+     * as they are read by the dispatcher.
+     *
+     * When the reply comes in, the slot is called from the dispatching thread
+     * with either the ReturnMessage or the ErrorMessage.  If no reply comes in
+     * before the timeout, the slot is called with an ErrorMessage named
+     * DBUSCXX_ERROR_NO_REPLY.  Timeouts are only noticed when the connection is
+     * dispatched; see milliseconds_until_timeout().
+     *
+     * @param msg The message to send
+     * @param slot Called with the reply
+     * @param timeout_milliseconds How long to wait for. If -1, a "sane default value" is used.
+     * @return The pending call, which may be used to cancel the call
+     */
+    std::shared_ptr<PendingCall> send_with_reply_async( std::shared_ptr<const CallMessage> msg,
+                                                        PendingCall::CompletedSlot slot,
+                                                        int timeout_milliseconds = -1 );
+
+    /**
+     * A timeout-less version of @ref send_with_reply_async().
+     */
+    std::shared_ptr<PendingCall> send_with_reply_async_notimeout( std::shared_ptr<const CallMessage> msg,
+                                                                  PendingCall::CompletedSlot slot );
+
+    /**
+     * How long until the next call sent with send_with_reply_async() times out.
+     * Dispatchers should dispatch this connection by then, even if nothing
+     * has been read.
+     *
+     * @return The number of milliseconds, or -1 if there is nothing that can time out
+     */
+    int milliseconds_until_timeout() const;
+
     /**
      * Flushes all data out to the bus.  This should generally
      * be called from the dispatching thread, but it should be
      * able to be called from any thread.
+     *
+     * This blocks until everything that has been sent has been written out.
      */
     void flush();
 
@@ -230,12 +326,90 @@ public:
      */
     DispatchStatus dispatch( );
 
+    /**
+     * Dispatch the connection, processing up to budget messages.  Everything
+     * that has been read is queued up at once, so this is cheaper than calling
+     * dispatch() budget times.  Like dispatch(), this can only be called from
+     * the dispatching thread.
+     *
+     * @param budget The most messages to process
+     * @return The status of dispatching, and how many messages were
+     * processed and are left over.  The status is DispatchStatus::DATA_REMAINS
+     * if the budget stopped us from reading everything, so call this again
+     * until it is DispatchStatus::COMPLETE.
+     */
+    DispatchResult dispatch( uint32_t budget );
+
     int unix_fd() const;
 
     int socket() const;
 
+    /**
+     * @return True if there are messages waiting to be written, or if
+     * there is data that could not be written yet because the bus is not
+     * reading fast enough.
+     */
     bool has_messages_to_send();
 
+    /**
+     * Set if dispatch() should only write what the bus will take without
+     * blocking.  Whatever can't be written stays buffered, and is written
+     * on the next dispatch().
+     *
+     * This should only be turned on by dispatchers that wait for socket()
+     * to become writable whenever has_messages_to_send() returns true,
+     * otherwise the buffered data may not be written until something else
+     * causes a dispatch.  By default, dispatch() blocks until everything
+     * has been written.
+     *
+     * @param nonblocking True to write without blocking.
+     */
+    void set_nonblocking_writes( bool nonblocking );
+
+    /**
+     * Set if a thread that makes a blocking call may send it and read the
+     * reply itself, instead of waiting for the dispatching thread to do so.
+     *
+     * This is only done when the dispatching thread is not reading at the
+     * time, and saves waking it up twice for each call.  Anything else that
+     * the calling thread reads is handed over to the dispatching thread,
+     * and handled there as usual.  This is off by default.
+     *
+     * @param enabled True to let blocking callers read for themselves.
+     */
+    void set_leader_follower_reads( bool enabled );
+
+    /**
+     * Set the watermarks for outgoing data.  Once the amount of data
+     * that has been buffered but not written reaches the high watermark,
+     * the connection is congested until the amount drops back down to the
+     * low watermark.
+     *
+     * Data only builds up when writes do not block; see set_nonblocking_writes().
+     *
+     * @param high The high watermark, in bytes
+     * @param low The low watermark, in bytes.  Must not be more than high.
+     */
+    void set_outgoing_watermarks( size_t high, size_t low );
+
+    /**
+     * @return True if the outgoing data is above the high watermark, and
+     * has not yet dropped back down to the low watermark.
+     */
+    bool is_outgoing_congested() const;
+
+    /**
+     * This signal is emitted with true when the connection becomes congested,
+     * and with false once it is no longer congested.  Producers of large
+     * amounts of data can use this to stop sending until the bus catches up.
+     *
+     * This is emitted from the thread that writes the data: normally the
+     * dispatching thread, but it may also be a thread that calls flush() or
+     * makes a blocking call.  No locks are held while it is emitted, so
+     * slots may send messages.
+     */
+    sigc::signal<void(bool)>& signal_outgoing_congestion();
+
     /**
      * This signal is emitted whenever we need to be dispatched.
      *
@@ -421,12 +595,81 @@ private:
      */
     uint32_t write_single_message( std::shared_ptr<const Message> msg );
 
+    /**
+     * Hand everything that is queued to the transport, and write out as
+     * much as we can.  Only blocks if nonblocking writes are not turned on.
+     */
+    void write_queued_messages();
+
+    /**
+     * Check the amount of outgoing data against our watermarks.  This must
+     * be called with a lock on m_outgoingLock; if it returns true, the
+     * caller must emit signal_outgoing_congestion() once it has let go of
+     * the lock.
+     *
+     * @return True if the connection became congested or uncongested
+     */
+    bool update_outgoing_congestion();
+
     void process_single_message();
 
     void remove_invalid_threaddispatchers_and_associated_objects();
 
     std::shared_ptr<ReturnMessage> send_with_reply_blocking_impl( std::shared_ptr<const CallMessage> msg, int timeout_milliseconds, bool disable_timeout );
 
+    std::shared_ptr<PendingCall> send_with_reply_async_impl( std::shared_ptr<const CallMessage> msg,
+                                                             PendingCall::CompletedSlot slot,
+                                                             int timeout_milliseconds,
+                                                             bool disable_timeout );
+
+    /**
+     * Stop waiting for the reply to a call sent with send_with_reply_async().
+     */
+    void remove_pending_call( uint32_t serial );
+
+    /**
+     * Stop timing out a call sent with send_with_reply_async(), because
+     * it is no longer pending.
+     */
+    void forget_pending_call_deadline( uint32_t serial );
+
+    /**
+     * Read from the transport until the reply to serial is in the reply
+     * table, handing everything else to the dispatching thread.  The
+     * caller must hold the read lock.
+     *
+     * Gives up at the deadline, or once the dispatching thread wants to
+     * read; either way the reply table has the reply if it came in.
+     *
+     * @return False if we were disconnected
+     */
+    bool read_for_reply( uint32_t serial, const std::chrono::steady_clock::time_point* deadline );
+
+    /**
+     * Complete every call sent with send_with_reply_async() whose
+     * timeout has passed with a DBUSCXX_ERROR_NO_REPLY error.
+     */
+    void expire_pending_calls();
+
+    /**
+     * Complete every call sent with send_with_reply_async() that is still
+     * pending with a DBUSCXX_ERROR_DISCONNECTED error, as the replies are
+     * never going to come in.
+     */
+    void fail_pending_calls();
+
+    /**
+     * Send all of the given messages without waiting for any replies in
+     * between, then wait for all of the replies.
+     *
+     * @param messages The messages to send, in order
+     * @param timeout_milliseconds How long to wait for all of the replies; -1 for the default
+     * @return The reply to each message; either a ReturnMessage or an ErrorMessage
+     */
+    std::vector<std::shared_ptr<Message>> send_with_replies_blocking( const std::vector<std::shared_ptr<const CallMessage>>& messages, int timeout_milliseconds );
+
+    static RequestNameResponse request_name_response( uint32_t retval );
+
     /**
      * Send an error back to the calling application based on HandlerResult.  No-op if the
      * result indicates that there is no error.
@@ -0,0 +1,210 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ ***************************************************************************/
+#include "connectiongroup.h"
+
+#include "callmessage.h"
+#include "connection.h"
+#include "dbus-cxx-private.h"
+#include "error.h"
+#include "objectproxy.h"
+#include "returnmessage.h"
+#include "signalmessage.h"
+#include "signalproxy.h"
+#include "standalonedispatcher.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+
+using DBus::ConnectionGroup;
+
+static const char* LOGGER_NAME = "DBus.ConnectionGroup";
+
+struct Shard {
+    std::shared_ptr<DBus::StandaloneDispatcher> dispatcher;
+    std::shared_ptr<DBus::Connection> connection;
+};
+
+class ConnectionGroup::priv_data {
+public:
+    priv_data() :
+        m_nextShard( 0 )
+    {}
+
+    std::vector<Shard> m_shards;
+    std::atomic<size_t> m_nextShard;
+    std::mutex m_signalLock;
+    /* Which shard each free signal proxy was added to */
+    std::map<std::shared_ptr<SignalProxyBase>, size_t> m_signalShards;
+    std::vector<size_t> m_signalsPerShard;
+};
+
+ConnectionGroup::ConnectionGroup() :
+    m_priv( std::make_unique<priv_data>() ) {
+}
+
+ConnectionGroup::~ConnectionGroup() {
+    // Stop all of the threads before the connections go away
+    for( Shard& shard : m_priv->m_shards ) {
+        shard.dispatcher->stop();
+    }
+}
+
+std::shared_ptr<ConnectionGroup> ConnectionGroup::create( BusType type, size_t num_connections ) {
+    std::shared_ptr<ConnectionGroup> group( new ConnectionGroup() );
+
+    if( num_connections == 0 ) {
+        throw ErrorInvalidArgs( "A ConnectionGroup needs at least one connection" );
+    }
+
+    for( size_t x = 0; x < num_connections; x++ ) {
+        group->open( Connection::create( type ) );
+    }
+
+    return group;
+}
+
+std::shared_ptr<ConnectionGroup> ConnectionGroup::create( std::string address, size_t num_connections ) {
+    std::shared_ptr<ConnectionGroup> group( new ConnectionGroup() );
+
+    if( num_connections == 0 ) {
+        throw ErrorInvalidArgs( "A ConnectionGroup needs at least one connection" );
+    }
+
+    for( size_t x = 0; x < num_connections; x++ ) {
+        group->open( Connection::create( address ) );
+    }
+
+    return group;
+}
+
+void ConnectionGroup::open( std::shared_ptr<Connection> conn ) {
+    Shard shard;
+
+    shard.dispatcher = StandaloneDispatcher::create();
+    shard.connection = conn;
+
+    if( conn->is_valid() ) {
+        conn->bus_register();
+        shard.dispatcher->add_connection( conn );
+    } else {
+        SIMPLELOGGER_ERROR( LOGGER_NAME, "Unable to open connection "
+            << m_priv->m_shards.size() << " of the group" );
+    }
+
+    m_priv->m_shards.push_back( shard );
+    m_priv->m_signalsPerShard.push_back( 0 );
+}
+
+bool ConnectionGroup::is_valid() const {
+    for( const Shard& shard : m_priv->m_shards ) {
+        if( !shard.connection->is_valid() ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+size_t ConnectionGroup::size() const {
+    return m_priv->m_shards.size();
+}
+
+std::shared_ptr<DBus::Connection> ConnectionGroup::connection( size_t index ) const {
+    return m_priv->m_shards.at( index ).connection;
+}
+
+std::vector<std::shared_ptr<DBus::Connection>> ConnectionGroup::connections() const {
+    std::vector<std::shared_ptr<Connection>> retval;
+
+    for( const Shard& shard : m_priv->m_shards ) {
+        retval.push_back( shard.connection );
+    }
+
+    return retval;
+}
+
+std::shared_ptr<DBus::Connection> ConnectionGroup::next_connection() {
+    size_t index = m_priv->m_nextShard++;
+
+    return m_priv->m_shards[ index % m_priv->m_shards.size() ].connection;
+}
+
+std::shared_ptr<DBus::Connection> ConnectionGroup::connection_for( const std::string& destination, const std::string& path ) const {
+    size_t hash = std::hash<std::string>()( destination ) ^ ( std::hash<std::string>()( path ) << 1 );
+
+    return m_priv->m_shards[ hash % m_priv->m_shards.size() ].connection;
+}
+
+std::shared_ptr<DBus::ObjectProxy> ConnectionGroup::create_object_proxy( const std::string& destination,
+                                                                          const std::string& path,
+                                                                          ThreadForCalling calling ) {
+    return connection_for( destination, path )->create_object_proxy( destination, path, calling );
+}
+
+uint32_t ConnectionGroup::send( std::shared_ptr<const Message> msg ) {
+    if( !msg ) { return 0; }
+
+    std::string path;
+
+    if( msg->type() == MessageType::CALL ) {
+        path = std::static_pointer_cast<const CallMessage>( msg )->path();
+    } else if( msg->type() == MessageType::SIGNAL ) {
+        path = std::static_pointer_cast<const SignalMessage>( msg )->path();
+    }
+
+    return connection_for( msg->destination(), path )->send( msg );
+}
+
+std::shared_ptr<DBus::ReturnMessage> ConnectionGroup::send_with_reply_blocking( std::shared_ptr<const CallMessage> msg, int timeout_milliseconds ) {
+    if( !msg ) { return std::shared_ptr<ReturnMessage>(); }
+
+    return connection_for( msg->destination(), msg->path() )->send_with_reply_blocking( msg, timeout_milliseconds );
+}
+
+std::shared_ptr<DBus::SignalProxyBase> ConnectionGroup::add_free_signal_proxy( std::shared_ptr<SignalProxyBase> signal,
+                                                                                ThreadForCalling calling ) {
+    size_t shard;
+
+    if( !signal ) { return signal; }
+
+    {
+        std::unique_lock<std::mutex> lock( m_priv->m_signalLock );
+
+        shard = std::min_element( m_priv->m_signalsPerShard.begin(), m_priv->m_signalsPerShard.end() )
+            - m_priv->m_signalsPerShard.begin();
+        m_priv->m_signalsPerShard[ shard ]++;
+        m_priv->m_signalShards[ signal ] = shard;
+    }
+
+    SIMPLELOGGER_DEBUG( LOGGER_NAME, "Adding signal proxy to connection " << shard );
+
+    return m_priv->m_shards[ shard ].connection->add_free_signal_proxy( signal, calling );
+}
+
+bool ConnectionGroup::remove_free_signal_proxy( std::shared_ptr<SignalProxyBase> proxy ) {
+    size_t shard;
+
+    {
+        std::unique_lock<std::mutex> lock( m_priv->m_signalLock );
+        std::map<std::shared_ptr<SignalProxyBase>, size_t>::iterator it =
+            m_priv->m_signalShards.find( proxy );
+
+        if( it == m_priv->m_signalShards.end() ) {
+            return false;
+        }
+
+        shard = it->second;
+        m_priv->m_signalsPerShard[ shard ]--;
+        m_priv->m_signalShards.erase( it );
+    }
+
+    return m_priv->m_shards[ shard ].connection->remove_free_signal_proxy( proxy );
+}
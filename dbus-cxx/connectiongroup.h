@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ ***************************************************************************/
+#ifndef DBUSCXX_CONNECTIONGROUP_H
+#define DBUSCXX_CONNECTIONGROUP_H
+
+#include <dbus-cxx/dbus-cxx-config.h>
+#include <dbus-cxx/connection.h>
+#include <dbus-cxx/enums.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace DBus {
+
+class CallMessage;
+class ObjectProxy;
+class ReturnMessage;
+class SignalProxyBase;
+
+/**
+ * A ConnectionGroup opens several connections to the same bus, each one with
+ * its own StandaloneDispatcher(and therefore its own thread), and spreads
+ * traffic across them.  This is useful when a single connection can't keep
+ * up; every Connection only has one socket and one thread doing all of the
+ * reading and writing.
+ *
+ * Each connection in the group is called a shard.  Messages to the same
+ * destination and path always go out over the same shard, so the order of
+ * method calls to any one object is the same as if only one connection was
+ * used.  Calls to different objects are spread across all of the shards.
+ * Free signal proxies are added to whichever shard has the fewest.
+ *
+ * Every shard has its own unique name on the bus.  Bus names and exported
+ * objects should be put on a single shard, normally connection( 0 ).
+ *
+ * @ingroup core
+ */
+class ConnectionGroup {
+private:
+    ConnectionGroup();
+
+public:
+    /**
+     * Create a group of connections to the given bus.
+     *
+     * @param type The bus to connect to
+     * @param num_connections How many connections to open; must be at least 1
+     */
+    static std::shared_ptr<ConnectionGroup> create( BusType type, size_t num_connections );
+
+    /**
+     * Create a group of connections to the bus at the given address.
+     *
+     * @param address The address of the bus
+     * @param num_connections How many connections to open; must be at least 1
+     */
+    static std::shared_ptr<ConnectionGroup> create( std::string address, size_t num_connections );
+
+    ~ConnectionGroup();
+
+    /** True if all of the connections in the group are valid */
+    bool is_valid() const;
+
+    /** The number of connections in this group */
+    size_t size() const;
+
+    /**
+     * Get the connection at the given index.
+     *
+     * @throws std::out_of_range if there is no connection at index
+     */
+    std::shared_ptr<Connection> connection( size_t index ) const;
+
+    /** All of the connections in this group */
+    std::vector<std::shared_ptr<Connection>> connections() const;
+
+    /**
+     * Get the connections in the group one after another.  This is useful
+     * for messages that don't care what order they go out in.
+     */
+    std::shared_ptr<Connection> next_connection();
+
+    /**
+     * Get the connection that all messages to the given destination and
+     * path go out on.  This is always the same connection for the same
+     * destination and path.
+     */
+    std::shared_ptr<Connection> connection_for( const std::string& destination, const std::string& path ) const;
+
+    /**
+     * Create an ObjectProxy on the connection given by connection_for().
+     * The proxy stays on that connection for its entire life, so calls
+     * made through it are sent in order.
+     */
+    std::shared_ptr<ObjectProxy> create_object_proxy( const std::string& destination, const std::string& path,
+                                                      ThreadForCalling calling = ThreadForCalling::DispatcherThread );
+
+    /**
+     * Send a message on the connection given by connection_for().
+     *
+     * @return The serial of the message on that connection
+     */
+    uint32_t send( std::shared_ptr<const Message> msg );
+
+    /**
+     * Send a method call on the connection given by connection_for() and
+     * wait for the reply.
+     *
+     * @see Connection::send_with_reply_blocking
+     */
+    std::shared_ptr<ReturnMessage> send_with_reply_blocking( std::shared_ptr<const CallMessage> msg, int timeout_milliseconds = -1 );
+
+    /**
+     * Create a free signal proxy on the connection that has the fewest
+     * free signal proxies.
+     *
+     * @see Connection::create_free_signal_proxy
+     */
+    template<typename... T_arg>
+    std::shared_ptr<SignalProxy<T_arg...> > create_free_signal_proxy( const SignalMatchRule& rule,
+                                                                 ThreadForCalling calling = ThreadForCalling::DispatcherThread ) {
+        std::shared_ptr<SignalProxy<T_arg...> > sig;
+        sig = SignalProxy<T_arg...>::create( rule );
+        this->add_free_signal_proxy( sig, calling );
+        return sig;
+    }
+
+    /**
+     * Add the given signal proxy to the connection that has the fewest
+     * free signal proxies.
+     */
+    std::shared_ptr<SignalProxyBase> add_free_signal_proxy( std::shared_ptr<SignalProxyBase> signal,
+                                                       ThreadForCalling calling = ThreadForCalling::DispatcherThread );
+
+    /**
+     * Remove a free signal proxy from whichever connection it was added to.
+     */
+    bool remove_free_signal_proxy( std::shared_ptr<SignalProxyBase> proxy );
+
+private:
+    void open( std::shared_ptr<Connection> conn );
+
+private:
+    class priv_data;
+
+    DBUS_CXX_PROPAGATE_CONST( std::unique_ptr<priv_data> ) m_priv;
+};
+
+} /* namespace DBus */
+
+#endif /* DBUSCXX_CONNECTIONGROUP_H */
@@ -6,6 +6,8 @@
  *   This file is part of the dbus-cxx library.                            *
  ***************************************************************************/
 #include "demarshaling.h"
+#include "byteswap.h"
+#include "error.h"
 #include <cstring>
 #include <stdint.h>
 #include <cassert>
@@ -129,6 +131,52 @@ std::string Demarshaling::demarshal_string() {
     return ret;
 }
 
+std::string_view Demarshaling::demarshal_string_view() {
+    uint32_t len = demarshal_uint32_t();
+    is_valid( len + 1 );
+    const char* start = reinterpret_cast<const char*>( m_priv->m_data + m_priv->m_dataPos );
+
+    m_priv->m_dataPos += len + 1;
+
+    return std::string_view( start, len );
+}
+
+std::string_view Demarshaling::demarshal_signature_view() {
+    uint8_t len = demarshal_uint8_t();
+    is_valid( len + 1 );
+    const char* start = reinterpret_cast<const char*>( m_priv->m_data + m_priv->m_dataPos );
+
+    m_priv->m_dataPos += len + 1;
+
+    return std::string_view( start, len );
+}
+
+const uint8_t* Demarshaling::demarshal_fixed_array_view( uint32_t count, int element_size ) {
+    uint64_t num_bytes = static_cast<uint64_t>( count ) * element_size;
+
+    if( m_priv->m_dataPos + num_bytes > m_priv->m_dataLen ) {
+        throw ErrorUnableToParse( "Array is longer than the data" );
+    }
+
+    const uint8_t* start = m_priv->m_data + m_priv->m_dataPos;
+    m_priv->m_dataPos += num_bytes;
+
+    return start;
+}
+
+void Demarshaling::demarshal_fixed_array( void* data, uint32_t count, int element_size ) {
+    uint64_t num_bytes = static_cast<uint64_t>( count ) * element_size;
+
+    if( m_priv->m_dataPos + num_bytes > m_priv->m_dataLen ) {
+        throw ErrorUnableToParse( "Array is longer than the data" );
+    }
+
+    priv::copy_fixed_array( static_cast<uint8_t*>( data ), priv::host_endianess(),
+                            m_priv->m_data + m_priv->m_dataPos, m_priv->m_endian,
+                            count, element_size );
+    m_priv->m_dataPos += num_bytes;
+}
+
 DBus::Path Demarshaling::demarshal_path() {
     std::string strPath = demarshal_string();
     Path ret = Path( strPath );
@@ -15,6 +15,7 @@
 #include <dbus-cxx/enums.h>
 #include <dbus-cxx/dbus-cxx-config.h>
 #include <memory>
+#include <string_view>
 
 namespace DBus {
 
@@ -72,6 +73,38 @@ public:
     Signature demarshal_signature();
     Variant demarshal_variant();
 
+    /**
+     * Demarshal a string or object path without copying it.  The view
+     * points into the data that is being demarshaled.
+     */
+    std::string_view demarshal_string_view();
+
+    /**
+     * Demarshal a signature without copying or parsing it.  The view
+     * points into the data that is being demarshaled.
+     */
+    std::string_view demarshal_signature_view();
+
+    /**
+     * Step over an array of fixed-size elements, returning a pointer to
+     * the first element in the data that is being demarshaled.  The
+     * elements are not byte swapped.
+     *
+     * @throws ErrorUnableToParse if there is not enough data left
+     */
+    const uint8_t* demarshal_fixed_array_view( uint32_t count, int element_size );
+
+    /**
+     * Demarshal an array of fixed-size elements all at once, converting
+     * them to the byte order of this machine.
+     *
+     * @param data Where to put the elements; must have room for count elements
+     * @param count The number of elements
+     * @param element_size The size of each element: 1, 2, 4 or 8 bytes
+     * @throws ErrorUnableToParse if there is not enough data left
+     */
+    void demarshal_fixed_array( void* data, uint32_t count, int element_size );
+
 private:
     /**
      * Checks to make sure that we're not overruing any array via an assertion.
@@ -116,6 +116,20 @@ enum class Endianess {
     Big,
 };
 
+/**
+ * How a connection reads and writes data on its socket.
+ */
+enum class TransportBackend {
+    /** Plain sendmsg()/recvmsg() calls */
+    Socket,
+    /**
+     * Use io_uring to keep a receive posted at all times and to submit
+     * writes, if the library and the kernel support it.  Falls back to
+     * TransportBackend::Socket if io_uring can't be used.
+     */
+    IoUring,
+};
+
 enum class RegistrationStatus {
     Success,
     /** Unable to register object: There is already an object exported on this path */
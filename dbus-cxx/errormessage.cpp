@@ -9,6 +9,7 @@
 #include "enums.h"
 #include "error.h"
 #include "message.h"
+#include "messagepool.h"
 #include "types.h"
 #include "dbus-error.h"
 
@@ -29,11 +30,11 @@ ErrorMessage::ErrorMessage( std::shared_ptr<const CallMessage> to_reply, const s
 }
 
 std::shared_ptr<ErrorMessage> ErrorMessage::create() {
-    return std::shared_ptr<ErrorMessage>( new ErrorMessage() );
+    return priv::create_pooled_message<ErrorMessage>();
 }
 
 std::shared_ptr<ErrorMessage> ErrorMessage::create( std::shared_ptr<const CallMessage> msg, const std::string& name, const std::string& message ) {
-    return std::shared_ptr<ErrorMessage>( new ErrorMessage( msg, name, message ) );
+    return priv::create_pooled_message<ErrorMessage>( msg, name, message );
 }
 
 bool ErrorMessage::operator == ( const ErrorMessage& m ) const {
@@ -25,6 +25,7 @@ extern simplelogger_log_function dbuscxx_log_function;
     } while(0)
 
 #define DBUSCXX_DEBUG_STDSTR( logger, message ) do{\
+        if( !dbuscxx_log_function ) break;\
         std::stringstream stream;\
         stream << message;\
         DBUSCXX_LOG_CSTR_HEADER( logger, stream.str().c_str(), SL_DEBUG);\
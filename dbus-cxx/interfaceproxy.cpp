@@ -230,11 +230,20 @@ std::shared_ptr<const ReturnMessage> InterfaceProxy::call_notimeout( std::shared
     return m_priv->m_object->call_notimeout( call_message );
 }
 
-//  std::shared_ptr<PendingCall> InterfaceProxy::call_async( std::shared_ptr<const CallMessage> call_message, int timeout_milliseconds ) const
-//  {
-//    if ( not m_priv->m_object ) return std::shared_ptr<PendingCall>();
-//    return m_priv->m_object->call_async( call_message, timeout_milliseconds );
-//  }
+std::shared_ptr<PendingCall> InterfaceProxy::call_async( std::shared_ptr<const CallMessage> call_message,
+                                                         PendingCall::CompletedSlot slot,
+                                                         int timeout_milliseconds ) const {
+    if( !m_priv->m_object ) { return std::shared_ptr<PendingCall>(); }
+
+    return m_priv->m_object->call_async( call_message, slot, timeout_milliseconds );
+}
+
+std::shared_ptr<PendingCall> InterfaceProxy::call_async_notimeout( std::shared_ptr<const CallMessage> call_message,
+                                                                   PendingCall::CompletedSlot slot ) const {
+    if( !m_priv->m_object ) { return std::shared_ptr<PendingCall>(); }
+
+    return m_priv->m_object->call_async_notimeout( call_message, slot );
+}
 
 const InterfaceProxy::Signals& InterfaceProxy::signals() const {
     return m_priv->m_signals;
@@ -149,7 +149,12 @@ public:
 
     std::shared_ptr<const ReturnMessage> call_notimeout( std::shared_ptr<const CallMessage> ) const;
 
-    //      std::shared_ptr<PendingCall> call_async( std::shared_ptr<const CallMessage>, int timeout_milliseconds=-1 ) const;
+    std::shared_ptr<PendingCall> call_async( std::shared_ptr<const CallMessage>,
+                                             PendingCall::CompletedSlot slot,
+                                             int timeout_milliseconds = -1 ) const;
+
+    std::shared_ptr<PendingCall> call_async_notimeout( std::shared_ptr<const CallMessage>,
+                                                       PendingCall::CompletedSlot slot ) const;
 
     template <class T_arg>
     std::shared_ptr<SignalProxy<T_arg >> create_signal( const std::string& sig_name ) {
@@ -0,0 +1,767 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ ***************************************************************************/
+#include "iouringtransport.h"
+
+#if DBUS_CXX_HAS_IO_URING
+
+#include "dbus-cxx-private.h"
+#include "message.h"
+#include "receivebuffer.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+using DBus::priv::IoUringTransport;
+
+static const char* LOGGER_NAME = "DBus.priv.IoUringTransport";
+
+#define RING_ENTRIES        8
+#define CONTROL_BUFFER_SIZE 512
+
+/* The user_data that we tag our submissions with */
+#define RECEIVE_TAG 1
+#define SEND_TAG    2
+#define CANCEL_TAG  3
+
+static int io_uring_setup( unsigned entries, struct io_uring_params* params ) {
+    return syscall( __NR_io_uring_setup, entries, params );
+}
+
+static int io_uring_enter( int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags ) {
+    return syscall( __NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0 );
+}
+
+static int io_uring_register( int ringFd, unsigned opcode, const void* arg, unsigned numArgs ) {
+    return syscall( __NR_io_uring_register, ringFd, opcode, arg, numArgs );
+}
+
+/**
+ * A minimal io_uring: the submission and completion queues mapped into our
+ * memory, with the socket registered as fixed file 0.
+ *
+ * Each queue only ever has one user at a time, so no locking is done here.
+ */
+class IoUring {
+public:
+    IoUring() :
+        m_fd( -1 ),
+        m_sqRing( MAP_FAILED ),
+        m_cqRing( MAP_FAILED ),
+        m_sqes( MAP_FAILED ),
+        m_sqRingSize( 0 ),
+        m_cqRingSize( 0 ),
+        m_sqesSize( 0 ),
+        m_sqLocalTail( 0 ),
+        m_toSubmit( 0 )
+    {}
+
+    ~IoUring() {
+        if( m_sqes != MAP_FAILED ) {
+            munmap( m_sqes, m_sqesSize );
+        }
+
+        if( m_cqRing != MAP_FAILED && m_cqRing != m_sqRing ) {
+            munmap( m_cqRing, m_cqRingSize );
+        }
+
+        if( m_sqRing != MAP_FAILED ) {
+            munmap( m_sqRing, m_sqRingSize );
+        }
+
+        if( m_fd >= 0 ) {
+            close( m_fd );
+        }
+    }
+
+    bool setup( int socketFd ) {
+        struct io_uring_params params;
+        std::memset( &params, 0, sizeof( params ) );
+
+        m_fd = io_uring_setup( RING_ENTRIES, &params );
+
+        if( m_fd < 0 ) {
+            return false;
+        }
+
+        m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof( unsigned );
+        m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof( struct io_uring_cqe );
+
+        if( params.features & IORING_FEAT_SINGLE_MMAP ) {
+            m_sqRingSize = std::max( m_sqRingSize, m_cqRingSize );
+            m_cqRingSize = m_sqRingSize;
+        }
+
+        m_sqRing = mmap( nullptr, m_sqRingSize, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING );
+
+        if( m_sqRing == MAP_FAILED ) {
+            return false;
+        }
+
+        if( params.features & IORING_FEAT_SINGLE_MMAP ) {
+            m_cqRing = m_sqRing;
+        } else {
+            m_cqRing = mmap( nullptr, m_cqRingSize, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING );
+
+            if( m_cqRing == MAP_FAILED ) {
+                return false;
+            }
+        }
+
+        m_sqesSize = params.sq_entries * sizeof( struct io_uring_sqe );
+        m_sqes = mmap( nullptr, m_sqesSize, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES );
+
+        if( m_sqes == MAP_FAILED ) {
+            return false;
+        }
+
+        uint8_t* sq = static_cast<uint8_t*>( m_sqRing );
+        uint8_t* cq = static_cast<uint8_t*>( m_cqRing );
+
+        m_sqHead = reinterpret_cast<unsigned*>( sq + params.sq_off.head );
+        m_sqTail = reinterpret_cast<unsigned*>( sq + params.sq_off.tail );
+        m_sqMask = *reinterpret_cast<unsigned*>( sq + params.sq_off.ring_mask );
+        m_sqEntries = *reinterpret_cast<unsigned*>( sq + params.sq_off.ring_entries );
+        m_sqArray = reinterpret_cast<unsigned*>( sq + params.sq_off.array );
+        m_sqLocalTail = *m_sqTail;
+
+        m_cqHead = reinterpret_cast<unsigned*>( cq + params.cq_off.head );
+        m_cqTail = reinterpret_cast<unsigned*>( cq + params.cq_off.tail );
+        m_cqMask = *reinterpret_cast<unsigned*>( cq + params.cq_off.ring_mask );
+        m_cqes = reinterpret_cast<struct io_uring_cqe*>( cq + params.cq_off.cqes );
+
+        // Register the socket so that the kernel doesn't need to look it up for every request
+        if( io_uring_register( m_fd, IORING_REGISTER_FILES, &socketFd, 1 ) < 0 ) {
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Get the next submission queue entry to fill in.  It is submitted
+     * on the next call to submit() or wait_cqe().
+     *
+     * @return The entry, or nullptr if the submission queue is full
+     */
+    struct io_uring_sqe* get_sqe() {
+        unsigned head = __atomic_load_n( m_sqHead, __ATOMIC_ACQUIRE );
+
+        if( m_sqLocalTail - head >= m_sqEntries ) {
+            return nullptr;
+        }
+
+        unsigned index = m_sqLocalTail & m_sqMask;
+        struct io_uring_sqe* sqe = &static_cast<struct io_uring_sqe*>( m_sqes )[ index ];
+        std::memset( sqe, 0, sizeof( struct io_uring_sqe ) );
+        m_sqArray[ index ] = index;
+        m_sqLocalTail++;
+        m_toSubmit++;
+
+        return sqe;
+    }
+
+    /**
+     * Submit everything that has been queued up, without waiting.
+     *
+     * @return The number of entries submitted, or -1 on error(with errno set)
+     */
+    int submit() {
+        return enter( 0, 0 );
+    }
+
+    /**
+     * Submit everything that has been queued up, and wait for a completion
+     * with the same system call.
+     *
+     * @return The completion, or nullptr on error(with errno set).  Call
+     * cqe_seen() once done with it.
+     */
+    struct io_uring_cqe* wait_cqe() {
+        struct io_uring_cqe* cqe;
+
+        while( ( cqe = peek_cqe() ) == nullptr ) {
+            if( enter( 1, IORING_ENTER_GETEVENTS ) < 0 ) {
+                return nullptr;
+            }
+        }
+
+        return cqe;
+    }
+
+    /**
+     * @return The next completion, or nullptr if there are none.  Call
+     * cqe_seen() once done with it.
+     */
+    struct io_uring_cqe* peek_cqe() {
+        unsigned head = *m_cqHead;
+
+        if( head == __atomic_load_n( m_cqTail, __ATOMIC_ACQUIRE ) ) {
+            return nullptr;
+        }
+
+        return &m_cqes[ head & m_cqMask ];
+    }
+
+    void cqe_seen() {
+        __atomic_store_n( m_cqHead, *m_cqHead + 1, __ATOMIC_RELEASE );
+    }
+
+    int fd() const {
+        return m_fd;
+    }
+
+private:
+    int enter( unsigned minComplete, unsigned flags ) {
+        __atomic_store_n( m_sqTail, m_sqLocalTail, __ATOMIC_RELEASE );
+
+        while( true ) {
+            int ret = io_uring_enter( m_fd, m_toSubmit, minComplete, flags );
+
+            if( ret < 0 ) {
+                if( errno == EINTR ) {
+                    continue;
+                }
+
+                return ret;
+            }
+
+            m_toSubmit -= std::min<unsigned>( ret, m_toSubmit );
+
+            return ret;
+        }
+    }
+
+private:
+    int m_fd;
+    void* m_sqRing;
+    void* m_cqRing;
+    void* m_sqes;
+    size_t m_sqRingSize;
+    size_t m_cqRingSize;
+    size_t m_sqesSize;
+
+    unsigned* m_sqHead;
+    unsigned* m_sqTail;
+    unsigned m_sqMask;
+    unsigned m_sqEntries;
+    unsigned* m_sqArray;
+    unsigned m_sqLocalTail;
+    unsigned m_toSubmit;
+
+    unsigned* m_cqHead;
+    unsigned* m_cqTail;
+    unsigned m_cqMask;
+    struct io_uring_cqe* m_cqes;
+};
+
+class IoUringTransport::priv_data {
+public:
+    priv_data( int fd ) :
+        m_fd( fd ),
+        m_ok( false ),
+        m_receivePosted( false ),
+        tx_control_data( nullptr ),
+        tx_control_capacity( 0 ) {
+        ::memset( &rx_msg, 0, sizeof( struct msghdr ) );
+        ::memset( &tx_msg, 0, sizeof( struct msghdr ) );
+    }
+
+    ~priv_data() {
+        free( tx_control_data );
+    }
+
+    int m_fd;
+    bool m_ok;
+
+    /* Only used by the dispatching thread; the FD of this is what it waits on */
+    IoUring m_receiveRing;
+    bool m_receivePosted;
+    ReceiveBuffer m_receiveBuffer;
+    struct msghdr rx_msg;
+    struct iovec rx_buf;
+    alignas( struct cmsghdr ) uint8_t rx_control[ CONTROL_BUFFER_SIZE ];
+
+    /* Used by whichever thread is writing, with m_send_mutex held */
+    IoUring m_sendRing;
+    std::mutex m_send_mutex;
+    /* One serialization buffer per message in a batch; kept around to reuse the capacity */
+    std::vector<std::vector<uint8_t>> m_sendBuffers;
+    std::vector<struct iovec> m_sendIovecs;
+    /* The FDs that go along with each entry in m_sendIovecs */
+    std::vector<const std::vector<int>*> m_sendFds;
+    struct msghdr tx_msg;
+    void* tx_control_data;
+    int tx_control_capacity;
+
+    /**
+     * Get an entry to send with.  If the submission queue is full, submit
+     * whatever is in it to make room first.
+     *
+     * @return The entry, or nullptr if there is still no room
+     */
+    struct io_uring_sqe* get_send_sqe() {
+        struct io_uring_sqe* sqe = m_sendRing.get_sqe();
+
+        if( sqe == nullptr && m_sendRing.submit() >= 0 ) {
+            sqe = m_sendRing.get_sqe();
+        }
+
+        return sqe;
+    }
+
+    /**
+     * Send all of the data in the given iovecs, attaching the given FDs
+     * to the first byte of data.  Short writes are resumed until everything
+     * has been written.
+     *
+     * @return The number of bytes written, or -1 on error
+     */
+    ssize_t send( struct iovec* iov, size_t iovcnt, const std::vector<int>& fds ) {
+        int fd_space_needed = CMSG_SPACE( sizeof( int ) * fds.size() );
+        ssize_t totalWritten = 0;
+
+        tx_msg.msg_control = nullptr;
+        tx_msg.msg_controllen = 0;
+
+        if( tx_control_capacity < fd_space_needed ) {
+            free( tx_control_data );
+            tx_control_data = ::malloc( fd_space_needed );
+            tx_control_capacity = fd_space_needed;
+        }
+
+        /* Fill in our FD array(ancillary data) */
+        if( fds.size() > 0 ) {
+            struct cmsghdr* cmsg;
+
+            tx_msg.msg_control = tx_control_data;
+            tx_msg.msg_controllen = fd_space_needed;
+            cmsg = CMSG_FIRSTHDR( &tx_msg );
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN( sizeof( int ) * fds.size() );
+
+            int* data = ( int* )CMSG_DATA( cmsg );
+
+            for( int fd : fds ) {
+                *data = fd;
+                data++;
+            }
+        }
+
+        while( iovcnt > 0 ) {
+            tx_msg.msg_iov = iov;
+            tx_msg.msg_iovlen = iovcnt;
+
+            ssize_t ret;
+            struct io_uring_sqe* sqe = get_send_sqe();
+
+            if( sqe == nullptr ) {
+                // No room in the ring; send this chunk ourselves instead of failing the write
+                SIMPLELOGGER_DEBUG( LOGGER_NAME, "Send queue is full, falling back to sendmsg()" );
+                ret = ::sendmsg( m_fd, &tx_msg, 0 );
+
+                if( ret < 0 ) {
+                    ret = -errno;
+                }
+            } else {
+                sqe->opcode = IORING_OP_SENDMSG;
+                sqe->fd = 0;
+                sqe->flags = IOSQE_FIXED_FILE;
+                sqe->addr = reinterpret_cast<uint64_t>( &tx_msg );
+                sqe->len = 1;
+                sqe->user_data = SEND_TAG;
+
+                // Submit and wait for the send with just the one system call
+                struct io_uring_cqe* cqe = m_sendRing.wait_cqe();
+
+                if( cqe == nullptr ) {
+                    return -1;
+                }
+
+                ret = cqe->res;
+                m_sendRing.cqe_seen();
+            }
+
+            if( ret < 0 ) {
+                if( ret == -EINTR ) {
+                    continue;
+                }
+
+                if( ret == -EAGAIN &&
+                    DBus::priv::wait_for_fd_writable( m_fd, -1 ) ) {
+                    continue;
+                }
+
+                errno = -ret;
+                return -1;
+            }
+
+            totalWritten += ret;
+
+            // The FDs have been sent along with the first chunk of data; don't send them again
+            tx_msg.msg_control = nullptr;
+            tx_msg.msg_controllen = 0;
+
+            while( iovcnt > 0 && static_cast<size_t>( ret ) >= iov->iov_len ) {
+                ret -= iov->iov_len;
+                iov++;
+                iovcnt--;
+            }
+
+            if( ret > 0 ) {
+                iov->iov_base = static_cast<uint8_t*>( iov->iov_base ) + ret;
+                iov->iov_len -= ret;
+            }
+        }
+
+        return totalWritten;
+    }
+};
+
+IoUringTransport::IoUringTransport( int fd ) :
+    m_priv( std::make_unique<priv_data>( fd ) ) {
+    /*
+     * The socket is shared with the transport that we replace, which keeps
+     * being used if we fail; leave it alone until we know that we work.
+     */
+    if( !m_priv->m_receiveRing.setup( fd ) ||
+        !m_priv->m_sendRing.setup( fd ) ) {
+        std::string errmsg = strerror( errno );
+        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Unable to set up io_uring: " + errmsg );
+        return;
+    }
+
+    /*
+     * io_uring waits for the socket to be ready on its own; with O_NONBLOCK
+     * set, we could get spurious EAGAIN completions.
+     */
+    int flags = fcntl( fd, F_GETFL );
+
+    if( flags >= 0 ) {
+        fcntl( fd, F_SETFL, flags & ~O_NONBLOCK );
+    }
+
+    /*
+     * The credentials were only needed for authentication.  A receive that
+     * completes asynchronously may truncate the control data when both
+     * credentials and FDs are attached, which would lose the FDs.
+     */
+    int passcred = 0;
+    socklen_t passcredLen = sizeof( int );
+    int oldPasscred = 0;
+    getsockopt( fd, SOL_SOCKET, SO_PASSCRED, &oldPasscred, &passcredLen );
+    setsockopt( fd, SOL_SOCKET, SO_PASSCRED, &passcred, sizeof( int ) );
+
+    m_priv->m_ok = true;
+
+    postReceive();
+
+    if( !m_priv->m_ok ) {
+        // Give the socket back the way that we found it
+        if( flags >= 0 ) {
+            fcntl( fd, F_SETFL, flags );
+        }
+
+        setsockopt( fd, SOL_SOCKET, SO_PASSCRED, &oldPasscred, sizeof( int ) );
+    }
+}
+
+IoUringTransport::~IoUringTransport() {
+    if( m_priv->m_receivePosted ) {
+        // The kernel must be done with our receive buffer before it goes away
+        struct io_uring_sqe* sqe = m_priv->m_receiveRing.get_sqe();
+
+        if( sqe ) {
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->addr = RECEIVE_TAG;
+            sqe->user_data = CANCEL_TAG;
+        }
+
+        struct io_uring_cqe* cqe;
+
+        while( ( cqe = m_priv->m_receiveRing.wait_cqe() ) != nullptr ) {
+            uint64_t tag = cqe->user_data;
+            m_priv->m_receiveRing.cqe_seen();
+
+            if( tag == RECEIVE_TAG ) {
+                break;
+            }
+        }
+    }
+
+    close( m_priv->m_fd );
+}
+
+std::shared_ptr<IoUringTransport> IoUringTransport::create( int fd ) {
+    return std::shared_ptr<IoUringTransport>( new IoUringTransport( fd ) );
+}
+
+bool IoUringTransport::is_supported() {
+    static const bool supported = []() {
+        struct io_uring_params params;
+        std::memset( &params, 0, sizeof( params ) );
+        int ringFd = io_uring_setup( 1, &params );
+
+        if( ringFd < 0 ) {
+            std::string errmsg = strerror( errno );
+            SIMPLELOGGER_DEBUG( LOGGER_NAME, "io_uring is not available: " + errmsg );
+            return false;
+        }
+
+        // Make sure that the kernel knows about all of the operations that we use
+        const int numOps = 256;
+        std::vector<uint8_t> probeBuffer( sizeof( struct io_uring_probe ) +
+            numOps * sizeof( struct io_uring_probe_op ) );
+        struct io_uring_probe* probe = reinterpret_cast<struct io_uring_probe*>( probeBuffer.data() );
+        bool haveOps = false;
+
+        if( io_uring_register( ringFd, IORING_REGISTER_PROBE, probe, numOps ) >= 0 ) {
+            haveOps = true;
+
+            for( int op : { IORING_OP_SENDMSG, IORING_OP_RECVMSG, IORING_OP_ASYNC_CANCEL } ) {
+                if( op > probe->last_op ||
+                    !( probe->ops[ op ].flags & IO_URING_OP_SUPPORTED ) ) {
+                    haveOps = false;
+                }
+            }
+        }
+
+        close( ringFd );
+
+        if( !haveOps ) {
+            SIMPLELOGGER_DEBUG( LOGGER_NAME, "io_uring does not support the operations that we need" );
+        }
+
+        return haveOps;
+    }();
+
+    return supported;
+}
+
+ssize_t IoUringTransport::writeMessage( std::shared_ptr<const DBus::Message> message, uint32_t serial ) {
+    std::vector<OutgoingMessage> messages;
+    messages.push_back( OutgoingMessage{ message, serial } );
+
+    return writeMessages( messages );
+}
+
+ssize_t IoUringTransport::writeMessages( const std::vector<OutgoingMessage>& messages ) {
+    std::scoped_lock lock( m_priv->m_send_mutex );
+    ssize_t totalWritten = 0;
+    size_t numBuffers = 0;
+    size_t batchStart = 0;
+
+    if( m_priv->m_sendBuffers.size() < messages.size() ) {
+        m_priv->m_sendBuffers.resize( messages.size() );
+    }
+
+    m_priv->m_sendIovecs.clear();
+    m_priv->m_sendFds.clear();
+
+    for( const OutgoingMessage& outgoing : messages ) {
+        std::vector<uint8_t>& buffer = m_priv->m_sendBuffers[ numBuffers ];
+        buffer.clear();
+
+        if( !outgoing.msg->serialize_to_vector( &buffer, outgoing.serial ) ) {
+            SIMPLELOGGER_DEBUG( LOGGER_NAME, "Unable to serialize message with serial " << outgoing.serial );
+            continue;
+        }
+
+        if( dbuscxx_log_function ) {
+            std::ostringstream debug_str;
+            debug_str << "Going to send the following bytes: " << std::endl;
+            DBus::hexdump( &buffer, &debug_str );
+            SIMPLELOGGER_TRACE( LOGGER_NAME, debug_str.str() );
+        }
+
+        struct iovec iov;
+        iov.iov_base = buffer.data();
+        iov.iov_len = buffer.size();
+        m_priv->m_sendIovecs.push_back( iov );
+        m_priv->m_sendFds.push_back( &outgoing.msg->filedescriptors() );
+        numBuffers++;
+    }
+
+    /*
+     * Send as many messages as we can with each submission.  Any FDs
+     * are attached to the first byte of a sendmsg, so a message that
+     * has FDs always starts a new batch.
+     */
+    while( batchStart < numBuffers ) {
+        size_t batchEnd = batchStart + 1;
+
+        while( batchEnd < numBuffers &&
+            ( batchEnd - batchStart ) < IOV_MAX &&
+            m_priv->m_sendFds[ batchEnd ]->empty() ) {
+            batchEnd++;
+        }
+
+        ssize_t ret = m_priv->send( &m_priv->m_sendIovecs[ batchStart ],
+                batchEnd - batchStart,
+                *m_priv->m_sendFds[ batchStart ] );
+
+        if( ret < 0 ) {
+            int my_errno = errno;
+            std::ostringstream debug_str;
+
+            debug_str << "Can't send message: " << strerror( my_errno );
+
+            SIMPLELOGGER_ERROR( LOGGER_NAME, debug_str.str() );
+            m_priv->m_ok = false;
+            errno = my_errno;
+            return ret;
+        }
+
+        totalWritten += ret;
+        batchStart = batchEnd;
+    }
+
+    SIMPLELOGGER_TRACE( LOGGER_NAME, "Wrote " << numBuffers << " messages(" << totalWritten << " bytes)" );
+
+    return totalWritten;
+}
+
+std::shared_ptr<DBus::Message> IoUringTransport::readMessage() {
+    if( !m_priv->m_receiveBuffer.has_message() ) {
+        processReceiveCompletions();
+    }
+
+    return m_priv->m_receiveBuffer.take_message();
+}
+
+int IoUringTransport::readMessages( std::vector<std::shared_ptr<Message>>* messages ) {
+    if( !m_priv->m_receiveBuffer.has_message() ) {
+        processReceiveCompletions();
+    }
+
+    return m_priv->m_receiveBuffer.take_messages( messages );
+}
+
+void IoUringTransport::processReceiveCompletions() {
+    struct io_uring_cqe* cqe;
+    ssize_t num_fds;
+    struct cmsghdr* cmsg;
+
+    while( ( cqe = m_priv->m_receiveRing.peek_cqe() ) != nullptr ) {
+        uint64_t tag = cqe->user_data;
+        int ret = cqe->res;
+        m_priv->m_receiveRing.cqe_seen();
+
+        if( tag != RECEIVE_TAG ) {
+            continue;
+        }
+
+        m_priv->m_receivePosted = false;
+
+        if( ret == -ECANCELED || ret == -EINTR || ret == -EAGAIN ) {
+            // Nothing was received; we just need to try again
+            continue;
+        }
+
+        if( ret < 0 ) {
+            std::string errmsg = strerror( -ret );
+            SIMPLELOGGER_DEBUG( LOGGER_NAME, "Unable to receive: " + errmsg );
+            m_priv->m_ok = false;
+            continue;
+        }
+
+        if( ret == 0 ) {
+            // End of the stream
+            SIMPLELOGGER_TRACE( LOGGER_NAME, "End of stream: closing transport" );
+            m_priv->m_ok = false;
+            continue;
+        }
+
+        for( cmsg = CMSG_FIRSTHDR( &m_priv->rx_msg );
+            cmsg != nullptr;
+            cmsg = CMSG_NXTHDR( &m_priv->rx_msg, cmsg ) ) {
+            if( cmsg->cmsg_level == SOL_SOCKET &&
+                cmsg->cmsg_type == SCM_RIGHTS ) {
+                /* This is our FD array */
+                num_fds = ( cmsg->cmsg_len - CMSG_LEN( 0 ) ) / sizeof( int );
+                SIMPLELOGGER_DEBUG( LOGGER_NAME, "Have " << num_fds << " fds to extract from CMSGHDR" );
+                m_priv->m_receiveBuffer.add_filedescriptors( reinterpret_cast<int*>( CMSG_DATA( cmsg ) ), num_fds );
+            }
+        }
+
+        if( m_priv->rx_msg.msg_flags & MSG_CTRUNC ) {
+            SIMPLELOGGER_WARN( LOGGER_NAME, "Control data truncated: some FDs have been lost" );
+        }
+
+        if( !m_priv->m_receiveBuffer.commit( ret ) ) {
+            // We can't skip over data that is already in flight, so we can't resync
+            SIMPLELOGGER_ERROR( LOGGER_NAME, "Invalid data received: closing transport" );
+            m_priv->m_ok = false;
+        }
+    }
+
+    if( m_priv->m_ok && !m_priv->m_receivePosted ) {
+        postReceive();
+    }
+}
+
+void IoUringTransport::postReceive() {
+    m_priv->m_receiveBuffer.make_room();
+
+    m_priv->rx_buf.iov_base = m_priv->m_receiveBuffer.write_location();
+    m_priv->rx_buf.iov_len = m_priv->m_receiveBuffer.write_space();
+    m_priv->rx_msg.msg_iov = &m_priv->rx_buf;
+    m_priv->rx_msg.msg_iovlen = 1;
+    m_priv->rx_msg.msg_control = m_priv->rx_control;
+    m_priv->rx_msg.msg_controllen = sizeof( m_priv->rx_control );
+    m_priv->rx_msg.msg_flags = 0;
+
+    struct io_uring_sqe* sqe = m_priv->m_receiveRing.get_sqe();
+
+    if( sqe == nullptr ) {
+        SIMPLELOGGER_ERROR( LOGGER_NAME, "No room to post a receive" );
+        m_priv->m_ok = false;
+        return;
+    }
+
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = 0;
+    sqe->flags = IOSQE_FIXED_FILE;
+    sqe->addr = reinterpret_cast<uint64_t>( &m_priv->rx_msg );
+    sqe->len = 1;
+    sqe->user_data = RECEIVE_TAG;
+
+    if( m_priv->m_receiveRing.submit() < 0 ) {
+        std::string errmsg = strerror( errno );
+        SIMPLELOGGER_ERROR( LOGGER_NAME, "Unable to post a receive: " + errmsg );
+        m_priv->m_ok = false;
+        return;
+    }
+
+    m_priv->m_receivePosted = true;
+}
+
+bool IoUringTransport::is_valid() const {
+    return m_priv->m_ok;
+}
+
+int IoUringTransport::fd() const {
+    return m_priv->m_receiveRing.fd();
+}
+
+#endif /* DBUS_CXX_HAS_IO_URING */
@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ ***************************************************************************/
+
+#ifndef DBUS_CXX_IOURINGTRANSPORT_H
+#define DBUS_CXX_IOURINGTRANSPORT_H
+
+#include <dbus-cxx/dbus-cxx-config.h>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+#include "transport.h"
+
+namespace DBus {
+
+class Message;
+
+namespace priv {
+
+/**
+ * The IoUringTransport handles reading and writing over a Unix FD by using
+ * io_uring.  A receive is always kept posted on the socket, so incoming data
+ * is already in our buffer by the time that the dispatcher wakes up, and
+ * each batch of outgoing messages is sent with a single submission.
+ *
+ * Like the SendmsgTransport, this allows file descriptors to be sent and
+ * received.
+ *
+ * The FD returned by fd() is the io_uring, not the socket.  It becomes
+ * readable whenever a receive has completed.
+ */
+class IoUringTransport : public Transport {
+private:
+    IoUringTransport( int fd );
+
+public:
+    ~IoUringTransport();
+
+    /**
+     * Create an IoUringTransport.  The connection must already be
+     * initialized and authenticated, as this starts receiving data from
+     * the socket straight away.
+     *
+     * @param fd The already-open file descriptor.  This transport takes
+     * ownership of the FD, even if it is not valid.
+     * @return
+     */
+    static std::shared_ptr<IoUringTransport> create( int fd );
+
+    /**
+     * Check to see if io_uring can be used.  This may be false if the
+     * library was built without io_uring support, or if the kernel does
+     * not support it(or has it disabled).
+     *
+     * @return
+     */
+    static bool is_supported();
+
+    ssize_t writeMessage( std::shared_ptr<const Message> message, uint32_t serial );
+
+    ssize_t writeMessages( const std::vector<OutgoingMessage>& messages );
+
+    std::shared_ptr<Message> readMessage();
+
+    int readMessages( std::vector<std::shared_ptr<Message>>* messages );
+
+    /**
+     * Check if this transport is OK
+     * @return
+     */
+    bool is_valid() const;
+
+    int fd() const;
+
+private:
+    void processReceiveCompletions();
+
+    void postReceive();
+
+private:
+    class priv_data;
+
+    DBUS_CXX_PROPAGATE_CONST( std::unique_ptr<priv_data> ) m_priv;
+};
+
+} /* namespace priv */
+
+} /* namespace DBus */
+
+#endif /* DBUS_CXX_IOURINGTRANSPORT_H */
@@ -6,6 +6,7 @@
  *   This file is part of the dbus-cxx library.                            *
  ***************************************************************************/
 #include "marshaling.h"
+#include "byteswap.h"
 #include <stdint.h>
 #include <vector>
 #include <string>
@@ -18,13 +19,88 @@
 
 using DBus::Marshaling;
 
+namespace {
+
+/*
+ * The operations that we need on the vector that we are writing to.  There
+ * is one of these for each type of vector, so the vector that we have is
+ * only looked at once, when it is set.
+ */
+struct BufferOps {
+    size_t ( *size )( const void* vector );
+    void ( *push_back )( void* vector, uint8_t byte );
+    void ( *append )( void* vector, const uint8_t* bytes, size_t len );
+    uint8_t* ( *grow )( void* vector, size_t len );
+    uint8_t* ( *data )( void* vector );
+};
+
+template <typename Vector>
+struct VectorOps {
+    static size_t size( const void* vector ) {
+        return static_cast<const Vector*>( vector )->size();
+    }
+
+    static void push_back( void* vector, uint8_t byte ) {
+        static_cast<Vector*>( vector )->push_back( byte );
+    }
+
+    static void append( void* vector, const uint8_t* bytes, size_t len ) {
+        Vector* v = static_cast<Vector*>( vector );
+        v->insert( v->end(), bytes, bytes + len );
+    }
+
+    static uint8_t* grow( void* vector, size_t len ) {
+        Vector* v = static_cast<Vector*>( vector );
+        size_t offset = v->size();
+        v->resize( offset + len );
+        return v->data() + offset;
+    }
+
+    static uint8_t* data( void* vector ) {
+        return static_cast<Vector*>( vector )->data();
+    }
+
+    static constexpr BufferOps ops = { size, push_back, append, grow, data };
+};
+
+} /* namespace */
+
 class Marshaling::priv_data {
 public:
     priv_data() :
-        m_data( nullptr ),
+        m_vector( nullptr ),
+        m_ops( nullptr ),
         m_endian( Endianess::Big ) {}
 
-    std::vector<uint8_t>* m_data;
+    template <typename Vector>
+    void set_vector( Vector* vector ) {
+        m_vector = vector;
+        m_ops = &VectorOps<Vector>::ops;
+    }
+
+    size_t size() const {
+        return m_ops->size( m_vector );
+    }
+
+    void push_back( uint8_t byte ) {
+        m_ops->push_back( m_vector, byte );
+    }
+
+    void append( const uint8_t* bytes, size_t len ) {
+        m_ops->append( m_vector, bytes, len );
+    }
+
+    /* Make room for len more bytes, returning where they start */
+    uint8_t* grow( size_t len ) {
+        return m_ops->grow( m_vector, len );
+    }
+
+    uint8_t* data() {
+        return m_ops->data( m_vector );
+    }
+
+    void* m_vector;
+    const BufferOps* m_ops;
     Endianess m_endian;
 };
 
@@ -34,7 +110,13 @@ Marshaling::Marshaling() {
 
 Marshaling::Marshaling( std::vector<uint8_t>* data, Endianess endian ) {
     m_priv = std::make_shared<priv_data>();
-    m_priv->m_data = data;
+    m_priv->set_vector( data );
+    m_priv->m_endian = endian;
+}
+
+Marshaling::Marshaling( std::pmr::vector<uint8_t>* data, Endianess endian ) {
+    m_priv = std::make_shared<priv_data>();
+    m_priv->set_vector( data );
     m_priv->m_endian = endian;
 }
 
@@ -50,7 +132,7 @@ void Marshaling::marshal( bool v ) {
 }
 
 void Marshaling::marshal( uint8_t v ) {
-    m_priv->m_data->push_back( v );
+    m_priv->push_back( v );
 }
 
 void Marshaling::marshal( int16_t v ) {
@@ -116,11 +198,16 @@ void Marshaling::marshal( std::string v ) {
     uint32_t len = v.size();
     marshal( len );
 
-    for( const char& c : v ) {
-        m_priv->m_data->push_back( c );
-    }
+    // Includes the terminating nul
+    m_priv->append( reinterpret_cast<const uint8_t*>( v.c_str() ), len + 1 );
+}
+
+void Marshaling::marshal_string_view( std::string_view v ) {
+    uint32_t len = v.size();
+    marshal( len );
 
-    m_priv->m_data->push_back( 0 );
+    m_priv->append( reinterpret_cast<const uint8_t*>( v.data() ), len );
+    m_priv->push_back( 0 );
 }
 
 void Marshaling::marshal( Path v ) {
@@ -129,83 +216,87 @@ void Marshaling::marshal( Path v ) {
 }
 
 void Marshaling::marshal( Signature v ) {
-    std::string data = v.str();
-    m_priv->m_data->push_back( data.size() & 0xFF );
-
-    for( const char& c : data ) {
-        m_priv->m_data->push_back( c );
-    }
-
-    m_priv->m_data->push_back( 0 );
+    const std::string& data = v.str();
+    m_priv->push_back( data.size() & 0xFF );
+    m_priv->append( reinterpret_cast<const uint8_t*>( data.c_str() ), data.size() + 1 );
 }
 
 void Marshaling::align( int alignment ) {
-    int bytesToAlign = alignment - ( m_priv->m_data->size() % alignment );
+    int bytesToAlign = alignment - ( m_priv->size() % alignment );
 
     if( bytesToAlign == alignment ) {
         // already aligned!
         return;
     }
 
-    for( int x = 0; x < bytesToAlign; x++ ) {
-        m_priv->m_data->push_back( 0 );
-    }
+    // Growing the vector fills the padding with zeros
+    m_priv->grow( bytesToAlign );
 }
 
 void Marshaling::marshalShortBig( uint16_t toMarshal ) {
     align( 2 );
-    m_priv->m_data->push_back( ( toMarshal & 0xFF00 ) >> 8 );
-    m_priv->m_data->push_back( ( toMarshal & 0x00FF ) >> 0 );
+    uint8_t* out = m_priv->grow( 2 );
+    out[ 0 ] = ( toMarshal & 0xFF00 ) >> 8;
+    out[ 1 ] = ( toMarshal & 0x00FF ) >> 0;
 }
 
 void Marshaling::marshalIntBig( uint32_t toMarshal ) {
     align( 4 );
-    m_priv->m_data->push_back( ( toMarshal & 0xFF000000 ) >> 24 );
-    m_priv->m_data->push_back( ( toMarshal & 0x00FF0000 ) >> 16 );
-    m_priv->m_data->push_back( ( toMarshal & 0x0000FF00 ) >> 8 );
-    m_priv->m_data->push_back( ( toMarshal & 0x000000FF ) >> 0 );
+    uint8_t* out = m_priv->grow( 4 );
+    out[ 0 ] = ( toMarshal & 0xFF000000 ) >> 24;
+    out[ 1 ] = ( toMarshal & 0x00FF0000 ) >> 16;
+    out[ 2 ] = ( toMarshal & 0x0000FF00 ) >> 8;
+    out[ 3 ] = ( toMarshal & 0x000000FF ) >> 0;
 }
 
 void Marshaling::marshalLongBig( uint64_t toMarshal ) {
     align( 8 );
-    m_priv->m_data->push_back( ( toMarshal & 0xFF00000000000000 ) >> 56 );
-    m_priv->m_data->push_back( ( toMarshal & 0x00FF000000000000 ) >> 48 );
-    m_priv->m_data->push_back( ( toMarshal & 0x0000FF0000000000 ) >> 40 );
-    m_priv->m_data->push_back( ( toMarshal & 0x000000FF00000000 ) >> 32 );
-    m_priv->m_data->push_back( ( toMarshal & 0x00000000FF000000 ) >> 24 );
-    m_priv->m_data->push_back( ( toMarshal & 0x0000000000FF0000 ) >> 16 );
-    m_priv->m_data->push_back( ( toMarshal & 0x000000000000FF00 ) >> 8 );
-    m_priv->m_data->push_back( ( toMarshal & 0x00000000000000FF ) >> 0 );
+    uint8_t* out = m_priv->grow( 8 );
+    out[ 0 ] = ( toMarshal & 0xFF00000000000000 ) >> 56;
+    out[ 1 ] = ( toMarshal & 0x00FF000000000000 ) >> 48;
+    out[ 2 ] = ( toMarshal & 0x0000FF0000000000 ) >> 40;
+    out[ 3 ] = ( toMarshal & 0x000000FF00000000 ) >> 32;
+    out[ 4 ] = ( toMarshal & 0x00000000FF000000 ) >> 24;
+    out[ 5 ] = ( toMarshal & 0x0000000000FF0000 ) >> 16;
+    out[ 6 ] = ( toMarshal & 0x000000000000FF00 ) >> 8;
+    out[ 7 ] = ( toMarshal & 0x00000000000000FF ) >> 0;
 }
 
 void Marshaling::marshalShortLittle( uint16_t toMarshal ) {
     align( 2 );
-    m_priv->m_data->push_back( ( toMarshal & 0x00FF ) >> 0 );
-    m_priv->m_data->push_back( ( toMarshal & 0xFF00 ) >> 8 );
+    uint8_t* out = m_priv->grow( 2 );
+    out[ 0 ] = ( toMarshal & 0x00FF ) >> 0;
+    out[ 1 ] = ( toMarshal & 0xFF00 ) >> 8;
 }
 
 void Marshaling::marshalIntLittle( uint32_t toMarshal ) {
     align( 4 );
-    m_priv->m_data->push_back( ( toMarshal & 0x000000FF ) >> 0 );
-    m_priv->m_data->push_back( ( toMarshal & 0x0000FF00 ) >> 8 );
-    m_priv->m_data->push_back( ( toMarshal & 0x00FF0000 ) >> 16 );
-    m_priv->m_data->push_back( ( toMarshal & 0xFF000000 ) >> 24 );
+    uint8_t* out = m_priv->grow( 4 );
+    out[ 0 ] = ( toMarshal & 0x000000FF ) >> 0;
+    out[ 1 ] = ( toMarshal & 0x0000FF00 ) >> 8;
+    out[ 2 ] = ( toMarshal & 0x00FF0000 ) >> 16;
+    out[ 3 ] = ( toMarshal & 0xFF000000 ) >> 24;
 }
 
 void Marshaling::marshalLongLittle( uint64_t toMarshal ) {
     align( 8 );
-    m_priv->m_data->push_back( ( toMarshal & 0x00000000000000FF ) >> 0 );
-    m_priv->m_data->push_back( ( toMarshal & 0x000000000000FF00 ) >> 8 );
-    m_priv->m_data->push_back( ( toMarshal & 0x0000000000FF0000 ) >> 16 );
-    m_priv->m_data->push_back( ( toMarshal & 0x00000000FF000000 ) >> 24 );
-    m_priv->m_data->push_back( ( toMarshal & 0x000000FF00000000 ) >> 32 );
-    m_priv->m_data->push_back( ( toMarshal & 0x0000FF0000000000 ) >> 40 );
-    m_priv->m_data->push_back( ( toMarshal & 0x00FF000000000000 ) >> 48 );
-    m_priv->m_data->push_back( ( toMarshal & 0xFF00000000000000 ) >> 56 );
+    uint8_t* out = m_priv->grow( 8 );
+    out[ 0 ] = ( toMarshal & 0x00000000000000FF ) >> 0;
+    out[ 1 ] = ( toMarshal & 0x000000000000FF00 ) >> 8;
+    out[ 2 ] = ( toMarshal & 0x0000000000FF0000 ) >> 16;
+    out[ 3 ] = ( toMarshal & 0x00000000FF000000 ) >> 24;
+    out[ 4 ] = ( toMarshal & 0x000000FF00000000 ) >> 32;
+    out[ 5 ] = ( toMarshal & 0x0000FF0000000000 ) >> 40;
+    out[ 6 ] = ( toMarshal & 0x00FF000000000000 ) >> 48;
+    out[ 7 ] = ( toMarshal & 0xFF00000000000000 ) >> 56;
 }
 
 void Marshaling::set_data( std::vector<uint8_t>* data ) {
-    m_priv->m_data = data;
+    m_priv->set_vector( data );
+}
+
+void Marshaling::set_data( std::pmr::vector<uint8_t>* data ) {
+    m_priv->set_vector( data );
 }
 
 void Marshaling::set_endianess( Endianess endian ) {
@@ -214,35 +305,41 @@ void Marshaling::set_endianess( Endianess endian ) {
 
 void Marshaling::marshal( const Variant& v ) {
     Signature signature = v.signature();
-    const std::vector<uint8_t>* data = v.marshaled();
-
-    m_priv->m_data->reserve( m_priv->m_data->size()
-        + signature.str().size()
-        + data->size()
-        + 12 /* Extra alignment bytes, if needed */ );
+    const uint8_t* data = v.marshaled_data();
+    size_t size = v.marshaled_size();
 
     marshal( signature );
     align(v.data_alignment());
 
-    for( const uint8_t& byte : *data ) {
-        m_priv->m_data->push_back( byte );
-    }
+    m_priv->append( data, size );
+}
+
+void Marshaling::marshal_fixed_array( const void* data, uint32_t count, int element_size ) {
+    align( element_size );
+
+    uint8_t* dest = m_priv->grow( static_cast<size_t>( count ) * element_size );
+
+    priv::copy_fixed_array( dest, m_priv->m_endian,
+                            static_cast<const uint8_t*>( data ), priv::host_endianess(),
+                            count, element_size );
 }
 
 void Marshaling::marshal_at_offset( uint32_t offset, uint32_t value ) {
+    uint8_t* out = m_priv->data() + offset;
+
     if( m_priv->m_endian == Endianess::Little ) {
-        ( *m_priv->m_data )[offset++] = ( value & 0x000000FF ) >> 0;
-        ( *m_priv->m_data )[offset++] = ( value & 0x0000FF00 ) >> 8;
-        ( *m_priv->m_data )[offset++] = ( value & 0x00FF0000 ) >> 16;
-        ( *m_priv->m_data )[offset++] = ( value & 0xFF000000 ) >> 24;
+        out[ 0 ] = ( value & 0x000000FF ) >> 0;
+        out[ 1 ] = ( value & 0x0000FF00 ) >> 8;
+        out[ 2 ] = ( value & 0x00FF0000 ) >> 16;
+        out[ 3 ] = ( value & 0xFF000000 ) >> 24;
     } else {
-        ( *m_priv->m_data )[offset++] = ( value & 0xFF000000 ) >> 24;
-        ( *m_priv->m_data )[offset++] = ( value & 0x00FF0000 ) >> 16;
-        ( *m_priv->m_data )[offset++] = ( value & 0x0000FF00 ) >> 8;
-        ( *m_priv->m_data )[offset++] = ( value & 0x000000FF ) >> 0;
+        out[ 0 ] = ( value & 0xFF000000 ) >> 24;
+        out[ 1 ] = ( value & 0x00FF0000 ) >> 16;
+        out[ 2 ] = ( value & 0x0000FF00 ) >> 8;
+        out[ 3 ] = ( value & 0x000000FF ) >> 0;
     }
 }
 
 uint32_t Marshaling::currentOffset() const {
-    return m_priv->m_data->size();
+    return m_priv->size();
 }
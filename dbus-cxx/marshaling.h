@@ -9,6 +9,8 @@
 #define DBUSCXX_MARSHALING_H
 
 #include <stdint.h>
+#include <memory_resource>
+#include <string_view>
 #include <vector>
 #include <dbus-cxx/path.h>
 #include <dbus-cxx/signature.h>
@@ -34,6 +36,13 @@ public:
      */
     Marshaling( std::vector<uint8_t>* data, Endianess endian );
 
+    /**
+     * Create a new Marshaling class that operates on the given vector of
+     * data, with the given endianess.  Any memory that the data needs is
+     * taken from the vector's memory resource.
+     */
+    Marshaling( std::pmr::vector<uint8_t>* data, Endianess endian );
+
     ~Marshaling();
 
     /**
@@ -43,6 +52,13 @@ public:
      */
     void set_data( std::vector<uint8_t>* data );
 
+    /**
+     * Set the data vector to marshal/demarshal.
+     *
+     * @param data
+     */
+    void set_data( std::pmr::vector<uint8_t>* data );
+
     void set_endianess( Endianess endian );
 
     void marshal( bool v );
@@ -59,6 +75,23 @@ public:
     void marshal( Signature v );
     void marshal( const Variant& v );
 
+    /**
+     * Marshal an array of fixed-size elements(the elements of an array,
+     * not the array length) all at once.  The elements are in the byte
+     * order of this machine, and are converted to our endianess if needed.
+     *
+     * @param data The first element
+     * @param count The number of elements
+     * @param element_size The size of each element: 1, 2, 4 or 8 bytes
+     */
+    void marshal_fixed_array( const void* data, uint32_t count, int element_size );
+
+    /**
+     * Marshal the characters in the view as a string, without needing a
+     * std::string to hold them first.
+     */
+    void marshal_string_view( std::string_view v );
+
     void align( int alignment );
 
     /**
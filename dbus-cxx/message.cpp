@@ -20,39 +20,287 @@
 #include "validator.h"
 #include "utility.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <optional>
 #include <unistd.h>
 
 static const char* LOGGER_NAME = "DBus.Message";
 
+/* One more than the highest header field code */
+#define HEADER_FIELD_SLOTS 10
+
 namespace DBus {
 
 class Message::priv_data {
 public:
+    typedef DBUS_CXX_PROPAGATE_CONST( std::unique_ptr<priv_data> ) Pointer;
+
     priv_data() :
         m_valid( true ),
+        m_rawHeaderOffsets{},
+        m_rawHeaderLength( 0 ),
+        m_undecodedHeaders( 0 ),
+        m_serializedHeaderEndianess( Endianess::Little ),
+        m_body( std::in_place ),
+        m_bodySliceLength( 0 ),
         m_endianess( DBus::default_endianess() ),
         m_flags( 0 ),
         m_serial( 0 )
     {}
 
+    /**
+     * Decode the given header field out of the raw header, if it has not
+     * been decoded yet.
+     */
+    void decode_header_field( uint8_t slot ) const;
+
+    /**
+     * Get the data for a new message, reusing the data of a message that
+     * was destroyed on this thread if there is one.
+     */
+    static Pointer acquire();
+
+    /**
+     * Keep the data of a message that is being destroyed, so that the next
+     * message created on this thread can use it(and its memory) again.
+     */
+    static void release( Pointer data );
+
+    /**
+     * Make this the same as a newly created priv_data, keeping the memory
+     * of the body.
+     *
+     * @return false if this can't be reused
+     */
+    bool reset();
+
+private:
+    static std::vector<Pointer>* thread_cache();
+
+public:
 
     bool m_valid;
-    std::map<MessageHeaderFields, Variant> m_headerMap;
-    std::vector<uint8_t> m_body;
+    /* Header fields, indexed by their field code */
+    mutable std::array<Variant, HEADER_FIELD_SLOTS> m_headerFields;
+    /*
+     * Header fields of received messages are only decoded when somebody asks
+     * for them; until then, this is where the variant for each one starts in
+     * m_rawHeader.  m_undecodedHeaders has a bit set for each field that
+     * still needs to be decoded.
+     */
+    std::array<uint32_t, HEADER_FIELD_SLOTS> m_rawHeaderOffsets;
+    std::shared_ptr<const uint8_t> m_rawHeader;
+    uint32_t m_rawHeaderLength;
+    mutable std::atomic<uint16_t> m_undecodedHeaders;
+    mutable std::mutex m_headerDecodeLock;
+    /* When set, every header field except the signature is taken from this message */
+    std::shared_ptr<const Message> m_prototype;
+    /*
+     * Messages that use this one as their prototype share its serialized
+     * header, as long as their signature is the same.
+     */
+    mutable std::mutex m_serializedHeaderLock;
+    mutable std::shared_ptr<const std::vector<uint8_t>> m_serializedHeader;
+    mutable std::string m_serializedHeaderSignature;
+    mutable Endianess m_serializedHeaderEndianess;
+    /*
+     * Always set.  The allocator of a std::pmr::vector can't be changed once
+     * it is made, so set_memory_resource() puts a new vector in here.
+     */
+    std::optional<std::pmr::vector<uint8_t>> m_body;
+    /* When set, the body is not in m_body but in this slice of shared data(e.g. a receive buffer) */
+    std::shared_ptr<const uint8_t> m_bodySlice;
+    uint32_t m_bodySliceLength;
     Endianess m_endianess;
     uint8_t m_flags;
     std::vector<int> m_filedescriptors;
     uint32_t m_serial;
 };
 
+/* The most priv_datas that one thread keeps for reuse */
+#define MAX_POOLED_MESSAGES 64
+/* Bodies bigger than this go back to the heap instead of being reused */
+#define MAX_POOLED_BODY_CAPACITY 65536
+
+/*
+ * Messages may be destroyed while the thread is exiting, after its cache is
+ * gone; this is trivially destructible, so it is still safe to look at.
+ */
+static thread_local bool t_messageCacheDestroyed = false;
+
+std::vector<Message::priv_data::Pointer>* Message::priv_data::thread_cache() {
+    struct Cache {
+        ~Cache() { t_messageCacheDestroyed = true; }
+
+        std::vector<Pointer> m_data;
+    };
+
+    if( t_messageCacheDestroyed ) {
+        return nullptr;
+    }
+
+    static thread_local Cache cache;
+    return &cache.m_data;
+}
+
+Message::priv_data::Pointer Message::priv_data::acquire() {
+    std::vector<Pointer>* cache = thread_cache();
+
+    if( !cache || cache->empty() ) {
+        return std::make_unique<priv_data>();
+    }
+
+    Pointer data = std::move( cache->back() );
+    cache->pop_back();
+    // The default may have changed since this was released
+    data->m_endianess = DBus::default_endianess();
+    return data;
+}
+
+void Message::priv_data::release( Pointer data ) {
+    std::vector<Pointer>* cache = thread_cache();
+
+    if( !cache || cache->size() >= MAX_POOLED_MESSAGES ) {
+        return;
+    }
+
+    try {
+        if( !data->reset() ) {
+            return;
+        }
+
+        cache->push_back( std::move( data ) );
+    } catch( ... ) {
+        // We're called from a destructor; just let the data go
+    }
+}
+
+bool Message::priv_data::reset() {
+    if( m_body->get_allocator().resource() != std::pmr::get_default_resource() ||
+        m_body->capacity() > MAX_POOLED_BODY_CAPACITY ) {
+        // The resource may not outlive us, or we would hold on to too much memory
+        return false;
+    }
+
+    m_valid = true;
+
+    for( Variant& field : m_headerFields ) {
+        field = Variant();
+    }
+
+    m_rawHeaderOffsets = {};
+    m_rawHeader.reset();
+    m_rawHeaderLength = 0;
+    m_undecodedHeaders = 0;
+    m_prototype.reset();
+    m_serializedHeader.reset();
+    m_serializedHeaderSignature.clear();
+    m_serializedHeaderEndianess = Endianess::Little;
+    m_body->clear();
+    m_bodySlice.reset();
+    m_bodySliceLength = 0;
+    m_flags = 0;
+    m_filedescriptors.clear();
+    m_serial = 0;
+
+    return true;
+}
+
+void Message::priv_data::decode_header_field( uint8_t slot ) const {
+    std::unique_lock<std::mutex> lock( m_headerDecodeLock );
+
+    if( !( m_undecodedHeaders & ( 1 << slot ) ) ) {
+        // Somebody else decoded this while we were waiting
+        return;
+    }
+
+    Demarshaling demarshal( m_rawHeader.get(), m_rawHeaderLength, m_endianess );
+    demarshal.set_data_offset( m_rawHeaderOffsets[ slot ] );
+    m_headerFields[ slot ] = demarshal.demarshal_variant();
+
+    m_undecodedHeaders &= ~( 1 << slot );
+}
+
+/**
+ * Skip over a header field value without decoding it.  Only the types that
+ * the spec uses for header fields are handled.
+ *
+ * @return true if the value was skipped, false if it needs to be decoded
+ */
+static bool skip_header_value( Demarshaling* demarshal, uint32_t headerEnd ) {
+    uint32_t start = demarshal->current_offset();
+    uint32_t len;
+
+    if( demarshal->demarshal_uint8_t() != 1 ) {
+        demarshal->set_data_offset( start );
+        return false;
+    }
+
+    uint8_t type = demarshal->demarshal_uint8_t();
+    demarshal->demarshal_uint8_t();
+
+    switch( type ) {
+    case 's':
+    case 'o':
+        demarshal->align( 4 );
+        len = demarshal->demarshal_uint32_t() + 1;
+        break;
+
+    case 'g':
+        len = demarshal->demarshal_uint8_t() + 1;
+        break;
+
+    case 'u':
+        demarshal->align( 4 );
+        len = 4;
+        break;
+
+    default:
+        demarshal->set_data_offset( start );
+        return false;
+    }
+
+    if( static_cast<uint64_t>( demarshal->current_offset() ) + len > headerEnd ) {
+        // Let the normal demarshaling deal with it
+        demarshal->set_data_offset( start );
+        return false;
+    }
+
+    demarshal->set_data_offset( demarshal->current_offset() + len );
+
+    return true;
+}
+
+/**
+ * Write a uint32 into already marshaled data.
+ */
+static void patch_uint32( uint8_t* location, uint32_t value, Endianess endian ) {
+    if( endian == Endianess::Little ) {
+        location[ 0 ] = value & 0xFF;
+        location[ 1 ] = ( value >> 8 ) & 0xFF;
+        location[ 2 ] = ( value >> 16 ) & 0xFF;
+        location[ 3 ] = ( value >> 24 ) & 0xFF;
+    } else {
+        location[ 0 ] = ( value >> 24 ) & 0xFF;
+        location[ 1 ] = ( value >> 16 ) & 0xFF;
+        location[ 2 ] = ( value >> 8 ) & 0xFF;
+        location[ 3 ] = value & 0xFF;
+    }
+}
+
 Message::Message() {
-    m_priv = std::make_unique<priv_data>();
+    m_priv = priv_data::acquire();
 }
 
 Message::~Message() {
     for( int i : m_priv->m_filedescriptors ) {
         close( i );
     }
+
+    priv_data::release( std::move( m_priv ) );
 }
 
 
@@ -78,7 +326,8 @@ bool Message::operator == ( const Message& other ) {
 
     if( headersEqual ) {
         // Okay, all of the headers are equal at this point, now we can check the raw data
-        dataEqual = m_priv->m_body == other.m_priv->m_body;
+        dataEqual = body_size() == other.body_size() &&
+            std::equal( body_data(), body_data() + body_size(), other.body_data() );
     }
 
     return  headersEqual && dataEqual;
@@ -123,7 +372,7 @@ bool Message::auto_start() {
 bool Message::set_destination( const std::string& s ) {
     if( Validator::validate_bus_name( s ) == false ) { return false; }
 
-    m_priv->m_headerMap[ MessageHeaderFields::Destination ] = DBus::Variant( s );
+    set_header_field( MessageHeaderFields::Destination, DBus::Variant( s ) );
     return true;
 }
 
@@ -170,11 +419,70 @@ Signature Message::signature() const {
 }
 
 bool Message::serialize_to_vector( std::vector<uint8_t>* vec, uint32_t serial ) const {
+    if( m_priv->m_prototype ) {
+        return serialize_from_prototype( vec, serial );
+    }
+
+    return serialize_fields_to_vector( vec, serial );
+}
+
+bool Message::serialize_from_prototype( std::vector<uint8_t>* vec, uint32_t serial ) const {
+    const priv_data* prototype = m_priv->m_prototype->m_priv.get();
+    std::shared_ptr<const std::vector<uint8_t>> header;
+    std::string sig = signature().str();
+    Endianess endian = DBus::default_endianess();
+
+    {
+        std::unique_lock<std::mutex> lock( prototype->m_serializedHeaderLock );
+
+        if( prototype->m_serializedHeader &&
+            prototype->m_serializedHeaderSignature == sig &&
+            prototype->m_serializedHeaderEndianess == endian ) {
+            header = prototype->m_serializedHeader;
+        }
+    }
+
+    if( !header ) {
+        // Serialize ourselves the normal way, and keep everything but the body
+        std::shared_ptr<std::vector<uint8_t>> newHeader = std::make_shared<std::vector<uint8_t>>();
+
+        if( !serialize_fields_to_vector( newHeader.get(), 0 ) ) {
+            return false;
+        }
+
+        newHeader->resize( newHeader->size() - body_size() );
+        header = newHeader;
+
+        std::unique_lock<std::mutex> lock( prototype->m_serializedHeaderLock );
+        prototype->m_serializedHeader = header;
+        prototype->m_serializedHeaderSignature = sig;
+        prototype->m_serializedHeaderEndianess = endian;
+    }
+
+    size_t start = vec->size();
+    vec->reserve( start + header->size() + body_size() );
+    vec->insert( vec->end(), header->begin(), header->end() );
+
+    // The flags, body length and serial are the only things that differ
+    ( *vec )[ start + 2 ] = m_priv->m_flags;
+    patch_uint32( vec->data() + start + 4, body_size(), endian );
+    patch_uint32( vec->data() + start + 8, serial, endian );
+
+    vec->insert( vec->end(), body_data(), body_data() + body_size() );
+
+    if( !Validator::message_is_small_enough( vec ) ) {
+        return false;
+    }
+
+    return true;
+}
+
+bool Message::serialize_fields_to_vector( std::vector<uint8_t>* vec, uint32_t serial ) const {
     Marshaling marshal( vec, DBus::default_endianess() );
     Variant serialHeader = header_field( MessageHeaderFields::Reply_Serial );
     bool mustHaveSerial = false;
 
-    vec->reserve( vec->size() + m_priv->m_body.size() + 256 );
+    vec->reserve( vec->size() + body_size() + 256 );
     if(DBus::default_endianess() == Endianess::Little){
         marshal.marshal( static_cast<uint8_t>( 'l' ) );
     }else{
@@ -211,7 +519,7 @@ bool Message::serialize_to_vector( std::vector<uint8_t>* vec, uint32_t serial )
     marshal.marshal( static_cast<uint8_t>( 1 ) );
 
     // Marshal the length
-    marshal.marshal( static_cast<uint32_t>( m_priv->m_body.size() ) );
+    marshal.marshal( static_cast<uint32_t>( body_size() ) );
 
     if( mustHaveSerial ) {
         // Make sure that we have a header for our serial and it is not 0
@@ -233,12 +541,14 @@ bool Message::serialize_to_vector( std::vector<uint8_t>* vec, uint32_t serial )
     // Marshal our header array
     marshal.marshal( static_cast<uint32_t>( 0 ) ); // The size of the header array; we update this later
 
-    for( const std::pair<const MessageHeaderFields, Variant>& entry : m_priv->m_headerMap ) {
-        if( entry.second.type() == DataType::INVALID ) { continue; }
+    for( uint8_t slot = 1; slot < HEADER_FIELD_SLOTS; slot++ ) {
+        Variant value = header_field( int_to_header_field( slot ) );
+
+        if( value.type() == DataType::INVALID ) { continue; }
 
         marshal.align( 8 );
-        marshal.marshal( header_field_to_int( entry.first ) );
-        marshal.marshal( entry.second );
+        marshal.marshal( slot );
+        marshal.marshal( value );
     }
 
     // The size of the header array is always at offset 12
@@ -247,9 +557,7 @@ bool Message::serialize_to_vector( std::vector<uint8_t>* vec, uint32_t serial )
     // Align the message data to an 8-byte boundary and add the data!
     marshal.align( 8 );
 
-    for( const uint8_t& byte : m_priv->m_body ) {
-        vec->push_back( byte );
-    }
+    vec->insert( vec->end(), body_data(), body_data() + body_size() );
 
     if( !Validator::message_is_small_enough( vec ) ) {
         return false;
@@ -258,8 +566,8 @@ bool Message::serialize_to_vector( std::vector<uint8_t>* vec, uint32_t serial )
     return true;
 }
 
-std::shared_ptr<Message> Message::create_from_data( uint8_t* data, uint32_t data_len, std::vector<int> fds ) {
-    Demarshaling demarshal( data, data_len, Endianess::Big );
+std::shared_ptr<Message> Message::create_from_header( std::shared_ptr<const uint8_t> data, uint32_t data_len, std::vector<int> fds, uint32_t* bodyOffset ) {
+    Demarshaling demarshal( data.get(), data_len, Endianess::Big );
     uint8_t method_type;
     uint8_t flags;
     uint8_t protoVersion;
@@ -267,7 +575,9 @@ std::shared_ptr<Message> Message::create_from_data( uint8_t* data, uint32_t data
     uint32_t serial;
     uint32_t arrayLen;
     std::shared_ptr<Message> retmsg;
-    std::map<MessageHeaderFields, Variant> headerMap;
+    std::array<Variant, HEADER_FIELD_SLOTS> headerFields;
+    std::array<uint32_t, HEADER_FIELD_SLOTS> headerOffsets{};
+    uint16_t undecodedHeaders = 0;
     Endianess msgEndian = Endianess::Big;
     std::vector<int> real_fds;
 
@@ -283,20 +593,44 @@ std::shared_ptr<Message> Message::create_from_data( uint8_t* data, uint32_t data
     serial = demarshal.demarshal_uint32_t();
     arrayLen = demarshal.demarshal_uint32_t();
 
-    while( demarshal.current_offset() < ( 12 + arrayLen ) ) {
+    if( static_cast<uint64_t>( arrayLen ) + 16 > data_len ) {
+        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Message header is longer than the data provided; ignoring" );
+        return retmsg;
+    }
+
+    while( demarshal.current_offset() < ( 16 + arrayLen ) ) {
         uint8_t key_demarshal;
         MessageHeaderFields key;
         Variant value;
+        uint32_t valueOffset;
         demarshal.align( 8 );
         key_demarshal = demarshal.demarshal_uint8_t();
-        value = demarshal.demarshal_variant();
-
         key = int_to_header_field( key_demarshal );
+        valueOffset = demarshal.current_offset();
+
+        // Only the number of FDs is needed right away; everything else
+        // is decoded when it is asked for
+        if( key != MessageHeaderFields::Unix_FDs &&
+            skip_header_value( &demarshal, 16 + arrayLen ) ) {
+            if( key == MessageHeaderFields::Invalid ) {
+                SIMPLELOGGER_WARN( LOGGER_NAME, "Found invalid header field "
+                    << static_cast<int>( key_demarshal )
+                    << " when parsing; ignoring." );
+                continue;
+            }
+
+            headerOffsets[ key_demarshal ] = valueOffset;
+            headerFields[ key_demarshal ] = Variant();
+            undecodedHeaders |= ( 1 << key_demarshal );
+            continue;
+        }
+
+        value = demarshal.demarshal_variant();
 
         if( key == MessageHeaderFields::Invalid ) {
             std::ostringstream logmsg;
             logmsg << "Found invalid header field "
-                << static_cast<int>( key )
+                << static_cast<int>( key_demarshal )
                 << " when parsing; ignoring.  Value: "
                 << value;
             SIMPLELOGGER_WARN( LOGGER_NAME, logmsg.str() );
@@ -306,12 +640,19 @@ std::shared_ptr<Message> Message::create_from_data( uint8_t* data, uint32_t data
         if( key == MessageHeaderFields::Unix_FDs ) {
             int total_fds = value.to_uint32();
 
+            if( total_fds > static_cast<int>( fds.size() ) ) {
+                SIMPLELOGGER_WARN( LOGGER_NAME, "Message claims " << total_fds
+                    << " fds, but only " << fds.size() << " were received" );
+                total_fds = fds.size();
+            }
+
             for( int fd_num = 0; fd_num < total_fds; fd_num++ ) {
                 real_fds.push_back( fds[ fd_num ] );
             }
         }
 
-        headerMap[ key ] = value;
+        headerFields[ key_demarshal ] = value;
+        undecodedHeaders &= ~( 1 << key_demarshal );
     }
 
     // Make sure we're aligned to an 8-byte boundary
@@ -337,6 +678,10 @@ std::shared_ptr<Message> Message::create_from_data( uint8_t* data, uint32_t data
         SIMPLELOGGER_TRACE( LOGGER_NAME, "Creating SignalMessage from data" );
         retmsg = SignalMessage::create();
         break;
+
+    default:
+        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Unknown message type " << static_cast<int>( method_type ) << "; ignoring" );
+        return retmsg;
     }
 
     SIMPLELOGGER_DEBUG( LOGGER_NAME, "Message has " << real_fds.size() << " fds" );
@@ -344,26 +689,72 @@ std::shared_ptr<Message> Message::create_from_data( uint8_t* data, uint32_t data
     retmsg->m_priv->m_serial = serial;
     retmsg->m_priv->m_flags = flags;
     retmsg->m_priv->m_valid = true;
-    retmsg->m_priv->m_headerMap = headerMap;
+    retmsg->m_priv->m_headerFields = headerFields;
+    retmsg->m_priv->m_rawHeaderOffsets = headerOffsets;
+    retmsg->m_priv->m_undecodedHeaders = undecodedHeaders;
+    retmsg->m_priv->m_rawHeader = data;
+    retmsg->m_priv->m_rawHeaderLength = 16 + arrayLen;
     retmsg->m_priv->m_endianess = msgEndian;
-    retmsg->m_priv->m_body.reserve( bodyLen );
     retmsg->m_priv->m_filedescriptors = real_fds;
+    retmsg->m_priv->m_bodySliceLength = bodyLen;
+
+    *bodyOffset = demarshal.current_offset();
 
-    for( uint32_t x = 0; x < bodyLen; x++ ) {
-        retmsg->m_priv->m_body.push_back( demarshal.demarshal_uint8_t() );
+    if( ( static_cast<uint64_t>( *bodyOffset ) + bodyLen ) > data_len ) {
+        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Message body is longer than the data provided; ignoring" );
+        return std::shared_ptr<Message>();
     }
 
-    {
-        std::ostringstream debug_str;
-        debug_str << "Following message created from the data: " << retmsg;
-        SIMPLELOGGER_TRACE( LOGGER_NAME, debug_str.str() );
+    return retmsg;
+}
+
+std::shared_ptr<Message> Message::create_from_data( uint8_t* data, uint32_t data_len, std::vector<int> fds ) {
+    uint32_t bodyOffset;
+    // We don't own the data, so don't let the message free it
+    std::shared_ptr<Message> retmsg = create_from_header(
+        std::shared_ptr<const uint8_t>( data, []( const uint8_t* ){} ), data_len, fds, &bodyOffset );
+
+    if( !retmsg ) {
+        return retmsg;
+    }
+
+    if( retmsg->m_priv->m_undecodedHeaders ) {
+        // Keep our own copy of the header for decoding it later
+        uint32_t headerLength = retmsg->m_priv->m_rawHeaderLength;
+        std::shared_ptr<uint8_t> header( new uint8_t[ headerLength ], std::default_delete<uint8_t[]>() );
+        std::copy( data, data + headerLength, header.get() );
+        retmsg->m_priv->m_rawHeader = header;
+    } else {
+        retmsg->m_priv->m_rawHeader.reset();
     }
 
+    retmsg->m_priv->m_body->assign( data + bodyOffset,
+        data + bodyOffset + retmsg->m_priv->m_bodySliceLength );
+    retmsg->m_priv->m_bodySliceLength = 0;
+
+    SIMPLELOGGER_TRACE( LOGGER_NAME, "Following message created from the data: " << retmsg );
+
+    return retmsg;
+}
+
+std::shared_ptr<Message> Message::create_from_data( std::shared_ptr<const uint8_t> data, uint32_t data_len, std::vector<int> fds ) {
+    uint32_t bodyOffset;
+    std::shared_ptr<Message> retmsg = create_from_header( data, data_len, fds, &bodyOffset );
+
+    if( !retmsg ) {
+        return retmsg;
+    }
+
+    // Point at the body within the data, keeping all of the data alive
+    retmsg->m_priv->m_bodySlice = std::shared_ptr<const uint8_t>( data, data.get() + bodyOffset );
+
+    SIMPLELOGGER_TRACE( LOGGER_NAME, "Following message created from the data: " << retmsg );
+
     return retmsg;
 }
 
 void Message::append_signature( std::string toappend ) {
-    DBus::Variant val = m_priv->m_headerMap[ MessageHeaderFields::Signature ];
+    DBus::Variant val = header_field( MessageHeaderFields::Signature );
     std::string newval;
 
     if( val.type() != DataType::INVALID ) {
@@ -372,29 +763,37 @@ void Message::append_signature( std::string toappend ) {
     }
 
     newval += toappend;
-    m_priv->m_headerMap[ MessageHeaderFields::Signature ] = DBus::Variant( Signature( newval ) );
+    set_header_field( MessageHeaderFields::Signature, DBus::Variant( Signature( newval ) ) );
 }
 
 Variant Message::header_field( MessageHeaderFields field ) const {
-    std::map<MessageHeaderFields, Variant>::const_iterator location =
-        m_priv->m_headerMap.find( field );
+    uint8_t slot = header_field_to_int( field );
+
+    if( slot == 0 || slot >= HEADER_FIELD_SLOTS ) {
+        return DBus::Variant();
+    }
+
+    if( m_priv->m_prototype && field != MessageHeaderFields::Signature ) {
+        return m_priv->m_prototype->header_field( field );
+    }
 
-    if( location != m_priv->m_headerMap.end() ) {
-        return location->second;
+    if( m_priv->m_undecodedHeaders.load( std::memory_order_acquire ) & ( 1 << slot ) ) {
+        m_priv->decode_header_field( slot );
     }
 
-    return DBus::Variant();
+    return m_priv->m_headerFields[ slot ];
 }
 
 void Message::clear_sig_and_data() {
-    std::map<MessageHeaderFields, Variant>::const_iterator location =
-        m_priv->m_headerMap.find( MessageHeaderFields::Signature );
+    set_header_field( MessageHeaderFields::Signature, DBus::Variant() );
 
-    if( location != m_priv->m_headerMap.end() ) {
-        m_priv->m_headerMap.erase( location );
-    }
+    m_priv->m_body->clear();
+    m_priv->m_bodySlice.reset();
+    m_priv->m_bodySliceLength = 0;
+}
 
-    m_priv->m_body.clear();
+void Message::set_prototype( std::shared_ptr<const Message> prototype ) {
+    m_priv->m_prototype = prototype;
 }
 
 uint8_t Message::flags() const {
@@ -407,18 +806,79 @@ void Message::set_flags( uint8_t flags ) {
 
 Variant Message::set_header_field( MessageHeaderFields field, Variant value ) {
     DBus::Variant retval = header_field( field );
+    uint8_t slot = header_field_to_int( field );
+
+    if( slot == 0 || slot >= HEADER_FIELD_SLOTS ) {
+        return retval;
+    }
+
+    if( m_priv->m_prototype && field != MessageHeaderFields::Signature ) {
+        // Take our own copy of the prototype's fields before changing any of them
+        for( uint8_t protoSlot = 1; protoSlot < HEADER_FIELD_SLOTS; protoSlot++ ) {
+            if( protoSlot == header_field_to_int( MessageHeaderFields::Signature ) ) { continue; }
+
+            m_priv->m_headerFields[ protoSlot ] =
+                m_priv->m_prototype->header_field( int_to_header_field( protoSlot ) );
+        }
+
+        m_priv->m_prototype.reset();
+    }
 
-    m_priv->m_headerMap[ field ] = value;
+    m_priv->m_headerFields[ slot ] = value;
+
+    {
+        // Anybody using us as a prototype can't use our old header anymore
+        std::unique_lock<std::mutex> lock( m_priv->m_serializedHeaderLock );
+        m_priv->m_serializedHeader.reset();
+    }
 
     return retval;
 }
 
-std::vector<uint8_t>* Message::body() {
-    return &m_priv->m_body;
+void Message::set_memory_resource( std::pmr::memory_resource* resource ) {
+    if( resource == nullptr || resource == memory_resource() ) {
+        return;
+    }
+
+    std::pmr::vector<uint8_t> newBody( resource );
+    const uint8_t* data = body_data();
+    newBody.assign( data, data + body_size() );
+
+    m_priv->m_body.emplace( std::move( newBody ) );
+    m_priv->m_bodySlice.reset();
+    m_priv->m_bodySliceLength = 0;
+}
+
+std::pmr::memory_resource* Message::memory_resource() const {
+    return m_priv->m_body->get_allocator().resource();
+}
+
+std::pmr::vector<uint8_t>* Message::body() {
+    if( m_priv->m_bodySlice ) {
+        // We are going to be modified; take our own copy of the data
+        m_priv->m_body->assign( m_priv->m_bodySlice.get(),
+            m_priv->m_bodySlice.get() + m_priv->m_bodySliceLength );
+        m_priv->m_bodySlice.reset();
+        m_priv->m_bodySliceLength = 0;
+    }
+
+    return &*m_priv->m_body;
+}
+
+const uint8_t* Message::body_data() const {
+    if( m_priv->m_bodySlice ) {
+        return m_priv->m_bodySlice.get();
+    }
+
+    return m_priv->m_body->data();
 }
 
-const std::vector<uint8_t>* Message::body() const {
-    return &m_priv->m_body;
+uint32_t Message::body_size() const {
+    if( m_priv->m_bodySlice ) {
+        return m_priv->m_bodySliceLength;
+    }
+
+    return m_priv->m_body->size();
 }
 
 void Message::add_filedescriptor( int fd ) {
@@ -475,12 +935,17 @@ std::ostream& operator <<( std::ostream& os, const DBus::Message* msg ) {
     }
 
     os << std::endl;
-    os << "  Message length: " << msg->m_priv->m_body.size() << std::endl;
+    os << "  Message length: " << msg->body_size() << std::endl;
     os << "  Endianess: " << msg->m_priv->m_endianess << std::endl;
     os << "  Serial: " << msg->m_priv->m_serial << std::endl;
     os << "  Headers:" << std::endl;
 
-    for( const std::pair<const MessageHeaderFields, DBus::Variant>& set : msg->m_priv->m_headerMap ) {
+    for( uint8_t slot = 1; slot < HEADER_FIELD_SLOTS; slot++ ) {
+        std::pair<MessageHeaderFields, DBus::Variant> set( int_to_header_field( slot ),
+            msg->header_field( int_to_header_field( slot ) ) );
+
+        if( set.second.type() == DataType::INVALID ) { continue; }
+
         os << "    ";
 
         switch( set.first ) {
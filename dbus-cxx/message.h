@@ -10,6 +10,7 @@
 #include <dbus-cxx/messageappenditerator.h>
 #include <dbus-cxx/messageiterator.h>
 #include <memory>
+#include <memory_resource>
 #include <string>
 #include "enums.h"
 
@@ -148,8 +149,39 @@ public:
 
     const std::vector<int>& filedescriptors() const;
 
+    /**
+     * Take the memory for the body of this message, and for the iterators
+     * that append to it, from the given memory resource.  This should be
+     * done before anything is appended; the body that is already there is
+     * copied into memory from the new resource.
+     *
+     * The resource must exist for as long as this message does.  By default,
+     * the memory comes from std::pmr::get_default_resource().
+     *
+     * @param resource The resource to take memory from
+     */
+    void set_memory_resource( std::pmr::memory_resource* resource );
+
+    /**
+     * The memory resource that the body of this message is taken from.
+     */
+    std::pmr::memory_resource* memory_resource() const;
+
     static std::shared_ptr<Message> create_from_data( uint8_t* data, uint32_t data_len, std::vector<int> fds = std::vector<int>() );
 
+    /**
+     * Create a message from the given data without copying the body.  The
+     * message keeps a reference to the data for as long as it exists, and
+     * reads its body directly out of it.  The data must not be modified
+     * while any message refers to it.
+     *
+     * @param data The marshaled message
+     * @param data_len The length of the marshaled message
+     * @param fds The file descriptors that go along with the message
+     * @return The message, or an invalid pointer if the data is not valid
+     */
+    static std::shared_ptr<Message> create_from_data( std::shared_ptr<const uint8_t> data, uint32_t data_len, std::vector<int> fds = std::vector<int>() );
+
 protected:
 
     void append_signature( std::string toappend );
@@ -161,9 +193,25 @@ protected:
 
     void set_flags( uint8_t flags );
 
+    /**
+     * Take all of the header fields except for the signature from the given
+     * message.  The header is then only serialized once for all of the
+     * messages that share a prototype and have the same signature, instead
+     * of once for every message.
+     *
+     * Setting any header field other than the signature makes this message
+     * take its own copy of the prototype's fields.
+     */
+    void set_prototype( std::shared_ptr<const Message> prototype );
+
 private:
-    std::vector<uint8_t>* body();
-    const std::vector<uint8_t>* body() const;
+    bool serialize_fields_to_vector( std::vector<uint8_t>* vec, uint32_t serial ) const;
+    bool serialize_from_prototype( std::vector<uint8_t>* vec, uint32_t serial ) const;
+
+    static std::shared_ptr<Message> create_from_header( std::shared_ptr<const uint8_t> data, uint32_t data_len, std::vector<int> fds, uint32_t* bodyOffset );
+    std::pmr::vector<uint8_t>* body();
+    const uint8_t* body_data() const;
+    uint32_t body_size() const;
     void add_filedescriptor( int fd );
     uint32_t filedescriptors_size() const;
     int filedescriptor_at_location( int location ) const;
@@ -11,6 +11,7 @@
 #include <any>
 #include <stdint.h>
 #include <limits>
+#include <memory_resource>
 #include <cstring>
 #include "enums.h"
 #include "filedescriptor.h"
@@ -30,12 +31,39 @@ public:
     priv_data() :
         m_message( nullptr ),
         m_subiter( nullptr ),
+        m_subiterResource( nullptr ),
         m_currentContainer( ContainerType::None ),
         m_arraySizeLocation( 0 ) {}
 
+    /* Make a sub-iterator out of memory from the message's resource */
+    template <typename... Args>
+    MessageAppendIterator* create_subiter( Args&&... args ) {
+        m_subiterResource = m_message ? m_message->memory_resource() : std::pmr::new_delete_resource();
+        std::pmr::polymorphic_allocator<MessageAppendIterator> alloc( m_subiterResource );
+        MessageAppendIterator* subiter = alloc.allocate( 1 );
+
+        try {
+            new( subiter ) MessageAppendIterator( std::forward<Args>( args )... );
+        } catch( ... ) {
+            alloc.deallocate( subiter, 1 );
+            throw;
+        }
+
+        return subiter;
+    }
+
+    void destroy_subiter() {
+        std::pmr::polymorphic_allocator<MessageAppendIterator> alloc( m_subiterResource );
+
+        m_subiter->~MessageAppendIterator();
+        alloc.deallocate( m_subiter, 1 );
+        m_subiter = nullptr;
+    }
+
     Marshaling m_marshaling;
     Message* m_message;
     MessageAppendIterator* m_subiter;
+    std::pmr::memory_resource* m_subiterResource;
     ContainerType m_currentContainer;
     uint32_t m_arraySizeLocation;
     uint32_t m_arrayStartLocation;
@@ -47,14 +75,21 @@ MessageAppendIterator::MessageAppendIterator( ContainerType container ) {
 }
 
 MessageAppendIterator::MessageAppendIterator( Message& message, ContainerType container ) {
-    m_priv = std::make_shared<priv_data>();
+    m_priv = std::allocate_shared<priv_data>(
+        std::pmr::polymorphic_allocator<priv_data>( message.memory_resource() ) );
     m_priv->m_marshaling = Marshaling( message.body(), DBus::default_endianess() );
     m_priv->m_message = &message;
     m_priv->m_currentContainer = container;
 }
 
 MessageAppendIterator::MessageAppendIterator( std::shared_ptr<Message> message, ContainerType container ) {
-    m_priv = std::make_shared<priv_data>();
+    if( message ) {
+        m_priv = std::allocate_shared<priv_data>(
+            std::pmr::polymorphic_allocator<priv_data>( message->memory_resource() ) );
+    } else {
+        m_priv = std::make_shared<priv_data>();
+    }
+
     m_priv->m_message = message.get();
     m_priv->m_currentContainer = container;
 
@@ -216,6 +251,17 @@ MessageAppendIterator& MessageAppendIterator::operator<<( const std::string& v )
     return *this;
 }
 
+MessageAppendIterator& MessageAppendIterator::operator<<( const std::pmr::string& v ) {
+    if( !this->is_valid() ) { return *this; }
+
+    if( m_priv->m_currentContainer == ContainerType::None ) {
+        m_priv->m_message->append_signature( signature( std::string() ) );
+    }
+
+    m_priv->m_marshaling.marshal_string_view( v );
+    return *this;
+}
+
 MessageAppendIterator& MessageAppendIterator::operator<<( const Signature& v ) {
     if( !this->is_valid() ) { return *this; }
 
@@ -299,7 +345,8 @@ MessageAppendIterator& MessageAppendIterator::operator<<( const Variant& v ) {
     // the DICT_ENTRY on an 8-byte boundary, which results in padding being
     // inserted into the data stream.  This padding is not always needed,
     // so we remove the padding and then do the alignment here.
-    const std::vector<uint8_t>* dataToMarshal = v.marshaled();
+    const uint8_t* dataToMarshal = v.marshaled_data();
+    size_t dataSize = v.marshaled_size();
     bool isDict = false;
     if( v.type() == DataType::ARRAY ){
         // determine if we have a dict or not.  If we do, remove padding
@@ -314,7 +361,7 @@ MessageAppendIterator& MessageAppendIterator::operator<<( const Variant& v ) {
 
     }
 
-    for( size_t x = 0; x < dataToMarshal->size(); x++ ) {
+    for( size_t x = 0; x < dataSize; x++ ) {
         if( isDict &&
                 (x == 4 || x == 5 || x == 6 || x == 7) ){
             // Ignore the 4 padding bytes that the variant inserts
@@ -324,7 +371,7 @@ MessageAppendIterator& MessageAppendIterator::operator<<( const Variant& v ) {
             // make sure to align for all of the dict entries
             m_priv->m_marshaling.align( 8 );
         }
-        m_priv->m_marshaling.marshal( (*dataToMarshal)[x] );
+        m_priv->m_marshaling.marshal( dataToMarshal[x] );
     }
 
     this->close_container();
@@ -382,9 +429,9 @@ bool MessageAppendIterator::open_container( ContainerType t, const std::string&
             m_priv->m_message->append_signature( signature );
         }
 
-        m_priv->m_subiter = new MessageAppendIterator( *m_priv->m_message, t );
+        m_priv->m_subiter = m_priv->create_subiter( *m_priv->m_message, t );
     } else {
-        m_priv->m_subiter = new MessageAppendIterator( t );
+        m_priv->m_subiter = m_priv->create_subiter( t );
     }
 
     return true;
@@ -414,8 +461,7 @@ bool MessageAppendIterator::close_container( ) {
         break;
     }
 
-    delete m_priv->m_subiter;
-    m_priv->m_subiter = nullptr;
+    m_priv->destroy_subiter();
     return true;
 }
 
@@ -423,5 +469,11 @@ MessageAppendIterator* MessageAppendIterator::sub_iterator() {
     return m_priv->m_subiter;
 }
 
+void MessageAppendIterator::append_fixed_array( const void* data, uint32_t count, int element_size ) {
+    if( !this->is_valid() ) { return; }
+
+    m_priv->m_marshaling.marshal_fixed_array( data, count, element_size );
+}
+
 }
 
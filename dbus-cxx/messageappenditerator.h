@@ -72,6 +72,7 @@ public:
     MessageAppendIterator& operator<<( const double& v );
     MessageAppendIterator& operator<<( const char* v );
     MessageAppendIterator& operator<<( const std::string& v );
+    MessageAppendIterator& operator<<( const std::pmr::string& v );
     MessageAppendIterator& operator<<( const Signature& v );
     MessageAppendIterator& operator<<( const Path& v );
     MessageAppendIterator& operator<<( const std::shared_ptr<FileDescriptor> v );
@@ -88,8 +89,8 @@ public:
         return *this;
     }
 
-    template <typename T>
-    MessageAppendIterator& operator<<( const std::vector<T>& v ) {
+    template <typename T, typename Alloc>
+    MessageAppendIterator& operator<<( const std::vector<T, Alloc>& v ) {
         bool success;
         T type {};
 
@@ -99,8 +100,12 @@ public:
             throw ErrorNoMemory();
         }
 
-        for( size_t i = 0; i < v.size(); i++ ) {
-            *sub_iterator() << v[i];
+        if constexpr( is_fixed_array_element<T>::value ) {
+            sub_iterator()->append_fixed_array( v.data(), v.size(), sizeof( T ) );
+        } else {
+            for( size_t i = 0; i < v.size(); i++ ) {
+                *sub_iterator() << v[i];
+            }
         }
 
         success = this->close_container();
@@ -112,10 +117,10 @@ public:
         return *this;
     }
 
-    template <typename Key, typename Data>
-    MessageAppendIterator& operator<<( const std::map<Key, Data>& dictionary ) {
+    template <typename Key, typename Data, typename Compare, typename Alloc>
+    MessageAppendIterator& operator<<( const std::map<Key, Data, Compare, Alloc>& dictionary ) {
         std::string sig = signature_dict_data( dictionary );
-        typename std::map<Key, Data>::const_iterator it;
+        typename std::map<Key, Data, Compare, Alloc>::const_iterator it;
         this->open_container( ContainerType::ARRAY, sig );
 
         for( it = dictionary.begin(); it != dictionary.end(); it++ ) {
@@ -152,6 +157,11 @@ private:
 
     MessageAppendIterator* sub_iterator();
 
+    /**
+     * Append the elements of an array of fixed-size numbers all at once.
+     */
+    void append_fixed_array( const void* data, uint32_t count, int element_size );
+
 private:
     class priv_data;
 
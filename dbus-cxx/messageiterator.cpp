@@ -12,6 +12,7 @@
 #include "types.h"
 #include "variant.h"
 #include "dbus-cxx-private.h"
+#include "byteswap.h"
 
 #include <unistd.h>
 #include <fcntl.h>
@@ -75,8 +76,8 @@ MessageIterator::MessageIterator( const Message& message ):
     m_priv( std::make_shared<priv_data>() ) {
     m_priv->m_message = &message;
     m_priv->m_demarshal = std::shared_ptr<Demarshaling>(
-            new Demarshaling( m_priv->m_message->body()->data(),
-                m_priv->m_message->body()->size(),
+            new Demarshaling( m_priv->m_message->body_data(),
+                m_priv->m_message->body_size(),
                 m_priv->m_message->endianess() )
         );
     m_priv->m_signatureIterator = m_priv->m_message->signature().begin();
@@ -87,8 +88,8 @@ MessageIterator::MessageIterator( std::shared_ptr<Message> message ):
     m_priv( std::make_shared<priv_data>() ) {
     m_priv->m_message = message.get();
     m_priv->m_demarshal = std::shared_ptr<Demarshaling>(
-            new Demarshaling( m_priv->m_message->body()->data(),
-                m_priv->m_message->body()->size(),
+            new Demarshaling( m_priv->m_message->body_data(),
+                m_priv->m_message->body_size(),
                 m_priv->m_message->endianess() )
         );
     m_priv->m_signatureIterator = m_priv->m_message->signature().begin();
@@ -602,6 +603,18 @@ Variant MessageIterator::get_variant() {
     return Variant::createFromDemarshal( sig, m_priv->m_demarshal, descriptors, 0 );
 }
 
+std::string_view MessageIterator::get_string_view() {
+    if( !( this->arg_type() == DataType::STRING || this->arg_type() == DataType::OBJECT_PATH || this->arg_type() == DataType::SIGNATURE ) ) {
+        throw ErrorInvalidTypecast( "MessageIterator: getting string view and type is not one of DataType::STRING, DataType::OBJECT_PATH or DataType::SIGNATURE" );
+    }
+
+    if( this->arg_type() == DataType::SIGNATURE ) {
+        return m_priv->m_demarshal->demarshal_signature_view();
+    }
+
+    return m_priv->m_demarshal->demarshal_string_view();
+}
+
 Signature MessageIterator::get_signature() {
     return m_priv->m_demarshal->demarshal_signature();
 }
@@ -610,6 +623,46 @@ void MessageIterator::align( int alignment ) {
     m_priv->m_demarshal->align( alignment );
 }
 
+uint32_t MessageIterator::get_fixed_array_count( int element_size ) {
+    uint32_t array_len = m_priv->m_demarshal->demarshal_uint32_t();
+
+    // The padding after the length is not part of the array
+    m_priv->m_demarshal->align( element_size );
+
+    if( array_len % element_size != 0 ) {
+        throw ErrorUnableToParse( "Array length is not a multiple of the element size" );
+    }
+
+    SIMPLELOGGER_TRACE_STDSTR( LOGGER_NAME,
+                               "Extracting fixed array.  Array len: " << array_len
+                               << " position: " << m_priv->m_demarshal->current_offset() );
+
+    return array_len / element_size;
+}
+
+void MessageIterator::get_fixed_array_data( void* data, uint32_t count, int element_size ) {
+    m_priv->m_demarshal->demarshal_fixed_array( data, count, element_size );
+}
+
+const uint8_t* MessageIterator::get_fixed_array_view( uint32_t* count, int element_size, int alignment ) {
+    uint32_t start = m_priv->m_demarshal->current_offset();
+
+    *count = get_fixed_array_count( element_size );
+    const uint8_t* data = m_priv->m_demarshal->demarshal_fixed_array_view( *count, element_size );
+
+    if( reinterpret_cast<uintptr_t>( data ) % alignment != 0 ) {
+        // Leave the array where it was, so that it can be copied out instead
+        m_priv->m_demarshal->set_data_offset( start );
+        throw ErrorInvalidTypecast( "MessageIterator: Array is not aligned in memory" );
+    }
+
+    return data;
+}
+
+bool MessageIterator::is_host_endianess() const {
+    return m_priv->m_message->endianess() == priv::host_endianess();
+}
+
 SignatureIterator MessageIterator::signature_iterator() {
     return m_priv->m_signatureIterator;
 }
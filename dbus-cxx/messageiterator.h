@@ -6,6 +6,7 @@
  *   This file is part of the dbus-cxx library.                            *
  ***************************************************************************/
 #include <stdint.h>
+#include <dbus-cxx/arrayview.h>
 #include <dbus-cxx/demangle.h>
 #include <dbus-cxx/types.h>
 #include <dbus-cxx/variant.h>
@@ -14,6 +15,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <type_traits>
 #include <vector>
@@ -202,16 +204,63 @@ public:
     Signature get_signature();
 
     /**
-     * Get values in an array, pushing them back one at a time
+     * Get a string, object path or signature without copying it.  The view
+     * points into the body of the message, so it is only valid for as long
+     * as the Message is.
+     */
+    std::string_view get_string_view();
+
+    /**
+     * Get an array of fixed-size numbers without copying it.  The view
+     * points into the body of the message, so it is only valid for as long
+     * as the Message is.
+     *
+     * The elements can only be used in place when the message is in the
+     * byte order of this machine, and they are aligned in memory; extract
+     * into a std::vector otherwise.  Nothing is consumed if the array
+     * cannot be used in place, so the same array can then be extracted.
+     *
+     * @throws ErrorInvalidTypecast if this is not an array of T, or if the
+     * array cannot be used in place
      */
     template <typename T>
-    void get_array( std::vector<T>& array ) {
+    ArrayView<T> get_array_view() {
+        static_assert( is_fixed_array_element<T>::value, "ArrayView can only hold fixed-size numbers" );
+
+        if( !this->is_array() || this->element_type() != DBus::type( T() ) ) {
+            throw ErrorInvalidTypecast( "MessageIterator: Extracting wrong type of array into ArrayView" );
+        }
+
+        if( sizeof( T ) > 1 && !this->is_host_endianess() ) {
+            throw ErrorInvalidTypecast( "MessageIterator: Array is not in the byte order of this machine" );
+        }
+
+        uint32_t count;
+        const uint8_t* data = this->get_fixed_array_view( &count, sizeof( T ), alignof( T ) );
+
+        return ArrayView<T>( reinterpret_cast<const T*>( data ), count );
+    }
+
+    /**
+     * Get values in an array, pushing them back one at a time.  Arrays of
+     * fixed-size numbers are copied out of the message all at once.
+     */
+    template <typename T, typename Alloc>
+    void get_array( std::vector<T, Alloc>& array ) {
         if( !this->is_array() ) { /* Should never happen */
             throw ErrorInvalidTypecast( "MessageIterator: Extracting non array into std::vector" );
         }
 
         array.clear();
 
+        if constexpr( is_fixed_array_element<T>::value ) {
+            if( this->element_type() == DBus::type( T() ) ) {
+                array.resize( this->get_fixed_array_count( sizeof( T ) ) );
+                this->get_fixed_array_data( array.data(), array.size(), sizeof( T ) );
+                return;
+            }
+        }
+
         MessageIterator subiter = this->recurse();
 
         while( subiter.is_valid() ) {
@@ -232,8 +281,8 @@ public:
         tup );
     }
 
-    template <typename Key, typename Data>
-    void get_dict( std::map<Key, Data>& dict ) {
+    template <typename Key, typename Data, typename Compare, typename Alloc>
+    void get_dict( std::map<Key, Data, Compare, Alloc>& dict ) {
         MessageIterator subiter = this->recurse();
 
         while( subiter.is_valid() ) {
@@ -278,13 +327,13 @@ public:
         return newMap;
     }
 
-    template <typename Key, typename Data>
-    MessageIterator& operator>>( std::map<Key, Data>& m ) {
+    template <typename Key, typename Data, typename Compare, typename Alloc>
+    MessageIterator& operator>>( std::map<Key, Data, Compare, Alloc>& m ) {
         if( !this->is_dict() ) {
             throw ErrorInvalidTypecast( "MessageIterator: Extracting non dict into std::map" );
         }
 
-        get_dict<Key, Data>( m );
+        get_dict( m );
         this->next();
         return *this;
     }
@@ -296,13 +345,35 @@ public:
         return *this;
     }
 
-    template <typename T>
-    MessageIterator& operator>>( std::vector<T>& v ) {
+    template <typename T, typename Alloc>
+    MessageIterator& operator>>( std::vector<T, Alloc>& v ) {
         if( !this->is_array() ) {
             throw ErrorInvalidTypecast( "MessageIterator: Extracting non array into std::vector" );
         }
 
-        this->get_array<T>( v );
+        this->get_array( v );
+        this->next();
+        return *this;
+    }
+
+    MessageIterator& operator>>( std::string_view& v ) {
+        v = this->get_string_view();
+        this->next();
+        return *this;
+    }
+
+    /**
+     * Extract a string into memory from the string's own memory resource.
+     */
+    MessageIterator& operator>>( std::pmr::string& v ) {
+        v.assign( this->get_string_view() );
+        this->next();
+        return *this;
+    }
+
+    template <typename T>
+    MessageIterator& operator>>( ArrayView<T>& v ) {
+        v = this->get_array_view<T>();
         this->next();
         return *this;
     }
@@ -338,6 +409,31 @@ public:
 private:
     SignatureIterator signature_iterator();
 
+    /**
+     * Start reading the array that we point at without a sub-iterator.
+     * Returns the number of elements in the array.
+     */
+    uint32_t get_fixed_array_count( int element_size );
+
+    /**
+     * Copy the elements of the array started with get_fixed_array_count()
+     * into data.
+     */
+    void get_fixed_array_data( void* data, uint32_t count, int element_size );
+
+    /**
+     * Step over the array that we point at without a sub-iterator,
+     * returning where its elements are in the message.  If the elements
+     * are not aligned, nothing is consumed.
+     *
+     * @param count Set to the number of elements in the array
+     * @throws ErrorInvalidTypecast if the elements are not aligned
+     */
+    const uint8_t* get_fixed_array_view( uint32_t* count, int element_size, int alignment );
+
+    /** True if the message is in the byte order of this machine */
+    bool is_host_endianess() const;
+
     /**
      * Align our memory to the specified location.  This skips bytes.
      * This is for internal use only; don't call it in client code!
@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ ***************************************************************************/
+#include "messagepool.h"
+
+#include <new>
+#include <vector>
+
+using DBus::priv::MessagePool;
+
+/* Blocks are cached in multiples of this size */
+#define SIZE_CLASS_BYTES 64
+#define NUM_SIZE_CLASSES 4
+/* The most blocks of each size that one thread keeps */
+#define MAX_CACHED_BLOCKS 128
+
+namespace {
+
+struct BlockCache {
+    BlockCache();
+    ~BlockCache();
+
+    std::vector<void*> m_free[ NUM_SIZE_CLASSES ];
+};
+
+/*
+ * Messages may be freed while the thread is exiting, after its cache is
+ * gone; this is trivially destructible, so it is still safe to look at.
+ */
+thread_local bool t_cacheDestroyed = false;
+
+BlockCache::BlockCache() {
+    // Giving a block back must never need to allocate
+    for( std::vector<void*>& blocks : m_free ) {
+        blocks.reserve( MAX_CACHED_BLOCKS );
+    }
+}
+
+BlockCache::~BlockCache() {
+    t_cacheDestroyed = true;
+
+    for( std::vector<void*>& blocks : m_free ) {
+        for( void* block : blocks ) {
+            ::operator delete( block );
+        }
+    }
+}
+
+BlockCache* thread_cache() {
+    if( t_cacheDestroyed ) {
+        return nullptr;
+    }
+
+    static thread_local BlockCache cache;
+    return &cache;
+}
+
+/* Which size class a block belongs to, or -1 if it is too big to cache */
+int size_class( size_t size ) {
+    size_t sizeClass = ( size + SIZE_CLASS_BYTES - 1 ) / SIZE_CLASS_BYTES;
+
+    if( sizeClass == 0 || sizeClass > NUM_SIZE_CLASSES ) {
+        return -1;
+    }
+
+    return static_cast<int>( sizeClass - 1 );
+}
+
+}
+
+void* MessagePool::allocate( size_t size ) {
+    int sizeClass = size_class( size );
+    BlockCache* cache = thread_cache();
+
+    if( sizeClass < 0 ) {
+        return ::operator new( size );
+    }
+
+    if( cache && !cache->m_free[ sizeClass ].empty() ) {
+        void* block = cache->m_free[ sizeClass ].back();
+        cache->m_free[ sizeClass ].pop_back();
+        return block;
+    }
+
+    // Always allocate the whole size class so the block can be used for anything in it
+    return ::operator new( ( sizeClass + 1 ) * SIZE_CLASS_BYTES );
+}
+
+void MessagePool::deallocate( void* block, size_t size ) {
+    int sizeClass = size_class( size );
+    BlockCache* cache = thread_cache();
+
+    if( sizeClass < 0 || !cache || cache->m_free[ sizeClass ].size() >= MAX_CACHED_BLOCKS ) {
+        ::operator delete( block );
+        return;
+    }
+
+    cache->m_free[ sizeClass ].push_back( block );
+}
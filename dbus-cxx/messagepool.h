@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ ***************************************************************************/
+#ifndef DBUSCXX_MESSAGEPOOL_H
+#define DBUSCXX_MESSAGEPOOL_H
+
+#include <dbus-cxx/dbus-cxx-config.h>
+
+#include <memory>
+#include <stddef.h>
+#include <utility>
+
+namespace DBus {
+
+namespace priv {
+
+/**
+ * Keeps the memory of messages that have been freed, so that it can be
+ * used again for the next messages that are created.
+ *
+ * Each thread has its own cache of memory blocks, so no locking is needed.
+ * A block goes back to the cache of the thread that frees it, which is not
+ * always the thread that allocated it.  Only small blocks are cached; larger
+ * ones come straight from the heap.
+ */
+class MessagePool {
+public:
+    /**
+     * Allocate a block of at least size bytes.
+     */
+    static void* allocate( size_t size );
+
+    /**
+     * Give back a block that was allocated with allocate().
+     *
+     * @param block The block
+     * @param size The size that the block was allocated with
+     */
+    static void deallocate( void* block, size_t size );
+};
+
+/**
+ * An allocator that takes its memory from the MessagePool.
+ */
+template <typename T>
+class MessageAllocator {
+public:
+    typedef T value_type;
+
+    MessageAllocator() = default;
+
+    template <typename U>
+    MessageAllocator( const MessageAllocator<U>& ) {}
+
+    T* allocate( size_t n ) {
+        return static_cast<T*>( MessagePool::allocate( n * sizeof( T ) ) );
+    }
+
+    void deallocate( T* p, size_t n ) {
+        MessagePool::deallocate( p, n * sizeof( T ) );
+    }
+
+    template <typename U>
+    bool operator==( const MessageAllocator<U>& ) const { return true; }
+
+    template <typename U>
+    bool operator!=( const MessageAllocator<U>& ) const { return false; }
+};
+
+/*
+ * The constructors of the messages are protected; this gives
+ * std::allocate_shared a way to get at them.
+ */
+template <typename T>
+class PooledMessage : public T {
+public:
+    template <typename... Args>
+    PooledMessage( Args&&... args ) :
+        T( std::forward<Args>( args )... ) {}
+};
+
+/**
+ * Create a message of type T, with the message and its reference count in
+ * one block from the MessagePool.
+ */
+template <typename T, typename... Args>
+std::shared_ptr<T> create_pooled_message( Args&&... args ) {
+    return std::allocate_shared<PooledMessage<T>>( MessageAllocator<PooledMessage<T>>(),
+            std::forward<Args>( args )... );
+}
+
+} /* namespace priv */
+
+} /* namespace DBus */
+
+#endif /* DBUSCXX_MESSAGEPOOL_H */
@@ -7,7 +7,10 @@
  ***************************************************************************/
 #include "methodproxybase.h"
 #include "callmessage.h"
+#include "error.h"
+#include "errormessage.h"
 #include "interfaceproxy.h"
+#include "returnmessage.h"
 
 #include <limits>
 
@@ -104,11 +107,37 @@ void DBus::MethodProxyBase::disable_interactive_authorization() {
     m_priv->m_override_timeout = -1;
 }
 
-//  std::shared_ptr<PendingCall> DBus::MethodProxyBase::call_async(std::shared_ptr<const CallMessage> call_message, int timeout_milliseconds) const
-//  {
-//    if ( not m_priv->m_interface ) return std::shared_ptr<PendingCall>();
-//    return m_priv->m_interface->call_async(call_message, timeout_milliseconds);
-//  }
+std::shared_ptr<PendingCall> DBus::MethodProxyBase::call_async( std::shared_ptr<const CallMessage> call_message,
+                                                                PendingCall::CompletedSlot slot,
+                                                                int timeout_milliseconds ) const {
+    if( !m_priv->m_interface ) { return std::shared_ptr<PendingCall>(); }
+
+    int timeout = m_priv->m_override_timeout;
+    switch ( timeout ) {
+    case -1:
+        return m_priv->m_interface->call_async( call_message, slot, timeout_milliseconds );
+    case 0:
+        return m_priv->m_interface->call_async_notimeout( call_message, slot );
+    default:
+        return m_priv->m_interface->call_async( call_message, slot, timeout );
+    }
+}
+
+std::shared_ptr<const ReturnMessage> DBus::MethodProxyBase::return_message_from_reply( std::shared_ptr<Message> reply ) {
+    if( !reply ) {
+        throw ErrorDisconnected();
+    }
+
+    if( reply->type() == MessageType::ERROR ) {
+        std::static_pointer_cast<ErrorMessage>( reply )->throw_error();
+    }
+
+    if( reply->type() != MessageType::RETURN ) {
+        throw ErrorUnexpectedResponse();
+    }
+
+    return std::static_pointer_cast<const ReturnMessage>( reply );
+}
 
 void MethodProxyBase::set_interface( InterfaceProxy* proxy ) {
     m_priv->m_interface = proxy;
@@ -7,8 +7,10 @@
  *                                                                         *
  *   This file is part of the dbus-cxx library.                            *
  ***************************************************************************/
+#include <dbus-cxx/awaitablecall.h>
 #include <dbus-cxx/callmessage.h>
 #include <dbus-cxx/headerlog.h>
+#include <dbus-cxx/pendingcall.h>
 #include <dbus-cxx/utility.h>
 #include <memory>
 #include <mutex>
@@ -16,6 +18,7 @@
 #include <sstream>
 #include "messageappenditerator.h"
 #include <sigc++/sigc++.h>
+#include <functional>
 #include <future>
 
 #ifndef DBUSCXX_METHODPROXYBASE_H
@@ -116,7 +119,25 @@ public:
      */
     void disable_interactive_authorization();
 
-    //      std::shared_ptr<PendingCall> call_async( std::shared_ptr<const CallMessage>, int timeout_milliseconds=-1 ) const;
+    /**
+     * Send the call without waiting for the reply; the slot is called from
+     * the dispatching thread once the reply comes in.
+     *
+     * @return The pending call, or an invalid pointer if the proxy is not
+     * attached to a connection
+     */
+    std::shared_ptr<PendingCall> call_async( std::shared_ptr<const CallMessage>,
+                                             PendingCall::CompletedSlot slot,
+                                             int timeout_milliseconds = -1 ) const;
+
+protected:
+    /**
+     * Check the reply to an asynchronous call.
+     *
+     * @return The reply as a ReturnMessage
+     * @throws The error if the reply is an ErrorMessage
+     */
+    static std::shared_ptr<const ReturnMessage> return_message_from_reply( std::shared_ptr<Message> reply );
 
 private:
     void set_interface( InterfaceProxy* proxy );
@@ -158,7 +179,77 @@ public:
         std::shared_ptr<const ReturnMessage> retmsg = this->call( _callmsg, -1 );
     }
 
+    /**
+     * Call the method without waiting for it to return.  Any number of calls
+     * may be outstanding at once; the future becomes ready once the
+     * dispatcher reads the reply.
+     */
     std::future<void> call_async( T_arg... args ) {
+        std::shared_ptr<std::promise<void>> promise = std::make_shared<std::promise<void>>();
+        std::future<void> future = promise->get_future();
+
+        send_async( [promise]( std::shared_ptr<Message> reply ) {
+            set_result( promise.get(), reply );
+        }, args... );
+
+        return future;
+    }
+
+    /**
+     * Call the method without waiting for it to return.  The callback is
+     * called from the dispatching thread with the result once the reply
+     * comes in, unless the returned call is canceled first.
+     */
+    std::shared_ptr<PendingCall> call_async( std::function<void( std::future<void> )> callback, T_arg... args ) {
+        return send_async( [callback]( std::shared_ptr<Message> reply ) {
+            std::promise<void> promise;
+            set_result( &promise, reply );
+            callback( promise.get_future() );
+        }, args... );
+    }
+
+#if DBUS_CXX_HAS_COROUTINES
+    /**
+     * Call the method from a coroutine: co_await the result to send the call
+     * and suspend until the method returns.  The coroutine is resumed on the
+     * dispatching thread.
+     */
+    AwaitableCall<void> async( T_arg... args ) {
+        return async( CallExecutor(), args... );
+    }
+
+    /**
+     * Call the method from a coroutine, resuming it with the given executor
+     * once the method returns.
+     */
+    AwaitableCall<void> async( CallExecutor executor, T_arg... args ) {
+        std::shared_ptr<CallMessage> _callmsg = create_async_call_message( args... );
+
+        return AwaitableCall<void>( [this, _callmsg]( PendingCall::CompletedSlot slot ) {
+            return MethodProxyBase::call_async( _callmsg, slot, -1 );
+        }, &MethodProxy::result_from_reply, executor );
+    }
+#endif
+
+    static std::shared_ptr<MethodProxy> create( const std::string& name ) {
+        return std::shared_ptr<MethodProxy>( new MethodProxy( name ) );
+    }
+
+private:
+    static void result_from_reply( std::shared_ptr<Message> reply ) {
+        return_message_from_reply( reply );
+    }
+
+    static void set_result( std::promise<void>* promise, std::shared_ptr<Message> reply ) {
+        try {
+            result_from_reply( reply );
+            promise->set_value();
+        } catch( ... ) {
+            promise->set_exception( std::current_exception() );
+        }
+    }
+
+    std::shared_ptr<CallMessage> create_async_call_message( T_arg... args ) {
         std::ostringstream debug_str;
         DBus::priv::dbus_function_traits<std::function<void( T_arg... )>> method_sig_gen;
 
@@ -168,11 +259,21 @@ public:
         debug_str << name();
         DBUSCXX_DEBUG_STDSTR( "DBus.MethodProxy", debug_str.str() );
 
-        return std::async( std::launch::async, *this, args... );
+        std::shared_ptr<CallMessage> _callmsg = this->create_call_message();
+        ( *_callmsg << ... << args );
+        return _callmsg;
     }
 
-    static std::shared_ptr<MethodProxy> create( const std::string& name ) {
-        return std::shared_ptr<MethodProxy>( new MethodProxy( name ) );
+    std::shared_ptr<PendingCall> send_async( PendingCall::CompletedSlot slot, T_arg... args ) {
+        std::shared_ptr<CallMessage> _callmsg = create_async_call_message( args... );
+        std::shared_ptr<PendingCall> pending = MethodProxyBase::call_async( _callmsg, slot, -1 );
+
+        if( !pending ) {
+            // There is nothing to send this on; the slot still needs to know
+            slot( std::shared_ptr<Message>() );
+        }
+
+        return pending;
     }
 };
 
@@ -208,9 +309,80 @@ public:
         return _retval;
     }
 
+    /**
+     * Call the method without waiting for it to return.  Any number of calls
+     * may be outstanding at once; the future becomes ready once the
+     * dispatcher reads the reply.
+     */
     std::future<T_return> call_async( T_arg... args ) {
+        std::shared_ptr<std::promise<T_return>> promise = std::make_shared<std::promise<T_return>>();
+        std::future<T_return> future = promise->get_future();
+
+        send_async( [promise]( std::shared_ptr<Message> reply ) {
+            set_result( promise.get(), reply );
+        }, args... );
+
+        return future;
+    }
+
+    /**
+     * Call the method without waiting for it to return.  The callback is
+     * called from the dispatching thread with the result once the reply
+     * comes in, unless the returned call is canceled first.
+     */
+    std::shared_ptr<PendingCall> call_async( std::function<void( std::future<T_return> )> callback, T_arg... args ) {
+        return send_async( [callback]( std::shared_ptr<Message> reply ) {
+            std::promise<T_return> promise;
+            set_result( &promise, reply );
+            callback( promise.get_future() );
+        }, args... );
+    }
+
+#if DBUS_CXX_HAS_COROUTINES
+    /**
+     * Call the method from a coroutine: co_await the result to send the call
+     * and suspend until the method returns.  The coroutine is resumed on the
+     * dispatching thread.
+     */
+    AwaitableCall<T_return> async( T_arg... args ) {
+        return async( CallExecutor(), args... );
+    }
+
+    /**
+     * Call the method from a coroutine, resuming it with the given executor
+     * once the method returns.
+     */
+    AwaitableCall<T_return> async( CallExecutor executor, T_arg... args ) {
+        std::shared_ptr<CallMessage> _callmsg = create_async_call_message( args... );
+
+        return AwaitableCall<T_return>( [this, _callmsg]( PendingCall::CompletedSlot slot ) {
+            return MethodProxyBase::call_async( _callmsg, slot, -1 );
+        }, &MethodProxy::result_from_reply, executor );
+    }
+#endif
+
+    static std::shared_ptr<MethodProxy> create( const std::string& name ) {
+        return std::shared_ptr<MethodProxy>( new MethodProxy( name ) );
+    }
+
+private:
+    static T_return result_from_reply( std::shared_ptr<Message> reply ) {
+        T_return _retval;
+        return_message_from_reply( reply ) >> _retval;
+        return _retval;
+    }
+
+    static void set_result( std::promise<T_return>* promise, std::shared_ptr<Message> reply ) {
+        try {
+            promise->set_value( result_from_reply( reply ) );
+        } catch( ... ) {
+            promise->set_exception( std::current_exception() );
+        }
+    }
+
+    std::shared_ptr<CallMessage> create_async_call_message( T_arg... args ) {
         std::ostringstream debug_str;
-        DBus::priv::dbus_function_traits<std::function<void( T_arg... )>> method_sig_gen;
+        DBus::priv::dbus_function_traits<std::function<T_return( T_arg... )>> method_sig_gen;
 
         debug_str << "DBus::MethodProxy<";
         debug_str << method_sig_gen.debug_string();
@@ -218,11 +390,22 @@ public:
         debug_str << name();
         DBUSCXX_DEBUG_STDSTR( "DBus.MethodProxy", debug_str.str() );
 
-        return std::async( std::launch::async, *this, args... );
+        std::shared_ptr<CallMessage> _callmsg = this->create_call_message();
+        MessageAppendIterator iter = _callmsg->append();
+        ( void )( iter << ... << args );
+        return _callmsg;
     }
 
-    static std::shared_ptr<MethodProxy> create( const std::string& name ) {
-        return std::shared_ptr<MethodProxy>( new MethodProxy( name ) );
+    std::shared_ptr<PendingCall> send_async( PendingCall::CompletedSlot slot, T_arg... args ) {
+        std::shared_ptr<CallMessage> _callmsg = create_async_call_message( args... );
+        std::shared_ptr<PendingCall> pending = MethodProxyBase::call_async( _callmsg, slot, -1 );
+
+        if( !pending ) {
+            // There is nothing to send this on; the slot still needs to know
+            slot( std::shared_ptr<Message>() );
+        }
+
+        return pending;
     }
 };
 
@@ -284,6 +284,25 @@ std::shared_ptr<const ReturnMessage> ObjectProxy::call_notimeout( std::shared_pt
     return conn->send_with_reply_blocking_notimeout( call_message );
 }
 
+std::shared_ptr<PendingCall> ObjectProxy::call_async( std::shared_ptr<const CallMessage> call_message,
+                                                      PendingCall::CompletedSlot slot,
+                                                      int timeout_milliseconds ) const {
+    std::shared_ptr<Connection> conn = m_priv->m_connection.lock();
+
+    if( !conn ) { return std::shared_ptr<PendingCall>(); }
+
+    return conn->send_with_reply_async( call_message, slot, timeout_milliseconds );
+}
+
+std::shared_ptr<PendingCall> ObjectProxy::call_async_notimeout( std::shared_ptr<const CallMessage> call_message,
+                                                                PendingCall::CompletedSlot slot ) const {
+    std::shared_ptr<Connection> conn = m_priv->m_connection.lock();
+
+    if( !conn ) { return std::shared_ptr<PendingCall>(); }
+
+    return conn->send_with_reply_async_notimeout( call_message, slot );
+}
+
 sigc::signal< void( std::shared_ptr<InterfaceProxy> )> ObjectProxy::signal_interface_added() {
     return m_priv->m_signal_interface_added;
 }
@@ -131,6 +131,24 @@ public:
      */
     std::shared_ptr<const ReturnMessage> call_notimeout( std::shared_ptr<const CallMessage> ) const;
 
+    /**
+     * Forwards this CallMessage to the Connection that this ObjectProxy is on without
+     * waiting for the response; see Connection::send_with_reply_async().
+     *
+     * @param slot Called from the dispatching thread with the reply
+     * @param timeout_milliseconds
+     * @return The pending call, or an invalid pointer if the connection has gone away
+     */
+    std::shared_ptr<PendingCall> call_async( std::shared_ptr<const CallMessage>,
+                                             PendingCall::CompletedSlot slot,
+                                             int timeout_milliseconds = -1 ) const;
+
+    /**
+     * A timeout-less version of @ref call_async().
+     */
+    std::shared_ptr<PendingCall> call_async_notimeout( std::shared_ptr<const CallMessage>,
+                                                       PendingCall::CompletedSlot slot ) const;
+
     /**
      * Creates a proxy method with a signature based on the template parameters and adds it to the named interface
      * @return A smart pointer to the newly created method proxy
@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ ***************************************************************************/
+#include "outgoingqueue.h"
+
+using DBus::priv::OutgoingQueue;
+
+/*
+ * This is an unbounded multi-producer single-consumer queue: producers
+ * atomically swap themselves in as the newest node and then link the
+ * previous node to themselves, and the consumer follows the links from
+ * a dummy node that it owns.
+ */
+
+OutgoingQueue::OutgoingQueue() :
+    m_size( 0 ) {
+    Node* stub = new Node;
+    stub->next.store( nullptr, std::memory_order_relaxed );
+    m_head.store( stub, std::memory_order_relaxed );
+    m_tail = stub;
+}
+
+OutgoingQueue::~OutgoingQueue() {
+    OutgoingMessage discard;
+
+    while( pop( &discard ) ) {}
+
+    delete m_tail;
+}
+
+bool OutgoingQueue::push( OutgoingMessage message ) {
+    Node* node = new Node;
+    node->next.store( nullptr, std::memory_order_relaxed );
+    node->message = std::move( message );
+
+    Node* prev = m_head.exchange( node, std::memory_order_acq_rel );
+    prev->next.store( node, std::memory_order_release );
+
+    /*
+     * Only count the message once it can be popped, so that the consumer
+     * never waits on a message that it is unable to see.  If the consumer
+     * popped it before we got here the count may be negative for a moment,
+     * which is not a transition from empty.
+     */
+    return m_size.fetch_add( 1, std::memory_order_acq_rel ) == 0;
+}
+
+bool OutgoingQueue::pop( OutgoingMessage* message ) {
+    Node* tail = m_tail;
+    Node* next = tail->next.load( std::memory_order_acquire );
+
+    if( next == nullptr ) {
+        return false;
+    }
+
+    *message = std::move( next->message );
+    next->message = OutgoingMessage();
+    m_tail = next;
+    delete tail;
+
+    m_size.fetch_sub( 1, std::memory_order_acq_rel );
+
+    return true;
+}
+
+bool OutgoingQueue::empty() const {
+    return m_size.load( std::memory_order_acquire ) <= 0;
+}
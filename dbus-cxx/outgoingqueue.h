@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ ***************************************************************************/
+#ifndef DBUSCXX_OUTGOINGQUEUE_H
+#define DBUSCXX_OUTGOINGQUEUE_H
+
+#include <atomic>
+#include "transport.h"
+
+namespace DBus {
+
+namespace priv {
+
+/**
+ * A queue of messages waiting to be written.
+ *
+ * Any number of threads may push onto this queue at the same time without
+ * taking a lock, but only one thread at a time may pop from it.
+ */
+class OutgoingQueue {
+public:
+    OutgoingQueue();
+
+    ~OutgoingQueue();
+
+    OutgoingQueue( const OutgoingQueue& ) = delete;
+    OutgoingQueue& operator=( const OutgoingQueue& ) = delete;
+
+    /**
+     * Add a message to the end of the queue.  May be called from any thread.
+     *
+     * @param message The message to add
+     * @return True if the queue was empty before this message was added,
+     * i.e. the consumer needs to be told that there is something to do.
+     */
+    bool push( OutgoingMessage message );
+
+    /**
+     * Take the message at the front of the queue.  Only one thread may
+     * call this at a time.
+     *
+     * A message that is still being pushed by another thread may not be
+     * visible yet; in that case, empty() stays false until it can be popped.
+     *
+     * @param message Where to put the message
+     * @return True if a message was taken
+     */
+    bool pop( OutgoingMessage* message );
+
+    /**
+     * @return True if there is nothing waiting in this queue
+     */
+    bool empty() const;
+
+private:
+    struct Node {
+        std::atomic<Node*> next;
+        OutgoingMessage message;
+    };
+
+    /* Where producers add nodes */
+    std::atomic<Node*> m_head;
+    /* The last node that was consumed; its next is the front of the queue */
+    Node* m_tail;
+    /* Number of messages that have been pushed but not popped */
+    std::atomic<int> m_size;
+};
+
+} /* namespace priv */
+
+} /* namespace DBus */
+
+#endif /* DBUSCXX_OUTGOINGQUEUE_H */
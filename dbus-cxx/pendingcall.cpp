@@ -6,57 +6,129 @@
  *   This file is part of the dbus-cxx library.                            *
  ***************************************************************************/
 #include "pendingcall.h"
-#include "error.h"
+#include "connection.h"
 #include "message.h"
+#include <condition_variable>
+#include <mutex>
 #include <sigc++/sigc++.h>
 
 namespace DBus {
 
+enum class PendingCallState {
+    WAITING,
+    COMPLETED,
+    CANCELED
+};
 
-//  PendingCall::PendingCall() :
-//      m_canceled( false )
-//  {
-//  }
-
-//  std::shared_ptr<PendingCall> PendingCall::create()
-//  {
-//    return std::shared_ptr<PendingCall>( new PendingCall() );
-//  }
-
-//  PendingCall::~PendingCall()
-//  {
-//  }
-
-//  void PendingCall::cancel()
-//  {
-//      m_canceled = true;
-//  }
-
-//  bool PendingCall::completed() const
-//  {
-//    return m_reply->is_valid();
-//  }
-
-//  std::shared_ptr<Message> PendingCall::reply() const
-//  {
-//    return m_reply;
-//  }
-
-//  void PendingCall::block() const
-//  {
-//      if( m_canceled ){
-//          return;
-//      }
-//  }
-
-//  sigc::signal<void()> PendingCall::signal_notify() const
-//  {
-//    return m_signal_notify;
-//  }
-
-//  void PendingCall::set_reply( std::shared_ptr<Message> msg ){
-//      m_reply = msg;
-//      m_signal_notify.emit();
-//  }
+class PendingCall::priv_data {
+public:
+    priv_data( std::weak_ptr<Connection> connection, uint32_t serial, CompletedSlot slot ) :
+        m_connection( connection ),
+        m_serial( serial ),
+        m_slot( slot ),
+        m_state( PendingCallState::WAITING )
+    {}
+
+    std::weak_ptr<Connection> m_connection;
+    uint32_t m_serial;
+    CompletedSlot m_slot;
+    mutable std::mutex m_lock;
+    mutable std::condition_variable m_cv;
+    PendingCallState m_state;
+    std::shared_ptr<Message> m_reply;
+};
+
+PendingCall::PendingCall( std::weak_ptr<Connection> connection, uint32_t serial, CompletedSlot slot ) :
+    m_priv( std::make_unique<priv_data>( connection, serial, slot ) ) {
+}
+
+std::shared_ptr<PendingCall> PendingCall::create( std::weak_ptr<Connection> connection, uint32_t serial, CompletedSlot slot ) {
+    return std::shared_ptr<PendingCall>( new PendingCall( connection, serial, slot ) );
+}
+
+PendingCall::~PendingCall() {
+}
+
+uint32_t PendingCall::serial() const {
+    return m_priv->m_serial;
+}
+
+bool PendingCall::cancel() {
+    {
+        std::unique_lock<std::mutex> lock( m_priv->m_lock );
+
+        if( m_priv->m_state != PendingCallState::WAITING ) {
+            return m_priv->m_state == PendingCallState::CANCELED;
+        }
+
+        m_priv->m_state = PendingCallState::CANCELED;
+        // Whatever the slot holds on to can go away now
+        m_priv->m_slot = CompletedSlot();
+    }
+
+    m_priv->m_cv.notify_all();
+
+    // Nobody needs the reply anymore, so the connection can forget about it
+    std::shared_ptr<Connection> conn = m_priv->m_connection.lock();
+
+    if( conn ) {
+        conn->remove_pending_call( m_priv->m_serial );
+    }
+
+    return true;
+}
+
+bool PendingCall::is_completed() const {
+    std::unique_lock<std::mutex> lock( m_priv->m_lock );
+
+    return m_priv->m_state == PendingCallState::COMPLETED;
+}
+
+bool PendingCall::is_canceled() const {
+    std::unique_lock<std::mutex> lock( m_priv->m_lock );
+
+    return m_priv->m_state == PendingCallState::CANCELED;
+}
+
+std::shared_ptr<Message> PendingCall::reply() const {
+    std::unique_lock<std::mutex> lock( m_priv->m_lock );
+
+    return m_priv->m_reply;
+}
+
+std::shared_ptr<Message> PendingCall::wait() const {
+    std::unique_lock<std::mutex> lock( m_priv->m_lock );
+
+    m_priv->m_cv.wait( lock, [this] {
+        return m_priv->m_state != PendingCallState::WAITING;
+    } );
+
+    return m_priv->m_reply;
+}
+
+bool PendingCall::complete( std::shared_ptr<Message> reply ) {
+    CompletedSlot slot;
+
+    {
+        std::unique_lock<std::mutex> lock( m_priv->m_lock );
+
+        if( m_priv->m_state != PendingCallState::WAITING ) {
+            return false;
+        }
+
+        m_priv->m_state = PendingCallState::COMPLETED;
+        m_priv->m_reply = reply;
+        std::swap( slot, m_priv->m_slot );
+    }
+
+    m_priv->m_cv.notify_all();
+
+    // Don't hold the lock while calling out, the slot may look at us
+    if( slot ) {
+        slot( reply );
+    }
+
+    return true;
+}
 
 }
@@ -5,74 +5,102 @@
  *                                                                         *
  *   This file is part of the dbus-cxx library.                            *
  ***************************************************************************/
+#include <dbus-cxx/dbus-cxx-config.h>
 #include <sigc++/sigc++.h>
 #include <memory>
+#include <stdint.h>
 
 #ifndef DBUSCXX_PENDING_CALL_H
 #define DBUSCXX_PENDING_CALL_H
 
 namespace DBus {
+class Connection;
 class Message;
 
 /**
- * Monitors an asynchronous call, emitting a signal when a response is received
+ * Monitors an asynchronous call that was sent with
+ * Connection::send_with_reply_async().
+ *
+ * When the reply comes in, the slot that the call was sent with is called
+ * from the dispatching thread with either the ReturnMessage or the
+ * ErrorMessage.  If no reply comes in before the timeout, the slot is
+ * called with an ErrorMessage named DBUSCXX_ERROR_NO_REPLY instead.
  *
  * @ingroup message
  *
  * @author Rick L Vinyard Jr <rvinyard@cs.nmsu.edu>
  */
-//  class PendingCall: public sigc::trackable
-//  {
-//    protected:
-
-//      PendingCall( );
-
-//    public:
-//      static std::shared_ptr<PendingCall> create( );
-
-//      virtual ~PendingCall();
-
-//      /**
-//       * Cancel the pending call; that is, signal_notify() will not
-//       * be emitted if and when the reply eventually comes back.
-//       */
-//      void cancel();
-
-//      /**
-//       * Check to see if the reply has actually come back.
-//       */
-//      bool completed() const;
-
-//      /**
-//       * Check to see if the
-//       * @return
-//       */
-////      bool is_timeout() const;
-
-//      /**
-//       * Get the reply that this pending call represents.  If
-//       * completed() is not true, or this call has been canceled,
-//       * returns an invalid pointer.
-//       *
-//       * @return
-//       */
-//      std::shared_ptr<Message> reply() const;
-
-//      void block() const;
-
-//      sigc::signal<void()> signal_notify() const;
-
-//      void set_reply( std::shared_ptr<Message> msg );
-
-//    private:
-
-//      sigc::signal<void()> m_signal_notify;
-
-//      std::shared_ptr<Message> m_reply;
-
-//      bool m_canceled;
-
-//  };
+class PendingCall {
+public:
+    /**
+     * Called with the reply to the call; the reply is either a ReturnMessage
+     * or an ErrorMessage.
+     */
+    typedef sigc::slot<void( std::shared_ptr<Message> )> CompletedSlot;
+
+private:
+    PendingCall( std::weak_ptr<Connection> connection, uint32_t serial, CompletedSlot slot );
+
+    static std::shared_ptr<PendingCall> create( std::weak_ptr<Connection> connection, uint32_t serial, CompletedSlot slot );
+
+public:
+    ~PendingCall();
+
+    /**
+     * The serial of the call message; the reply will have this as its reply serial.
+     */
+    uint32_t serial() const;
+
+    /**
+     * Cancel the pending call; that is, the slot will not be called
+     * if and when the reply eventually comes back.
+     *
+     * @return True if the call was canceled, false if it had already completed
+     */
+    bool cancel();
+
+    /**
+     * Check to see if the reply has actually come back.
+     */
+    bool is_completed() const;
+
+    /**
+     * Check to see if this call has been canceled.
+     */
+    bool is_canceled() const;
+
+    /**
+     * Get the reply that this pending call represents.  If
+     * is_completed() is not true, or this call has been canceled,
+     * returns an invalid pointer.
+     */
+    std::shared_ptr<Message> reply() const;
+
+    /**
+     * Block until the reply comes in, or this call is canceled.
+     *
+     * This must not be called from the dispatching thread, as nothing
+     * would be able to read the reply.
+     *
+     * @return The reply, or an invalid pointer if this call was canceled
+     */
+    std::shared_ptr<Message> wait() const;
+
+private:
+    /**
+     * Called by the Connection when the reply comes in.
+     *
+     * @return False if this call was canceled, and the reply was ignored
+     */
+    bool complete( std::shared_ptr<Message> reply );
+
+private:
+    class priv_data;
+
+    DBUS_CXX_PROPAGATE_CONST( std::unique_ptr<priv_data> ) m_priv;
+
+    friend class Connection;
+};
 
 }
 
@@ -0,0 +1,255 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ ***************************************************************************/
+#include "receivebuffer.h"
+
+#include "dbus-cxx-private.h"
+#include "demarshaling.h"
+#include "message.h"
+#include "utility.h"
+#include "validator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <sstream>
+#include <unistd.h>
+
+using DBus::priv::ReceiveBuffer;
+
+static const char* LOGGER_NAME = "DBus.priv.ReceiveBuffer";
+
+/*
+ * Messages with a body at least this big refer to the slab directly instead of
+ * copying their body out.  Smaller messages are cheap to copy, and copying them
+ * means that they don't keep a whole slab alive.
+ */
+#define ZERO_COPY_MINIMUM_BODY_SIZE 4096
+
+/* Don't bother reading into the end of the slab if there is less space than this */
+#define MINIMUM_READ_SPACE 4096
+
+static std::shared_ptr<uint8_t> allocate_slab( uint32_t capacity ) {
+    return std::shared_ptr<uint8_t>( new uint8_t[ capacity ], std::default_delete<uint8_t[]>() );
+}
+
+class ReceiveBuffer::priv_data {
+public:
+    priv_data( uint32_t initialCapacity ) :
+        m_slab( allocate_slab( initialCapacity ) ),
+        m_initialCapacity( initialCapacity ),
+        m_capacity( initialCapacity ),
+        m_start( 0 ),
+        m_end( 0 ),
+        m_needed( 0 )
+    {}
+
+    /*
+     * The memory that data is read into.  Messages with large bodies hold a
+     * reference to this, so it may only be rewritten when we are the sole owner.
+     */
+    std::shared_ptr<uint8_t> m_slab;
+    uint32_t m_initialCapacity;
+    uint32_t m_capacity;
+    /* Offset of the first byte that has not been turned into a message yet */
+    uint32_t m_start;
+    /* Offset one past the last valid byte of data */
+    uint32_t m_end;
+    /* Total size of the partial message at m_start, if we know it */
+    uint32_t m_needed;
+    std::vector<int> m_fds;
+    std::deque<std::shared_ptr<Message>> m_messages;
+};
+
+ReceiveBuffer::ReceiveBuffer( uint32_t initialCapacity ) :
+    m_priv( std::make_unique<priv_data>( initialCapacity ) ) {
+}
+
+ReceiveBuffer::~ReceiveBuffer() {
+    for( int fd : m_priv->m_fds ) {
+        ::close( fd );
+    }
+}
+
+void ReceiveBuffer::make_room() {
+    uint32_t remaining = m_priv->m_end - m_priv->m_start;
+    uint32_t required = std::max( m_priv->m_needed, remaining + MINIMUM_READ_SPACE );
+    bool slabShared = m_priv->m_slab.use_count() > 1;
+
+    if( remaining == 0 && !slabShared ) {
+        m_priv->m_start = 0;
+        m_priv->m_end = 0;
+    }
+
+    if( ( static_cast<uint64_t>( m_priv->m_start ) + required ) <= m_priv->m_capacity ) {
+        return;
+    }
+
+    if( !slabShared && m_priv->m_capacity >= required ) {
+        if( remaining > 0 ) {
+            std::memmove( m_priv->m_slab.get(),
+                m_priv->m_slab.get() + m_priv->m_start,
+                remaining );
+        }
+    } else {
+        /*
+         * Either the slab is too small, or messages still refer to it; move
+         * what we have to a new slab.  The old one is freed once the last
+         * message that uses it goes away.
+         */
+        uint32_t newCapacity = std::max( m_priv->m_initialCapacity, required );
+        std::shared_ptr<uint8_t> newSlab = allocate_slab( newCapacity );
+
+        if( remaining > 0 ) {
+            std::memcpy( newSlab.get(),
+                m_priv->m_slab.get() + m_priv->m_start,
+                remaining );
+        }
+
+        m_priv->m_slab = newSlab;
+        m_priv->m_capacity = newCapacity;
+    }
+
+    m_priv->m_start = 0;
+    m_priv->m_end = remaining;
+}
+
+uint8_t* ReceiveBuffer::write_location() {
+    return m_priv->m_slab.get() + m_priv->m_end;
+}
+
+uint32_t ReceiveBuffer::write_space() const {
+    return m_priv->m_capacity - m_priv->m_end;
+}
+
+bool ReceiveBuffer::commit( uint32_t numBytes ) {
+    m_priv->m_end += numBytes;
+
+    while( ( m_priv->m_end - m_priv->m_start ) >= 16 ) {
+        uint8_t* header_raw = m_priv->m_slab.get() + m_priv->m_start;
+        Demarshaling demarshal( header_raw, 16, Endianess::Big );
+        uint64_t body_len;
+        uint64_t header_array_len;
+        uint64_t total_len;
+        uint8_t endian = demarshal.demarshal_uint8_t();
+
+        if( endian == 'l' ) {
+            demarshal.set_endianess( Endianess::Little );
+        } else if( endian != 'B' ) {
+            SIMPLELOGGER_DEBUG( LOGGER_NAME, "Bad endianess on incoming message; discarding data" );
+            discard_data();
+            return false;
+        }
+
+        demarshal.set_data_offset( 4 );
+        body_len = demarshal.demarshal_uint32_t();
+        demarshal.set_data_offset( 12 );
+        header_array_len = demarshal.demarshal_uint32_t();
+
+        if( ( body_len + header_array_len + 12 + 4 ) >
+            DBus::Validator::maximum_message_size() ) {
+            // Invalid message: it can't be that big!
+            SIMPLELOGGER_DEBUG( LOGGER_NAME, "Incoming message is too large; discarding data" );
+            discard_data();
+            return false;
+        }
+
+        if( 0 != header_array_len % 8 ) {
+            header_array_len += 8 - ( header_array_len % 8 );
+        }
+
+        total_len = 12 + ( 4 + header_array_len ) + body_len;
+
+        if( ( m_priv->m_end - m_priv->m_start ) < total_len ) {
+            /* Only part of this message is here; make_room() makes sure that the rest will fit */
+            m_priv->m_needed = total_len;
+            break;
+        }
+
+        m_priv->m_needed = 0;
+
+        if( dbuscxx_log_function ) {
+            std::ostringstream debug_str;
+            debug_str << "Going to create a message from the following data: " << std::endl;
+            DBus::hexdump( header_raw, total_len, &debug_str );
+            SIMPLELOGGER_TRACE( LOGGER_NAME, debug_str.str() );
+        }
+
+        std::shared_ptr<Message> msg;
+
+        if( body_len >= ZERO_COPY_MINIMUM_BODY_SIZE ) {
+            msg = Message::create_from_data(
+                    std::shared_ptr<const uint8_t>( m_priv->m_slab, header_raw ),
+                    total_len,
+                    m_priv->m_fds );
+        } else {
+            msg = Message::create_from_data( header_raw, total_len, m_priv->m_fds );
+        }
+
+        m_priv->m_start += total_len;
+
+        if( !msg ) {
+            continue;
+        }
+
+        /* The message has taken ownership of the first N FDs that we have */
+        size_t fdsTaken = std::min( msg->filedescriptors().size(), m_priv->m_fds.size() );
+        m_priv->m_fds.erase( m_priv->m_fds.begin(), m_priv->m_fds.begin() + fdsTaken );
+
+        m_priv->m_messages.push_back( msg );
+    }
+
+    return true;
+}
+
+void ReceiveBuffer::add_filedescriptors( const int* fds, int numFds ) {
+    m_priv->m_fds.insert( m_priv->m_fds.end(), fds, fds + numFds );
+}
+
+bool ReceiveBuffer::has_message() const {
+    return !m_priv->m_messages.empty();
+}
+
+std::shared_ptr<DBus::Message> ReceiveBuffer::take_message() {
+    if( m_priv->m_messages.empty() ) {
+        return std::shared_ptr<Message>();
+    }
+
+    std::shared_ptr<Message> retmsg = m_priv->m_messages.front();
+    m_priv->m_messages.pop_front();
+
+    return retmsg;
+}
+
+int ReceiveBuffer::take_messages( std::vector<std::shared_ptr<Message>>* messages ) {
+    int numMessages = m_priv->m_messages.size();
+
+    for( std::shared_ptr<Message>& msg : m_priv->m_messages ) {
+        messages->push_back( std::move( msg ) );
+    }
+
+    m_priv->m_messages.clear();
+
+    return numMessages;
+}
+
+void ReceiveBuffer::clear() {
+    discard_data();
+    m_priv->m_messages.clear();
+}
+
+void ReceiveBuffer::discard_data() {
+    for( int fd : m_priv->m_fds ) {
+        ::close( fd );
+    }
+
+    m_priv->m_fds.clear();
+
+    // Skip over the data rather than rewinding, since messages may still refer to it
+    m_priv->m_start = m_priv->m_end;
+    m_priv->m_needed = 0;
+}
@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ ***************************************************************************/
+#ifndef DBUSCXX_RECEIVEBUFFER_H
+#define DBUSCXX_RECEIVEBUFFER_H
+
+#include <dbus-cxx/dbus-cxx-config.h>
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+namespace DBus {
+
+class Message;
+
+namespace priv {
+
+/**
+ * Buffers the raw data that a transport reads from its stream, and splits
+ * that data up into complete messages.
+ *
+ * This allows a transport to read everything that is available with a single
+ * system call into one large buffer, rather than reading each message
+ * piece-by-piece.  Any partial message at the end of the data is kept until
+ * the rest of it is read.
+ *
+ * Messages with a large body don't copy it out of the buffer; they keep a
+ * reference to the memory that it was read into, which is only reused once
+ * all of those messages are gone.
+ */
+class ReceiveBuffer {
+public:
+    /**
+     * Create a new ReceiveBuffer.
+     *
+     * @param initialCapacity The initial size of the buffer.  The buffer will
+     * grow if a single message is larger than this.
+     */
+    ReceiveBuffer( uint32_t initialCapacity = 32768 );
+
+    ~ReceiveBuffer();
+
+    /**
+     * Make sure that there is space to read more data into this buffer.
+     * This must be called before each read, as write_location() may change.
+     *
+     * Data that messages still refer to is never overwritten; if needed, a
+     * new slab of memory is used for reading into instead.
+     */
+    void make_room();
+
+    /**
+     * @return The location that new data should be read into.
+     */
+    uint8_t* write_location();
+
+    /**
+     * @return The number of bytes that may be read into write_location()
+     */
+    uint32_t write_space() const;
+
+    /**
+     * Note that data has been read into write_location(), and parse all of
+     * the complete messages that are now available.
+     *
+     * @param numBytes The number of bytes that were read
+     * @return False if the data is not a valid DBus stream.  All of the
+     * unparsed data in the buffer is discarded in this case.
+     */
+    bool commit( uint32_t numBytes );
+
+    /**
+     * Add file descriptors that were received along with the data.  These
+     * are handed out to messages in the order that they are received.
+     *
+     * @param fds The file descriptors
+     * @param numFds How many file descriptors there are
+     */
+    void add_filedescriptors( const int* fds, int numFds );
+
+    /**
+     * @return True if there is at least one complete message available
+     */
+    bool has_message() const;
+
+    /**
+     * Take the next complete message out of this buffer.
+     *
+     * @return The message, or an invalid pointer if there is no complete message
+     */
+    std::shared_ptr<Message> take_message();
+
+    /**
+     * Take all of the complete messages out of this buffer.
+     *
+     * @param messages Where to append the messages to
+     * @return The number of messages that were taken
+     */
+    int take_messages( std::vector<std::shared_ptr<Message>>* messages );
+
+    /**
+     * Discard all of the data and messages, and close any file descriptors
+     * that have not been given to a message.
+     */
+    void clear();
+
+private:
+    void discard_data();
+
+private:
+    class priv_data;
+
+    DBUS_CXX_PROPAGATE_CONST( std::unique_ptr<priv_data> ) m_priv;
+};
+
+} /* namespace priv */
+} /* namespace DBus */
+
+#endif /* DBUSCXX_RECEIVEBUFFER_H */
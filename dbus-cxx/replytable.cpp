@@ -0,0 +1,332 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ ***************************************************************************/
+#include "replytable.h"
+#include "message.h"
+#include "pendingcall.h"
+
+#include <thread>
+#include <vector>
+
+/*
+ * How many calls the table has room for; must be a power of two.  Serials
+ * count up, so calls that are outstanding at the same time mostly land in
+ * slots that are next to each other.
+ */
+#define REPLY_TABLE_SIZE 1024
+/* How many slots past the one a serial maps to are tried before overflowing */
+#define REPLY_TABLE_PROBES 8
+
+using DBus::priv::ReplyTable;
+
+namespace DBus {
+
+namespace priv {
+
+/**
+ * What a thread sleeps on while it waits for a reply.
+ */
+struct ReplyWaiter {
+    std::mutex lock;
+    std::condition_variable cv;
+};
+
+}
+
+}
+
+using DBus::priv::ReplyWaiter;
+
+/*
+ * Every slot goes through these states, with the serial of the call that
+ * owns the slot alongside:
+ *
+ * FREE -> CLAIMED -> WAITING -> DELIVERING -> REPLIED -> RELEASING -> FREE
+ *
+ * The thread that makes a call claims a slot, and releases it once it is done
+ * with the reply.  The dispatching thread only touches a slot while it is
+ * DELIVERING, which it can only get to from WAITING.  Because the serial is
+ * part of the state, a slot that was released and claimed again by a
+ * different call in the meantime is never mistaken for the old one.
+ */
+enum SlotState : uint32_t {
+    SLOT_FREE = 0,
+    SLOT_CLAIMED,
+    SLOT_WAITING,
+    SLOT_DELIVERING,
+    SLOT_REPLIED,
+    SLOT_RELEASING
+};
+
+static uint64_t slot_state( uint32_t serial, SlotState state ) {
+    return ( static_cast<uint64_t>( serial ) << 32 ) | state;
+}
+
+/*
+ * Waiters are handed out to threads from here, and are never destroyed:
+ * the dispatching thread may still be waking one up after the thread that
+ * it belonged to has gotten its reply and exited.
+ */
+struct ReplyWaiterPool {
+    std::mutex lock;
+    std::vector<ReplyWaiter*> waiters;
+};
+
+static ReplyWaiterPool* waiter_pool() {
+    static ReplyWaiterPool* pool = new ReplyWaiterPool();
+    return pool;
+}
+
+/* The waiter that a thread uses for every call that it makes */
+class ThreadReplyWaiter {
+public:
+    ThreadReplyWaiter() {
+        ReplyWaiterPool* pool = waiter_pool();
+        std::unique_lock<std::mutex> lock( pool->lock );
+
+        if( pool->waiters.empty() ) {
+            m_waiter = new ReplyWaiter();
+        } else {
+            m_waiter = pool->waiters.back();
+            pool->waiters.pop_back();
+        }
+    }
+
+    ~ThreadReplyWaiter() {
+        ReplyWaiterPool* pool = waiter_pool();
+        std::unique_lock<std::mutex> lock( pool->lock );
+
+        pool->waiters.push_back( m_waiter );
+    }
+
+    ReplyWaiter* m_waiter;
+};
+
+static ReplyWaiter* this_thread_waiter() {
+    thread_local ThreadReplyWaiter waiter;
+    return waiter.m_waiter;
+}
+
+ReplyTable::ReplyTable() :
+    m_slots( new Slot[ REPLY_TABLE_SIZE ] ),
+    m_overflowSize( 0 ) {
+    for( size_t x = 0; x < REPLY_TABLE_SIZE; x++ ) {
+        m_slots[ x ].state.store( slot_state( 0, SLOT_FREE ), std::memory_order_relaxed );
+        m_slots[ x ].waiter.store( nullptr, std::memory_order_relaxed );
+    }
+}
+
+ReplyTable::~ReplyTable() {}
+
+void ReplyTable::add( uint32_t serial, std::shared_ptr<PendingCall> pending ) {
+    for( uint32_t x = 0; x < REPLY_TABLE_PROBES; x++ ) {
+        Slot* slot = &m_slots[ ( serial + x ) & ( REPLY_TABLE_SIZE - 1 ) ];
+        uint64_t expected = slot_state( 0, SLOT_FREE );
+
+        if( slot->state.compare_exchange_strong( expected,
+                slot_state( serial, SLOT_CLAIMED ),
+                std::memory_order_acquire ) ) {
+            slot->pending = std::move( pending );
+            slot->state.store( slot_state( serial, SLOT_WAITING ), std::memory_order_release );
+            return;
+        }
+    }
+
+    std::unique_lock<std::mutex> lock( m_overflowLock );
+    m_overflow[ serial ] = OverflowEntry{ std::shared_ptr<Message>(), std::move( pending ), false };
+    m_overflowSize.fetch_add( 1, std::memory_order_release );
+}
+
+ReplyTable::Slot* ReplyTable::find_slot( uint32_t serial ) {
+    for( uint32_t x = 0; x < REPLY_TABLE_PROBES; x++ ) {
+        Slot* slot = &m_slots[ ( serial + x ) & ( REPLY_TABLE_SIZE - 1 ) ];
+
+        if( ( slot->state.load( std::memory_order_acquire ) >> 32 ) == serial ) {
+            return slot;
+        }
+    }
+
+    return nullptr;
+}
+
+std::shared_ptr<DBus::Message> ReplyTable::release_slot( Slot* slot, uint32_t serial ) {
+    uint64_t current = slot->state.load( std::memory_order_acquire );
+
+    for( ;; ) {
+        if( current == slot_state( serial, SLOT_DELIVERING ) ) {
+            // The reply is being handed over right now; this won't take long
+            std::this_thread::yield();
+            current = slot->state.load( std::memory_order_acquire );
+            continue;
+        }
+
+        if( slot->state.compare_exchange_weak( current,
+                slot_state( serial, SLOT_RELEASING ),
+                std::memory_order_acq_rel ) ) {
+            break;
+        }
+    }
+
+    std::shared_ptr<Message> reply = std::move( slot->reply );
+    slot->reply.reset();
+    slot->pending.reset();
+    slot->state.store( slot_state( 0, SLOT_FREE ), std::memory_order_release );
+
+    return reply;
+}
+
+std::shared_ptr<DBus::Message> ReplyTable::wait( uint32_t serial, const std::chrono::steady_clock::time_point* deadline ) {
+    Slot* slot = find_slot( serial );
+
+    if( !slot ) {
+        return wait_overflow( serial, deadline );
+    }
+
+    if( slot->state.load( std::memory_order_acquire ) != slot_state( serial, SLOT_REPLIED ) ) {
+        ReplyWaiter* waiter = this_thread_waiter();
+        std::unique_lock<std::mutex> lock( waiter->lock );
+        auto replied = [slot, serial] {
+            return slot->state.load( std::memory_order_seq_cst ) == slot_state( serial, SLOT_REPLIED );
+        };
+
+        /*
+         * Either deliver() sees that we are here and wakes us up, or we see
+         * that the reply is in before going to sleep.  deliver() can't wake
+         * us up between the check and us going to sleep, as we hold the lock.
+         */
+        slot->waiter.store( waiter, std::memory_order_seq_cst );
+
+        if( deadline ) {
+            waiter->cv.wait_until( lock, *deadline, replied );
+        } else {
+            waiter->cv.wait( lock, replied );
+        }
+
+        slot->waiter.store( nullptr, std::memory_order_relaxed );
+    }
+
+    return release_slot( slot, serial );
+}
+
+std::shared_ptr<DBus::Message> ReplyTable::wait_overflow( uint32_t serial, const std::chrono::steady_clock::time_point* deadline ) {
+    std::unique_lock<std::mutex> lock( m_overflowLock );
+    std::map<uint32_t, OverflowEntry>::iterator it = m_overflow.find( serial );
+
+    if( it == m_overflow.end() ) {
+        return std::shared_ptr<Message>();
+    }
+
+    auto replied = [it] {
+        return it->second.replied;
+    };
+
+    if( deadline ) {
+        m_overflowCv.wait_until( lock, *deadline, replied );
+    } else {
+        m_overflowCv.wait( lock, replied );
+    }
+
+    std::shared_ptr<Message> reply = it->second.reply;
+    m_overflow.erase( it );
+    m_overflowSize.fetch_sub( 1, std::memory_order_release );
+
+    return reply;
+}
+
+bool ReplyTable::deliver( uint32_t serial, std::shared_ptr<Message> reply, std::shared_ptr<PendingCall>* pending ) {
+    for( uint32_t x = 0; x < REPLY_TABLE_PROBES; x++ ) {
+        Slot* slot = &m_slots[ ( serial + x ) & ( REPLY_TABLE_SIZE - 1 ) ];
+        uint64_t expected = slot_state( serial, SLOT_WAITING );
+
+        if( !slot->state.compare_exchange_strong( expected,
+                slot_state( serial, SLOT_DELIVERING ),
+                std::memory_order_acq_rel ) ) {
+            continue;
+        }
+
+        if( slot->pending ) {
+            // Nobody is waiting on this one, so we are done with the slot
+            *pending = std::move( slot->pending );
+            slot->pending.reset();
+            slot->state.store( slot_state( 0, SLOT_FREE ), std::memory_order_release );
+            return true;
+        }
+
+        slot->reply = std::move( reply );
+        slot->state.store( slot_state( serial, SLOT_REPLIED ), std::memory_order_seq_cst );
+
+        // If the waiter was a different call's by now, it just wakes up for nothing
+        ReplyWaiter* waiter = slot->waiter.load( std::memory_order_seq_cst );
+
+        if( waiter ) {
+            std::unique_lock<std::mutex> lock( waiter->lock );
+            waiter->cv.notify_all();
+        }
+
+        return true;
+    }
+
+    if( m_overflowSize.load( std::memory_order_acquire ) == 0 ) {
+        return false;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock( m_overflowLock );
+        std::map<uint32_t, OverflowEntry>::iterator it = m_overflow.find( serial );
+
+        if( it == m_overflow.end() || it->second.replied ) {
+            return false;
+        }
+
+        if( it->second.pending ) {
+            *pending = std::move( it->second.pending );
+            m_overflow.erase( it );
+            m_overflowSize.fetch_sub( 1, std::memory_order_release );
+            return true;
+        }
+
+        it->second.reply = std::move( reply );
+        it->second.replied = true;
+    }
+
+    m_overflowCv.notify_all();
+
+    return true;
+}
+
+std::shared_ptr<DBus::PendingCall> ReplyTable::remove( uint32_t serial ) {
+    std::shared_ptr<PendingCall> pending;
+
+    for( uint32_t x = 0; x < REPLY_TABLE_PROBES; x++ ) {
+        Slot* slot = &m_slots[ ( serial + x ) & ( REPLY_TABLE_SIZE - 1 ) ];
+        uint64_t expected = slot_state( serial, SLOT_WAITING );
+
+        if( slot->state.compare_exchange_strong( expected,
+                slot_state( serial, SLOT_RELEASING ),
+                std::memory_order_acq_rel ) ) {
+            pending = std::move( slot->pending );
+            slot->pending.reset();
+            slot->state.store( slot_state( 0, SLOT_FREE ), std::memory_order_release );
+            return pending;
+        }
+    }
+
+    if( m_overflowSize.load( std::memory_order_acquire ) == 0 ) {
+        return pending;
+    }
+
+    std::unique_lock<std::mutex> lock( m_overflowLock );
+    std::map<uint32_t, OverflowEntry>::iterator it = m_overflow.find( serial );
+
+    if( it != m_overflow.end() && it->second.pending ) {
+        pending = std::move( it->second.pending );
+        m_overflow.erase( it );
+        m_overflowSize.fetch_sub( 1, std::memory_order_release );
+    }
+
+    return pending;
+}
@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ ***************************************************************************/
+#ifndef DBUSCXX_REPLYTABLE_H
+#define DBUSCXX_REPLYTABLE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+
+namespace DBus {
+
+class Message;
+class PendingCall;
+
+namespace priv {
+
+struct ReplyWaiter;
+
+/**
+ * The calls that we are expecting a reply to, looked up by the serial
+ * of the call.
+ *
+ * Any thread may add a call and wait for its reply, while whichever thread
+ * reads the replies delivers them.  Neither adding, delivering nor picking up
+ * a reply takes a lock unless there are more calls outstanding than the
+ * table has room for; waiters that have to sleep only share a lock with
+ * the thread that wakes them up.
+ */
+class ReplyTable {
+public:
+    ReplyTable();
+
+    ~ReplyTable();
+
+    ReplyTable( const ReplyTable& ) = delete;
+    ReplyTable& operator=( const ReplyTable& ) = delete;
+
+    /**
+     * Start expecting a reply to the call with the given serial.  This must
+     * be done before the call is sent, so that the reply can't beat us.
+     *
+     * @param serial The serial of the call
+     * @param pending Who to give the reply to, or an invalid pointer if
+     * a thread is going to wait() for it.
+     */
+    void add( uint32_t serial, std::shared_ptr<PendingCall> pending );
+
+    /**
+     * Wait for the reply to a call that was added without a PendingCall,
+     * and then stop expecting it.  Only the thread that added the call may
+     * wait for it.
+     *
+     * @param serial The serial of the call
+     * @param deadline When to give up, or nullptr to wait forever
+     * @return The reply, or an invalid pointer if it didn't come in before
+     * the deadline.
+     */
+    std::shared_ptr<Message> wait( uint32_t serial, const std::chrono::steady_clock::time_point* deadline );
+
+    /**
+     * Give a reply to whoever is expecting it.  Any thread may deliver
+     * replies, but each reply must only be delivered once.
+     *
+     * If the call was added with a PendingCall, it is no longer expected and
+     * the PendingCall is handed back, for the caller to complete.
+     *
+     * @param serial The reply serial of the reply
+     * @param reply The reply
+     * @param pending Set to the PendingCall that the reply is for, if any
+     * @return False if nobody is expecting this reply
+     */
+    bool deliver( uint32_t serial, std::shared_ptr<Message> reply, std::shared_ptr<PendingCall>* pending );
+
+    /**
+     * Stop expecting a reply to a call that was added with a PendingCall.
+     *
+     * @param serial The serial of the call
+     * @return The PendingCall, or an invalid pointer if the reply has
+     * already been delivered.
+     */
+    std::shared_ptr<PendingCall> remove( uint32_t serial );
+
+private:
+    struct Slot {
+        /* The serial of the call in the upper 32 bits, the SlotState in the lower */
+        std::atomic<uint64_t> state;
+        /* Set while the waiting thread is asleep */
+        std::atomic<ReplyWaiter*> waiter;
+        std::shared_ptr<Message> reply;
+        std::shared_ptr<PendingCall> pending;
+    };
+
+    /* Calls that didn't fit into m_slots; these are protected by m_overflowLock */
+    struct OverflowEntry {
+        std::shared_ptr<Message> reply;
+        std::shared_ptr<PendingCall> pending;
+        bool replied;
+    };
+
+    Slot* find_slot( uint32_t serial );
+
+    std::shared_ptr<Message> release_slot( Slot* slot, uint32_t serial );
+
+    std::shared_ptr<Message> wait_overflow( uint32_t serial, const std::chrono::steady_clock::time_point* deadline );
+
+    std::unique_ptr<Slot[]> m_slots;
+    std::mutex m_overflowLock;
+    std::condition_variable m_overflowCv;
+    std::map<uint32_t, OverflowEntry> m_overflow;
+    std::atomic<size_t> m_overflowSize;
+};
+
+} /* namespace priv */
+
+} /* namespace DBus */
+
+#endif /* DBUSCXX_REPLYTABLE_H */
@@ -7,6 +7,7 @@
  ***************************************************************************/
 #include "returnmessage.h"
 #include "message.h"
+#include "messagepool.h"
 #include "callmessage.h"
 
 namespace DBus {
@@ -16,11 +17,11 @@ ReturnMessage::ReturnMessage( ) :
 }
 
 std::shared_ptr<ReturnMessage> ReturnMessage::create() {
-    return std::shared_ptr<ReturnMessage>( new ReturnMessage() );
+    return priv::create_pooled_message<ReturnMessage>();
 }
 
 std::shared_ptr<ReturnMessage> ReturnMessage::create( std::shared_ptr<const CallMessage> callee ) {
-    std::shared_ptr<ReturnMessage> ret = std::shared_ptr<ReturnMessage>( new ReturnMessage() );
+    std::shared_ptr<ReturnMessage> ret = priv::create_pooled_message<ReturnMessage>();
     ret->set_reply_serial( callee->serial() );
     return ret;
 }
@@ -9,12 +9,16 @@
 
 #include "dbus-cxx-private.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 #include <ostream>
 #include <poll.h>
 #include <regex>
 #include <sstream>
 #include <unistd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
 
 using DBus::priv::SASL;
 
@@ -22,11 +26,30 @@ class SASL::priv_data {
 public:
     priv_data( int fd, bool negotiateFDPassing ) :
         m_fd( fd ),
-        m_negotiateFDpassing( negotiateFDPassing )
+        m_negotiateFDpassing( negotiateFDPassing ),
+        m_gotNulByte( false ),
+        m_clientAuthenticated( false ),
+        m_waitingForData( false ),
+        m_negotiatedFD( false ),
+        m_numCommands( 0 ),
+        m_hasDeadline( false )
     {}
 
     int m_fd;
     bool m_negotiateFDpassing;
+    /* Data from the other side that has not been made into a line yet */
+    std::string m_lineBuffer;
+
+    /* Where the server side of the handshake with a client is at */
+    std::string m_serverGUID;
+    bool m_gotNulByte;
+    bool m_clientAuthenticated;
+    bool m_waitingForData;
+    bool m_negotiatedFD;
+    int m_numCommands;
+    /* If set, the client must be done by m_deadline */
+    bool m_hasDeadline;
+    std::chrono::steady_clock::time_point m_deadline;
 };
 
 static const std::regex OK_REGEX( "OK ([a-z0-9]*)" );
@@ -34,6 +57,13 @@ static const std::regex DATA_REGEX( "DATA ([a-z0-9]*)" );
 static const std::regex ERROR_REGEX( "ERROR(.*)" );
 static const std::regex AGREE_UNIX_FD_REGEX( "AGREE_UNIX_FD" );
 static const std::regex REJECTED_REGEX( "REJECTED (.*)" );
+static const std::regex AUTH_EXTERNAL_REGEX( "AUTH EXTERNAL ?([a-fA-F0-9]*)" );
+static const std::regex CLIENT_DATA_REGEX( "DATA ?([a-fA-F0-9]*)" );
+
+/* Lines longer than this from a client are an error */
+#define MAXIMUM_LINE_LENGTH 16384
+/* A client that can't authenticate within this many commands is rejected */
+#define MAXIMUM_AUTH_COMMANDS 16
 static const char* LOGGER_NAME = "DBus.priv.SASL";
 
 static int hexchar2int( char c ) {
@@ -42,7 +72,11 @@ static int hexchar2int( char c ) {
     }
 
     if( c >= 'a' && c <= 'f' ) {
-        return c - 97;
+        return c - 'a' + 10;
+    }
+
+    if( c >= 'A' && c <= 'F' ) {
+        return c - 'A' + 10;
     }
 
     return 0;
@@ -60,13 +94,25 @@ std::tuple<bool, bool, std::vector<uint8_t>> SASL::authenticate() {
     bool negotiatedFD = false;
     std::vector<uint8_t> serverGUID;
     uid_t uid = getuid();
+    std::string commands;
     std::string line;
     std::smatch regex_match;
 
-    write_data_with_newline( "AUTH EXTERNAL " + encode_as_hex( uid ) );
+    /*
+     * Send all of our commands at once instead of waiting for the response
+     * to each one; the server answers them in order, so we only need one
+     * round trip to authenticate.
+     */
+    commands = "AUTH EXTERNAL " + encode_as_hex( uid ) + "\r\n";
+
+    if( m_priv->m_negotiateFDpassing ) {
+        commands += "NEGOTIATE_UNIX_FD\r\n";
+    }
+
+    commands += "BEGIN";
+    write_data_with_newline( commands );
 
-    line = read_data();
-    if( line.length() == 0 ){
+    if( !read_line( &line ) ) {
         goto out;
     }
 
@@ -81,16 +127,12 @@ std::tuple<bool, bool, std::vector<uint8_t>> SASL::authenticate() {
             + regex_match[ 1 ].str() );
         goto out;
     } else {
-        // Unknown command, return an error to the server
-        write_data_with_newline( "ERROR Unrecognized response" );
+        SIMPLELOGGER_DEBUG( "DBus.priv.SASL", "Unrecognized response: " + line );
         goto out;
     }
 
     if( m_priv->m_negotiateFDpassing ) {
-        write_data_with_newline( "NEGOTIATE_UNIX_FD" );
-        line = read_data();
-
-        if( line.length() == 0 ){
+        if( !read_line( &line ) ) {
             goto out;
         }
 
@@ -104,8 +146,6 @@ std::tuple<bool, bool, std::vector<uint8_t>> SASL::authenticate() {
         }
     }
 
-    write_data_with_newline( "BEGIN" );
-
     success = true;
 
 out:
@@ -113,39 +153,283 @@ out:
     return std::make_tuple( success, negotiatedFD, serverGUID );
 }
 
-int SASL::write_data_with_newline( std::string data ) {
-    SIMPLELOGGER_DEBUG( LOGGER_NAME, "Sending command: " + data );
-    data += "\r\n";
-    return ::write( m_priv->m_fd, data.c_str(), data.length() );
+void SASL::start_client_authentication( const std::string& serverGUID, int timeout_milliseconds ) {
+    m_priv->m_serverGUID = serverGUID;
+
+    /*
+     * The whole handshake has to be done in time, not just each line: a
+     * client that trickles in one byte at a time must not be able to stay
+     * around forever.
+     */
+    if( timeout_milliseconds >= 0 ) {
+        m_priv->m_hasDeadline = true;
+        m_priv->m_deadline = std::chrono::steady_clock::now() +
+            std::chrono::milliseconds( timeout_milliseconds );
+    }
+}
+
+SASL::ClientAuthStatus SASL::continue_client_authentication() {
+    std::string line;
+    int readRet;
+
+    while( ( readRet = read_available_line( &line ) ) > 0 ) {
+        // The client always starts by sending us a single nul byte
+        if( !m_priv->m_gotNulByte ) {
+            if( line.empty() || line[ 0 ] != '\0' ) {
+                SIMPLELOGGER_DEBUG( LOGGER_NAME, "Client did not send a nul byte first" );
+                return ClientAuthStatus::Failed;
+            }
+
+            line.erase( 0, 1 );
+            m_priv->m_gotNulByte = true;
+        }
+
+        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Received command: " + line );
+
+        ClientAuthStatus status = process_client_command( line );
+
+        if( status != ClientAuthStatus::InProgress ) {
+            return status;
+        }
+    }
+
+    if( readRet < 0 ) {
+        return ClientAuthStatus::Failed;
+    }
+
+    if( client_time_left() == 0 ) {
+        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Client took too long to authenticate" );
+        return ClientAuthStatus::Failed;
+    }
+
+    return ClientAuthStatus::InProgress;
+}
+
+SASL::ClientAuthStatus SASL::process_client_command( const std::string& line ) {
+    std::smatch regex_match;
+
+    if( ++m_priv->m_numCommands > MAXIMUM_AUTH_COMMANDS ) {
+        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Client did not authenticate" );
+        return ClientAuthStatus::Failed;
+    }
+
+    if( line == "BEGIN" ) {
+        if( m_priv->m_clientAuthenticated ) {
+            return ClientAuthStatus::Authenticated;
+        }
+
+        // BEGIN before authenticating is not allowed
+        return ClientAuthStatus::Failed;
+    }
+
+    if( m_priv->m_clientAuthenticated ) {
+        if( line == "NEGOTIATE_UNIX_FD" ) {
+            if( m_priv->m_negotiateFDpassing ) {
+                m_priv->m_negotiatedFD = true;
+                write_data_with_newline( "AGREE_UNIX_FD" );
+            } else {
+                write_data_with_newline( "ERROR FD passing is not supported" );
+            }
+        } else {
+            write_data_with_newline( "ERROR Unknown command" );
+        }
+
+        return ClientAuthStatus::InProgress;
+    }
+
+    if( m_priv->m_waitingForData &&
+        std::regex_match( line, regex_match, CLIENT_DATA_REGEX ) ) {
+        m_priv->m_waitingForData = false;
+
+        if( client_uid_is_valid( regex_match[ 1 ] ) ) {
+            m_priv->m_clientAuthenticated = true;
+            write_data_with_newline( "OK " + m_priv->m_serverGUID );
+        } else {
+            write_data_with_newline( "REJECTED EXTERNAL" );
+        }
+    } else if( std::regex_match( line, regex_match, AUTH_EXTERNAL_REGEX ) ) {
+        if( regex_match[ 1 ].length() == 0 ) {
+            // No initial response; ask for the identity
+            m_priv->m_waitingForData = true;
+            write_data_with_newline( "DATA" );
+        } else if( client_uid_is_valid( regex_match[ 1 ] ) ) {
+            m_priv->m_clientAuthenticated = true;
+            write_data_with_newline( "OK " + m_priv->m_serverGUID );
+        } else {
+            write_data_with_newline( "REJECTED EXTERNAL" );
+        }
+    } else if( line.compare( 0, 4, "AUTH" ) == 0 ||
+        line == "CANCEL" ||
+        line.compare( 0, 5, "ERROR" ) == 0 ) {
+        // Either an unsupported mechanism, or the client gave up on this one
+        m_priv->m_waitingForData = false;
+        write_data_with_newline( "REJECTED EXTERNAL" );
+    } else {
+        write_data_with_newline( "ERROR Unknown command" );
+    }
+
+    return ClientAuthStatus::InProgress;
+}
+
+int SASL::client_time_left() const {
+    if( !m_priv->m_hasDeadline ) {
+        return -1;
+    }
+
+    std::chrono::steady_clock::duration remaining =
+        m_priv->m_deadline - std::chrono::steady_clock::now();
+
+    // Round up, so that nobody spins on a deadline less than 1ms away
+    return std::max<int>( 0,
+            std::chrono::ceil<std::chrono::milliseconds>( remaining ).count() );
 }
 
-std::string SASL::read_data() {
-    std::string line_read;
+bool SASL::client_negotiated_fd() const {
+    return m_priv->m_negotiatedFD;
+}
+
+bool SASL::read_line( std::string* line ) {
+    int readRet;
+
+    while( ( readRet = read_available_line( line ) ) == 0 ) {
+        pollfd pollfd;
+        pollfd.fd = m_priv->m_fd;
+        pollfd.events = POLLIN;
+
+        if( poll( &pollfd, 1, -1 ) < 0 && errno != EINTR ) {
+            std::string errmsg = strerror( errno );
+            SIMPLELOGGER_ERROR( LOGGER_NAME, "Unable to poll for SASL data: " + errmsg );
+            return false;
+        }
+    }
+
+    return readRet > 0;
+}
+
+int SASL::read_available_line( std::string* line ) {
+    size_t lineEnd;
     char dataBuffer[ 512 ];
     ssize_t bytesRead;
 
-    pollfd pollfd;
-    pollfd.fd = m_priv->m_fd;
-    pollfd.events = POLLIN;
+    while( ( lineEnd = m_priv->m_lineBuffer.find( "\r\n" ) ) == std::string::npos ) {
+        if( m_priv->m_lineBuffer.size() > MAXIMUM_LINE_LENGTH ) {
+            SIMPLELOGGER_DEBUG( LOGGER_NAME, "Line from other side is too long" );
+            return -1;
+        }
+
+        /*
+         * Only take up to the end of the line out of the socket; anything
+         * after the last line belongs to whoever reads from the socket next.
+         */
+        bytesRead = ::recv( m_priv->m_fd, dataBuffer, sizeof( dataBuffer ), MSG_PEEK | MSG_DONTWAIT );
+
+        if( bytesRead > 0 ) {
+            char* newline = static_cast<char*>( memchr( dataBuffer, '\n', bytesRead ) );
+
+            if( newline != nullptr ) {
+                bytesRead = newline - dataBuffer + 1;
+            }
+
+            bytesRead = ::recv( m_priv->m_fd, dataBuffer, bytesRead, MSG_DONTWAIT );
+        }
+
+        if( bytesRead < 0 && errno == EINTR ) {
+            continue;
+        }
+
+        if( bytesRead < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) ) {
+            return 0;
+        }
+
+        if( bytesRead <= 0 ) {
+            SIMPLELOGGER_DEBUG( LOGGER_NAME, "Other side went away while authenticating" );
+            return -1;
+        }
+
+        m_priv->m_lineBuffer.append( dataBuffer, bytesRead );
+    }
+
+    *line = m_priv->m_lineBuffer.substr( 0, lineEnd );
+    m_priv->m_lineBuffer.erase( 0, lineEnd + 2 );
+
+    return 1;
+}
+
+/*
+ * Find out who is on the other end of a unix socket.
+ */
+static bool get_peer_uid( int fd, uid_t* uid ) {
+#ifdef SO_PEERCRED
+    struct ucred cred;
+    socklen_t credLen = sizeof( cred );
 
-    if( poll( &pollfd, 1, -1 ) < 0 ) {
+    if( getsockopt( fd, SOL_SOCKET, SO_PEERCRED, &cred, &credLen ) < 0 ) {
         std::string errmsg = strerror( errno );
-        SIMPLELOGGER_ERROR( "DBus.priv.SASL", "Unable to poll for response from daemon: " + errmsg );
-        return line_read;
+        SIMPLELOGGER_ERROR( LOGGER_NAME, "Unable to get credentials of client: " + errmsg );
+        return false;
+    }
+
+    *uid = cred.uid;
+#else
+    gid_t peerGID;
+
+    if( getpeereid( fd, uid, &peerGID ) < 0 ) {
+        std::string errmsg = strerror( errno );
+        SIMPLELOGGER_ERROR( LOGGER_NAME, "Unable to get credentials of client: " + errmsg );
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+bool SASL::client_is_same_user( int fd ) {
+    uid_t peerUID;
+
+    if( !get_peer_uid( fd, &peerUID ) ) {
+        return false;
+    }
+
+    if( peerUID != getuid() ) {
+        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Rejecting client with uid " << peerUID );
+        return false;
+    }
+
+    return true;
+}
+
+bool SASL::client_uid_is_valid( const std::string& hexUID ) {
+    std::vector<uint8_t> uidChars = hex_to_vector( hexUID );
+    std::string uidString( uidChars.begin(), uidChars.end() );
+    uid_t peerUID;
+
+    if( uidString.empty() ||
+        uidString.find_first_not_of( "0123456789" ) != std::string::npos ) {
+        return false;
     }
 
-    // TODO Note that we are making an assumption here that we don't
-    // have a short read.  This may need to be fixed in the future.
-    bytesRead = ::read( m_priv->m_fd, &dataBuffer, 512 );
-    if( bytesRead < 0 ){
-        SIMPLELOGGER_ERROR( LOGGER_NAME, "Unable to read SASL data!" );
-        return std::string();
+    if( !get_peer_uid( m_priv->m_fd, &peerUID ) ) {
+        return false;
     }
-    line_read = std::string( dataBuffer, bytesRead );
 
-    SIMPLELOGGER_DEBUG( LOGGER_NAME, "Received response: " + line_read );
+    if( std::to_string( peerUID ) != uidString ) {
+        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Client claims to be uid " << uidString << ", but is " << peerUID );
+        return false;
+    }
+
+    // Only let in the same user that we are
+    if( peerUID != getuid() ) {
+        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Rejecting client with uid " << peerUID );
+        return false;
+    }
 
-    return line_read;
+    return true;
+}
+
+int SASL::write_data_with_newline( std::string data ) {
+    SIMPLELOGGER_DEBUG( LOGGER_NAME, "Sending command: " + data );
+    data += "\r\n";
+    return ::write( m_priv->m_fd, data.c_str(), data.length() );
 }
 
 std::string SASL::encode_as_hex( int num ) {
@@ -45,9 +45,89 @@ public:
      */
     std::tuple<bool, bool, std::vector<uint8_t>> authenticate();
 
+    /**
+     * Where the server side of the authentication with a client is at.
+     */
+    enum class ClientAuthStatus {
+        /** The client has not finished authenticating yet */
+        InProgress,
+        /** The client has authenticated and sent BEGIN */
+        Authenticated,
+        /** The client is not allowed in, has gone away or took too long */
+        Failed,
+    };
+
+    /**
+     * Start the server side of the authentication with a client that has
+     * connected to us.  Only the EXTERNAL mechanism is supported, and the
+     * client must be running as the same user that we are.
+     *
+     * Nothing is read here; call continue_client_authentication() whenever
+     * the socket is readable until the client is done.
+     *
+     * @param serverGUID Our GUID, as a hex string
+     * @param timeout_milliseconds How long the client has to authenticate,
+     * or -1 to wait forever.  A client that takes longer than this is
+     * rejected.
+     */
+    void start_client_authentication( const std::string& serverGUID, int timeout_milliseconds );
+
+    /**
+     * Handle whatever the client has sent us so far, without waiting for
+     * any more.  The socket should be non-blocking.
+     *
+     * @return Where the authentication is at
+     */
+    ClientAuthStatus continue_client_authentication();
+
+    /**
+     * How long the client has left to authenticate, in milliseconds, or
+     * -1 if there is no limit.
+     */
+    int client_time_left() const;
+
+    /** True if the client asked for and got FD passing */
+    bool client_negotiated_fd() const;
+
+    /**
+     * Check that the other end of the given socket is running as the same
+     * user that we are.  This is known as soon as the client has connected,
+     * before it says anything.
+     */
+    static bool client_is_same_user( int fd );
+
 private:
     int write_data_with_newline( std::string data );
-    std::string read_data();
+
+    /**
+     * Read a single line from the other side, without the line ending.
+     *
+     * @param line Set to the line that was read
+     * @return False if the other side has gone away
+     */
+    bool read_line( std::string* line );
+
+    /**
+     * Read a single line from the other side if all of it is here, without
+     * waiting for the rest of it.
+     *
+     * @param line Set to the line that was read, without the line ending
+     * @return 1 if line was set, 0 if the line has not all come in yet, or
+     * -1 if the other side has gone away or sent a line that is too long
+     */
+    int read_available_line( std::string* line );
+
+    /**
+     * Act on a single command from a client that is authenticating.
+     */
+    ClientAuthStatus process_client_command( const std::string& line );
+
+    /**
+     * Check that the user ID that the client sent us is who they really are.
+     *
+     * @param hexUID The user ID as sent with AUTH EXTERNAL
+     */
+    bool client_uid_is_valid( const std::string& hexUID );
     std::string encode_as_hex( int num );
     std::vector<uint8_t> hex_to_vector( std::string hexData );
 
@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ ***************************************************************************/
+#include "sendbuffer.h"
+
+#ifndef _WIN32
+
+#include "dbus-cxx-private.h"
+#include "message.h"
+#include "utility.h"
+
+#include <deque>
+#include <sstream>
+
+using DBus::priv::SendBuffer;
+
+static const char* LOGGER_NAME = "DBus.priv.SendBuffer";
+
+/* Serialization buffers bigger than this are freed instead of being reused */
+#define MAXIMUM_SPARE_CAPACITY 65536
+#define MAXIMUM_SPARE_BUFFERS  32
+
+struct PendingMessage {
+    std::vector<uint8_t> data;
+    /* Only set if this message has FDs to send, to keep them open until they are */
+    std::shared_ptr<const DBus::Message> fdMessage;
+};
+
+class SendBuffer::priv_data {
+public:
+    priv_data() :
+        m_frontOffset( 0 ),
+        m_size( 0 )
+    {}
+
+    std::deque<PendingMessage> m_messages;
+    /* How much of the front message has already been written */
+    size_t m_frontOffset;
+    size_t m_size;
+    /* Buffers of messages that have been written, to serialize new messages into */
+    std::vector<std::vector<uint8_t>> m_spareBuffers;
+};
+
+SendBuffer::SendBuffer() :
+    m_priv( std::make_unique<priv_data>() ) {
+}
+
+SendBuffer::~SendBuffer() {
+}
+
+bool SendBuffer::append( std::shared_ptr<const Message> message, uint32_t serial ) {
+    PendingMessage pending;
+
+    if( !m_priv->m_spareBuffers.empty() ) {
+        pending.data = std::move( m_priv->m_spareBuffers.back() );
+        m_priv->m_spareBuffers.pop_back();
+    }
+
+    if( !message->serialize_to_vector( &pending.data, serial ) ) {
+        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Unable to serialize message with serial " << serial );
+        return false;
+    }
+
+    if( dbuscxx_log_function ) {
+        std::ostringstream debug_str;
+        debug_str << "Going to send the following bytes: " << std::endl;
+        DBus::hexdump( &pending.data, &debug_str );
+        SIMPLELOGGER_TRACE( LOGGER_NAME, debug_str.str() );
+    }
+
+    if( !message->filedescriptors().empty() ) {
+        pending.fdMessage = message;
+    }
+
+    m_priv->m_size += pending.data.size();
+    m_priv->m_messages.push_back( std::move( pending ) );
+
+    return true;
+}
+
+size_t SendBuffer::size() const {
+    return m_priv->m_size;
+}
+
+bool SendBuffer::empty() const {
+    return m_priv->m_size == 0;
+}
+
+int SendBuffer::next_write( struct iovec* iov, int maxIovecs, const std::vector<int>** fds ) {
+    int numIovecs = 0;
+
+    *fds = nullptr;
+
+    for( PendingMessage& pending : m_priv->m_messages ) {
+        if( numIovecs == maxIovecs ) {
+            break;
+        }
+
+        if( pending.fdMessage ) {
+            if( numIovecs > 0 ) {
+                break;
+            }
+
+            // If we have already written part of this message, its FDs have been sent
+            if( m_priv->m_frontOffset == 0 ) {
+                *fds = &pending.fdMessage->filedescriptors();
+            }
+        }
+
+        size_t offset = numIovecs == 0 ? m_priv->m_frontOffset : 0;
+        iov[ numIovecs ].iov_base = pending.data.data() + offset;
+        iov[ numIovecs ].iov_len = pending.data.size() - offset;
+        numIovecs++;
+    }
+
+    return numIovecs;
+}
+
+void SendBuffer::consume( size_t numBytes ) {
+    m_priv->m_size -= numBytes;
+
+    while( numBytes > 0 ) {
+        PendingMessage& front = m_priv->m_messages.front();
+        size_t remaining = front.data.size() - m_priv->m_frontOffset;
+
+        if( numBytes < remaining ) {
+            m_priv->m_frontOffset += numBytes;
+            return;
+        }
+
+        numBytes -= remaining;
+        m_priv->m_frontOffset = 0;
+
+        if( front.data.capacity() <= MAXIMUM_SPARE_CAPACITY &&
+            m_priv->m_spareBuffers.size() < MAXIMUM_SPARE_BUFFERS ) {
+            front.data.clear();
+            m_priv->m_spareBuffers.push_back( std::move( front.data ) );
+        }
+
+        m_priv->m_messages.pop_front();
+    }
+}
+
+void SendBuffer::clear() {
+    m_priv->m_messages.clear();
+    m_priv->m_frontOffset = 0;
+    m_priv->m_size = 0;
+}
+
+#endif /* _WIN32 */
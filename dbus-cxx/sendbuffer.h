@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ ***************************************************************************/
+#ifndef DBUSCXX_SENDBUFFER_H
+#define DBUSCXX_SENDBUFFER_H
+
+#include <dbus-cxx/dbus-cxx-config.h>
+
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
+namespace DBus {
+
+class Message;
+
+namespace priv {
+
+#ifndef _WIN32
+
+/**
+ * Holds serialized messages that have not been completely written to a
+ * stream yet.
+ *
+ * A transport appends messages to this, writes as much as the stream will
+ * take without blocking, and then tells this buffer how much was written.
+ * Whatever is left over is written once the stream becomes writable again,
+ * so a slow reader on the other end never blocks the writer.
+ */
+class SendBuffer {
+public:
+    SendBuffer();
+
+    ~SendBuffer();
+
+    /**
+     * Serialize a message onto the end of this buffer.
+     *
+     * @param message The message to add
+     * @param serial The serial to send the message with
+     * @return False if the message could not be serialized
+     */
+    bool append( std::shared_ptr<const Message> message, uint32_t serial );
+
+    /**
+     * @return The number of bytes waiting to be written
+     */
+    size_t size() const;
+
+    /**
+     * @return True if there is nothing waiting to be written
+     */
+    bool empty() const;
+
+    /**
+     * Get the data to hand to the next write.  File descriptors must be
+     * attached to the first byte of the message that they belong to, so a
+     * message with file descriptors always starts a new write.
+     *
+     * @param iov Where to put the data to write
+     * @param maxIovecs How many entries iov has room for
+     * @param fds Set to the file descriptors to send along with this write,
+     * or nullptr if there are none.
+     * @return The number of entries of iov that were filled in
+     */
+    int next_write( struct iovec* iov, int maxIovecs, const std::vector<int>** fds );
+
+    /**
+     * Note that data from next_write() has been written.
+     *
+     * @param numBytes How many bytes were written
+     */
+    void consume( size_t numBytes );
+
+    /**
+     * Discard everything in this buffer.
+     */
+    void clear();
+
+private:
+    class priv_data;
+
+    DBUS_CXX_PROPAGATE_CONST( std::unique_ptr<priv_data> ) m_priv;
+};
+
+#endif /* _WIN32 */
+
+} /* namespace priv */
+} /* namespace DBus */
+
+#endif /* DBUSCXX_SENDBUFFER_H */
@@ -11,7 +11,11 @@
 #include "utility.h"
 #include "validator.h"
 #include "message.h"
+#include "receivebuffer.h"
+#include "sendbuffer.h"
 
+#include <algorithm>
+#include <climits>
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -19,12 +23,12 @@
 
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 using DBus::priv::SendmsgTransport;
 
 static const char* LOGGER_NAME = "DBus.priv.SendmsgTransport";
 
-#define RECEIVE_BUFFER_SIZE 1024
 #define SEND_BUFFER_SIZE    2048
 #define CONTROL_BUFFER_SIZE 512
 
@@ -34,7 +38,6 @@ public:
     priv_data( int fd ) :
         m_fd( fd ),
         m_ok( false ),
-        rx_capacity( RECEIVE_BUFFER_SIZE ),
         rx_control_capacity( CONTROL_BUFFER_SIZE ),
         lpWSARecvMsg( NULL ) {
         ::memset( &rx_msg, 0, sizeof( WSAMSG ) );
@@ -43,7 +46,6 @@ public:
     }
 
     ~priv_data() {
-        free( rx_msg.lpBuffers[0].buf );
         free( rx_msg.Control.buf );
         free( tx_msg.Control.buf );
     }
@@ -51,10 +53,10 @@ public:
     int m_fd;
     bool m_ok;
     std::vector<uint8_t> m_sendBuffer;
+    ReceiveBuffer m_receiveBuffer;
 
     WSAMSG rx_msg;
     WSABUF rx_buf;
-    int rx_capacity;
     int rx_control_capacity;
 
     WSAMSG tx_msg;
@@ -65,8 +67,6 @@ public:
     void init() {
         // Setup the RX data msghdr
         rx_msg.lpBuffers = &rx_buf;
-        rx_msg.lpBuffers[0].buf = ( PCHAR ) ::malloc( rx_capacity );
-        rx_msg.lpBuffers[0].len = rx_capacity;
         rx_msg.dwBufferCount = 1;
         rx_msg.Control.buf = ( PCHAR ) ::malloc( rx_control_capacity );
         rx_msg.Control.len = rx_control_capacity;
@@ -84,28 +84,10 @@ public:
         }
     }
 
-    uint8_t* rx_byte_buf_data() {
-        return reinterpret_cast<uint8_t*>( rx_msg.lpBuffers[0].buf );
-    }
-
-    ssize_t rx_size() {
-        return rx_msg.lpBuffers[0].len;
-    }
-
     ssize_t rx_control_size() {
         return rx_msg.Control.len;
     }
 
-    void set_rx_capacity( ssize_t capacity ) {
-        free( rx_msg.lpBuffers[0].buf );
-        rx_msg.lpBuffers[0].buf = ( PCHAR ) ::malloc( capacity );
-        rx_capacity = capacity;
-    }
-
-    int peek( ssize_t size ) {
-        return receive( size, 0, 0, MSG_PEEK );
-    }
-
     int send() {
         tx_buf.buf = ( PCHAR )m_sendBuffer.data();
         tx_buf.len = m_sendBuffer.size();
@@ -121,19 +103,23 @@ public:
         return result;
     }
 
-    int receive( ssize_t size, ssize_t control_size, ssize_t name_size, DWORD flags ) {
+    int receive( uint8_t* data, ssize_t size, ssize_t control_size, ssize_t name_size, DWORD flags ) {
+        DWORD bytesReceived = 0;
+
+        rx_msg.lpBuffers[0].buf = ( PCHAR )data;
         rx_msg.lpBuffers[0].len = size;
         rx_msg.namelen = name_size;
         rx_msg.Control.len = control_size;
 
         rx_msg.dwFlags = flags;
-        int result = lpWSARecvMsg( m_fd, &rx_msg, NULL, NULL, NULL );
+        int result = lpWSARecvMsg( m_fd, &rx_msg, &bytesReceived, NULL, NULL );
 
         if( result == SOCKET_ERROR ) {
             wsa_errno( result );
+            return result;
         }
 
-        return result;
+        return bytesReceived;
     }
 };
 #else /* POSIX */
@@ -142,82 +128,144 @@ public:
     priv_data( int fd ) :
         m_fd( fd ),
         m_ok( false ),
-        rx_capacity( RECEIVE_BUFFER_SIZE ),
         rx_control_capacity( CONTROL_BUFFER_SIZE ),
         tx_control_data( nullptr ),
         tx_control_capacity( CONTROL_BUFFER_SIZE )
         {
         ::memset( &rx_msg, 0, sizeof( struct msghdr ) );
         ::memset( &tx_msg, 0, sizeof( struct msghdr ) );
-        m_sendBuffer.reserve( SEND_BUFFER_SIZE );
     }
 
     ~priv_data() {
-        free( rx_msg.msg_iov[0].iov_base );
         free( rx_msg.msg_control );
         free( tx_control_data );
     }
 
     int m_fd;
     bool m_ok;
-    std::vector<uint8_t> m_sendBuffer;
+    SendBuffer m_sendBuffer;
+    std::vector<struct iovec> m_sendIovecs;
+    ReceiveBuffer m_receiveBuffer;
 
     struct msghdr rx_msg;
     struct iovec rx_buf;
-    int rx_capacity;
     int rx_control_capacity;
 
     struct msghdr tx_msg;
-    struct iovec tx_buf;
     void* tx_control_data;
     int tx_control_capacity;
 
-    std::mutex m_send_mutex;
+    mutable std::mutex m_send_mutex;
 
     void init() {
         // Setup the RX data msghdr
         rx_msg.msg_iov = &rx_buf;
-        rx_msg.msg_iov[0].iov_base = ::malloc( rx_capacity );
-        rx_msg.msg_iov[0].iov_len = rx_capacity;
         rx_msg.msg_iovlen = 1;
         rx_msg.msg_control = ::malloc( rx_control_capacity );
 
-        // Setup the TX data msghdr
-        tx_msg.msg_iov = &tx_buf;
-        tx_msg.msg_iovlen = 1;
         tx_control_data = ::malloc( tx_control_capacity );
     }
 
-    uint8_t* rx_byte_buf_data() {
-        return static_cast<uint8_t*>( rx_msg.msg_iov[0].iov_base );
-    }
-
-    ssize_t rx_size() {
-        return rx_msg.msg_iov[0].iov_len;
-    }
-
     ssize_t rx_control_size() {
         return rx_msg.msg_controllen;
     }
 
-    void set_rx_capacity( ssize_t capacity ) {
-        free( rx_msg.msg_iov[0].iov_base );
-        rx_msg.msg_iov[0].iov_base = ::malloc( capacity );
-        rx_capacity = capacity;
-    }
+    /**
+     * Do a single sendmsg() of the given iovecs, attaching the given FDs
+     * to the first byte of data.
+     *
+     * @return The number of bytes written, or -1 on error
+     */
+    ssize_t send( struct iovec* iov, size_t iovcnt, const std::vector<int>* fds ) {
+        tx_msg.msg_iov = iov;
+        tx_msg.msg_iovlen = iovcnt;
+        tx_msg.msg_control = nullptr;
+        tx_msg.msg_controllen = 0;
+
+        /* Fill in our FD array(ancillary data) */
+        if( fds != nullptr && fds->size() > 0 ) {
+            int fd_space_needed = CMSG_SPACE( sizeof( int ) * fds->size() );
+            struct cmsghdr* cmsg;
+
+            if( tx_control_capacity < fd_space_needed ) {
+                free( tx_control_data );
+                tx_control_data = ::malloc( fd_space_needed );
+                tx_control_capacity = fd_space_needed;
+            }
 
-    int peek( ssize_t size ) {
-        return receive( size, 0, 0, MSG_PEEK );
-    }
+            tx_msg.msg_control = tx_control_data;
+            tx_msg.msg_controllen = fd_space_needed;
+            cmsg = CMSG_FIRSTHDR( &tx_msg );
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN( sizeof( int ) * fds->size() );
 
-    int send() {
-        tx_buf.iov_base = m_sendBuffer.data();
-        tx_buf.iov_len = m_sendBuffer.size();
+            int* data = ( int* )CMSG_DATA( cmsg );
+
+            for( int fd : *fds ) {
+                *data = fd;
+                data++;
+            }
+        }
 
         return sendmsg( m_fd, &tx_msg, 0 );
     }
 
-    int receive( ssize_t size, ssize_t control_size, ssize_t name_size, int flags ) {
+    /**
+     * Write out what is in our send buffer.
+     *
+     * @param block True to wait until everything has been written, false to
+     * only write what the socket will take right now.
+     * @return The number of bytes written, or -1 on error
+     */
+    ssize_t write_pending( bool block ) {
+        ssize_t totalWritten = 0;
+
+        if( m_sendIovecs.size() < IOV_MAX ) {
+            m_sendIovecs.resize( IOV_MAX );
+        }
+
+        while( !m_sendBuffer.empty() ) {
+            const std::vector<int>* fds;
+            int iovcnt = m_sendBuffer.next_write( m_sendIovecs.data(), IOV_MAX, &fds );
+            ssize_t ret = send( m_sendIovecs.data(), iovcnt, fds );
+
+            if( ret < 0 ) {
+                if( errno == EINTR ) {
+                    continue;
+                }
+
+                if( errno == EAGAIN || errno == EWOULDBLOCK ) {
+                    if( block && DBus::priv::wait_for_fd_writable( m_fd, -1 ) ) {
+                        continue;
+                    }
+
+                    // The rest will be written once the socket is writable
+                    break;
+                }
+
+                int my_errno = errno;
+                std::ostringstream debug_str;
+
+                debug_str << "Can't send message: " << strerror( my_errno );
+
+                SIMPLELOGGER_ERROR( LOGGER_NAME, debug_str.str() );
+                m_ok = false;
+                errno = my_errno;
+                return ret;
+            }
+
+            m_sendBuffer.consume( ret );
+            totalWritten += ret;
+        }
+
+        SIMPLELOGGER_TRACE( LOGGER_NAME, "Wrote " << totalWritten << " bytes, " << m_sendBuffer.size() << " bytes pending" );
+
+        return totalWritten;
+    }
+
+    ssize_t receive( uint8_t* data, ssize_t size, ssize_t control_size, ssize_t name_size, int flags ) {
+        rx_msg.msg_iov[0].iov_base = data;
         rx_msg.msg_iov[0].iov_len = size;
         rx_msg.msg_controllen = control_size;
         rx_msg.msg_namelen = name_size;
@@ -263,8 +311,8 @@ std::shared_ptr<SendmsgTransport> SendmsgTransport::create( int fd, bool initial
 
 ssize_t SendmsgTransport::writeMessage( std::shared_ptr<const DBus::Message> message, uint32_t serial )
 {
-    std::scoped_lock lock(m_priv->m_send_mutex);
 #ifdef _WIN32
+    std::scoped_lock lock(m_priv->m_send_mutex);
     const std::vector<int> filedescriptors = message->filedescriptors();
 
     if( filedescriptors.size() > 0 ) {
@@ -284,50 +332,6 @@ ssize_t SendmsgTransport::writeMessage( std::shared_ptr<const DBus::Message> mes
     debug_str << "Going to send the following bytes: " << std::endl;
     DBus::hexdump( &m_priv->m_sendBuffer, &debug_str );
     SIMPLELOGGER_TRACE( LOGGER_NAME, debug_str.str() );
-#else /* POSIX */
-    const std::vector<int> filedescriptors = message->filedescriptors();
-    struct cmsghdr* cmsg;
-    int fd_space_needed = CMSG_SPACE( sizeof( int ) * filedescriptors.size() );
-    std::ostringstream debug_str;
-    ssize_t ret;
-
-    m_priv->m_sendBuffer.clear();
-
-    if( !message->serialize_to_vector( &m_priv->m_sendBuffer, serial ) ) {
-        return 0;
-    }
-
-    debug_str << "Going to send the following bytes: " << std::endl;
-    DBus::hexdump( &m_priv->m_sendBuffer, &debug_str );
-    SIMPLELOGGER_TRACE( LOGGER_NAME, debug_str.str() );
-
-    m_priv->tx_msg.msg_control = nullptr;
-    m_priv->tx_msg.msg_controllen = 0;
-
-    if( m_priv->tx_control_capacity < fd_space_needed ) {
-        free( m_priv->tx_control_data );
-        m_priv->tx_control_data = ::malloc( fd_space_needed );
-        m_priv->tx_control_capacity = fd_space_needed;
-    }
-
-    /* Fill in our FD array(ancillary data) */
-    if( filedescriptors.size() > 0 ) {
-        m_priv->tx_msg.msg_control = m_priv->tx_control_data;
-        m_priv->tx_msg.msg_controllen = fd_space_needed;
-        cmsg = CMSG_FIRSTHDR( &m_priv->tx_msg );
-        cmsg->cmsg_level = SOL_SOCKET;
-        cmsg->cmsg_type = SCM_RIGHTS;
-        cmsg->cmsg_len = CMSG_LEN( sizeof( int ) * filedescriptors.size() );
-
-        int* data = ( int* )CMSG_DATA( cmsg );
-
-        for( int fd : filedescriptors ) {
-            *data = fd;
-            data++;
-        }
-    }
-
-#endif /* WIN32 */
 
     /* Now we finally send the data! */
     ret = m_priv->send();
@@ -344,110 +348,146 @@ ssize_t SendmsgTransport::writeMessage( std::shared_ptr<const DBus::Message> mes
     }
 
     return ret;
-}
+#else /* POSIX */
+    std::scoped_lock lock(m_priv->m_send_mutex);
 
-std::shared_ptr<DBus::Message> SendmsgTransport::readMessage() {
-    uint32_t header_array_len;
-    ssize_t body_len;
-    ssize_t total_len;
-    ssize_t ret;
-    uint8_t* header_raw = m_priv->rx_byte_buf_data();
-    std::vector<int> fds;
-#ifndef _WIN32
-    ssize_t num_fds;
-    struct cmsghdr* cmsg;
-#endif
+    m_priv->m_sendBuffer.append( message, serial );
 
-    /* Do a peek of the data to determine if our arrays are large enough or not */
-    ret = m_priv->peek( 16 );
+    return m_priv->write_pending( true );
+#endif /* WIN32 */
+}
 
-    if( ret < 0 ) {
-        return std::shared_ptr<DBus::Message>();
-    }
+ssize_t SendmsgTransport::writeMessages( const std::vector<OutgoingMessage>& messages )
+{
+#ifdef _WIN32
+    return Transport::writeMessages( messages );
+#else /* POSIX */
+    std::scoped_lock lock(m_priv->m_send_mutex);
 
-    if( header_raw[0] == 'l' ) {
-        /* Little-endian */
-        body_len = header_raw[ 7 ] << 24 |
-            header_raw[ 6 ] << 16 |
-            header_raw[ 5 ] << 8 |
-            header_raw[ 4 ] << 0;
-
-        header_array_len = header_raw[ 15 ] << 24 |
-            header_raw[ 14 ] << 16 |
-            header_raw[ 13 ] << 8 |
-            header_raw[ 12 ] << 0;
-    } else if( header_raw[0] == 'B' ) {
-        /* Big-endian */
-        body_len = header_raw[ 4 ] << 24 |
-            header_raw[ 5 ] << 16 |
-            header_raw[ 6 ] << 8 |
-            header_raw[ 7 ] << 0;
-
-        header_array_len = header_raw[ 12 ] << 24 |
-            header_raw[ 13 ] << 16 |
-            header_raw[ 14 ] << 8 |
-            header_raw[ 15 ] << 0;
-    } else {
-        m_priv->m_ok = false;
-        return std::shared_ptr<DBus::Message>();
+    for( const OutgoingMessage& outgoing : messages ) {
+        m_priv->m_sendBuffer.append( outgoing.msg, outgoing.serial );
     }
 
-    if( (body_len + header_array_len + 12 + 4) >
-            DBus::Validator::maximum_message_size() ){
-        // Invalid message: it can't be that big!
-        // purge our reading buffer and reset to a known state.
-        purgeData();
-        return std::shared_ptr<DBus::Message>();
-    }
+    return m_priv->write_pending( false );
+#endif /* WIN32 */
+}
 
-    if( 0 != header_array_len % 8 ) {
-        header_array_len += 8 - ( header_array_len % 8 );
-    }
+ssize_t SendmsgTransport::writePending()
+{
+#ifdef _WIN32
+    return Transport::writePending();
+#else /* POSIX */
+    std::scoped_lock lock(m_priv->m_send_mutex);
+
+    return m_priv->write_pending( false );
+#endif /* WIN32 */
+}
+
+size_t SendmsgTransport::pendingBytes() const
+{
+#ifdef _WIN32
+    return Transport::pendingBytes();
+#else /* POSIX */
+    std::scoped_lock lock(m_priv->m_send_mutex);
 
-    total_len = 12 + ( 4 + header_array_len ) + body_len;
+    return m_priv->m_sendBuffer.size();
+#endif /* WIN32 */
+}
 
-    /* Check to see if our receive buffer capacity is big enough - expand if not */
-    if( m_priv->rx_capacity < total_len ) {
-        m_priv->set_rx_capacity( total_len );
-        header_raw = m_priv->rx_byte_buf_data();
+std::shared_ptr<DBus::Message> SendmsgTransport::readMessage() {
+    if( !m_priv->m_receiveBuffer.has_message() ) {
+        fillReceiveBuffer();
     }
 
-    /* Do the real reading of the data */
-    ret = m_priv->receive( total_len, m_priv->rx_control_capacity, 0, 0 );
+    return m_priv->m_receiveBuffer.take_message();
+}
 
-    if( ret <= 0 ) {
-        m_priv->m_ok = false;
-        return std::shared_ptr<DBus::Message>();
+int SendmsgTransport::readMessages( std::vector<std::shared_ptr<Message>>* messages ) {
+    if( !m_priv->m_receiveBuffer.has_message() ) {
+        fillReceiveBuffer();
     }
 
-    SIMPLELOGGER_DEBUG( LOGGER_NAME, "Have " << m_priv->rx_control_size() << " bytes of control after real reading" );
+    return m_priv->m_receiveBuffer.take_messages( messages );
+}
+
+void SendmsgTransport::fillReceiveBuffer() {
+#ifndef _WIN32
+    ssize_t num_fds;
+    struct cmsghdr* cmsg;
+#endif
+
+    while( true ) {
+        bool gotFds = false;
+        m_priv->m_receiveBuffer.make_room();
+        uint32_t space = m_priv->m_receiveBuffer.write_space();
+        ssize_t ret = m_priv->receive( m_priv->m_receiveBuffer.write_location(),
+                space,
+                m_priv->rx_control_capacity,
+                0,
+                0 );
+
+        if( ret < 0 ) {
+            if( errno == EINTR ) {
+                continue;
+            }
+
+            if( errno != EAGAIN && errno != EWOULDBLOCK ) {
+                std::string errmsg = strerror( errno );
+                SIMPLELOGGER_DEBUG( LOGGER_NAME, "Unable to receive: " + errmsg );
+                m_priv->m_ok = false;
+            }
+
+            return;
+        }
+
+        if( ret == 0 ) {
+            // End of the stream
+            SIMPLELOGGER_TRACE( LOGGER_NAME, "End of stream: closing transport" );
+            m_priv->m_ok = false;
+            return;
+        }
 
 #ifndef _WIN32
 
-    /* Need to figure out how many FDs we have to create our array */
-    for( cmsg = CMSG_FIRSTHDR( &m_priv->rx_msg );
-        cmsg != nullptr;
-        cmsg = CMSG_NXTHDR( &m_priv->rx_msg, cmsg ) ) {
-        if( cmsg->cmsg_level == SOL_SOCKET &&
-            cmsg->cmsg_type == SCM_RIGHTS ) {
-            /* This is our FD array */
-            num_fds = CMSG_LEN( cmsg->cmsg_len ) / sizeof( int );
-            SIMPLELOGGER_DEBUG( LOGGER_NAME, "Have " << num_fds << " fds to extract from CMSGHDR" );
-            int* fd_array = reinterpret_cast<int*>( CMSG_DATA( cmsg ) );
-
-            for( ssize_t current = 0; current < num_fds; current++ ) {
-                fds.push_back( *fd_array );
-                fd_array++;
+        /*
+         * Any FDs that we get belong to messages that start in this chunk of
+         * data(or to ones that we have already partially read), so they are
+         * handed out to messages in the order that they are received.
+         */
+        for( cmsg = CMSG_FIRSTHDR( &m_priv->rx_msg );
+            cmsg != nullptr;
+            cmsg = CMSG_NXTHDR( &m_priv->rx_msg, cmsg ) ) {
+            if( cmsg->cmsg_level == SOL_SOCKET &&
+                cmsg->cmsg_type == SCM_RIGHTS ) {
+                /* This is our FD array */
+                num_fds = ( cmsg->cmsg_len - CMSG_LEN( 0 ) ) / sizeof( int );
+                SIMPLELOGGER_DEBUG( LOGGER_NAME, "Have " << num_fds << " fds to extract from CMSGHDR" );
+                m_priv->m_receiveBuffer.add_filedescriptors( reinterpret_cast<int*>( CMSG_DATA( cmsg ) ), num_fds );
+                gotFds = true;
             }
         }
-    }
+
+        if( m_priv->rx_msg.msg_flags & MSG_CTRUNC ) {
+            SIMPLELOGGER_WARN( LOGGER_NAME, "Control data truncated: some FDs have been lost" );
+        }
 
 #endif
 
-    std::shared_ptr<DBus::Message> retmsg =
-        DBus::Message::create_from_data( header_raw, m_priv->rx_size(), fds );
+        if( !m_priv->m_receiveBuffer.commit( ret ) ) {
+            // Invalid data; reset to a known state.
+            purgeData();
+            return;
+        }
 
-    return retmsg;
+        /*
+         * A receive stops early at data that has FDs attached to it, so a
+         * short read only means that the socket is drained if there were no FDs.
+         */
+        if( static_cast<uint32_t>( ret ) < space && !gotFds ) {
+            // We have read everything that is currently available
+            return;
+        }
+    }
 }
 
 bool SendmsgTransport::is_valid() const {
@@ -459,9 +499,14 @@ int SendmsgTransport::fd() const {
 }
 
 void SendmsgTransport::purgeData(){
-//    If a message is
-//    too long to fit in the supplied buffers, and MSG_PEEK is not set in
-//    the flags argument, the excess bytes shall be discarded....
-    // https://man7.org/linux/man-pages/man3/recvmsg.3p.html
-    m_priv->receive( 0, m_priv->rx_control_capacity, 0, 0 );
+    uint8_t purgeBuffer[ 1024 ];
+    ssize_t bytes_read;
+
+    m_priv->m_receiveBuffer.clear();
+
+    // With no space for control data, any FDs that are attached are
+    // closed by the kernel
+    do{
+        bytes_read = m_priv->receive( purgeBuffer, sizeof( purgeBuffer ), 0, 0, 0 );
+    }while( bytes_read > 0 );
 }
@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ ***************************************************************************/
+#include "server.h"
+
+#include "connection.h"
+#include "dbus-cxx-private.h"
+#include "sasl.h"
+#include "transport.h"
+
+#include <cstring>
+#include <iomanip>
+#include <poll.h>
+#include <random>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+using DBus::Server;
+
+static const char* LOGGER_NAME = "DBus.Server";
+
+/* Length of the server GUID, in bytes */
+#define SERVER_GUID_LENGTH 16
+/* How long a client has to authenticate by default, in milliseconds */
+#define DEFAULT_AUTH_TIMEOUT 30000
+
+/*
+ * A client that has connected, but has not finished authenticating yet.
+ */
+struct PendingClient {
+    int fd;
+    std::unique_ptr<DBus::priv::SASL> auth;
+};
+
+class Server::priv_data {
+public:
+    priv_data() :
+        m_fd( -1 ),
+        m_authTimeout( DEFAULT_AUTH_TIMEOUT )
+    {}
+
+    int m_fd;
+    int m_authTimeout;
+    std::vector<PendingClient> m_pendingClients;
+    std::string m_guid;
+    std::string m_listenAddress;
+    /* Where our socket is on the filesystem, if it is not abstract */
+    std::string m_socketPath;
+};
+
+static std::string generate_guid() {
+    std::random_device random;
+    std::ostringstream guid;
+
+    guid << std::hex << std::setfill( '0' );
+
+    for( int x = 0; x < SERVER_GUID_LENGTH; x++ ) {
+        guid << std::setw( 2 ) << ( random() & 0xFF );
+    }
+
+    return guid.str();
+}
+
+Server::Server( std::string address ) :
+    m_priv( std::make_unique<priv_data>() ) {
+    m_priv->m_fd = priv::Transport::listen_on_address( address, &m_priv->m_listenAddress );
+
+    if( m_priv->m_fd < 0 ) {
+        SIMPLELOGGER_ERROR( LOGGER_NAME, "Unable to listen on " + address + ": " + strerror( errno ) );
+        return;
+    }
+
+    if( m_priv->m_listenAddress.compare( 0, 10, "unix:path=" ) == 0 ) {
+        m_priv->m_socketPath = m_priv->m_listenAddress.substr( 10 );
+    }
+
+    m_priv->m_guid = generate_guid();
+}
+
+std::shared_ptr<Server> Server::create( std::string address ) {
+    return std::shared_ptr<Server>( new Server( address ) );
+}
+
+Server::~Server() {
+    for( PendingClient& client : m_priv->m_pendingClients ) {
+        close( client.fd );
+    }
+
+    if( m_priv->m_fd >= 0 ) {
+        close( m_priv->m_fd );
+    }
+
+    if( !m_priv->m_socketPath.empty() ) {
+        unlink( m_priv->m_socketPath.c_str() );
+    }
+}
+
+bool Server::is_valid() const {
+    return m_priv->m_fd >= 0;
+}
+
+std::string Server::address() const {
+    if( !is_valid() ) { return std::string(); }
+
+    return m_priv->m_listenAddress + ",guid=" + m_priv->m_guid;
+}
+
+int Server::fd() const {
+    return m_priv->m_fd;
+}
+
+void Server::set_authentication_timeout( int milliseconds ) {
+    m_priv->m_authTimeout = milliseconds;
+}
+
+int Server::authentication_timeout() const {
+    return m_priv->m_authTimeout;
+}
+
+std::shared_ptr<DBus::Connection> Server::accept() {
+    if( !is_valid() ) { return std::shared_ptr<Connection>(); }
+
+    /*
+     * All of the clients that have connected authenticate side by side, and
+     * whoever finishes first is the one that we return.  That way a client
+     * that is slow to authenticate can't keep anybody else out.
+     */
+    for( ;; ) {
+        std::vector<pollfd> pollfds;
+        int timeout = -1;
+        bool clientFailed = false;
+
+        pollfds.push_back( pollfd{ m_priv->m_fd, POLLIN, 0 } );
+
+        for( PendingClient& client : m_priv->m_pendingClients ) {
+            int timeLeft = client.auth->client_time_left();
+
+            pollfds.push_back( pollfd{ client.fd, POLLIN, 0 } );
+
+            if( timeLeft >= 0 && ( timeout < 0 || timeLeft < timeout ) ) {
+                timeout = timeLeft;
+            }
+        }
+
+        if( poll( pollfds.data(), pollfds.size(), timeout ) < 0 ) {
+            if( errno == EINTR ) {
+                continue;
+            }
+
+            SIMPLELOGGER_ERROR( LOGGER_NAME, std::string( "Unable to poll for clients: " ) + strerror( errno ) );
+            return std::shared_ptr<Connection>();
+        }
+
+        // Going from the back lets us remove clients as we go
+        for( size_t x = m_priv->m_pendingClients.size(); x > 0; x-- ) {
+            PendingClient& client = m_priv->m_pendingClients[ x - 1 ];
+            priv::SASL::ClientAuthStatus status = client.auth->continue_client_authentication();
+            int fd = client.fd;
+
+            if( status == priv::SASL::ClientAuthStatus::InProgress ) {
+                continue;
+            }
+
+            m_priv->m_pendingClients.erase( m_priv->m_pendingClients.begin() + ( x - 1 ) );
+
+            if( status == priv::SASL::ClientAuthStatus::Failed ) {
+                SIMPLELOGGER_DEBUG( LOGGER_NAME, "Client did not authenticate" );
+                close( fd );
+                clientFailed = true;
+                continue;
+            }
+
+            std::shared_ptr<priv::Transport> transport =
+                priv::Transport::create_for_client( fd, m_priv->m_guid );
+
+            if( !transport ) {
+                clientFailed = true;
+                continue;
+            }
+
+            SIMPLELOGGER_DEBUG( LOGGER_NAME, "Accepted new client" );
+
+            return Connection::create_for_peer( transport );
+        }
+
+        if( pollfds[ 0 ].revents & POLLIN ) {
+            int fd = priv::Transport::accept_client( m_priv->m_fd );
+
+            if( fd >= 0 ) {
+                PendingClient client{ fd, std::make_unique<priv::SASL>( fd, true ) };
+                client.auth->start_client_authentication( m_priv->m_guid, m_priv->m_authTimeout );
+                m_priv->m_pendingClients.push_back( std::move( client ) );
+            } else {
+                clientFailed = true;
+            }
+        }
+
+        // Nobody else is on their way in, so let the caller know
+        if( clientFailed && m_priv->m_pendingClients.empty() ) {
+            return std::shared_ptr<Connection>();
+        }
+    }
+}
@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ ***************************************************************************/
+#ifndef DBUSCXX_SERVER_H
+#define DBUSCXX_SERVER_H
+
+#include <dbus-cxx/dbus-cxx-config.h>
+
+#include <memory>
+#include <string>
+
+namespace DBus {
+
+class Connection;
+
+/**
+ * A Server listens for clients that want to talk to us directly, without
+ * going through a bus daemon.  Each client that connects becomes a
+ * Connection, which can be added to a Dispatcher and used to export objects
+ * and create proxies just like a connection to a bus.
+ *
+ * Clients connect to the address() of the server with Connection::create_peer().
+ * Since there is no bus, there are no bus names on these connections; method
+ * calls and signals go straight to the peer on the other end.
+ *
+ * Only unix sockets(unix:path= and unix:abstract=) are supported, and
+ * only clients running as the same user as the server are allowed in.
+ *
+ * @ingroup core
+ */
+class Server {
+private:
+    Server( std::string address );
+
+public:
+    /**
+     * Create a new server listening on the given address.
+     *
+     * @param address The address to listen on, in DBus transport format
+     * (e.g. unix:path=/tmp/dbus-test or unix:abstract=dbus-test)
+     * @return The server.  Check is_valid() to see if it is listening.
+     */
+    static std::shared_ptr<Server> create( std::string address );
+
+    ~Server();
+
+    /** True if this server is listening for clients; false otherwise */
+    bool is_valid() const;
+
+    /**
+     * The address that clients should connect to, including the GUID of
+     * this server.
+     */
+    std::string address() const;
+
+    /**
+     * The listening socket.  This becomes readable when a client is waiting
+     * to be accepted.
+     */
+    int fd() const;
+
+    /**
+     * Set how long a client has to authenticate once it has connected.
+     * A client that has not finished authenticating by then is
+     * disconnected.  The default is 30 seconds.
+     *
+     * @param milliseconds The timeout, or -1 to wait forever
+     */
+    void set_authentication_timeout( int milliseconds );
+
+    /** How long a client has to authenticate, in milliseconds */
+    int authentication_timeout() const;
+
+    /**
+     * Wait for a client to connect and authenticate.  Clients that have
+     * connected authenticate side by side, so one that is slow to
+     * authenticate doesn't hold up the others; clients that are still
+     * authenticating when this returns carry on with the next call.
+     * Clients running as a different user are turned away as soon as
+     * they connect.
+     *
+     * @return The connection to the client, or an invalid pointer if a
+     * client could not be accepted and no others are authenticating.
+     */
+    std::shared_ptr<Connection> accept();
+
+private:
+    class priv_data;
+
+    DBUS_CXX_PROPAGATE_CONST( std::unique_ptr<priv_data> ) m_priv;
+};
+
+} /* namespace DBus */
+
+#endif /* DBUSCXX_SERVER_H */
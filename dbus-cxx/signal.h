@@ -91,7 +91,7 @@ protected:
     sigc::connection m_internal_callback_connection;
 
     void internal_callback( T_type... args ) {
-        std::shared_ptr<SignalMessage> __msg = SignalMessage::create( path(), interface_name(), name() );
+        std::shared_ptr<SignalMessage> __msg = create_signal_message();
         DBUSCXX_DEBUG_STDSTR( "DBus.Signal", "Sending following signal: "
             << __msg->path()
             << " "
@@ -99,8 +99,6 @@ protected:
             << " "
             << __msg->member() );
 
-        if( !destination().empty() ) { __msg->set_destination( destination() ); }
-
         ( *__msg << ... << args );
         bool result = this->handle_dbus_outgoing( __msg );
         DBUSCXX_DEBUG_STDSTR( "DBus.Signal", "signal::internal_callback: result=" << result );
@@ -8,6 +8,9 @@
 #include "signalbase.h"
 #include "connection.h"
 #include "path.h"
+#include "signalmessage.h"
+
+#include <mutex>
 
 namespace DBus {
 class Message;
@@ -23,6 +26,14 @@ public:
     std::string m_name;
     std::string m_destination;
     std::string m_match_rule;
+    /* The header for all of our messages; rebuilt when any part of it changes */
+    std::mutex m_prototypeLock;
+    std::shared_ptr<SignalMessage> m_prototype;
+
+    void reset_prototype() {
+        std::unique_lock<std::mutex> lock( m_prototypeLock );
+        m_prototype.reset();
+    }
 };
 
 SignalBase::SignalBase( const std::string& path, const std::string& interface_name, const std::string& name ):
@@ -78,6 +89,7 @@ const std::string& SignalBase::interface_name() const {
 
 void SignalBase::set_interface( const std::string& i ) {
     m_priv->m_interface = i;
+    m_priv->reset_prototype();
 }
 
 const std::string& SignalBase::name() const {
@@ -86,6 +98,7 @@ const std::string& SignalBase::name() const {
 
 void SignalBase::set_name( const std::string& n ) {
     m_priv->m_name = n;
+    m_priv->reset_prototype();
 }
 
 const Path& SignalBase::path() const {
@@ -94,6 +107,7 @@ const Path& SignalBase::path() const {
 
 void SignalBase::set_path( const std::string& s ) {
     m_priv->m_path = s;
+    m_priv->reset_prototype();
 }
 
 const std::string& SignalBase::destination() const {
@@ -102,6 +116,7 @@ const std::string& SignalBase::destination() const {
 
 void SignalBase::set_destination( const std::string& s ) {
     m_priv->m_destination = s;
+    m_priv->reset_prototype();
 }
 
 bool SignalBase::handle_dbus_outgoing( std::shared_ptr<const Message> msg ) {
@@ -113,6 +128,20 @@ bool SignalBase::handle_dbus_outgoing( std::shared_ptr<const Message> msg ) {
     return true;
 }
 
+std::shared_ptr<SignalMessage> SignalBase::create_signal_message() {
+    std::unique_lock<std::mutex> lock( m_priv->m_prototypeLock );
+
+    if( !m_priv->m_prototype ) {
+        m_priv->m_prototype = SignalMessage::create( m_priv->m_path, m_priv->m_interface, m_priv->m_name );
+
+        if( !m_priv->m_destination.empty() ) {
+            m_priv->m_prototype->set_destination( m_priv->m_destination );
+        }
+    }
+
+    return SignalMessage::create( m_priv->m_prototype );
+}
+
 
 
 }
@@ -17,6 +17,7 @@
 namespace DBus {
 class Connection;
 class Message;
+class SignalMessage;
 
 /**
  * @defgroup signals Signals
@@ -86,6 +87,13 @@ public:
 protected:
     bool handle_dbus_outgoing( std::shared_ptr<const Message> );
 
+    /**
+     * Create a new, empty message for this signal.  The header is shared
+     * between all of the messages that this returns, so it does not need to
+     * be built again for every emission.
+     */
+    std::shared_ptr<SignalMessage> create_signal_message();
+
 private:
     class priv_data;
 
@@ -8,6 +8,7 @@
 #include "signalmessage.h"
 #include "error.h"
 #include "message.h"
+#include "messagepool.h"
 #include "validator.h"
 
 namespace DBus {
@@ -29,15 +30,21 @@ SignalMessage::SignalMessage( const std::string& path, const std::string& interf
 }
 
 std::shared_ptr<SignalMessage> SignalMessage::create( ) {
-    return std::shared_ptr<SignalMessage>( new SignalMessage() );
+    return priv::create_pooled_message<SignalMessage>();
 }
 
 std::shared_ptr<SignalMessage> SignalMessage::create( const std::string& name ) {
-    return std::shared_ptr<SignalMessage>( new SignalMessage( name ) );
+    return priv::create_pooled_message<SignalMessage>( name );
 }
 
 std::shared_ptr<SignalMessage> SignalMessage::create( const std::string& path, const std::string& interface_name, const std::string& name ) {
-    return std::shared_ptr<SignalMessage>( new SignalMessage( path, interface_name, name ) );
+    return priv::create_pooled_message<SignalMessage>( path, interface_name, name );
+}
+
+std::shared_ptr<SignalMessage> SignalMessage::create( std::shared_ptr<const SignalMessage> prototype ) {
+    std::shared_ptr<SignalMessage> msg = priv::create_pooled_message<SignalMessage>();
+    msg->set_prototype( prototype );
+    return msg;
 }
 
 bool SignalMessage::set_path( const std::string& p ) {
@@ -44,6 +44,20 @@ public:
 
     static std::shared_ptr<SignalMessage> create( const std::string& path, const std::string& interface_name, const std::string& name );
 
+    /**
+     * Create a new signal with the same path, interface, member and
+     * destination as the given one, but with an empty body.
+     *
+     * When the same signal is sent over and over again, this is a lot
+     * cheaper than creating a new one each time: nothing is validated again,
+     * and the header is only serialized once for all of the signals that
+     * are created from the same prototype.
+     *
+     * @param prototype The signal to take the header from; it should not
+     * have a body.
+     */
+    static std::shared_ptr<SignalMessage> create( std::shared_ptr<const SignalMessage> prototype );
+
     bool set_path( const std::string& p );
 
     Path path() const;
@@ -10,123 +10,64 @@
 #include <vector>
 #include <stack>
 #include <exception>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
 
 #include "dbus-cxx-private.h"
 
 #include "types.h"
 
+/*
+ * The most signatures that are kept in the intern table.  Signatures come
+ * off of the bus, so this stops somebody from filling up our memory with them.
+ */
+#define MAX_INTERNED_SIGNATURES 4096
+
 static const char* LOGGER_NAME = "DBus.Signature";
 
 namespace DBus {
 
 const Signature::size_type npos = std::string::npos;
 
-class Signature::priv_data {
-public:
-    priv_data() :
-        m_valid( false )
-    {}
-
-    std::string m_signature;
+typedef std::vector<priv::SignatureNode> SignatureNodes;
 
-    std::shared_ptr<priv::SignatureNode> m_startingNode;
-    bool m_valid;
+/*
+ * Every valid signature that we have parsed, so that each one is only
+ * parsed once.  This is never destroyed, as Signatures may still be created
+ * by other threads while the program is exiting.
+ */
+struct InternTable {
+    std::shared_mutex m_lock;
+    std::unordered_map<std::string, std::shared_ptr<const priv::SignatureTree>> m_trees;
 };
 
-Signature::Signature() :
-    m_priv( std::make_shared<priv_data>() ) {
-}
-
-Signature::Signature( const std::string& s, size_type pos, size_type n ):
-    m_priv( std::make_shared<priv_data>() ) {
-    m_priv->m_signature = std::string( s, pos, n );
-    initialize();
-}
-
-Signature::Signature( const char* s ) :
-    m_priv( std::make_shared<priv_data>() ) {
-    m_priv->m_signature = std::string( s );
-    initialize();
-}
-
-Signature::Signature( const char* s, size_type n ):
-    m_priv( std::make_shared<priv_data>() ) {
-    m_priv->m_signature = std::string( s, n );
-    initialize();
-}
-
-Signature::Signature( size_type n, char c ):
-    m_priv( std::make_shared<priv_data>() ) {
-    m_priv->m_signature = std::string( n, c );
-    initialize();
-}
-
-Signature::~Signature() {
-}
-
-Signature::operator const std::string& () const {
-    return m_priv->m_signature;
-}
-
-const std::string& Signature::str() const {
-    return m_priv->m_signature;
-}
-
-Signature& Signature::operator =( const std::string& s ) {
-    m_priv->m_signature = s;
-    return *this;
-}
-
-Signature& Signature::operator =( const char* s ) {
-    m_priv->m_signature = s;
-    return *this;
-}
-
-Signature::iterator Signature::begin() {
-    if( !m_priv->m_valid ) { return SignatureIterator(); }
-
-    return SignatureIterator( m_priv->m_startingNode );
+static InternTable* intern_table() {
+    static InternTable* table = new InternTable();
+    return table;
 }
 
-Signature::const_iterator Signature::begin() const {
-    if( !m_priv->m_valid ) { return SignatureIterator(); }
-
-    return SignatureIterator( m_priv->m_startingNode );
-}
-
-Signature::iterator Signature::end() {
-    return SignatureIterator( nullptr );
-}
-
-Signature::const_iterator Signature::end() const {
-    return SignatureIterator( nullptr );
-}
-
-bool Signature::is_valid() const {
-    return m_priv->m_valid;
-}
-
-bool Signature::is_singleton() const {
-    return m_priv->m_valid &&
-        m_priv->m_startingNode != nullptr &&
-        m_priv->m_startingNode->m_dataType != DataType::INVALID  &&
-        m_priv->m_startingNode->m_next == nullptr;
-}
-
-Signature::SignatureNodePointer Signature::create_signature_tree(
+/**
+ * Parse the signature starting at itr, adding the nodes to the end of nodes.
+ *
+ * @return The index of the first node that was added, or -1 if there are none
+ */
+static int32_t create_signature_tree(
+    const std::string& signature,
     std::string::const_iterator& itr,
     std::stack<ContainerType>* container_stack,
-    bool& ok) {
-    SignatureNodePointer first;
-    SignatureNodePointer current;
+    bool& ok,
+    SignatureNodes* nodes ) {
+    int32_t first = -1;
+    int32_t current = -1;
 
     if( container_stack->size() > 64 ) {
         ok = false;
-        return nullptr;
+        return -1;
     }
 
-    if( itr == m_priv->m_signature.cend() ) {
-        return nullptr;
+    if( itr == signature.cend() ) {
+        return -1;
     }
 
     do {
@@ -135,13 +76,13 @@ Signature::SignatureNodePointer Signature::create_signature_tree(
 
         if( data_type == DataType::INVALID ) {
             ok = false;
-            return nullptr;
+            return -1;
         }
 
         if( ending_container ) {
             if( container_stack->size() == 0 ) {
                 ok = false;
-                return nullptr;
+                return -1;
             }
 
             ContainerType currentTop = container_stack->top();
@@ -156,19 +97,19 @@ Signature::SignatureNodePointer Signature::create_signature_tree(
                 return first;
             } else {
                 ok = false;
-                return nullptr;
+                return -1;
             }
         }
 
-        SignatureNodePointer newnode =
-            std::make_shared<priv::SignatureNode>( data_type );
+        int32_t newnode = static_cast<int32_t>( nodes->size() );
+        nodes->push_back( priv::SignatureNode{ data_type, -1, -1 } );
 
-        if( current != nullptr ) {
-            current->m_next = newnode;
+        if( current != -1 ) {
+            ( *nodes )[ current ].m_next = newnode;
             current = newnode;
         }
 
-        if( first == nullptr ) {
+        if( first == -1 ) {
             first = newnode;
             current = newnode;
         }
@@ -188,17 +129,19 @@ Signature::SignatureNodePointer Signature::create_signature_tree(
             ContainerType toPush = char_to_container_type( *itr );
             container_stack->push( toPush );
             itr++;
-            current->m_sub = create_signature_tree( itr, container_stack, ok );
+            // Nodes may move while the sub-tree is added, so only refer to them by index
+            int32_t sub = create_signature_tree( signature, itr, container_stack, ok, nodes );
+            ( *nodes )[ current ].m_sub = sub;
 
             // Check for unbalanced containers
             if( container_stack->top() != toPush ) {
                 ok = false;
-                return nullptr;
+                return -1;
             }
 
             // Handle array (no end of array character)
             if( toPush == ContainerType::ARRAY &&
-                current->m_sub != nullptr ) {
+                sub != -1 ) {
                 // Note: need to be special about popping and advancing iterator
                 // Assume we have 'aaid' as our signature.  When popping the array
                 // off of our stack, we only need to advance the iterator once.
@@ -216,7 +159,7 @@ Signature::SignatureNodePointer Signature::create_signature_tree(
                     isArrayEnd = false;
                 }
 
-                if( isArrayEnd && itr != m_priv->m_signature.cend() ) {
+                if( isArrayEnd && itr != signature.cend() ) {
                     continue;
                 }
 
@@ -224,9 +167,9 @@ Signature::SignatureNodePointer Signature::create_signature_tree(
             }
 
             // Check for missing end of container char
-            if( itr == m_priv->m_signature.cend() ) {
+            if( itr == signature.cend() ) {
                 ok = false;
-                return nullptr;
+                return -1;
             }
 
             // If we're the ending character of a container,
@@ -244,27 +187,129 @@ Signature::SignatureNodePointer Signature::create_signature_tree(
                 return first;
             } else {
                 ok = false;
-                return nullptr;
+                return -1;
             }
         }
 
-        if( itr != m_priv->m_signature.cend() ) {
+        if( itr != signature.cend() ) {
             itr++;
         }
     }
-    while (itr != m_priv->m_signature.cend() );
+    while (itr != signature.cend() );
 
     return first;
 }
 
+static std::shared_ptr<const priv::SignatureTree> parse_signature( const std::string& signature ) {
+    std::shared_ptr<priv::SignatureTree> tree = std::make_shared<priv::SignatureTree>();
+    std::stack<ContainerType> containerStack;
+    std::string::const_iterator it = signature.begin();
+
+    tree->m_signature = signature;
+    tree->m_valid = true;
+    create_signature_tree( signature, it, &containerStack, tree->m_valid, &tree->m_nodes );
+
+    if( !containerStack.empty() ||
+        it != signature.end() ) {
+        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Either stack not empty or signature not used up completely" );
+        tree->m_valid = false;
+    }
+
+    if( !tree->m_valid ) {
+        // Nothing can be iterated over in an invalid signature
+        tree->m_nodes.clear();
+    }
+
+    SIMPLELOGGER_TRACE( LOGGER_NAME, "Signature \'" << signature << "\' is "
+        << ( tree->m_valid ? "valid" : "invalid" ) );
+
+    return tree;
+}
+
+Signature::Signature() {
+    initialize( std::string() );
+}
+
+Signature::Signature( const std::string& s, size_type pos, size_type n ) {
+    if( pos == 0 && n == npos ) {
+        initialize( s );
+    } else {
+        initialize( std::string( s, pos, n ) );
+    }
+}
+
+Signature::Signature( const char* s ) {
+    initialize( std::string( s ) );
+}
+
+Signature::Signature( const char* s, size_type n ) {
+    initialize( std::string( s, n ) );
+}
+
+Signature::Signature( size_type n, char c ) {
+    initialize( std::string( n, c ) );
+}
+
+Signature::~Signature() {
+}
+
+Signature::operator const std::string& () const {
+    return m_tree->m_signature;
+}
+
+const std::string& Signature::str() const {
+    return m_tree->m_signature;
+}
+
+Signature& Signature::operator =( const std::string& s ) {
+    initialize( s );
+    return *this;
+}
+
+Signature& Signature::operator =( const char* s ) {
+    initialize( std::string( s ) );
+    return *this;
+}
+
+Signature::iterator Signature::begin() {
+    if( !m_tree->m_valid || m_tree->m_nodes.empty() ) { return SignatureIterator(); }
+
+    return SignatureIterator( m_tree, 0 );
+}
+
+Signature::const_iterator Signature::begin() const {
+    if( !m_tree->m_valid || m_tree->m_nodes.empty() ) { return SignatureIterator(); }
+
+    return SignatureIterator( m_tree, 0 );
+}
+
+Signature::iterator Signature::end() {
+    return SignatureIterator();
+}
+
+Signature::const_iterator Signature::end() const {
+    return SignatureIterator();
+}
+
+bool Signature::is_valid() const {
+    return m_tree->m_valid;
+}
+
+bool Signature::is_singleton() const {
+    return m_tree->m_valid &&
+        !m_tree->m_nodes.empty() &&
+        m_tree->m_nodes[ 0 ].m_dataType != DataType::INVALID  &&
+        m_tree->m_nodes[ 0 ].m_next == -1;
+}
+
 void Signature::print_tree( std::ostream* stream ) const {
-    SignatureNodePointer current = m_priv->m_startingNode;
+    int32_t current = m_tree->m_nodes.empty() ? -1 : 0;
 
-    while( current != nullptr ) {
-        *stream << current->m_dataType;
-        current = current->m_next;
+    while( current != -1 ) {
+        *stream << m_tree->m_nodes[ current ].m_dataType;
+        current = m_tree->m_nodes[ current ].m_next;
 
-        if( current == nullptr ) {
+        if( current == -1 ) {
             *stream << " (null) ";
         } else {
             *stream << " --> ";
@@ -272,42 +317,32 @@ void Signature::print_tree( std::ostream* stream ) const {
     }
 }
 
-void Signature::print_node( std::ostream* stream, priv::SignatureNode* node, int spaces ) const {
-    if( node == nullptr ) {
-        return;
-    }
-
-    //if( node->)
-    for( int x = 0; x < spaces; x++ ) {
-        *stream << " ";
-    }
+void Signature::initialize( const std::string& signature ) {
+    InternTable* table = intern_table();
 
-    *stream << node->m_dataType;
-}
+    {
+        std::shared_lock<std::shared_mutex> lock( table->m_lock );
+        auto it = table->m_trees.find( signature );
 
-void Signature::initialize() {
-    m_priv->m_valid = true;
-    std::stack<ContainerType> containerStack;
-    std::string::const_iterator it = m_priv->m_signature.begin();
+        if( it != table->m_trees.end() ) {
+            m_tree = it->second;
+            return;
+        }
+    }
 
-    m_priv->m_startingNode = create_signature_tree( it, &containerStack, m_priv->m_valid );
+    m_tree = parse_signature( signature );
 
-    if( !containerStack.empty() ||
-        it != m_priv->m_signature.end() ) {
-        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Either stack not empty or signature not used up completely" );
-        m_priv->m_valid = false;
+    if( !m_tree->m_valid ) {
+        // Anybody can send us invalid signatures; don't keep them around
+        return;
     }
 
-    std::ostringstream logmsg;
-    logmsg << "Signature \'" << m_priv->m_signature << "\' is ";
+    std::unique_lock<std::shared_mutex> lock( table->m_lock );
 
-    if( m_priv->m_valid ) {
-        logmsg << "valid";
-    } else {
-        logmsg << "invalid";
+    if( table->m_trees.size() < MAX_INTERNED_SIGNATURES ) {
+        // If another thread parsed this first, use its copy instead
+        m_tree = table->m_trees.emplace( signature, m_tree ).first->second;
     }
-
-    SIMPLELOGGER_TRACE( LOGGER_NAME, logmsg.str() );
 }
 
 }
@@ -12,8 +12,12 @@
 #include <any>
 #include <map>
 #include <memory>
+#include <memory_resource>
 #include <ostream>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 #include <stack>
 
@@ -47,20 +51,27 @@ namespace DBus {
 
 namespace priv {
 /**
- * Represents a single entry in our graph of the signature
+ * Represents a single entry in our graph of the signature.  All of the
+ * entries of a signature are stored one after another in a SignatureTree,
+ * and refer to each other by their index there.
  */
-class SignatureNode {
-public:
-    typedef std::shared_ptr<SignatureNode> SignatureNodePointer;
-
-    SignatureNode(DataType data_type) :
-        m_dataType(data_type),
-        m_next(),
-        m_sub(){}
-
+struct SignatureNode {
     DataType m_dataType;
-    SignatureNodePointer m_next;
-    SignatureNodePointer m_sub;
+    /* The next type after this one, or -1 if this is the last one */
+    int32_t m_next;
+    /* The first type inside of this container, or -1 if it's not a container */
+    int32_t m_sub;
+};
+
+/**
+ * A parsed signature.  These are never changed once they are created, so
+ * all of the Signatures with the same string share one of them.  The first
+ * type of the signature is at index 0.
+ */
+struct SignatureTree {
+    std::string m_signature;
+    std::vector<SignatureNode> m_nodes;
+    bool m_valid;
 };
 
 }
@@ -132,27 +143,154 @@ public:
     void print_tree( std::ostream* stream ) const;
 
 private:
-    void initialize();
+    void initialize( const std::string& signature );
+
+private:
+    /* Shared with every other Signature that has the same string */
+    std::shared_ptr<const priv::SignatureTree> m_tree;
+};
+
+/**
+ * A signature that is built at compile time.  N is the number of characters
+ * in the signature; the characters are always followed by a nul.
+ *
+ * @see signature<T>()
+ */
+template <size_t N>
+class StaticSignature {
+public:
+    constexpr StaticSignature() :
+        m_data{} {}
+
+    constexpr StaticSignature( const char ( &str )[ N + 1 ] ) :
+        m_data{} {
+        for( size_t x = 0; x < N; x++ ) {
+            m_data[ x ] = str[ x ];
+        }
+    }
+
+    /**
+     * Create a signature that is first followed by second.
+     */
+    template <size_t A, size_t B, typename = std::enable_if_t<A + B == N>>
+    constexpr StaticSignature( const StaticSignature<A>& first, const StaticSignature<B>& second ) :
+        m_data{} {
+        for( size_t x = 0; x < A; x++ ) {
+            m_data[ x ] = first[ x ];
+        }
+
+        for( size_t x = 0; x < B; x++ ) {
+            m_data[ A + x ] = second[ x ];
+        }
+    }
+
+    constexpr size_t size() const { return N; }
 
-    typedef priv::SignatureNode::SignatureNodePointer SignatureNodePointer;
+    constexpr const char* c_str() const { return m_data; }
 
-    SignatureNodePointer create_signature_tree(
-        std::string::const_iterator& itr,
-        std::stack<ContainerType>* container_stack,
-        bool& ok);
+    constexpr char operator[]( size_t index ) const { return m_data[ index ]; }
 
-    void print_node(
-        std::ostream* stream,
-        priv::SignatureNode* node,
-        int spaces) const;
+    constexpr std::string_view view() const { return std::string_view( m_data, N ); }
+
+    std::string str() const { return std::string( m_data, N ); }
 
 private:
-    class priv_data;
+    char m_data[ N + 1 ];
+};
 
+template <size_t M>
+StaticSignature( const char ( & )[ M ] ) -> StaticSignature<M - 1>;
+
+template <size_t A, size_t B>
+constexpr StaticSignature<A + B> operator+( const StaticSignature<A>& first, const StaticSignature<B>& second ) {
+    return StaticSignature<A + B>( first, second );
+}
+
+namespace priv {
+
+/*
+ * static_signature_of<T>::value is the signature of T, for the types that
+ * the signature is known of at compile time.  It doesn't exist for other
+ * types(e.g. types that are added with DBUS_CXX_ITERATOR_SUPPORT), which
+ * have to use the signature() functions instead.
+ */
+template <typename T, typename = void>
+struct static_signature_of {};
 
-    std::shared_ptr<priv_data> m_priv;
+template <typename T, typename = void>
+struct has_static_signature : std::false_type {};
+
+template <typename T>
+struct has_static_signature<T, std::void_t<decltype( static_signature_of<T>::value )>> : std::true_type {};
+
+template <typename... T>
+struct has_static_signatures : std::conjunction<has_static_signature<T>...> {};
+
+/* All of the signatures of T, one after another */
+template <typename... T>
+constexpr auto static_signatures_of() {
+    return ( StaticSignature<0>() + ... + static_signature_of<T>::value );
+}
+
+#define DBUSCXX_STATIC_SIGNATURE( CppType, sig )                          \
+    template <> struct static_signature_of<CppType> {                   \
+        static constexpr StaticSignature<1> value = StaticSignature<1>( sig ); \
+    }
+
+DBUSCXX_STATIC_SIGNATURE( uint8_t, DBUSCXX_TYPE_BYTE_AS_STRING );
+DBUSCXX_STATIC_SIGNATURE( bool, DBUSCXX_TYPE_BOOLEAN_AS_STRING );
+DBUSCXX_STATIC_SIGNATURE( int16_t, DBUSCXX_TYPE_INT16_AS_STRING );
+DBUSCXX_STATIC_SIGNATURE( uint16_t, DBUSCXX_TYPE_UINT16_AS_STRING );
+DBUSCXX_STATIC_SIGNATURE( int32_t, DBUSCXX_TYPE_INT32_AS_STRING );
+DBUSCXX_STATIC_SIGNATURE( uint32_t, DBUSCXX_TYPE_UINT32_AS_STRING );
+DBUSCXX_STATIC_SIGNATURE( int64_t, DBUSCXX_TYPE_INT64_AS_STRING );
+DBUSCXX_STATIC_SIGNATURE( uint64_t, DBUSCXX_TYPE_UINT64_AS_STRING );
+DBUSCXX_STATIC_SIGNATURE( double, DBUSCXX_TYPE_DOUBLE_AS_STRING );
+DBUSCXX_STATIC_SIGNATURE( std::string, DBUSCXX_TYPE_STRING_AS_STRING );
+DBUSCXX_STATIC_SIGNATURE( std::pmr::string, DBUSCXX_TYPE_STRING_AS_STRING );
+DBUSCXX_STATIC_SIGNATURE( Signature, DBUSCXX_TYPE_SIGNATURE_AS_STRING );
+DBUSCXX_STATIC_SIGNATURE( Path, DBUSCXX_TYPE_OBJECT_PATH_AS_STRING );
+DBUSCXX_STATIC_SIGNATURE( Variant, DBUSCXX_TYPE_VARIANT_AS_STRING );
+DBUSCXX_STATIC_SIGNATURE( std::shared_ptr<FileDescriptor>, DBUSCXX_TYPE_UNIX_FD_AS_STRING );
+
+#undef DBUSCXX_STATIC_SIGNATURE
+
+template <typename T, typename Alloc>
+struct static_signature_of<std::vector<T, Alloc>, std::enable_if_t<has_static_signature<T>::value>> {
+    static constexpr auto value = StaticSignature( DBUSCXX_TYPE_ARRAY_AS_STRING ) + static_signature_of<T>::value;
+};
+
+template <typename Key, typename Data, typename Compare, typename Alloc>
+struct static_signature_of<std::map<Key, Data, Compare, Alloc>,
+    std::enable_if_t<has_static_signatures<Key, Data>::value>> {
+    static constexpr auto value = StaticSignature( DBUSCXX_TYPE_ARRAY_AS_STRING DBUSCXX_DICT_ENTRY_BEGIN_CHAR_AS_STRING ) +
+        static_signatures_of<Key, Data>() +
+        StaticSignature( DBUSCXX_DICT_ENTRY_END_CHAR_AS_STRING );
 };
 
+template <typename... T>
+struct static_signature_of<std::tuple<T...>, std::enable_if_t<has_static_signatures<T...>::value>> {
+    static constexpr auto value = StaticSignature( DBUSCXX_STRUCT_BEGIN_CHAR_AS_STRING ) +
+        static_signatures_of<T...>() +
+        StaticSignature( DBUSCXX_STRUCT_END_CHAR_AS_STRING );
+};
+
+} /* namespace priv */
+
+/**
+ * The signature of T, built at compile time.  This works for all of the
+ * basic types and any vector, map or tuple of them:
+ *
+ * @code
+ * constexpr auto sig = DBus::signature<std::map<std::string, std::vector<int32_t>>>();
+ * static_assert( sig.view() == "a{sai}" );
+ * @endcode
+ */
+template <typename T>
+constexpr auto signature() -> decltype( priv::static_signature_of<T>::value ) {
+    return priv::static_signature_of<T>::value;
+}
+
 template <typename... T>
 inline std::string signature( const std::tuple<T...>& );
 
@@ -166,6 +304,7 @@ inline std::string signature( int64_t )     { return DBUSCXX_TYPE_INT64_AS_STRIN
 inline std::string signature( uint64_t )    { return DBUSCXX_TYPE_UINT64_AS_STRING;      }
 inline std::string signature( double )      { return DBUSCXX_TYPE_DOUBLE_AS_STRING;      }
 inline std::string signature( std::string ) { return DBUSCXX_TYPE_STRING_AS_STRING;      }
+inline std::string signature( const std::pmr::string& ) { return DBUSCXX_TYPE_STRING_AS_STRING; }
 inline std::string signature( Signature )   { return DBUSCXX_TYPE_SIGNATURE_AS_STRING;   }
 inline std::string signature( Path )        { return DBUSCXX_TYPE_OBJECT_PATH_AS_STRING; }
 inline std::string signature( const DBus::Variant& )     { return DBUSCXX_TYPE_VARIANT_AS_STRING; }
@@ -174,9 +313,21 @@ template<typename... T>
 inline std::string signature( const DBus::MultipleReturn<T...>& )     { return DBUSCXX_TYPE_INVALID_AS_STRING; }
 
 
-template <typename T> inline std::string signature( const std::vector<T>& ) { T t {}; return DBUSCXX_TYPE_ARRAY_AS_STRING + signature( t ); }
+template <typename T, typename Alloc> inline std::string signature( const std::vector<T, Alloc>& ) {
+    if constexpr( priv::has_static_signature<T>::value ) {
+        return signature<std::vector<T, Alloc>>().str();
+    } else {
+        T t {};
+        return DBUSCXX_TYPE_ARRAY_AS_STRING + signature( t );
+    }
+}
+
+template <typename Key, typename Data, typename Compare, typename Alloc>
+inline std::string signature( const std::map<Key, Data, Compare, Alloc>& ) {
+    if constexpr( priv::has_static_signatures<Key, Data>::value ) {
+        return signature<std::map<Key, Data, Compare, Alloc>>().str();
+    }
 
-template <typename Key, typename Data> inline std::string signature( const std::map<Key, Data>& ) {
     Key k {}; Data d {};
     std::string sig;
     sig = DBUSCXX_TYPE_ARRAY_AS_STRING;
@@ -190,7 +341,15 @@ template <typename Key, typename Data> inline std::string signature( const std::
 //when introspecting, we need to use the normal signature() so that it comes up properly.
 //However, when we are sending out data, that signature would give us an extra array signature,
 //which is not good.  Hence, this method is only used when we need to send out a dict
-template <typename Key, typename Data> inline std::string signature_dict_data( const std::map<Key, Data>& ) {
+template <typename Key, typename Data, typename Compare, typename Alloc>
+inline std::string signature_dict_data( const std::map<Key, Data, Compare, Alloc>& ) {
+    if constexpr( priv::has_static_signatures<Key, Data>::value ) {
+        constexpr auto sig = StaticSignature( DBUSCXX_DICT_ENTRY_BEGIN_CHAR_AS_STRING ) +
+            priv::static_signatures_of<Key, Data>() +
+            StaticSignature( DBUSCXX_DICT_ENTRY_END_CHAR_AS_STRING );
+        return sig.str();
+    }
+
     Key k {}; Data d {};
     std::string sig;
     sig = DBUSCXX_DICT_ENTRY_BEGIN_CHAR_AS_STRING +
@@ -220,8 +379,12 @@ template<typename arg1, typename... argn>
 class dbus_signature<arg1, argn...> : public dbus_signature<argn...> {
 public:
     std::string dbus_sig() const {
-        arg1 arg {};
-        return signature( arg ) + dbus_signature<argn...>::dbus_sig();
+        if constexpr( has_static_signatures<arg1, argn...>::value ) {
+            return static_signatures_of<arg1, argn...>().str();
+        } else {
+            arg1 arg {};
+            return signature( arg ) + dbus_signature<argn...>::dbus_sig();
+        }
     }
 };
 
@@ -229,6 +392,10 @@ public:
 
 template<typename... T_arg>
 inline std::string signature( const std::tuple<T_arg...>& ) {
+    if constexpr( priv::has_static_signatures<T_arg...>::value ) {
+        return signature<std::tuple<T_arg...>>().str();
+    }
+
     priv::dbus_signature<T_arg...> sig;
 
     return DBUSCXX_STRUCT_BEGIN_CHAR_AS_STRING +
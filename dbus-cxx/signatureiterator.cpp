@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <iterator>
 #include "enums.h"
+#include "signature.h"
 #include "types.h"
 
 namespace DBus {
@@ -17,18 +18,26 @@ namespace DBus {
 class SignatureIterator::priv_data {
 public:
     priv_data() :
-        m_valid( false )
+        m_valid( false ),
+        m_current( -1 ),
+        m_first( -1 )
     {}
 
-    priv_data( std::shared_ptr<priv::SignatureNode> startnode ) :
-        m_valid( startnode != nullptr ),
-        m_current( startnode ),
-        m_first( startnode )
+    priv_data( std::shared_ptr<const priv::SignatureTree> tree, int32_t start ) :
+        m_valid( tree != nullptr && start != -1 ),
+        m_tree( tree ),
+        m_current( start ),
+        m_first( start )
     {}
 
+    const priv::SignatureNode& current() const {
+        return m_tree->m_nodes[ m_current ];
+    }
+
     bool m_valid;
-    std::shared_ptr<priv::SignatureNode> m_current;
-    std::shared_ptr<priv::SignatureNode> m_first;
+    std::shared_ptr<const priv::SignatureTree> m_tree;
+    int32_t m_current;
+    int32_t m_first;
 };
 
 SignatureIterator::SignatureIterator():
@@ -40,8 +49,8 @@ SignatureIterator::SignatureIterator( const SignatureIterator& other ) :
     *m_priv = *other.m_priv;
 }
 
-SignatureIterator::SignatureIterator( std::shared_ptr<priv::SignatureNode> startnode ) :
-    m_priv( std::make_unique<priv_data>( startnode ) ) {
+SignatureIterator::SignatureIterator( std::shared_ptr<const priv::SignatureTree> tree, int32_t start ) :
+    m_priv( std::make_unique<priv_data>( tree, start ) ) {
 }
 
 SignatureIterator::~SignatureIterator() {}
@@ -61,13 +70,13 @@ SignatureIterator::operator bool() const {
 bool SignatureIterator::next() {
     if( !this->is_valid() ) { return false; }
 
-    if( m_priv->m_current->m_next == nullptr ) {
-        m_priv->m_current = nullptr;
+    if( m_priv->current().m_next == -1 ) {
+        m_priv->m_current = -1;
         m_priv->m_valid = false;
         return false;
     }
 
-    m_priv->m_current = m_priv->m_current->m_next;
+    m_priv->m_current = m_priv->current().m_next;
 
     return true;
 }
@@ -85,20 +94,28 @@ SignatureIterator SignatureIterator::operator ++( int ) {
 }
 
 bool SignatureIterator::operator==( const SignatureIterator& other ) {
-    return m_priv->m_current == other.m_priv->m_current;
+    if( m_priv->m_current == -1 || other.m_priv->m_current == -1 ) {
+        return m_priv->m_current == other.m_priv->m_current;
+    }
+
+    return m_priv->m_tree == other.m_priv->m_tree &&
+        m_priv->m_current == other.m_priv->m_current;
 }
 
 DataType SignatureIterator::type() const {
     if( !m_priv->m_valid ) { return DataType::INVALID; }
 
-    return m_priv->m_current->m_dataType;
+    return m_priv->current().m_dataType;
 }
 
 DataType SignatureIterator::element_type() const {
     if( this->type() != DataType::ARRAY ) { return DataType::INVALID; }
 
-    SignatureIterator subit( m_priv->m_current->m_sub );
-    return subit.type();
+    int32_t sub = m_priv->current().m_sub;
+
+    if( sub == -1 ) { return DataType::INVALID; }
+
+    return m_priv->m_tree->m_nodes[ sub ].m_dataType;
 }
 
 bool SignatureIterator::is_basic() const {
@@ -125,38 +142,40 @@ bool SignatureIterator::is_dict() const {
 }
 
 SignatureIterator SignatureIterator::recurse() {
-    std::string substr;
-
     if( !this->is_container() ) { return SignatureIterator(); }
 
-    SignatureIterator subiter = SignatureIterator( m_priv->m_current->m_sub );
-
-    return subiter;
+    return SignatureIterator( m_priv->m_tree, m_priv->current().m_sub );
 }
 
 std::string SignatureIterator::signature() const {
-    return iterate_over(m_priv->m_first);
+    if( m_priv->m_first == 0 ) {
+        // This is the top level of the signature, which is the whole thing
+        return m_priv->m_tree->m_signature;
+    }
+
+    return iterate_over( m_priv->m_first );
 }
 
-std::string SignatureIterator::iterate_over(
-    std::shared_ptr<priv::SignatureNode> start) const {
+std::string SignatureIterator::iterate_over( int32_t start ) const {
     std::string signature;
 
-    for( std::shared_ptr<priv::SignatureNode> current = start;
-        current != nullptr;
-        current = current->m_next ) {
-        if ( current->m_dataType == DataType::STRUCT ) {
-            signature += "(" + iterate_over(current->m_sub) + ")";
-        } else if ( current->m_dataType == DataType::DICT_ENTRY ) {
-            signature += "{" + iterate_over(current->m_sub) + "}";
+    for( int32_t current = start;
+        current != -1;
+        current = m_priv->m_tree->m_nodes[ current ].m_next ) {
+        const priv::SignatureNode& node = m_priv->m_tree->m_nodes[ current ];
+
+        if ( node.m_dataType == DataType::STRUCT ) {
+            signature += "(" + iterate_over( node.m_sub ) + ")";
+        } else if ( node.m_dataType == DataType::DICT_ENTRY ) {
+            signature += "{" + iterate_over( node.m_sub ) + "}";
         } else {
             char dbus_char =
-                TypeInfo(current->m_dataType).to_dbus_char();
+                TypeInfo( node.m_dataType ).to_dbus_char();
 
             signature += dbus_char;
 
-            if ( current->m_dataType == DataType::ARRAY ) {
-                signature += iterate_over(current->m_sub);
+            if ( node.m_dataType == DataType::ARRAY ) {
+                signature += iterate_over( node.m_sub );
             }
         }
     }
@@ -166,17 +185,14 @@ std::string SignatureIterator::iterate_over(
 
 SignatureIterator& SignatureIterator::operator=( const SignatureIterator& other ) {
     if( this != &other ) {
-        m_priv->m_valid = other.m_priv->m_valid;
-        m_priv->m_current = other.m_priv->m_current;
-        m_priv->m_first = other.m_priv->m_first;
+        *m_priv = *other.m_priv;
     }
 
     return *this;
 }
 
 bool SignatureIterator::has_next() const {
-    return m_priv->m_current->m_next != nullptr;
+    return m_priv->current().m_next != -1;
 }
 
 }
-
@@ -7,6 +7,7 @@
  ***************************************************************************/
 #include <dbus-cxx/enums.h>
 #include <dbus-cxx/dbus-cxx-config.h>
+#include <stdint.h>
 #include <string>
 #include <memory>
 
@@ -16,7 +17,7 @@
 namespace DBus {
 
 namespace priv {
-class SignatureNode;
+struct SignatureTree;
 }
 
 /**
@@ -37,7 +38,11 @@ public:
 
     SignatureIterator( const SignatureIterator& other );
 
-    SignatureIterator( std::shared_ptr<priv::SignatureNode> startnode );
+    /**
+     * Iterate over the given signature, starting at the node at index start.
+     * An index of -1 gives an invalid iterator.
+     */
+    SignatureIterator( std::shared_ptr<const priv::SignatureTree> tree, int32_t start );
 
     ~SignatureIterator();
 
@@ -109,7 +114,7 @@ public:
 
 private:
 
-    std::string iterate_over( std::shared_ptr<priv::SignatureNode> start ) const;
+    std::string iterate_over( int32_t start ) const;
 
 private:
     class priv_data;
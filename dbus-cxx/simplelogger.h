@@ -64,31 +64,37 @@ extern simplelogger_log_function SIMPLELOGGER_LOG_FUNCTION_NAME;
 #include <sstream>
 
 #define SIMPLELOGGER_TRACE_STDSTR( logger, message ) do{\
+        if( !SIMPLELOGGER_LOG_FUNCTION_NAME ) break;\
         std::stringstream stream;\
         stream << message;\
         SIMPLELOGGER_LOG_CSTR( logger, stream.str().c_str(), SL_TRACE);\
     } while(0)
 #define SIMPLELOGGER_DEBUG_STDSTR( logger, message ) do{\
+        if( !SIMPLELOGGER_LOG_FUNCTION_NAME ) break;\
         std::stringstream stream;\
         stream << message;\
         SIMPLELOGGER_LOG_CSTR( logger, stream.str().c_str(), SL_DEBUG);\
     } while(0)
 #define SIMPLELOGGER_INFO_STDSTR( logger, message ) do{\
+        if( !SIMPLELOGGER_LOG_FUNCTION_NAME ) break;\
         std::stringstream stream;\
         stream << message;\
         SIMPLELOGGER_LOG_CSTR( logger, stream.str().c_str(), SL_INFO);\
     } while(0)
 #define SIMPLELOGGER_WARN_STDSTR( logger, message ) do{\
+        if( !SIMPLELOGGER_LOG_FUNCTION_NAME ) break;\
         std::stringstream stream;\
         stream << message;\
         SIMPLELOGGER_LOG_CSTR( logger, stream.str().c_str(), SL_WARN);\
     } while(0)
 #define SIMPLELOGGER_ERROR_STDSTR( logger, message ) do{\
+        if( !SIMPLELOGGER_LOG_FUNCTION_NAME ) break;\
         std::stringstream stream;\
         stream << message;\
         SIMPLELOGGER_LOG_CSTR( logger, stream.str().c_str(), SL_ERROR);\
     } while(0)
 #define SIMPLELOGGER_FATAL_STDSTR( logger, message ) do{\
+        if( !SIMPLELOGGER_LOG_FUNCTION_NAME ) break;\
         std::stringstream stream;\
         stream << message;\
         SIMPLELOGGER_LOG_CSTR( logger, stream.str().c_str(), SL_FATAL);\
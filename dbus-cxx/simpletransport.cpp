@@ -8,47 +8,88 @@
 #include "simpletransport.h"
 
 #include "dbus-cxx-private.h"
-#include "demarshaling.h"
 #include "message.h"
+#include "receivebuffer.h"
+#include "sendbuffer.h"
 #include "utility.h"
 #include "validator.h"
 
+#include <algorithm>
+#include <climits>
 #include <cstring>
 #include <memory>
+#include <mutex>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 
 using DBus::priv::SimpleTransport;
 
 static const char* LOGGER_NAME = "DBus.SimpleTransport";
 
-enum class ReadingState {
-    FirstHeaderPart,
-    SecondHeaderPart,
-    Body
-};
-
 class SimpleTransport::priv_data {
 public:
     priv_data( int fd ):
         m_fd( fd ),
-        m_ok( false ),
-        m_readingState( ReadingState::FirstHeaderPart ),
-        m_receiveBuffer( nullptr ),
-        m_receiveBufferLocation( 0 ),
-        m_receiveBufferSize( 512 ),
-        m_headerLeftToRead( 0 )
+        m_ok( false )
     {}
 
     int m_fd;
     bool m_ok;
-    ReadingState m_readingState;
-    std::vector<uint8_t> m_sendBuffer;
-    uint8_t* m_receiveBuffer;
-    uint32_t m_receiveBufferLocation;
-    uint32_t m_receiveBufferSize;
-    uint32_t m_bodyLeftToRead;
-    uint32_t m_headerLeftToRead;
+    mutable std::mutex m_send_mutex;
+    SendBuffer m_sendBuffer;
+    std::vector<struct iovec> m_sendIovecs;
+    ReceiveBuffer m_receiveBuffer;
+
+    /**
+     * Write out what is in our send buffer.
+     *
+     * @param block True to wait until everything has been written, false to
+     * only write what the stream will take right now.
+     * @return The number of bytes written, or -1 on error
+     */
+    ssize_t write_pending( bool block ) {
+        ssize_t totalWritten = 0;
+
+        if( m_sendIovecs.size() < IOV_MAX ) {
+            m_sendIovecs.resize( IOV_MAX );
+        }
+
+        while( !m_sendBuffer.empty() ) {
+            const std::vector<int>* fds;
+            int iovcnt = m_sendBuffer.next_write( m_sendIovecs.data(), IOV_MAX, &fds );
+            ssize_t bytesWritten = ::writev( m_fd, m_sendIovecs.data(), iovcnt );
+
+            if( bytesWritten < 0 ) {
+                if( errno == EINTR ) {
+                    continue;
+                }
+
+                if( errno == EAGAIN || errno == EWOULDBLOCK ) {
+                    if( block && priv::wait_for_fd_writable( m_fd, -1 ) ) {
+                        continue;
+                    }
+
+                    // The rest will be written once the stream is writable
+                    break;
+                }
+
+                int my_errno = errno;
+                std::string errmsg = strerror( errno );
+                SIMPLELOGGER_DEBUG( LOGGER_NAME, "Unable to send message: " + errmsg );
+                m_ok = false;
+                errno = my_errno;
+                return bytesWritten;
+            }
+
+            m_sendBuffer.consume( bytesWritten );
+            totalWritten += bytesWritten;
+        }
+
+        SIMPLELOGGER_TRACE( LOGGER_NAME, "Wrote " << totalWritten << " bytes, " << m_sendBuffer.size() << " bytes pending" );
+
+        return totalWritten;
+    }
 };
 
 SimpleTransport::SimpleTransport( int fd, bool initialize ) :
@@ -67,13 +108,11 @@ SimpleTransport::SimpleTransport( int fd, bool initialize ) :
         }
     }
 
-    m_priv->m_receiveBuffer = new uint8_t[ m_priv->m_receiveBufferSize ];
     m_priv->m_ok = true;
 }
 
 SimpleTransport::~SimpleTransport() {
     close( m_priv->m_fd );
-    delete[] m_priv->m_receiveBuffer;
 }
 
 
@@ -82,172 +121,91 @@ std::shared_ptr<SimpleTransport> SimpleTransport::create( int fd, bool initializ
 }
 
 ssize_t SimpleTransport::writeMessage( std::shared_ptr<const Message> message, uint32_t serial ) {
-    std::ostringstream debug_str;
-    m_priv->m_sendBuffer.clear();
+    std::scoped_lock lock( m_priv->m_send_mutex );
 
-    if( !message->serialize_to_vector( &m_priv->m_sendBuffer, serial ) ) {
-        return 0;
-    }
+    m_priv->m_sendBuffer.append( message, serial );
 
-    debug_str << "Going to send the following bytes: " << std::endl;
-    DBus::hexdump( &m_priv->m_sendBuffer, &debug_str );
-    SIMPLELOGGER_TRACE( LOGGER_NAME, debug_str.str() );
+    return m_priv->write_pending( true );
+}
 
-    ssize_t bytesWritten = ::write( m_priv->m_fd, m_priv->m_sendBuffer.data(), m_priv->m_sendBuffer.size() );
+ssize_t SimpleTransport::writeMessages( const std::vector<OutgoingMessage>& messages ) {
+    std::scoped_lock lock( m_priv->m_send_mutex );
 
-    if( bytesWritten < 0 ) {
-        int my_errno = errno;
-        std::string errmsg = strerror( errno );
-        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Unable to send message: " + errmsg );
-        errno = my_errno;
+    for( const OutgoingMessage& outgoing : messages ) {
+        m_priv->m_sendBuffer.append( outgoing.msg, outgoing.serial );
     }
 
-    return bytesWritten;
+    return m_priv->write_pending( false );
 }
 
-std::shared_ptr<DBus::Message> SimpleTransport::readMessage() {
-    ssize_t bytesRead;
-    std::shared_ptr<Message> retmsg;
-
-    if( m_priv->m_readingState == ReadingState::FirstHeaderPart ) {
-        /*
-         * First part of the reading: read the first 16 bytes, which include the
-         * important data(including the size of the variable-length array)
-         */
-        bytesRead = ::read( m_priv->m_fd,
-                m_priv->m_receiveBuffer + m_priv->m_receiveBufferLocation,
-                16 - m_priv->m_receiveBufferLocation );
+ssize_t SimpleTransport::writePending() {
+    std::scoped_lock lock( m_priv->m_send_mutex );
 
-        if( bytesRead < 0 ) {
-            return std::shared_ptr<DBus::Message>();
-        }
+    return m_priv->write_pending( false );
+}
 
-        if( bytesRead == 0 ) {
-            // End of the stream
-            SIMPLELOGGER_TRACE( LOGGER_NAME, "End of stream: closing transport" );
-            m_priv->m_ok = false;
-            return std::shared_ptr<DBus::Message>();
-        }
+size_t SimpleTransport::pendingBytes() const {
+    std::scoped_lock lock( m_priv->m_send_mutex );
 
-        m_priv->m_receiveBufferLocation += bytesRead;
+    return m_priv->m_sendBuffer.size();
+}
 
-        if( m_priv->m_receiveBufferLocation == 16 ) {
-            m_priv->m_readingState = ReadingState::SecondHeaderPart;
-        }
+std::shared_ptr<DBus::Message> SimpleTransport::readMessage() {
+    if( !m_priv->m_receiveBuffer.has_message() ) {
+        fillReceiveBuffer();
     }
 
-    if( m_priv->m_readingState == ReadingState::SecondHeaderPart ) {
-        /*
-         * Next part of the reading: read the variable-sized array in the header
-         */
-        if( m_priv->m_headerLeftToRead == 0 ) {
-            Demarshaling m( m_priv->m_receiveBuffer, 16, Endianess::Big );
-            uint32_t totalMessageSize;
-            uint32_t headerArraySize;
-            int bytesToAdd;
-            uint8_t endian = m.demarshal_uint8_t();
-
-            if( endian == 'l' ) {
-                m.set_endianess( Endianess::Little );
-            }else if( endian != 'B' ){
-                // Bad endianess
-                purgeData();
-                return std::shared_ptr<DBus::Message>();
-            }
-
-            m.set_data_offset( 4 );
-            uint32_t bodyToRead = m.demarshal_uint32_t();
-            m.set_data_offset( 12 );
-            headerArraySize = m.demarshal_uint32_t();
-
-            if( (bodyToRead + headerArraySize + 12) >
-                    DBus::Validator::maximum_message_size() ){
-                // Invalid message: it can't be that big!
-                // purge our reading buffer and reset to a known state.
-                purgeData();
-                return std::shared_ptr<DBus::Message>();
-            }
-            m_priv->m_bodyLeftToRead = bodyToRead;
-
-            // Make sure that the header would align to a multiple of 8
-            bytesToAdd = 8 - ( ( 16 + headerArraySize ) % 8 );
-
-            if( bytesToAdd != 8 ) {
-                headerArraySize += bytesToAdd;
-            }
-
-            m_priv-> m_headerLeftToRead = headerArraySize;
+    return m_priv->m_receiveBuffer.take_message();
+}
 
-            totalMessageSize = ( 12 /* Basic header size */
-                    + m_priv->m_headerLeftToRead
-                    + m_priv->m_bodyLeftToRead
-                    + 12 /* Extra padding */ );
+int SimpleTransport::readMessages( std::vector<std::shared_ptr<Message>>* messages ) {
+    if( !m_priv->m_receiveBuffer.has_message() ) {
+        fillReceiveBuffer();
+    }
 
-            if( m_priv->m_receiveBufferSize < totalMessageSize ) {
-                m_priv->m_receiveBufferSize = totalMessageSize;
-                uint8_t* newbuffer = new uint8_t[ m_priv->m_receiveBufferSize ];
-                std::memcpy( newbuffer, m_priv->m_receiveBuffer, m_priv->m_receiveBufferLocation );
-                delete[] m_priv->m_receiveBuffer;
-                m_priv->m_receiveBuffer = newbuffer;
-            }
-        }
+    return m_priv->m_receiveBuffer.take_messages( messages );
+}
 
-        /*
-         * Now that we know how big the variable-sized array is and the body size,
-         * try to read that number of bytes(to keep the number of read() calls down)
-         */
-        bytesRead = ::read( m_priv->m_fd,
-                m_priv->m_receiveBuffer + m_priv->m_receiveBufferLocation,
-                m_priv->m_headerLeftToRead + m_priv->m_bodyLeftToRead );
+void SimpleTransport::fillReceiveBuffer() {
+    while( true ) {
+        m_priv->m_receiveBuffer.make_room();
+        uint32_t space = m_priv->m_receiveBuffer.write_space();
+        ssize_t bytesRead = ::read( m_priv->m_fd,
+                m_priv->m_receiveBuffer.write_location(),
+                space );
 
         if( bytesRead < 0 ) {
-            return std::shared_ptr<DBus::Message>();
-        }
+            if( errno == EINTR ) {
+                continue;
+            }
 
-        m_priv->m_receiveBufferLocation += bytesRead;
+            if( errno != EAGAIN && errno != EWOULDBLOCK ) {
+                std::string errmsg = strerror( errno );
+                SIMPLELOGGER_DEBUG( LOGGER_NAME, "Unable to read: " + errmsg );
+                m_priv->m_ok = false;
+            }
 
-        if( m_priv->m_headerLeftToRead - bytesRead <= 0 ) {
-            bytesRead -= m_priv->m_headerLeftToRead;
-            m_priv->m_headerLeftToRead = 0;
+            return;
         }
 
-        m_priv->m_bodyLeftToRead -= bytesRead;
-
-        if( m_priv->m_headerLeftToRead == 0 ) {
-            // We have at least full header at this point
-            m_priv->m_readingState = ReadingState::Body;
+        if( bytesRead == 0 ) {
+            // End of the stream
+            SIMPLELOGGER_TRACE( LOGGER_NAME, "End of stream: closing transport" );
+            m_priv->m_ok = false;
+            return;
         }
-    }
-
-    if( m_priv->m_readingState == ReadingState::Body ) {
-        if( m_priv->m_bodyLeftToRead ) {
-            bytesRead = ::read( m_priv->m_fd,
-                    m_priv->m_receiveBuffer + m_priv->m_receiveBufferLocation,
-                    m_priv->m_bodyLeftToRead );
-
-            if( bytesRead < 0 ) {
-                return std::shared_ptr<DBus::Message>();
-            }
 
-            m_priv->m_bodyLeftToRead -= bytesRead;
+        if( !m_priv->m_receiveBuffer.commit( bytesRead ) ) {
+            // Invalid data; reset to a known state.
+            purgeData();
+            return;
         }
 
-        if( m_priv->m_bodyLeftToRead == 0 ) {
-            // We have a full message at this point!
-            std::ostringstream debug_str;
-            debug_str << "Going to create a message from the following data: " << std::endl;
-            DBus::hexdump( m_priv->m_receiveBuffer, m_priv->m_receiveBufferLocation, &debug_str );
-            SIMPLELOGGER_TRACE( LOGGER_NAME, debug_str.str() );
-
-            retmsg = Message::create_from_data( m_priv->m_receiveBuffer, m_priv->m_receiveBufferLocation );
-
-            m_priv->m_receiveBufferLocation = 0;
-            m_priv->m_readingState = ReadingState::FirstHeaderPart;
-            m_priv->m_headerLeftToRead = 0;
+        if( static_cast<uint32_t>( bytesRead ) < space ) {
+            // We have read everything that is currently available
+            return;
         }
     }
-
-    return retmsg;
 }
 
 bool SimpleTransport::is_valid() const {
@@ -262,10 +220,6 @@ void SimpleTransport::purgeData(){
     uint8_t purgeBuffer[ 1024 ];
     ssize_t bytes_read;
 
-    m_priv->m_receiveBufferLocation = 0;
-    m_priv->m_readingState = ReadingState::FirstHeaderPart;
-    m_priv->m_headerLeftToRead = 0;
-
     do{
         bytes_read = ::read( m_priv->m_fd, purgeBuffer, 1024 );
     }while( bytes_read > 0 );
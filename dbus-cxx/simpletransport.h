@@ -43,8 +43,16 @@ public:
 
     ssize_t writeMessage( std::shared_ptr<const Message> message, uint32_t serial );
 
+    ssize_t writeMessages( const std::vector<OutgoingMessage>& messages );
+
+    ssize_t writePending();
+
+    size_t pendingBytes() const;
+
     std::shared_ptr<Message> readMessage();
 
+    int readMessages( std::vector<std::shared_ptr<Message>>* messages );
+
     /**
      * Check if this transport is OK
      * @return
@@ -54,6 +62,8 @@ public:
     int fd() const;
 
 private:
+    void fillReceiveBuffer();
+
     void purgeData();
 
 private:
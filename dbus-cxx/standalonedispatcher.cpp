@@ -7,6 +7,7 @@
  ***************************************************************************/
 #include <dbus-cxx/connection.h>
 #include <dbus-cxx/dbus-cxx-private.h>
+#include <atomic>
 #include <thread>
 #include <mutex>
 #include <vector>
@@ -15,9 +16,18 @@
 #include <sys/socket.h>
 #include <unistd.h>
 #include <deque>
+#include <unordered_set>
 #include <utility>
 #include <string.h>
 
+#if DBUS_CXX_HAS_EPOLL
+#include <sys/epoll.h>
+#endif
+
+#if DBUS_CXX_HAS_EVENTFD
+#include <sys/eventfd.h>
+#endif
+
 #include "standalonedispatcher.h"
 
 #if defined( _WIN32 ) && defined( connect )
@@ -28,19 +38,45 @@ using DBus::StandaloneDispatcher;
 
 static const char* LOGGER_NAME = "DBus.StandaloneDispatcher";
 
+/* How many ready FDs we will handle with each wakeup */
+#define MAX_EVENTS 64
+
 class StandaloneDispatcher::priv_data {
 public:
     priv_data() :
         m_running( false ),
-        m_dispatch_loop_limit( 0 ) {
+        m_wakeup_pending( false ),
+        m_dispatch_loop_limit( 0 )
+#if DBUS_CXX_HAS_EPOLL
+        , m_epoll_fd( -1 )
+#endif
+    {
 
     }
 
+    /* Only touched by the dispatch thread once it is running */
     std::vector<std::shared_ptr<Connection>> m_connections;
+    /*
+     * Connections that have been added but not picked up by the dispatch
+     * thread yet, and connections that need to be dispatched because they
+     * have something to write.  Protected by m_pending_lock.
+     */
+    std::mutex m_pending_lock;
+    std::vector<std::shared_ptr<Connection>> m_pending_connections;
+    /* Swapped with m_pending_connections while they are being added */
+    std::vector<std::shared_ptr<Connection>> m_adding;
+    std::vector<Connection*> m_needs_dispatch;
+    /* Swapped with m_needs_dispatch, so that the capacity of both is reused */
+    std::vector<Connection*> m_dispatching;
     volatile bool m_running;
     std::thread m_dispatch_thread;
-    /* socketpair for telling the thread to process data */
+    /*
+     * socketpair for telling the thread to process data.  If we have
+     * eventfd, both of these are the same eventfd instead.
+     */
     int process_fd[ 2 ];
+    /* Set when process_fd has been signalled and the thread has not woken up yet */
+    std::atomic<bool> m_wakeup_pending;
     /**
      * This is the maximum number of dispatches that will occur for a
      * connection in one iteration of the dispatch thread.
@@ -50,15 +86,55 @@ public:
      */
     unsigned int m_dispatch_loop_limit;
 
+#if DBUS_CXX_HAS_EPOLL
+    /*
+     * All of our FDs stay registered with this for as long as they are open,
+     * so each wakeup only costs us as much as the number of ready FDs.
+     */
+    int m_epoll_fd;
+    struct epoll_event m_events[ MAX_EVENTS ];
+    /* Connections that we are also waiting on to become writable */
+    std::unordered_set<Connection*> m_write_watched;
+#endif
 };
 
 StandaloneDispatcher::StandaloneDispatcher( bool is_running ) {
     m_priv = std::make_unique<priv_data>();
 
+#if DBUS_CXX_HAS_EVENTFD
+    m_priv->process_fd[ 0 ] = eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+
+    if( m_priv->process_fd[ 0 ] < 0 ) {
+        SIMPLELOGGER_ERROR( LOGGER_NAME, "error creating eventfd" );
+        throw ErrorDispatcherInitFailed();
+    }
+
+    m_priv->process_fd[ 1 ] = m_priv->process_fd[ 0 ];
+#else
     if( socketpair( AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, m_priv->process_fd ) < 0 ) {
         SIMPLELOGGER_ERROR( LOGGER_NAME, "error creating socket pair" );
         throw ErrorDispatcherInitFailed();
     }
+#endif
+
+#if DBUS_CXX_HAS_EPOLL
+    m_priv->m_epoll_fd = epoll_create1( EPOLL_CLOEXEC );
+
+    if( m_priv->m_epoll_fd < 0 ) {
+        SIMPLELOGGER_ERROR( LOGGER_NAME, "error creating epoll: " << strerror( errno ) );
+        throw ErrorDispatcherInitFailed();
+    }
+
+    // A null pointer means that this is our wakeup socket, not a connection
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLET;
+    event.data.ptr = nullptr;
+
+    if( epoll_ctl( m_priv->m_epoll_fd, EPOLL_CTL_ADD, m_priv->process_fd[ 1 ], &event ) < 0 ) {
+        SIMPLELOGGER_ERROR( LOGGER_NAME, "error adding socket pair to epoll: " << strerror( errno ) );
+        throw ErrorDispatcherInitFailed();
+    }
+#endif
 
     if( is_running ) { this->start(); }
 }
@@ -69,6 +145,16 @@ std::shared_ptr<StandaloneDispatcher> StandaloneDispatcher::create( bool is_runn
 
 StandaloneDispatcher::~StandaloneDispatcher() {
     this->stop();
+
+#if DBUS_CXX_HAS_EPOLL
+    close( m_priv->m_epoll_fd );
+#endif
+
+    close( m_priv->process_fd[ 0 ] );
+
+    if( m_priv->process_fd[ 1 ] != m_priv->process_fd[ 0 ] ) {
+        close( m_priv->process_fd[ 1 ] );
+    }
 }
 
 std::shared_ptr<DBus::Connection> StandaloneDispatcher::create_connection( std::string address ) {
@@ -93,8 +179,14 @@ bool StandaloneDispatcher::add_connection( std::shared_ptr<Connection> connectio
     if( !connection || !connection->is_valid() ) { return false; }
 
     connection->set_dispatching_thread( m_priv->m_dispatch_thread.get_id() );
-    connection->signal_needs_dispatch().connect( sigc::mem_fun( *this, &StandaloneDispatcher::wakeup_thread ) );
-    m_priv->m_connections.push_back( connection );
+    connection->signal_needs_dispatch().connect(
+        sigc::bind( sigc::mem_fun( *this, &StandaloneDispatcher::connection_needs_dispatch ), connection.get() ) );
+
+    {
+        std::scoped_lock lock( m_priv->m_pending_lock );
+        m_priv->m_pending_connections.push_back( connection );
+    }
+
     wakeup_thread();
 
     return true;
@@ -129,70 +221,260 @@ bool StandaloneDispatcher::is_running() {
 }
 
 void StandaloneDispatcher::dispatch_thread_main() {
-    std::vector<int> fds;
+    // Pick up anything that was added before we were started
+    add_pending_connections();
 
-    for( std::shared_ptr<Connection> conn : m_priv->m_connections ) {
-        conn->set_dispatching_thread( std::this_thread::get_id() );
+#if DBUS_CXX_HAS_EPOLL
+
+    while( m_priv->m_running ) {
+        int timeout = milliseconds_until_timeout();
+        int numEvents = epoll_wait( m_priv->m_epoll_fd, m_priv->m_events, MAX_EVENTS, timeout );
+        bool woken = false;
+
+        if( numEvents < 0 ) {
+            if( errno != EINTR ) {
+                SIMPLELOGGER_ERROR( LOGGER_NAME, "Failure waiting for events: " << strerror( errno ) );
+            }
+
+            continue;
+        }
+
+        for( int x = 0; x < numEvents; x++ ) {
+            Connection* conn = static_cast<Connection*>( m_priv->m_events[ x ].data.ptr );
+
+            if( conn == nullptr ) {
+                woken = true;
+                continue;
+            }
+
+            dispatch_connection( conn );
+        }
+
+        if( woken ) {
+            drain_wakeups();
+            add_pending_connections();
+            dispatch_needed_connections();
+        }
+
+        if( timeout >= 0 ) {
+            dispatch_timed_out_connections();
+        }
     }
 
+#else
+
+    std::vector<int> fds;
+
     while( m_priv->m_running ) {
         fds.clear();
         fds.push_back( m_priv->process_fd[ 1 ] );
 
         for( std::shared_ptr<Connection> conn : m_priv->m_connections ) {
-            if( !conn->is_registered() ) {
-                conn->bus_register();
-            }
-
             fds.push_back( conn->unix_fd() );
         }
 
         std::tuple<bool, int, std::vector<int>, std::chrono::milliseconds> fdResponse =
-            DBus::priv::wait_for_fd_activity( fds, -1 );
+            DBus::priv::wait_for_fd_activity( fds, milliseconds_until_timeout() );
         std::vector<int> fdsToRead = std::get<2>( fdResponse );
 
         if( !fdsToRead.empty() && fdsToRead[ 0 ] == m_priv->process_fd[ 1 ] ) {
-            char discard;
-            if( read( m_priv->process_fd[ 1 ], &discard, sizeof( char ) ) < 0 ){
-                SIMPLELOGGER_DEBUG( LOGGER_NAME, "Failure reading from dispatch thread process_fd: "
-                                    << strerror( errno ) );
-            }
+            drain_wakeups();
+            add_pending_connections();
+            dispatch_needed_connections();
         }
 
         dispatch_connections();
     }
+
+#endif
+}
+
+void StandaloneDispatcher::add_pending_connections() {
+    {
+        std::scoped_lock lock( m_priv->m_pending_lock );
+
+        if( m_priv->m_pending_connections.empty() ) {
+            return;
+        }
+
+        std::swap( m_priv->m_pending_connections, m_priv->m_adding );
+    }
+
+    // Registering may send messages, which needs the lock; don't hold it here
+    for( std::shared_ptr<Connection>& conn : m_priv->m_adding ) {
+        conn->set_dispatching_thread( std::this_thread::get_id() );
+
+        if( !conn->is_registered() ) {
+            conn->bus_register();
+        }
+
+#if DBUS_CXX_HAS_EPOLL
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLET;
+        event.data.ptr = conn.get();
+
+        if( epoll_ctl( m_priv->m_epoll_fd, EPOLL_CTL_ADD, conn->unix_fd(), &event ) < 0 ) {
+            SIMPLELOGGER_ERROR( LOGGER_NAME, "Unable to add connection to epoll: " << strerror( errno ) );
+        }
+
+        // We wait for the connection to be writable, so it doesn't need to block on writes
+        conn->set_nonblocking_writes( true );
+#endif
+
+        // Anything that arrived before it was registered won't trigger epoll
+        dispatch_connection( conn.get() );
+
+        m_priv->m_connections.push_back( std::move( conn ) );
+    }
+
+    m_priv->m_adding.clear();
+}
+
+void StandaloneDispatcher::drain_wakeups() {
+#if DBUS_CXX_HAS_EVENTFD
+    uint64_t discard;
+
+    if( read( m_priv->process_fd[ 1 ], &discard, sizeof( discard ) ) < 0 && errno != EAGAIN ) {
+        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Failure reading from dispatch thread eventfd: "
+                            << strerror( errno ) );
+    }
+#else
+    char discard[ 64 ];
+
+    while( read( m_priv->process_fd[ 1 ], discard, sizeof( discard ) ) == sizeof( discard ) ) {}
+#endif
+
+    /*
+     * Anything that happens from here on needs to wake us up again.  This
+     * must come after the read, or a wakeup that lands in between would be
+     * read away while the flag stays set, and nothing would wake us again.
+     * A wakeup that comes in before this is not lost: whatever it was for
+     * is picked up after we are done draining.
+     */
+    m_priv->m_wakeup_pending.store( false );
 }
 
 void StandaloneDispatcher::dispatch_connections() {
+    SIMPLELOGGER_DEBUG( LOGGER_NAME, "Dispatching connections" );
+
+    for( std::shared_ptr<Connection>& conn : m_priv->m_connections ) {
+        dispatch_connection( conn.get() );
+    }
+
+    SIMPLELOGGER_DEBUG( LOGGER_NAME, "done dispatching" );
+}
+
+int StandaloneDispatcher::milliseconds_until_timeout() {
+    int timeout = -1;
+
+    for( std::shared_ptr<Connection>& conn : m_priv->m_connections ) {
+        int connTimeout = conn->milliseconds_until_timeout();
+
+        if( connTimeout >= 0 && ( timeout < 0 || connTimeout < timeout ) ) {
+            timeout = connTimeout;
+        }
+    }
+
+    return timeout;
+}
+
+void StandaloneDispatcher::dispatch_timed_out_connections() {
+    for( std::shared_ptr<Connection>& conn : m_priv->m_connections ) {
+        if( conn->milliseconds_until_timeout() == 0 ) {
+            dispatch_connection( conn.get() );
+        }
+    }
+}
+
+void StandaloneDispatcher::dispatch_needed_connections() {
+    {
+        std::scoped_lock lock( m_priv->m_pending_lock );
+        std::swap( m_priv->m_needs_dispatch, m_priv->m_dispatching );
+    }
+
+    for( Connection* conn : m_priv->m_dispatching ) {
+        dispatch_connection( conn );
+    }
+
+    m_priv->m_dispatching.clear();
+}
+
+void StandaloneDispatcher::dispatch_connection( Connection* conn ) {
     uint32_t loop_limit = m_priv->m_dispatch_loop_limit;
 
     if( loop_limit == 0 ) {
         loop_limit = UINT32_MAX;
     }
 
-    SIMPLELOGGER_DEBUG( LOGGER_NAME, "Dispatching connections" );
+    uint32_t processed = 0;
 
-    for( std::shared_ptr<Connection> conn : m_priv->m_connections ) {
-        for( uint32_t x = 0; x < loop_limit; x++ ) {
-            DispatchStatus stat = conn->dispatch();
+    while( processed < loop_limit ) {
+        DispatchResult result = conn->dispatch( loop_limit - processed );
 
-            if( stat == DispatchStatus::COMPLETE ) {
-                break;
-            }
-        }
+        processed += result.processed;
 
-        if( conn->dispatch_status() != DispatchStatus::COMPLETE ) {
-            wakeup_thread();
+        // If nothing could be done, the connection is waiting on the socket
+        if( result.status == DispatchStatus::COMPLETE ||
+            result.processed == 0 ) {
+            break;
         }
     }
 
-    SIMPLELOGGER_DEBUG( LOGGER_NAME, "done dispatching" );
+    if( conn->dispatch_status() != DispatchStatus::COMPLETE ) {
+        connection_needs_dispatch( conn );
+    }
+
+    update_write_watch( conn );
+}
+
+void StandaloneDispatcher::update_write_watch( Connection* conn ) {
+#if DBUS_CXX_HAS_EPOLL
+    bool wantsWrite = conn->has_messages_to_send();
+    bool watched = m_priv->m_write_watched.count( conn ) > 0;
+
+    if( wantsWrite == watched ) {
+        return;
+    }
+
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLET;
+    event.data.ptr = conn;
+
+    if( wantsWrite ) {
+        event.events |= EPOLLOUT;
+        m_priv->m_write_watched.insert( conn );
+    } else {
+        m_priv->m_write_watched.erase( conn );
+    }
+
+    if( epoll_ctl( m_priv->m_epoll_fd, EPOLL_CTL_MOD, conn->unix_fd(), &event ) < 0 ) {
+        SIMPLELOGGER_ERROR( LOGGER_NAME, "Unable to update connection in epoll: " << strerror( errno ) );
+    }
+#endif
+}
+
+void StandaloneDispatcher::connection_needs_dispatch( Connection* conn ) {
+    {
+        std::scoped_lock lock( m_priv->m_pending_lock );
+        m_priv->m_needs_dispatch.push_back( conn );
+    }
+
+    wakeup_thread();
 }
 
 void StandaloneDispatcher::wakeup_thread() {
+    // If the thread hasn't woken up from the last time, it will see this too
+    if( m_priv->m_wakeup_pending.exchange( true ) ) {
+        return;
+    }
+
+#if DBUS_CXX_HAS_EVENTFD
+    uint64_t to_write = 1;
+#else
     char to_write = '0';
+#endif
 
-    if( write( m_priv->process_fd[ 0 ], &to_write, sizeof( char ) ) < 0 ) {
-        SIMPLELOGGER_ERROR( LOGGER_NAME, "Can't write to socketpair?!" );
+    if( write( m_priv->process_fd[ 0 ], &to_write, sizeof( to_write ) ) < 0 ) {
+        SIMPLELOGGER_ERROR( LOGGER_NAME, "Can't write to wakeup FD?!" );
     }
 }
@@ -53,11 +53,56 @@ private:
 
     void wakeup_thread();
 
+    /**
+     * Take ownership of all of the connections that have been added since
+     * the last time that this was called.  Only called from the dispatch thread.
+     */
+    void add_pending_connections();
+
+    /**
+     * Read everything from our wakeup socket.
+     */
+    void drain_wakeups();
+
     /**
      * Dispatch all of our connections
      */
     void dispatch_connections();
 
+    /**
+     * Dispatch only the connections that have said that they need it
+     */
+    void dispatch_needed_connections();
+
+    /**
+     * Dispatch a single connection until it has nothing left to do.
+     */
+    void dispatch_connection( Connection* conn );
+
+    /**
+     * Wait for the connection to become writable if it has data that it
+     * could not write yet, and stop waiting once it doesn't.
+     */
+    void update_write_watch( Connection* conn );
+
+    /**
+     * Note that the connection needs to be dispatched, and wakeup the
+     * dispatch thread to do it.
+     */
+    void connection_needs_dispatch( Connection* conn );
+
+    /**
+     * How long we can wait before a call on one of our connections times out.
+     *
+     * @return The number of milliseconds, or -1 to wait forever
+     */
+    int milliseconds_until_timeout();
+
+    /**
+     * Dispatch the connections that have calls which have timed out.
+     */
+    void dispatch_timed_out_connections();
+
 private:
     class priv_data;
 
@@ -10,7 +10,9 @@
 #include "dbus-cxx-private.h"
 #include "simpletransport.h"
 #include "sendmsgtransport.h"
+#include "iouringtransport.h"
 #include "sasl.h"
+#include "utility.h"
 
 #include <cstring>
 #include <fcntl.h>
@@ -218,9 +220,95 @@ static int open_unix_socket( std::string socketAddress, bool is_abstract ) {
     return fd;
 }
 
+static int listen_unix_socket( std::string socketAddress, bool is_abstract ) {
+    struct sockaddr_un addr;
+    int fd;
+    socklen_t data_len = 0;
+
+    memset( &addr, 0, sizeof( struct sockaddr_un ) );
+
+    if( socketAddress.size() >= sizeof( addr.sun_path ) - 1 ) {
+        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Socket address is too long: " + socketAddress );
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    fd = ::socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+
+    if( fd < 0 ) {
+        std::string errmsg = strerror( errno );
+        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Unable to create socket: " + errmsg );
+        return fd;
+    }
+
+    addr.sun_family = AF_UNIX;
+
+    if( is_abstract ) {
+        memcpy( &addr.sun_path[ 1 ], socketAddress.c_str(), socketAddress.size() );
+        data_len = offsetof( struct sockaddr_un, sun_path ) + socketAddress.size() + 1;
+    } else {
+        memcpy( addr.sun_path, socketAddress.c_str(), socketAddress.size() );
+        data_len = sizeof( addr );
+    }
+
+    if( ::bind( fd, ( struct sockaddr* )&addr, data_len ) < 0 ||
+        ::listen( fd, SOMAXCONN ) < 0 ) {
+        int my_errno = errno;
+        std::string errmsg = strerror( errno );
+        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Unable to listen on " + socketAddress + ": " + errmsg );
+        close( fd );
+        errno = my_errno;
+        return -1;
+    }
+
+    SIMPLELOGGER_DEBUG( LOGGER_NAME, "Listening for dbus connections on " + socketAddress );
+
+    return fd;
+}
+
 Transport::~Transport() {}
 
+ssize_t Transport::writeMessages( const std::vector<OutgoingMessage>& messages ) {
+    ssize_t totalWritten = 0;
+
+    for( const OutgoingMessage& outgoing : messages ) {
+        ssize_t written = writeMessage( outgoing.msg, outgoing.serial );
+
+        if( written < 0 ) {
+            return written;
+        }
+
+        totalWritten += written;
+    }
+
+    return totalWritten;
+}
+
+ssize_t Transport::writePending() {
+    return 0;
+}
+
+size_t Transport::pendingBytes() const {
+    return 0;
+}
+
+int Transport::readMessages( std::vector<std::shared_ptr<Message>>* messages ) {
+    int numMessages = 0;
+    std::shared_ptr<Message> msg;
+
+    while( ( msg = readMessage() ) ) {
+        messages->push_back( msg );
+        numMessages++;
+    }
+
+    return numMessages;
+}
+
 std::shared_ptr<Transport> Transport::open_transport( std::string address ) {
+    return open_transport( address, DBus::default_transport_backend() );
+}
+
+std::shared_ptr<Transport> Transport::open_transport( std::string address, TransportBackend backend ) {
     std::vector<ParsedTransport> transports = parseTransports( address );
     std::shared_ptr<Transport> retTransport;
     bool negotiateFD = false;
@@ -278,5 +366,105 @@ std::shared_ptr<Transport> Transport::open_transport( std::string address ) {
         }
     }
 
+    if( retTransport ) {
+        return use_backend( retTransport, backend );
+    }
+
     return retTransport;
 }
+
+std::shared_ptr<Transport> Transport::use_backend( std::shared_ptr<Transport> transport, TransportBackend backend ) {
+    if( backend == TransportBackend::IoUring ) {
+#if DBUS_CXX_HAS_IO_URING
+        if( IoUringTransport::is_supported() ) {
+            /*
+             * Authentication is done on the plain socket; once that is done,
+             * hand the socket over to io_uring for everything else.
+             */
+            std::shared_ptr<IoUringTransport> uringTransport =
+                IoUringTransport::create( ::dup( transport->fd() ) );
+
+            if( uringTransport->is_valid() ) {
+                uringTransport->m_serverAddress = transport->m_serverAddress;
+                return uringTransport;
+            }
+        }
+#endif
+        SIMPLELOGGER_INFO( LOGGER_NAME, "io_uring transport not available, using socket transport" );
+    }
+
+    return transport;
+}
+
+int Transport::listen_on_address( std::string address, std::string* listenAddress ) {
+    std::vector<ParsedTransport> transports = parseTransports( address );
+
+    for( ParsedTransport param : transports ) {
+        if( param.m_transportName != "unix" ) {
+            continue;
+        }
+
+        std::string path = param.m_config[ "path" ];
+        std::string abstractPath = param.m_config[ "abstract" ];
+        int fd;
+
+        if( !path.empty() ) {
+            fd = listen_unix_socket( path, false );
+
+            if( fd >= 0 ) {
+                *listenAddress = "unix:path=" + path;
+                return fd;
+            }
+        }
+
+        if( !abstractPath.empty() ) {
+            fd = listen_unix_socket( abstractPath, true );
+
+            if( fd >= 0 ) {
+                *listenAddress = "unix:abstract=" + abstractPath;
+                return fd;
+            }
+        }
+    }
+
+    return -1;
+}
+
+int Transport::accept_client( int listenFd ) {
+    int fd;
+
+    do {
+        fd = ::accept4( listenFd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK );
+    } while( fd < 0 && errno == EINTR );
+
+    if( fd < 0 ) {
+        std::string errmsg = strerror( errno );
+        SIMPLELOGGER_DEBUG( LOGGER_NAME, "Unable to accept client: " + errmsg );
+        return -1;
+    }
+
+    // Who the client is never changes, so don't wait for it to tell us
+    if( !priv::SASL::client_is_same_user( fd ) ) {
+        close( fd );
+        return -1;
+    }
+
+    return fd;
+}
+
+std::shared_ptr<Transport> Transport::create_for_client( int fd, const std::string& serverGUID ) {
+    std::shared_ptr<Transport> retTransport;
+
+    retTransport = SendmsgTransport::create( fd, false );
+
+    if( !retTransport->is_valid() ) {
+        return std::shared_ptr<Transport>();
+    }
+
+    for( size_t x = 0; x + 1 < serverGUID.size(); x += 2 ) {
+        retTransport->m_serverAddress.push_back(
+            static_cast<uint8_t>( std::stoi( serverGUID.substr( x, 2 ), nullptr, 16 ) ) );
+    }
+
+    return use_backend( retTransport, DBus::default_transport_backend() );
+}
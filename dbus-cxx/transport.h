@@ -8,6 +8,7 @@
 #ifndef DBUSCXX_TRANSPORT_H
 #define DBUSCXX_TRANSPORT_H
 
+#include <dbus-cxx/enums.h>
 #include <memory>
 #include <stdint.h>
 #include <string>
@@ -19,12 +20,23 @@ class Message;
 
 namespace priv {
 
+/**
+ * A message that is queued up to be written, along with the serial
+ * that it will be sent with.
+ */
+struct OutgoingMessage {
+    std::shared_ptr<const Message> msg;
+    uint32_t serial;
+};
+
 class Transport {
 public:
     virtual ~Transport();
 
     /**
-     * Writes a message to the transport stream.
+     * Writes a message to the transport stream.  Anything that was already
+     * waiting to be written goes first, and this method does not return until
+     * all of it has been written.
      *
      * @param message The message to write
      * @param serial The serial of the message to write.
@@ -32,6 +44,33 @@ public:
      */
     virtual ssize_t writeMessage( std::shared_ptr<const Message> message, uint32_t serial ) = 0;
 
+    /**
+     * Writes a batch of messages to the transport stream.  Implementations
+     * should coalesce the messages into as few system calls as possible;
+     * the default implementation simply calls writeMessage() for each message.
+     *
+     * Transports that buffer outgoing data only write as much as the stream
+     * will take without blocking.  The rest is kept in order, and is written by
+     * writePending() once the stream is writable again.
+     *
+     * @param messages The messages to write, in the order to write them.
+     * @return The total number of bytes written on success, an error code otherwise.
+     */
+    virtual ssize_t writeMessages( const std::vector<OutgoingMessage>& messages );
+
+    /**
+     * Write as much of the buffered outgoing data as possible without blocking.
+     *
+     * @return The number of bytes written on success, an error code otherwise.
+     */
+    virtual ssize_t writePending();
+
+    /**
+     * @return The number of outgoing bytes that have been buffered, but not
+     * yet written to the stream.
+     */
+    virtual size_t pendingBytes() const;
+
     /**
      * Read a message from the transport stream.  If there is no message
      * to be read, or there is not enough data to read a message yet,
@@ -41,6 +80,17 @@ public:
      */
     virtual std::shared_ptr<Message> readMessage() = 0;
 
+    /**
+     * Read all of the messages that are currently available from the
+     * transport stream.  Implementations should read as much data as
+     * possible with each system call; the default implementation simply
+     * calls readMessage() until there are no more messages.
+     *
+     * @param messages Where to append the messages that were read to.
+     * @return The number of messages that were read.
+     */
+    virtual int readMessages( std::vector<std::shared_ptr<Message>>* messages );
+
     /**
      * Check to see if this transport is valid.
      * @return
@@ -63,6 +113,58 @@ public:
      */
     static std::shared_ptr<Transport> open_transport( std::string address );
 
+    /**
+     * Open and return a transport based off of the given address, using the
+     * given backend to do the I/O.  If the backend can't be used, this falls
+     * back to the normal socket transport.
+     *
+     * @param address The address to connect to, in DBus transport format
+     * (e.g. unix:path=/tmp/dbus-test)
+     * @param backend How to do I/O on the transport
+     * @return The transport, or an invalid pointer on error
+     */
+    static std::shared_ptr<Transport> open_transport( std::string address, TransportBackend backend );
+
+    /**
+     * Create a socket that listens for clients on the given address.
+     *
+     * @param address The address to listen on, in DBus transport format
+     * (e.g. unix:path=/tmp/dbus-test or unix:abstract=dbus-test)
+     * @param listenAddress Set to the address that we are actually listening on
+     * @return The listening socket, or -1 on error(with errno set)
+     */
+    static int listen_on_address( std::string address, std::string* listenAddress );
+
+    /**
+     * Accept a client from a listening socket.  Clients that are not
+     * running as the same user that we are are turned away straight away,
+     * before they get to authenticate.
+     *
+     * @param listenFd The socket from listen_on_address()
+     * @return The non-blocking socket of the client, which still has to
+     * authenticate, or -1 if there was no client or it was turned away
+     */
+    static int accept_client( int listenFd );
+
+    /**
+     * Create the transport for a client that has authenticated.
+     *
+     * @param fd The socket of the client, from accept_client().  This is
+     * owned by the transport from now on, even on error.
+     * @param serverGUID The GUID of our server, as a hex string
+     * @return The transport to the client, or an invalid pointer on error
+     */
+    static std::shared_ptr<Transport> create_for_client( int fd, const std::string& serverGUID );
+
+private:
+    /**
+     * Switch an authenticated transport over to the given backend, if it
+     * is not the socket backend.
+     *
+     * @return The transport to use from now on
+     */
+    static std::shared_ptr<Transport> use_backend( std::shared_ptr<Transport> transport, TransportBackend backend );
+
 protected:
     std::vector<uint8_t> m_serverAddress;
 
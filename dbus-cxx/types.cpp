@@ -132,12 +132,14 @@ std::string TypeInfo::cppType() const {
 bool TypeInfo::is_basic() const {
     switch( m_type ) {
     case DataType::BYTE:
+    case DataType::BOOLEAN:
     case DataType::INT16:
     case DataType::UINT16:
     case DataType::INT32:
     case DataType::UINT32:
     case DataType::INT64:
     case DataType::UINT64:
+    case DataType::DOUBLE:
     case DataType::STRING:
     case DataType::OBJECT_PATH:
     case DataType::SIGNATURE:
@@ -152,12 +154,14 @@ bool TypeInfo::is_basic() const {
 bool TypeInfo::is_fixed() const {
     switch( m_type ) {
     case DataType::BYTE:
+    case DataType::BOOLEAN:
     case DataType::INT16:
     case DataType::UINT16:
     case DataType::INT32:
     case DataType::UINT32:
     case DataType::INT64:
     case DataType::UINT64:
+    case DataType::DOUBLE:
         return true;
 
     default:
@@ -12,6 +12,7 @@
 #include <stdint.h>
 #include <string>
 #include <tuple>
+#include <type_traits>
 #include <vector>
 
 #ifndef DBUSCXX_TYPES_H
@@ -146,6 +147,7 @@ inline DataType type( const int64_t& )            { return DataType::INT64; }
 inline DataType type( const uint64_t& )           { return DataType::UINT64; }
 inline DataType type( const double& )             { return DataType::DOUBLE; }
 inline DataType type( const std::string& ) { return DataType::STRING; }
+inline DataType type( const std::pmr::string& ) { return DataType::STRING; }
 inline DataType type( const char* )        { return DataType::STRING; }
 inline DataType type( const Path& )               { return DataType::OBJECT_PATH; }
 inline DataType type( const Signature& )          { return DataType::SIGNATURE; }
@@ -158,12 +160,28 @@ inline DataType type( const int8_t& )             { return DataType::BYTE; }
 
 inline DataType type( const float& )               { return DataType::DOUBLE; }
 
-template <typename T>
-inline DataType type( const std::vector<T>& ) { return DataType::ARRAY; }
+template <typename T, typename Alloc>
+inline DataType type( const std::vector<T, Alloc>& ) { return DataType::ARRAY; }
 
 template <typename ...T>
 inline DataType type( const std::tuple<T...>& ) { return DataType::STRUCT; }
 
+/**
+ * True for the types that are marshaled exactly as they are stored in
+ * memory(apart from the byte order).  Arrays of these types are copied
+ * all at once instead of one element at a time.
+ */
+template <typename T>
+struct is_fixed_array_element : std::integral_constant<bool,
+    std::is_same<T, uint8_t>::value ||
+    std::is_same<T, int16_t>::value ||
+    std::is_same<T, uint16_t>::value ||
+    std::is_same<T, int32_t>::value ||
+    std::is_same<T, uint32_t>::value ||
+    std::is_same<T, int64_t>::value ||
+    std::is_same<T, uint64_t>::value ||
+    std::is_same<T, double>::value> {};
+
 inline
 DataType checked_type_cast( int n ) {
     return DataType( n );
@@ -42,10 +42,27 @@ static void  configure_endianess(){
     }
 }
 
+[[gnu::constructor]]
+static void  configure_transport_backend(){
+    char* env_var = getenv("DBUSCXX_TRANSPORT");
+    if(env_var == nullptr){
+        return;
+    }
+
+    std::string backend( env_var );
+
+    if(backend == "socket"){
+        DBus::set_default_transport_backend(DBus::TransportBackend::Socket);
+    }else if(backend == "io_uring"){
+        DBus::set_default_transport_backend(DBus::TransportBackend::IoUring);
+    }
+}
+
 namespace DBus {
 
 static enum SL_LogLevel log_level = SL_INFO;
 static Endianess lib_default_endianess = Endianess::Big;
+static TransportBackend lib_default_transport_backend = TransportBackend::Socket;
 
 void set_logging_function( simplelogger_log_function function ) {
     dbuscxx_log_function = function;
@@ -157,6 +174,25 @@ std::tuple<bool, int, std::vector<int>, std::chrono::milliseconds> priv::wait_fo
     return std::make_tuple( timeout, poll_ret, fdsToRead, ms_waited );
 }
 
+bool priv::wait_for_fd_writable( int fd, int timeout_ms ) {
+    struct pollfd pollfd;
+    int poll_ret;
+
+    pollfd.fd = fd;
+    pollfd.events = POLLOUT;
+    pollfd.revents = 0;
+
+    do {
+        poll_ret = ::poll( &pollfd, 1, timeout_ms );
+    } while( poll_ret < 0 && errno == EINTR );
+
+    if( poll_ret <= 0 ) {
+        return false;
+    }
+
+    return ( pollfd.revents & POLLOUT ) && !( pollfd.revents & ( POLLERR | POLLHUP | POLLNVAL ) );
+}
+
 void set_default_endianess(DBus::Endianess endianess){
     lib_default_endianess = endianess;
 }
@@ -165,6 +201,14 @@ DBus::Endianess default_endianess(){
     return lib_default_endianess;
 }
 
+void set_default_transport_backend(DBus::TransportBackend backend){
+    lib_default_transport_backend = backend;
+}
+
+DBus::TransportBackend default_transport_backend(){
+    return lib_default_transport_backend;
+}
+
 } /* namespace DBus */
 
 
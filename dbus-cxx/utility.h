@@ -133,6 +133,19 @@ void set_default_endianess(DBus::Endianess endianess);
 
 DBus::Endianess default_endianess();
 
+/**
+ * Set the backend that new connections use to talk over their socket.
+ * By default, TransportBackend::Socket is used.
+ *
+ * You may also set the environment variable DBUSCXX_TRANSPORT to either 'socket' or 'io_uring' to set the backend.
+ * This requires your compiler to have constructor support.
+ *
+ * @param backend
+ */
+void set_default_transport_backend(DBus::TransportBackend backend);
+
+DBus::TransportBackend default_transport_backend();
+
 namespace priv {
 /*
  * method_signature class - like dbus_signature, but outputs the args of the signature
@@ -371,6 +384,16 @@ struct dbus_function_traits<std::function<DBus::MultipleReturn<T_ret...>( Args..
  */
 std::tuple<bool, int, std::vector<int>, std::chrono::milliseconds> wait_for_fd_activity( std::vector<int> fds, int timeout_ms );
 
+/**
+ * Wait for the given FD to become writable.
+ * If the system call is interrupted, it will be restarted automatically.
+ *
+ * @param fd The FD to monitor
+ * @param timeout_ms The timeout, in milliseconds to wait.  -1 means infinite.
+ * @return True if the FD can be written to, false on timeout or error
+ */
+bool wait_for_fd_writable( int fd, int timeout_ms );
+
 } /* namespace priv */
 
 } /* namespace DBus */
@@ -14,6 +14,8 @@
 #include <stdint.h>
 #include <utility>
 #include <assert.h>
+#include <cstring>
+#include <mutex>
 #include "enums.h"
 #include "path.h"
 #include "signature.h"
@@ -21,125 +23,207 @@
 
 static const char* LOGGER_NAME = "DBus.Variant";
 
+/*
+ * marshaled() is const, so any number of threads may call it on the same
+ * Variant at once; this makes sure only one of them copies inline data
+ * into m_marshaled.
+ */
+static std::mutex marshaled_copy_lock;
+
 namespace DBus { class FileDescriptor; }
 
 using DBus::Variant;
 
+/*
+ * The signatures of the basic types.  These are only parsed once, and are
+ * then shared between all of the Variants of that type.  They are never
+ * destroyed, since Variants may still be created by other threads while
+ * the program exits.
+ */
+static DBus::Signature basic_signature( DBus::DataType dt ) {
+    static const DBus::Signature* signatures = new DBus::Signature[ 13 ] {
+        DBUSCXX_TYPE_BYTE_AS_STRING,
+        DBUSCXX_TYPE_BOOLEAN_AS_STRING,
+        DBUSCXX_TYPE_INT16_AS_STRING,
+        DBUSCXX_TYPE_UINT16_AS_STRING,
+        DBUSCXX_TYPE_INT32_AS_STRING,
+        DBUSCXX_TYPE_UINT32_AS_STRING,
+        DBUSCXX_TYPE_INT64_AS_STRING,
+        DBUSCXX_TYPE_UINT64_AS_STRING,
+        DBUSCXX_TYPE_DOUBLE_AS_STRING,
+        DBUSCXX_TYPE_STRING_AS_STRING,
+        DBUSCXX_TYPE_OBJECT_PATH_AS_STRING,
+        DBUSCXX_TYPE_SIGNATURE_AS_STRING,
+        DBUSCXX_TYPE_VARIANT_AS_STRING,
+    };
+
+    switch( dt ) {
+    case DBus::DataType::BYTE: return signatures[ 0 ];
+    case DBus::DataType::BOOLEAN: return signatures[ 1 ];
+    case DBus::DataType::INT16: return signatures[ 2 ];
+    case DBus::DataType::UINT16: return signatures[ 3 ];
+    case DBus::DataType::INT32: return signatures[ 4 ];
+    case DBus::DataType::UINT32: return signatures[ 5 ];
+    case DBus::DataType::INT64: return signatures[ 6 ];
+    case DBus::DataType::UINT64: return signatures[ 7 ];
+    case DBus::DataType::DOUBLE: return signatures[ 8 ];
+    case DBus::DataType::STRING: return signatures[ 9 ];
+    case DBus::DataType::OBJECT_PATH: return signatures[ 10 ];
+    case DBus::DataType::SIGNATURE: return signatures[ 11 ];
+    case DBus::DataType::VARIANT: return signatures[ 12 ];
+    default: break;
+    }
+
+    return DBus::Signature();
+}
+
+/*
+ * Write an integer of the given size in the default endianess, the same as
+ * Marshaling would do.  Returns the number of bytes written.
+ */
+static uint8_t store_integer( uint8_t* where, uint64_t value, int size ) {
+    bool big = DBus::default_endianess() == DBus::Endianess::Big;
+
+    for( int x = 0; x < size; x++ ) {
+        int shift = big ? ( size - 1 - x ) * 8 : x * 8;
+        where[ x ] = ( value >> shift ) & 0xFF;
+    }
+
+    return size;
+}
+
+static uint64_t load_integer( const uint8_t* where, int size ) {
+    bool big = DBus::default_endianess() == DBus::Endianess::Big;
+    uint64_t value = 0;
+
+    for( int x = 0; x < size; x++ ) {
+        int shift = big ? ( size - 1 - x ) * 8 : x * 8;
+        value |= static_cast<uint64_t>( where[ x ] ) << shift;
+    }
+
+    return value;
+}
+
+static uint8_t store_double( uint8_t* where, double d ) {
+    uint64_t value;
+
+    std::memcpy( &value, &d, sizeof( value ) );
+
+    return store_integer( where, value, 8 );
+}
+
 Variant::Variant():
-    m_currentType( DataType::INVALID )
+    m_currentType( DataType::INVALID ),
+    m_dataAlignment( 0 ),
+    m_inlineSize( 0 )
 {}
 
 Variant::Variant( uint8_t byte ) :
     m_currentType( DataType::BYTE ),
-    m_signature( DBus::signature( byte ) ),
-    m_dataAlignment( 1 ) {
-    Marshaling marshal( &m_marshaled, DBus::default_endianess() );
-    marshal.marshal( byte );
-}
+    m_signature( basic_signature( DataType::BYTE ) ),
+    m_dataAlignment( 1 ),
+    m_inlineSize( store_integer( m_inline, byte, 1 ) )
+{}
 
 Variant::Variant( bool b ) :
     m_currentType( DataType::BOOLEAN ),
-    m_signature( DBus::signature( b ) ),
-    m_dataAlignment( 4 ) {
-    Marshaling marshal( &m_marshaled, DBus::default_endianess() );
-    marshal.marshal( b );
-}
+    m_signature( basic_signature( DataType::BOOLEAN ) ),
+    m_dataAlignment( 4 ),
+    m_inlineSize( store_integer( m_inline, b ? 1 : 0, 4 ) )
+{}
 
 Variant::Variant( int16_t i ) :
     m_currentType( DataType::INT16 ),
-    m_signature( DBus::signature( i ) ),
-    m_dataAlignment( 2 ) {
-    Marshaling marshal( &m_marshaled, DBus::default_endianess() );
-    marshal.marshal( i );
-}
+    m_signature( basic_signature( DataType::INT16 ) ),
+    m_dataAlignment( 2 ),
+    m_inlineSize( store_integer( m_inline, static_cast<uint16_t>( i ), 2 ) )
+{}
 
 Variant::Variant( uint16_t i ):
     m_currentType( DataType::UINT16 ),
-    m_signature( DBus::signature( i ) ),
-    m_dataAlignment( 2 ) {
-    Marshaling marshal( &m_marshaled, DBus::default_endianess() );
-    marshal.marshal( i );
-}
+    m_signature( basic_signature( DataType::UINT16 ) ),
+    m_dataAlignment( 2 ),
+    m_inlineSize( store_integer( m_inline, i, 2 ) )
+{}
 
 Variant::Variant( int32_t i ) :
     m_currentType( DataType::INT32 ),
-    m_signature( DBus::signature( i ) ),
-    m_dataAlignment( 4 ) {
-    Marshaling marshal( &m_marshaled, DBus::default_endianess() );
-    marshal.marshal( i );
-}
+    m_signature( basic_signature( DataType::INT32 ) ),
+    m_dataAlignment( 4 ),
+    m_inlineSize( store_integer( m_inline, static_cast<uint32_t>( i ), 4 ) )
+{}
 
 Variant::Variant( uint32_t i ) :
     m_currentType( DataType::UINT32 ),
-    m_signature( DBus::signature( i ) ),
-    m_dataAlignment( 4 ) {
-    Marshaling marshal( &m_marshaled, DBus::default_endianess() );
-    marshal.marshal( i );
-}
+    m_signature( basic_signature( DataType::UINT32 ) ),
+    m_dataAlignment( 4 ),
+    m_inlineSize( store_integer( m_inline, i, 4 ) )
+{}
 
 Variant::Variant( int64_t i ) :
     m_currentType( DataType::INT64 ),
-    m_signature( DBus::signature( i ) ),
-    m_dataAlignment( 8 ) {
-    Marshaling marshal( &m_marshaled, DBus::default_endianess() );
-    marshal.marshal( i );
-}
+    m_signature( basic_signature( DataType::INT64 ) ),
+    m_dataAlignment( 8 ),
+    m_inlineSize( store_integer( m_inline, static_cast<uint64_t>( i ), 8 ) )
+{}
 
 Variant::Variant( uint64_t i ) :
     m_currentType( DataType::UINT64 ),
-    m_signature( DBus::signature( i ) ),
-    m_dataAlignment( 8 ) {
-    Marshaling marshal( &m_marshaled, DBus::default_endianess() );
-    marshal.marshal( i );
-}
+    m_signature( basic_signature( DataType::UINT64 ) ),
+    m_dataAlignment( 8 ),
+    m_inlineSize( store_integer( m_inline, i, 8 ) )
+{}
 
 Variant::Variant( double i ) :
     m_currentType( DataType::DOUBLE ),
-    m_signature( DBus::signature( i ) ),
-    m_dataAlignment( 8 ) {
-    Marshaling marshal( &m_marshaled, DBus::default_endianess() );
-    marshal.marshal( i );
-}
+    m_signature( basic_signature( DataType::DOUBLE ) ),
+    m_dataAlignment( 8 ),
+    m_inlineSize( store_double( m_inline, i ) )
+{}
 
 Variant::Variant( const char* cstr ) :
     Variant( std::string( cstr ) ) {}
 
 Variant::Variant( std::string str ) :
     m_currentType( DataType::STRING ),
-    m_signature( DBus::signature( str ) ),
+    m_signature( basic_signature( DataType::STRING ) ),
     m_dataAlignment( 4 ) {
-    Marshaling marshal( &m_marshaled, DBus::default_endianess() );
-    marshal.marshal( str );
+    set_string_data( str, false );
 }
 
 Variant::Variant( DBus::Signature sig ) :
     m_currentType( DataType::SIGNATURE ),
-    m_signature( DBus::signature( sig ) ),
+    m_signature( basic_signature( DataType::SIGNATURE ) ),
     m_dataAlignment( 1 ) {
-    Marshaling marshal( &m_marshaled, DBus::default_endianess() );
-    marshal.marshal( sig );
+    set_string_data( sig.str(), true );
 }
 
 Variant::Variant( DBus::Path path )  :
     m_currentType( DataType::OBJECT_PATH ),
-    m_signature( DBus::signature( path ) ),
+    m_signature( basic_signature( DataType::OBJECT_PATH ) ),
     m_dataAlignment( 4 ) {
-    Marshaling marshal( &m_marshaled, DBus::default_endianess() );
-    marshal.marshal( path );
+    set_string_data( path, false );
 }
 
 Variant::Variant( const Variant& other ) :
     m_currentType( other.m_currentType ),
     m_signature( other.m_signature ),
-    m_marshaled( other.m_marshaled ),
-    m_dataAlignment( other.m_dataAlignment )
-{}
+    m_dataAlignment( other.m_dataAlignment ),
+    m_inlineSize( other.m_inlineSize ) {
+    if( m_inlineSize ) {
+        std::memcpy( m_inline, other.m_inline, m_inlineSize );
+    } else {
+        m_marshaled = other.m_marshaled;
+    }
+}
 
 Variant::Variant( Variant&& other ) :
     m_currentType( std::exchange( other.m_currentType, DataType::INVALID ) ),
     m_signature( std::move( other.m_signature ) ),
     m_marshaled( std::move( other.m_marshaled ) ),
-    m_dataAlignment( std::exchange( other.m_dataAlignment, 0 ) ){
+    m_dataAlignment( std::exchange( other.m_dataAlignment, 0 ) ),
+    m_inlineSize( std::exchange( other.m_inlineSize, 0 ) ) {
+    std::memcpy( m_inline, other.m_inline, m_inlineSize );
 }
 
 Variant::~Variant() {}
@@ -173,51 +257,51 @@ Variant Variant::createFromDemarshal( Signature sig, std::shared_ptr<Demarshalin
 
     switch( dt ){
     case DataType::BYTE:
-        marshal.marshal( demarshal->demarshal_uint8_t() );
+        v = Variant( demarshal->demarshal_uint8_t() );
         break;
 
     case  DataType::BOOLEAN:
-        marshal.marshal( demarshal->demarshal_boolean() );
+        v = Variant( demarshal->demarshal_boolean() );
         break;
 
     case  DataType::INT16:
-        marshal.marshal( demarshal->demarshal_int16_t() );
+        v = Variant( demarshal->demarshal_int16_t() );
         break;
 
     case  DataType::UINT16:
-        marshal.marshal( demarshal->demarshal_uint16_t() );
+        v = Variant( demarshal->demarshal_uint16_t() );
         break;
 
     case  DataType::INT32:
-        marshal.marshal( demarshal->demarshal_int32_t() );
+        v = Variant( demarshal->demarshal_int32_t() );
         break;
 
     case  DataType::UINT32:
-        marshal.marshal( demarshal->demarshal_uint32_t() );
+        v = Variant( demarshal->demarshal_uint32_t() );
         break;
 
     case  DataType::INT64:
-        marshal.marshal( demarshal->demarshal_int64_t() );
+        v = Variant( demarshal->demarshal_int64_t() );
         break;
 
     case  DataType::UINT64:
-        marshal.marshal( demarshal->demarshal_uint64_t() );
+        v = Variant( demarshal->demarshal_uint64_t() );
         break;
 
     case  DataType::DOUBLE:
-        marshal.marshal( demarshal->demarshal_double() );
+        v = Variant( demarshal->demarshal_double() );
         break;
 
     case  DataType::STRING:
-        marshal.marshal( demarshal->demarshal_string() );
+        v = Variant( demarshal->demarshal_string() );
         break;
 
     case  DataType::OBJECT_PATH:
-        marshal.marshal( demarshal->demarshal_string() );
+        v = Variant( Path( demarshal->demarshal_string() ) );
         break;
 
     case  DataType::SIGNATURE:
-        marshal.marshal( demarshal->demarshal_signature() );
+        v = Variant( demarshal->demarshal_signature() );
         break;
 
     case DBus::DataType::ARRAY:
@@ -417,7 +501,8 @@ void Variant::remarshal(DataType dt, SignatureIterator sigit, std::shared_ptr<De
         // the DICT_ENTRY on an 8-byte boundary, which results in padding being
         // inserted into the data stream.  This padding is not always needed,
         // so we remove the padding and then do the alignment here.
-        const std::vector<uint8_t>* dataToMarshal = v.marshaled();
+        const uint8_t* dataToMarshal = v.marshaled_data();
+        size_t dataSize = v.marshaled_size();
         bool isDict = false;
         if( v.type() == DataType::ARRAY ){
             // determine if we have a dict or not.  If we do, remove padding
@@ -431,7 +516,7 @@ void Variant::remarshal(DataType dt, SignatureIterator sigit, std::shared_ptr<De
             }
         }
 
-        for( size_t x = 0; x < dataToMarshal->size(); x++ ) {
+        for( size_t x = 0; x < dataSize; x++ ) {
             if( isDict &&
                     (x == 4 || x == 5 || x == 6 || x == 7) ){
                 // Ignore the 4 padding bytes that the variant inserts
@@ -441,7 +526,7 @@ void Variant::remarshal(DataType dt, SignatureIterator sigit, std::shared_ptr<De
                 // make sure to align for all of the dict entries
                 marshal->align( 8 );
             }
-            marshal->marshal( (*dataToMarshal)[x] );
+            marshal->marshal( dataToMarshal[x] );
         }
     }
         break;
@@ -456,30 +541,101 @@ void Variant::remarshal(DataType dt, SignatureIterator sigit, std::shared_ptr<De
     }
 }
 
+void Variant::set_string_data( const std::string& str, bool is_signature ) {
+    size_t length_size = is_signature ? 1 : 4;
+    size_t total_size = length_size + str.size() + 1;
+    uint8_t* data;
+
+    if( total_size <= INLINE_SIZE ) {
+        m_inlineSize = total_size;
+        data = m_inline;
+    } else {
+        m_inlineSize = 0;
+        m_marshaled.resize( total_size );
+        data = m_marshaled.data();
+    }
+
+    store_integer( data, str.size(), length_size );
+    std::memcpy( data + length_size, str.data(), str.size() );
+    data[ total_size - 1 ] = '\0';
+}
+
 const std::vector<uint8_t>* Variant::marshaled() const {
+    if( !m_inlineSize ) {
+        return &m_marshaled;
+    }
+
+    std::lock_guard<std::mutex> lock( marshaled_copy_lock );
+
+    if( m_marshaled.empty() ) {
+        m_marshaled.assign( m_inline, m_inline + m_inlineSize );
+    }
+
     return &m_marshaled;
 }
 
+const uint8_t* Variant::marshaled_data() const {
+    if( m_inlineSize ) {
+        return m_inline;
+    }
+
+    return m_marshaled.data();
+}
+
+size_t Variant::marshaled_size() const {
+    if( m_inlineSize ) {
+        return m_inlineSize;
+    }
+
+    return m_marshaled.size();
+}
+
 int Variant::data_alignment() const {
     return m_dataAlignment;
 }
 
 bool Variant::operator==( const Variant& other ) const {
     bool sameType = other.type() == type();
-    bool vectorsEqual = false;
+    bool dataEqual = false;
 
-    if( sameType ) {
-        vectorsEqual = other.m_marshaled == m_marshaled;
+    if( sameType && other.marshaled_size() == marshaled_size() ) {
+        dataEqual = std::memcmp( other.marshaled_data(), marshaled_data(), marshaled_size() ) == 0;
     }
 
-    return sameType && vectorsEqual;
+    return sameType && dataEqual;
 }
 
 Variant& Variant::operator=( const Variant& other ) {
+    if( this == &other ) {
+        return *this;
+    }
+
     m_currentType = other.m_currentType;
     m_signature = other.m_signature;
-    m_marshaled = other.m_marshaled;
     m_dataAlignment = other.m_dataAlignment;
+    m_inlineSize = other.m_inlineSize;
+
+    if( m_inlineSize ) {
+        m_marshaled.clear();
+        std::memcpy( m_inline, other.m_inline, m_inlineSize );
+    } else {
+        m_marshaled = other.m_marshaled;
+    }
+
+    return *this;
+}
+
+Variant& Variant::operator=( Variant&& other ) {
+    if( this == &other ) {
+        return *this;
+    }
+
+    m_currentType = std::exchange( other.m_currentType, DataType::INVALID );
+    m_signature = std::move( other.m_signature );
+    m_marshaled = std::move( other.m_marshaled );
+    m_dataAlignment = std::exchange( other.m_dataAlignment, 0 );
+    m_inlineSize = std::exchange( other.m_inlineSize, 0 );
+    std::memcpy( m_inline, other.m_inline, m_inlineSize );
 
     return *this;
 }
@@ -489,8 +645,7 @@ bool Variant::to_bool() const {
         throw ErrorBadVariantCast();
     }
 
-    priv::VariantIterator vi( this );
-    return vi.get_bool();
+    return load_integer( marshaled_data(), 4 ) != 0;
 }
 
 uint8_t Variant::to_uint8() const {
@@ -498,8 +653,7 @@ uint8_t Variant::to_uint8() const {
         throw ErrorBadVariantCast();
     }
 
-    priv::VariantIterator vi( this );
-    return vi.get_uint8();
+    return load_integer( marshaled_data(), 1 );
 }
 
 uint16_t Variant::to_uint16() const {
@@ -507,8 +661,7 @@ uint16_t Variant::to_uint16() const {
         throw ErrorBadVariantCast();
     }
 
-    priv::VariantIterator vi( this );
-    return vi.get_uint16();
+    return load_integer( marshaled_data(), 2 );
 }
 
 int16_t Variant::to_int16() const {
@@ -516,8 +669,7 @@ int16_t Variant::to_int16() const {
         throw ErrorBadVariantCast();
     }
 
-    priv::VariantIterator vi( this );
-    return vi.get_int16();
+    return static_cast<int16_t>( load_integer( marshaled_data(), 2 ) );
 }
 
 uint32_t Variant::to_uint32() const {
@@ -525,8 +677,7 @@ uint32_t Variant::to_uint32() const {
         throw ErrorBadVariantCast();
     }
 
-    priv::VariantIterator vi( this );
-    return vi.get_uint32();
+    return load_integer( marshaled_data(), 4 );
 }
 
 int32_t Variant::to_int32() const {
@@ -534,8 +685,7 @@ int32_t Variant::to_int32() const {
         throw ErrorBadVariantCast();
     }
 
-    priv::VariantIterator vi( this );
-    return vi.get_int32();
+    return static_cast<int32_t>( load_integer( marshaled_data(), 4 ) );
 }
 
 uint64_t Variant::to_uint64() const {
@@ -543,8 +693,7 @@ uint64_t Variant::to_uint64() const {
         throw ErrorBadVariantCast();
     }
 
-    priv::VariantIterator vi( this );
-    return vi.get_uint64();
+    return load_integer( marshaled_data(), 8 );
 }
 
 int64_t Variant::to_int64() const {
@@ -552,8 +701,7 @@ int64_t Variant::to_int64() const {
         throw ErrorBadVariantCast();
     }
 
-    priv::VariantIterator vi( this );
-    return vi.get_int64();
+    return static_cast<int64_t>( load_integer( marshaled_data(), 8 ) );
 }
 
 double Variant::to_double() const {
@@ -561,8 +709,11 @@ double Variant::to_double() const {
         throw ErrorBadVariantCast();
     }
 
-    priv::VariantIterator vi( this );
-    return vi.get_double();
+    uint64_t value = load_integer( marshaled_data(), 8 );
+    double d;
+    std::memcpy( &d, &value, sizeof( d ) );
+
+    return d;
 }
 
 std::string Variant::to_string() const {
@@ -570,8 +721,8 @@ std::string Variant::to_string() const {
         throw ErrorBadVariantCast();
     }
 
-    priv::VariantIterator vi( this );
-    return vi.get_string();
+    const char* data = reinterpret_cast<const char*>( marshaled_data() );
+    return std::string( data + 4, marshaled_size() - 5 );
 }
 
 DBus::Path Variant::to_path() const {
@@ -579,8 +730,8 @@ DBus::Path Variant::to_path() const {
         throw ErrorBadVariantCast();
     }
 
-    priv::VariantIterator vi( this );
-    return vi.get_string();
+    const char* data = reinterpret_cast<const char*>( marshaled_data() );
+    return std::string( data + 4, marshaled_size() - 5 );
 }
 
 DBus::Signature Variant::to_signature() const {
@@ -588,8 +739,8 @@ DBus::Signature Variant::to_signature() const {
         throw ErrorBadVariantCast();
     }
 
-    priv::VariantIterator vi( this );
-    return vi.get_signature();
+    const char* data = reinterpret_cast<const char*>( marshaled_data() );
+    return DBus::Signature( data + 1, marshaled_size() - 2 );
 }
 
 Variant Variant::to_variant() const{
@@ -736,7 +887,7 @@ Variant Variant::createFromVariant( Variant& other ){
     TypeInfo ti(DataType::VARIANT);
 
     v.m_currentType = DataType::VARIANT;
-    v.m_signature = DBus::signature(v);
+    v.m_signature = basic_signature( DataType::VARIANT );
     v.m_dataAlignment = ti.alignment();
 
     Marshaling marshal(&v.m_marshaled, DBus::default_endianess());
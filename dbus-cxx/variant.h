@@ -60,7 +60,8 @@ public:
     Variant( const std::vector<T>& vec ) :
         m_currentType( DataType::ARRAY ),
         m_signature( DBus::signature( vec ) ),
-        m_dataAlignment( 4 ) {
+        m_dataAlignment( 4 ),
+        m_inlineSize( 0 ) {
         priv::VariantAppendIterator it( this );
 
         it << vec;
@@ -70,7 +71,8 @@ public:
     Variant( const std::map<Key, Value>& map ) :
         m_currentType( DataType::ARRAY ),
         m_signature( DBus::signature( map ) ),
-        m_dataAlignment( 4 ) {
+        m_dataAlignment( 4 ),
+        m_inlineSize( 0 ) {
         priv::VariantAppendIterator it( this );
 
         it << map;
@@ -80,7 +82,8 @@ public:
     Variant( const std::tuple<T...>& tup ) :
         m_currentType( DataType::STRUCT ),
         m_signature( DBus::signature( tup ) ),
-        m_dataAlignment( 8 ) {
+        m_dataAlignment( 8 ),
+        m_inlineSize( 0 ) {
         priv::VariantAppendIterator it( this );
         it << tup;
     }
@@ -93,14 +96,35 @@ public:
 
     DataType type() const;
 
+    /**
+     * Get the marshaled data of this Variant as a vector.
+     *
+     * Small values are stored inside of the Variant itself, so for those
+     * this copies the data into a vector the first time it is called.  This
+     * is safe to call from several threads at once.  Use marshaled_data()
+     * and marshaled_size() to avoid the copy.
+     */
     const std::vector<uint8_t>* marshaled() const;
 
+    /**
+     * Pointer to the marshaled data of this Variant, in the default
+     * endianess.  Valid for as long as this Variant is not modified.
+     */
+    const uint8_t* marshaled_data() const;
+
+    /**
+     * The number of bytes pointed to by marshaled_data().
+     */
+    size_t marshaled_size() const;
+
     int data_alignment() const;
 
     bool operator==( const Variant& other ) const;
 
     Variant& operator=( const Variant& other );
 
+    Variant& operator=( Variant&& other );
+
     template <typename T>
     std::vector<T> to_vector() {
         if( m_currentType != DataType::ARRAY ) {
@@ -199,6 +223,7 @@ private:
     void recurseArray( SignatureIterator iter, std::shared_ptr<Demarshaling> demarshal, Marshaling* marshal, const std::vector<int>& filedescriptors, uint32_t depth );
     void recurseDictEntry( SignatureIterator iter, std::shared_ptr<Demarshaling> demarshal, Marshaling* marshal, uint32_t ending_offset, const std::vector<int>& filedescriptors, uint32_t depth );
     void recurseStruct( SignatureIterator sigit, std::shared_ptr<Demarshaling> demarshal, Marshaling* marshal, const std::vector<int>& filedescriptors, uint32_t depth );
+    void set_string_data( const std::string& str, bool is_signature );
     void remarshal(DataType dt, SignatureIterator sigit, std::shared_ptr<Demarshaling> demarshal, Marshaling* marshal, const std::vector<int>& filedescriptors, uint32_t depth);
 
     /**
@@ -218,10 +243,17 @@ private:
     void recurseStruct( MessageIterator iter, Marshaling* marshal );
 
 private:
+    /* Values that marshal to at most this many bytes are stored inline */
+    static constexpr size_t INLINE_SIZE = 32;
+
     DataType m_currentType;
     Signature m_signature;
-    std::vector<uint8_t> m_marshaled;
+    /* Only filled in by marshaled() for inline values, under a lock */
+    mutable std::vector<uint8_t> m_marshaled;
     int m_dataAlignment;
+    /* The number of bytes in m_inline; 0 if the data is in m_marshaled */
+    uint8_t m_inlineSize;
+    alignas( 8 ) uint8_t m_inline[ INLINE_SIZE ];
 
     friend std::ostream& operator<<( std::ostream& os, const Variant& var );
     friend class priv::VariantAppendIterator;
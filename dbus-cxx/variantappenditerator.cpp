@@ -138,7 +138,8 @@ VariantAppendIterator& VariantAppendIterator::operator<<( const Variant& v ){
     // the DICT_ENTRY on an 8-byte boundary, which results in padding being
     // inserted into the data stream.  This padding is not always needed,
     // so we remove the padding and then do the alignment here.
-    const std::vector<uint8_t>* dataToMarshal = v.marshaled();
+    const uint8_t* dataToMarshal = v.marshaled_data();
+    size_t dataSize = v.marshaled_size();
     bool isDict = false;
     if( v.type() == DataType::ARRAY ){
         // determine if we have a dict or not.  If we do, remove padding
@@ -152,7 +153,7 @@ VariantAppendIterator& VariantAppendIterator::operator<<( const Variant& v ){
         }
     }
 
-    for( size_t x = 0; x < dataToMarshal->size(); x++ ) {
+    for( size_t x = 0; x < dataSize; x++ ) {
         if( isDict &&
                 (x == 4 || x == 5 || x == 6 || x == 7) ){
             // Ignore the 4 padding bytes that the variant inserts
@@ -162,7 +163,7 @@ VariantAppendIterator& VariantAppendIterator::operator<<( const Variant& v ){
             // make sure to align for all of the dict entries
             m_priv->m_marshaling.align( 8 );
         }
-        m_priv->m_marshaling.marshal( (*dataToMarshal)[x] );
+        m_priv->m_marshaling.marshal( dataToMarshal[x] );
     }
 
     return *this;
@@ -42,7 +42,7 @@ VariantIterator::VariantIterator() {
 VariantIterator::VariantIterator( const Variant* variant ) {
     m_priv = std::make_shared<priv_data>();
     m_priv->m_variant = variant;
-    m_priv->m_demarshal = std::make_shared<Demarshaling>( variant->m_marshaled.data(), variant->m_marshaled.size(), DBus::default_endianess() );
+    m_priv->m_demarshal = std::make_shared<Demarshaling>( variant->marshaled_data(), variant->marshaled_size(), DBus::default_endianess() );
     m_priv->m_signatureIterator = variant->signature().begin();
 }
 
@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ *                                                                         *
+ *   The dbus-cxx library is free software; you can redistribute it and/or *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The dbus-cxx library is distributed in the hope that it will be       *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#include <dbus-cxx.h>
+#include <atomic>
+#include <set>
+#include <thread>
+
+#include "test_macros.h"
+
+static std::shared_ptr<DBus::Dispatcher> dispatch;
+static std::atomic<int> signal_rx( 0 );
+
+static int add( int a, int b ) {
+    return a + b;
+}
+
+static void sigHandle( int value ) {
+    signal_rx += value;
+}
+
+bool connectiongroup_create() {
+    std::shared_ptr<DBus::ConnectionGroup> group = DBus::ConnectionGroup::create( DBus::BusType::SESSION, 4 );
+    std::set<std::string> uniqueNames;
+
+    TEST_ASSERT_RET_FAIL( group->is_valid() );
+    TEST_ASSERT_RET_FAIL( group->size() == 4 );
+
+    for( std::shared_ptr<DBus::Connection> conn : group->connections() ) {
+        TEST_ASSERT_RET_FAIL( conn->is_registered() );
+        uniqueNames.insert( conn->unique_name() );
+    }
+
+    // Every connection is separate on the bus
+    TEST_ASSERT_RET_FAIL( uniqueNames.size() == 4 );
+
+    // Round-robin goes through all of them
+    std::shared_ptr<DBus::Connection> first = group->next_connection();
+    group->next_connection();
+    group->next_connection();
+    group->next_connection();
+    TEST_ASSERT_RET_FAIL( group->next_connection() == first );
+
+    return true;
+}
+
+bool connectiongroup_method_call() {
+    std::shared_ptr<DBus::Connection> serverConn = dispatch->create_connection( DBus::BusType::SESSION );
+    std::shared_ptr<DBus::ConnectionGroup> group = DBus::ConnectionGroup::create( DBus::BusType::SESSION, 3 );
+    std::vector<std::shared_ptr<DBus::ObjectProxy>> proxies;
+    std::vector<std::shared_ptr<DBus::MethodProxy<int( int, int )>>> methods;
+    std::set<std::shared_ptr<DBus::Connection>> usedConnections;
+
+    TEST_ASSERT_RET_FAIL( serverConn->request_name( "dbuscxx.test.group" ) == DBus::RequestNameResponse::PrimaryOwner );
+
+    for( int x = 0; x < 8; x++ ) {
+        std::string path = "/test/" + std::to_string( x );
+        std::shared_ptr<DBus::Object> obj = serverConn->create_object( path, DBus::ThreadForCalling::DispatcherThread );
+        obj->create_method<int( int, int )>( "dbuscxx.group", "add", sigc::ptr_fun( add ) );
+
+        // The same object always goes to the same connection
+        std::shared_ptr<DBus::Connection> conn = group->connection_for( "dbuscxx.test.group", path );
+        TEST_ASSERT_RET_FAIL( conn == group->connection_for( "dbuscxx.test.group", path ) );
+        usedConnections.insert( conn );
+
+        std::shared_ptr<DBus::ObjectProxy> proxy = group->create_object_proxy( "dbuscxx.test.group", path );
+        TEST_ASSERT_RET_FAIL( proxy->connection().lock() == conn );
+        methods.push_back( proxy->create_method<int( int, int )>( "dbuscxx.group", "add" ) );
+        proxies.push_back( proxy );
+    }
+
+    // Different objects are spread out over the group
+    TEST_ASSERT_RET_FAIL( usedConnections.size() > 1 );
+
+    for( int x = 0; x < 8; x++ ) {
+        TEST_EQUALS_RET_FAIL( ( *methods[ x ] )( x, 5 ), x + 5 );
+    }
+
+    std::shared_ptr<DBus::CallMessage> msg = DBus::CallMessage::create( "dbuscxx.test.group", "/test/3", "dbuscxx.group", "add" );
+    *msg << 3 << 4;
+    std::shared_ptr<DBus::ReturnMessage> reply = group->send_with_reply_blocking( msg );
+    int result = 0;
+    reply >> result;
+    TEST_EQUALS_RET_FAIL( result, 7 );
+
+    return true;
+}
+
+bool connectiongroup_signals_spread() {
+    std::shared_ptr<DBus::Connection> sender = dispatch->create_connection( DBus::BusType::SESSION );
+    std::shared_ptr<DBus::ConnectionGroup> group = DBus::ConnectionGroup::create( DBus::BusType::SESSION, 2 );
+    std::vector<std::shared_ptr<DBus::SignalProxy<void(int)>>> proxies;
+
+    for( int x = 0; x < 4; x++ ) {
+        std::shared_ptr<DBus::SignalProxy<void(int)>> proxy = group->create_free_signal_proxy<void(int)>(
+                    DBus::MatchRuleBuilder::create()
+                    .set_interface( "dbuscxx.group" )
+                    .set_member( "Value" )
+                    .as_signal_match(),
+                    DBus::ThreadForCalling::DispatcherThread );
+        proxy->connect( sigc::ptr_fun( sigHandle ) );
+        proxies.push_back( proxy );
+    }
+
+    TEST_ASSERT_RET_FAIL( group->connection( 0 )->get_free_signal_proxies( "dbuscxx.group" ).size() == 2 );
+    TEST_ASSERT_RET_FAIL( group->connection( 1 )->get_free_signal_proxies( "dbuscxx.group" ).size() == 2 );
+
+    std::shared_ptr<DBus::Signal<void(int)>> signal =
+        sender->create_free_signal<void(int)>( "/test/signal", "dbuscxx.group", "Value" );
+    signal->emit( 5 );
+
+    for( int waited = 0; waited < 100 && signal_rx < 20; waited++ ) {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    }
+
+    TEST_EQUALS_RET_FAIL( signal_rx, 20 );
+
+    TEST_ASSERT_RET_FAIL( group->remove_free_signal_proxy( proxies[ 0 ] ) );
+    TEST_ASSERT_RET_FAIL( !group->remove_free_signal_proxy( proxies[ 0 ] ) );
+
+    return true;
+}
+
+#define ADD_TEST(name) do{ if( test_name == STRINGIFY(name) ){ \
+            ret = connectiongroup_##name();\
+        } \
+    } while( 0 )
+
+int main( int argc, char** argv ) {
+    if( argc < 1 ) {
+        return 1;
+    }
+
+    std::string test_name = argv[1];
+    bool ret = false;
+
+    DBus::set_logging_function( DBus::log_std_err );
+    DBus::set_log_level( SL_TRACE );
+
+    dispatch = DBus::StandaloneDispatcher::create();
+
+    ADD_TEST( create );
+    ADD_TEST( method_call );
+    ADD_TEST( signals_spread );
+
+    return !ret;
+}
@@ -180,6 +180,526 @@ bool connection_remove_obj_in_hierarchy(){
     return false;
 }
 
+bool connection_pipelined_register(){
+    std::shared_ptr<DBus::Connection> conn = DBus::Connection::create( DBus::BusType::SESSION );
+    std::shared_ptr<DBus::Connection> sender = dispatch->create_connection( DBus::BusType::SESSION );
+    std::atomic<int> received( 0 );
+
+    // The match rule for this has to be sent along with the Hello
+    std::shared_ptr<DBus::SignalProxy<void(int)>> proxy = conn->create_free_signal_proxy<void(int)>(
+                DBus::MatchRuleBuilder::create()
+                .set_interface( "dbuscxx.test.pipelined" )
+                .set_member( "Value" )
+                .as_signal_match(),
+                DBus::ThreadForCalling::DispatcherThread );
+    proxy->connect( [&received]( int value ){
+        received += value;
+    } );
+
+    TEST_ASSERT_RET_FAIL( !conn->is_registered() );
+
+    std::vector<DBus::RequestNameResponse> responses =
+        conn->bus_register( { "dbuscxx.test.pipelined.a", "dbuscxx.test.pipelined.b" } );
+
+    TEST_ASSERT_RET_FAIL( conn->is_registered() );
+    TEST_ASSERT_RET_FAIL( !conn->unique_name().empty() );
+    TEST_ASSERT_RET_FAIL( responses.size() == 2 );
+    TEST_ASSERT_RET_FAIL( responses[ 0 ] == DBus::RequestNameResponse::PrimaryOwner );
+    TEST_ASSERT_RET_FAIL( responses[ 1 ] == DBus::RequestNameResponse::PrimaryOwner );
+    TEST_ASSERT_RET_FAIL( sender->name_has_owner( "dbuscxx.test.pipelined.a" ) );
+    TEST_ASSERT_RET_FAIL( sender->name_has_owner( "dbuscxx.test.pipelined.b" ) );
+
+    // Registering again only asks for the new names
+    responses = conn->bus_register( { "dbuscxx.test.pipelined.a" } );
+    TEST_ASSERT_RET_FAIL( responses.size() == 1 );
+    TEST_ASSERT_RET_FAIL( responses[ 0 ] == DBus::RequestNameResponse::AlreadyOwner );
+
+    std::shared_ptr<DBus::Signal<void(int)>> signal =
+        sender->create_free_signal<void(int)>( "/test/pipelined", "dbuscxx.test.pipelined", "Value" );
+    signal->emit( 5 );
+
+    // We are the dispatching thread for this connection
+    for( int x = 0; x < 10 && received.load() == 0; x++ ) {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+        conn->dispatch();
+    }
+
+    TEST_EQUALS_RET_FAIL( received.load(), 5 );
+
+    return true;
+}
+
+bool connection_dispatch_batch(){
+    std::shared_ptr<DBus::Connection> conn = DBus::Connection::create( DBus::BusType::SESSION );
+    std::shared_ptr<DBus::Connection> sender = dispatch->create_connection( DBus::BusType::SESSION );
+    std::atomic<int> received( 0 );
+    const int numSignals = 20;
+
+    std::shared_ptr<DBus::SignalProxy<void(int)>> proxy = conn->create_free_signal_proxy<void(int)>(
+                DBus::MatchRuleBuilder::create()
+                .set_interface( "dbuscxx.test.batch" )
+                .set_member( "Value" )
+                .as_signal_match(),
+                DBus::ThreadForCalling::DispatcherThread );
+    proxy->connect( [&received]( int ){
+        received++;
+    } );
+
+    TEST_ASSERT_RET_FAIL( conn->bus_register() );
+
+    // Anything left over from registering shouldn't count against us
+    while( conn->dispatch( 100 ).status != DBus::DispatchStatus::COMPLETE ) {}
+
+    std::shared_ptr<DBus::Signal<void(int)>> signal =
+        sender->create_free_signal<void(int)>( "/test/batch", "dbuscxx.test.batch", "Value" );
+
+    for( int x = 0; x < numSignals; x++ ) {
+        signal->emit( x );
+    }
+
+    // We are the dispatching thread for this connection; wait for all of
+    // the signals to be waiting for us on the socket
+    std::this_thread::sleep_for( std::chrono::milliseconds( 500 ) );
+
+    DBus::DispatchResult result = conn->dispatch( 5 );
+    TEST_EQUALS_RET_FAIL( result.processed, 5 );
+    TEST_ASSERT_RET_FAIL( result.status == DBus::DispatchStatus::DATA_REMAINS );
+    TEST_EQUALS_RET_FAIL( result.remaining, numSignals - 5 );
+    TEST_EQUALS_RET_FAIL( received.load(), 5 );
+
+    result = conn->dispatch( 100 );
+    TEST_EQUALS_RET_FAIL( result.processed, numSignals - 5 );
+    TEST_ASSERT_RET_FAIL( result.status == DBus::DispatchStatus::COMPLETE );
+    TEST_EQUALS_RET_FAIL( result.remaining, 0 );
+    TEST_EQUALS_RET_FAIL( received.load(), numSignals );
+
+    return true;
+}
+
+bool connection_dispatch_budget_read(){
+    std::shared_ptr<DBus::Connection> conn = DBus::Connection::create( DBus::BusType::SESSION );
+    std::shared_ptr<DBus::Connection> sender = dispatch->create_connection( DBus::BusType::SESSION );
+    std::atomic<int> received( 0 );
+    const int numSignals = 20;
+
+    std::shared_ptr<DBus::SignalProxy<void(int)>> proxy = conn->create_free_signal_proxy<void(int)>(
+                DBus::MatchRuleBuilder::create()
+                .set_interface( "dbuscxx.test.budgetread" )
+                .set_member( "Value" )
+                .as_signal_match(),
+                DBus::ThreadForCalling::DispatcherThread );
+    proxy->connect( [&received]( int ){
+        received++;
+    } );
+
+    TEST_ASSERT_RET_FAIL( conn->bus_register() );
+
+    while( conn->dispatch( 100 ).status != DBus::DispatchStatus::COMPLETE ) {}
+
+    std::shared_ptr<DBus::Signal<void(int)>> signal =
+        sender->create_free_signal<void(int)>( "/test/budgetread", "dbuscxx.test.budgetread", "Value" );
+
+    for( int x = 0; x < numSignals; x++ ) {
+        signal->emit( x );
+    }
+
+    std::this_thread::sleep_for( std::chrono::milliseconds( 500 ) );
+
+    // Reading stops once the budget is used up, so even though nothing is
+    // queued up we can't know that the socket is empty
+    DBus::DispatchResult result = conn->dispatch( numSignals );
+    TEST_EQUALS_RET_FAIL( result.processed, numSignals );
+    TEST_EQUALS_RET_FAIL( result.remaining, 0 );
+    TEST_ASSERT_RET_FAIL( result.status == DBus::DispatchStatus::DATA_REMAINS );
+
+    result = conn->dispatch( 100 );
+    TEST_EQUALS_RET_FAIL( result.processed, 0 );
+    TEST_ASSERT_RET_FAIL( result.status == DBus::DispatchStatus::COMPLETE );
+    TEST_EQUALS_RET_FAIL( received.load(), numSignals );
+
+    return true;
+}
+
+static std::atomic<int> slow_calls( 0 );
+
+static int slow_echo( int value ) {
+    slow_calls++;
+    std::this_thread::sleep_for( std::chrono::milliseconds( 500 ) );
+    return value;
+}
+
+/*
+ * Create the object that the async tests call, on a connection with its own
+ * dispatcher so that slow calls don't hold up the caller.
+ */
+static std::shared_ptr<DBus::Connection> create_async_server( std::shared_ptr<DBus::Dispatcher> serverDispatch ) {
+    std::shared_ptr<DBus::Connection> server = serverDispatch->create_connection( DBus::BusType::SESSION );
+
+    if( server->request_name( "dbuscxx.test.async" ) != DBus::RequestNameResponse::PrimaryOwner ) {
+        return std::shared_ptr<DBus::Connection>();
+    }
+
+    std::shared_ptr<DBus::Object> object = server->create_object( "/test/async", DBus::ThreadForCalling::DispatcherThread );
+    object->create_method<double( double, double )>( "dbuscxx.test.async", "add", sigc::ptr_fun( add ) );
+    object->create_method<int( int )>( "dbuscxx.test.async", "slowEcho", sigc::ptr_fun( slow_echo ) );
+
+    return server;
+}
+
+bool connection_async_calls(){
+    std::shared_ptr<DBus::Dispatcher> serverDispatch = DBus::StandaloneDispatcher::create();
+    std::shared_ptr<DBus::Connection> server = create_async_server( serverDispatch );
+    std::shared_ptr<DBus::Connection> conn = dispatch->create_connection( DBus::BusType::SESSION );
+    const int numCalls = 1000;
+
+    TEST_ASSERT_RET_FAIL( server );
+
+    std::shared_ptr<DBus::ObjectProxy> proxy = conn->create_object_proxy( "dbuscxx.test.async", "/test/async" );
+    std::shared_ptr<DBus::MethodProxy<double( double, double )>> addProxy =
+        proxy->create_method<double( double, double )>( "dbuscxx.test.async", "add" );
+
+    // Everything is sent before we wait for any of the replies
+    std::vector<std::future<double>> results;
+
+    for( int x = 0; x < numCalls; x++ ) {
+        results.push_back( addProxy->call_async( x, 1 ) );
+    }
+
+    for( int x = 0; x < numCalls; x++ ) {
+        TEST_EQUALS_RET_FAIL( results[ x ].get(), x + 1 );
+    }
+
+    std::atomic<int> completed( 0 );
+    std::atomic<double> sum( 0 );
+    std::promise<void> allDone;
+
+    for( int x = 0; x < numCalls; x++ ) {
+        addProxy->call_async( [&]( std::future<double> result ) {
+            sum = sum + result.get();
+
+            if( ++completed == numCalls ) {
+                allDone.set_value();
+            }
+        }, x, 0 );
+    }
+
+    TEST_ASSERT_RET_FAIL( allDone.get_future().wait_for( std::chrono::seconds( 10 ) ) == std::future_status::ready );
+    TEST_EQUALS_RET_FAIL( sum.load(), ( numCalls - 1 ) * numCalls / 2 );
+
+    return true;
+}
+
+bool connection_async_cancel(){
+    std::shared_ptr<DBus::Dispatcher> serverDispatch = DBus::StandaloneDispatcher::create();
+    std::shared_ptr<DBus::Connection> server = create_async_server( serverDispatch );
+    std::shared_ptr<DBus::Connection> conn = dispatch->create_connection( DBus::BusType::SESSION );
+    std::atomic<bool> called( false );
+
+    TEST_ASSERT_RET_FAIL( server );
+
+    std::shared_ptr<DBus::ObjectProxy> proxy = conn->create_object_proxy( "dbuscxx.test.async", "/test/async" );
+    std::shared_ptr<DBus::MethodProxy<int( int )>> echoProxy =
+        proxy->create_method<int( int )>( "dbuscxx.test.async", "slowEcho" );
+
+    std::shared_ptr<DBus::PendingCall> pending = echoProxy->call_async( [&called]( std::future<int> ) {
+        called = true;
+    }, 5 );
+
+    TEST_ASSERT_RET_FAIL( pending );
+    TEST_ASSERT_RET_FAIL( pending->cancel() );
+    TEST_ASSERT_RET_FAIL( pending->is_canceled() );
+    TEST_ASSERT_RET_FAIL( !pending->is_completed() );
+
+    // The server handles calls in order, so once this is back the first reply has come in too
+    std::future<int> after = echoProxy->call_async( 6 );
+    TEST_EQUALS_RET_FAIL( after.get(), 6 );
+    TEST_EQUALS_RET_FAIL( slow_calls.load(), 2 );
+    TEST_ASSERT_RET_FAIL( !called );
+    TEST_ASSERT_RET_FAIL( !pending->reply() );
+
+    return true;
+}
+
+bool connection_async_timeout(){
+    std::shared_ptr<DBus::Dispatcher> serverDispatch = DBus::StandaloneDispatcher::create();
+    std::shared_ptr<DBus::Connection> server = create_async_server( serverDispatch );
+    std::shared_ptr<DBus::Connection> conn = dispatch->create_connection( DBus::BusType::SESSION );
+
+    TEST_ASSERT_RET_FAIL( server );
+
+    std::shared_ptr<DBus::CallMessage> callmsg =
+        DBus::CallMessage::create( "dbuscxx.test.async", "/test/async", "dbuscxx.test.async", "slowEcho" );
+    *callmsg << 5;
+
+    std::shared_ptr<DBus::PendingCall> pending = conn->send_with_reply_async( callmsg, []( std::shared_ptr<DBus::Message> ) {}, 100 );
+
+    TEST_ASSERT_RET_FAIL( pending );
+
+    // Nothing else is going on, so only the timeout can complete this
+    std::shared_ptr<DBus::Message> reply = pending->wait();
+    TEST_ASSERT_RET_FAIL( reply );
+    TEST_ASSERT_RET_FAIL( reply->type() == DBus::MessageType::ERROR );
+    TEST_EQUALS_RET_FAIL( std::static_pointer_cast<DBus::ErrorMessage>( reply )->name(), DBUSCXX_ERROR_NO_REPLY );
+    TEST_EQUALS_RET_FAIL( std::static_pointer_cast<DBus::ErrorMessage>( reply )->reply_serial(), pending->serial() );
+    TEST_ASSERT_RET_FAIL( conn->milliseconds_until_timeout() == -1 );
+
+    return true;
+}
+
+bool connection_blocking_threads(){
+    std::shared_ptr<DBus::Dispatcher> serverDispatch = DBus::StandaloneDispatcher::create();
+    std::shared_ptr<DBus::Connection> server = create_async_server( serverDispatch );
+    std::shared_ptr<DBus::Connection> conn = dispatch->create_connection( DBus::BusType::SESSION );
+    const int numThreads = 16;
+    const int numCalls = 200;
+    std::atomic<int> failures( 0 );
+    std::vector<std::thread> threads;
+
+    TEST_ASSERT_RET_FAIL( server );
+
+    std::shared_ptr<DBus::ObjectProxy> proxy = conn->create_object_proxy( "dbuscxx.test.async", "/test/async" );
+    std::shared_ptr<DBus::MethodProxy<double( double, double )>> addProxy =
+        proxy->create_method<double( double, double )>( "dbuscxx.test.async", "add" );
+
+    for( int x = 0; x < numThreads; x++ ) {
+        threads.push_back( std::thread( [&failures, addProxy, x, numCalls]() {
+            for( int y = 0; y < numCalls; y++ ) {
+                try {
+                    if( ( *addProxy )( x, y ) != x + y ) {
+                        failures++;
+                    }
+                } catch( const DBus::Error& ) {
+                    failures++;
+                }
+            }
+        } ) );
+    }
+
+    for( std::thread& thr : threads ) {
+        thr.join();
+    }
+
+    TEST_EQUALS_RET_FAIL( failures.load(), 0 );
+
+    // More calls than fit into the reply table at once
+    std::vector<std::future<double>> results;
+
+    for( int x = 0; x < 2000; x++ ) {
+        results.push_back( addProxy->call_async( x, 1 ) );
+    }
+
+    for( int x = 0; x < 2000; x++ ) {
+        TEST_EQUALS_RET_FAIL( results[ x ].get(), x + 1 );
+    }
+
+    // A reply that comes in after we gave up on it is thrown away
+    std::shared_ptr<DBus::CallMessage> slowmsg =
+        DBus::CallMessage::create( "dbuscxx.test.async", "/test/async", "dbuscxx.test.async", "slowEcho" );
+    *slowmsg << 5;
+    bool timedOut = false;
+
+    try {
+        conn->send_with_reply_blocking( slowmsg, 100 );
+    } catch( const DBus::ErrorNoReply& ) {
+        timedOut = true;
+    }
+
+    TEST_ASSERT_RET_FAIL( timedOut );
+    TEST_EQUALS_RET_FAIL( ( *addProxy )( 2, 3 ), 5 );
+
+    return true;
+}
+
+bool connection_leader_follower(){
+    std::shared_ptr<DBus::Dispatcher> serverDispatch = DBus::StandaloneDispatcher::create();
+    std::shared_ptr<DBus::Connection> server = create_async_server( serverDispatch );
+    std::shared_ptr<DBus::Connection> conn = dispatch->create_connection( DBus::BusType::SESSION );
+    const int numThreads = 4;
+    const int numCalls = 200;
+    const int numSignals = 50;
+    std::atomic<int> failures( 0 );
+    std::atomic<int> received( 0 );
+    std::vector<std::thread> threads;
+
+    TEST_ASSERT_RET_FAIL( server );
+
+    conn->set_leader_follower_reads( true );
+
+    std::shared_ptr<DBus::SignalProxy<void(int)>> signalProxy = conn->create_free_signal_proxy<void(int)>(
+                DBus::MatchRuleBuilder::create()
+                .set_interface( "dbuscxx.test.leader" )
+                .set_member( "Value" )
+                .as_signal_match(),
+                DBus::ThreadForCalling::DispatcherThread );
+    signalProxy->connect( [&received]( int ){
+        received++;
+    } );
+
+    std::shared_ptr<DBus::ObjectProxy> proxy = conn->create_object_proxy( "dbuscxx.test.async", "/test/async" );
+    std::shared_ptr<DBus::MethodProxy<double( double, double )>> addProxy =
+        proxy->create_method<double( double, double )>( "dbuscxx.test.async", "add" );
+    std::shared_ptr<DBus::MethodProxy<int( int )>> echoProxy =
+        proxy->create_method<int( int )>( "dbuscxx.test.async", "slowEcho" );
+
+    // Whoever reads these replies and signals, the dispatcher has to handle them
+    std::future<int> slow = echoProxy->call_async( 7 );
+    std::shared_ptr<DBus::Signal<void(int)>> signal =
+        server->create_free_signal<void(int)>( "/test/leader", "dbuscxx.test.leader", "Value" );
+
+    for( int x = 0; x < numThreads; x++ ) {
+        threads.push_back( std::thread( [&failures, addProxy, x, numCalls]() {
+            for( int y = 0; y < numCalls; y++ ) {
+                try {
+                    if( ( *addProxy )( x, y ) != x + y ) {
+                        failures++;
+                    }
+                } catch( const DBus::Error& ) {
+                    failures++;
+                }
+            }
+        } ) );
+    }
+
+    for( int x = 0; x < numSignals; x++ ) {
+        signal->emit( x );
+    }
+
+    for( std::thread& thr : threads ) {
+        thr.join();
+    }
+
+    TEST_EQUALS_RET_FAIL( failures.load(), 0 );
+    TEST_EQUALS_RET_FAIL( slow.get(), 7 );
+
+    for( int x = 0; x < 100 && received.load() < numSignals; x++ ) {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    }
+
+    TEST_EQUALS_RET_FAIL( received.load(), numSignals );
+
+    // Giving up on a reply works the same when we read it ourselves
+    bool timedOut = false;
+
+    std::shared_ptr<DBus::CallMessage> slowmsg =
+        DBus::CallMessage::create( "dbuscxx.test.async", "/test/async", "dbuscxx.test.async", "slowEcho" );
+    *slowmsg << 5;
+
+    try {
+        conn->send_with_reply_blocking( slowmsg, 100 );
+    } catch( const DBus::ErrorNoReply& ) {
+        timedOut = true;
+    }
+
+    TEST_ASSERT_RET_FAIL( timedOut );
+    TEST_EQUALS_RET_FAIL( ( *addProxy )( 2, 3 ), 5 );
+
+    return true;
+}
+
+bool connection_leader_wakeup(){
+    std::shared_ptr<DBus::Dispatcher> serverDispatch = DBus::StandaloneDispatcher::create();
+    std::shared_ptr<DBus::Connection> server = create_async_server( serverDispatch );
+    std::shared_ptr<DBus::Connection> conn = dispatch->create_connection( DBus::BusType::SESSION );
+    const int numRounds = 200;
+    std::atomic<int> received( 0 );
+
+    TEST_ASSERT_RET_FAIL( server );
+
+    conn->set_leader_follower_reads( true );
+
+    std::shared_ptr<DBus::SignalProxy<void(int)>> signalProxy = conn->create_free_signal_proxy<void(int)>(
+                DBus::MatchRuleBuilder::create()
+                .set_interface( "dbuscxx.test.leaderwakeup" )
+                .set_member( "Value" )
+                .as_signal_match(),
+                DBus::ThreadForCalling::DispatcherThread );
+    signalProxy->connect( [&received]( int ){
+        received++;
+    } );
+
+    std::shared_ptr<DBus::ObjectProxy> proxy = conn->create_object_proxy( "dbuscxx.test.async", "/test/async" );
+    std::shared_ptr<DBus::MethodProxy<double( double, double )>> addProxy =
+        proxy->create_method<double( double, double )>( "dbuscxx.test.async", "add" );
+    std::shared_ptr<DBus::Signal<void(int)>> signal =
+        server->create_free_signal<void(int)>( "/test/leaderwakeup", "dbuscxx.test.leaderwakeup", "Value" );
+
+    /*
+     * Each signal comes in around the time that we are reading our own reply;
+     * whether or not we read it, the dispatcher has to get to it without any
+     * more traffic coming in.
+     */
+    for( int x = 0; x < numRounds; x++ ) {
+        std::thread emitter( [signal, x]() {
+            std::this_thread::sleep_for( std::chrono::microseconds( ( x * 37 ) % 500 ) );
+            signal->emit( x );
+        } );
+
+        TEST_EQUALS_RET_FAIL( ( *addProxy )( x, 1 ), x + 1 );
+        emitter.join();
+
+        for( int y = 0; y < 200 && received.load() <= x; y++ ) {
+            std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+        }
+
+        TEST_EQUALS_RET_FAIL( received.load(), x + 1 );
+    }
+
+    return true;
+}
+
+bool connection_wakeup_stress(){
+    std::shared_ptr<DBus::Connection> receiver = dispatch->create_connection( DBus::BusType::SESSION );
+    std::atomic<int> received( 0 );
+    const int numThreads = 4;
+    const int numRounds = 2000;
+    std::vector<std::thread> threads;
+
+    std::shared_ptr<DBus::SignalProxy<void(int)>> proxy = receiver->create_free_signal_proxy<void(int)>(
+                DBus::MatchRuleBuilder::create()
+                .set_interface( "dbuscxx.test.wakeup" )
+                .set_member( "Value" )
+                .as_signal_match(),
+                DBus::ThreadForCalling::DispatcherThread );
+    proxy->connect( [&received]( int ){
+        received++;
+    } );
+
+    std::vector<std::shared_ptr<DBus::Connection>> senders;
+
+    for( int x = 0; x < numThreads; x++ ) {
+        senders.push_back( dispatch->create_connection( DBus::BusType::SESSION ) );
+    }
+
+    /*
+     * Every signal is sent from a thread that is not the dispatching thread,
+     * so only the dispatcher writes it out once it is woken up; some of the
+     * wakeups come in while it is still draining the last one.
+     */
+    for( int x = 0; x < numThreads; x++ ) {
+        threads.push_back( std::thread( [numRounds, sender = senders[ x ]]() {
+            std::shared_ptr<DBus::Signal<void(int)>> signal =
+                sender->create_free_signal<void(int)>( "/test/wakeup", "dbuscxx.test.wakeup", "Value" );
+
+            for( int y = 0; y < numRounds; y++ ) {
+                signal->emit( y );
+                std::this_thread::yield();
+            }
+        } ) );
+    }
+
+    for( std::thread& thr : threads ) {
+        thr.join();
+    }
+
+    for( int x = 0; x < 500 && received.load() < numThreads * numRounds; x++ ) {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    }
+
+    TEST_EQUALS_RET_FAIL( received.load(), numThreads * numRounds );
+
+    return true;
+}
+
 #define ADD_TEST(name) do{ if( test_name == STRINGIFY(name) ){ \
             ret = connection_##name();\
         } \
@@ -206,6 +726,16 @@ int main( int argc, char** argv ) {
     ADD_TEST( reparent_1 );
     ADD_TEST( reparent_2 );
     ADD_TEST( remove_obj_in_hierarchy );
+    ADD_TEST( pipelined_register );
+    ADD_TEST( dispatch_batch );
+    ADD_TEST( dispatch_budget_read );
+    ADD_TEST( async_calls );
+    ADD_TEST( async_cancel );
+    ADD_TEST( async_timeout );
+    ADD_TEST( blocking_threads );
+    ADD_TEST( leader_follower );
+    ADD_TEST( leader_wakeup );
+    ADD_TEST( wakeup_stress );
 
     return !ret;
 }
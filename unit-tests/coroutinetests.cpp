@@ -0,0 +1,220 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ *                                                                         *
+ *   The dbus-cxx library is free software; you can redistribute it and/or *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The dbus-cxx library is distributed in the hope that it will be       *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#include <dbus-cxx.h>
+#include <atomic>
+#include <coroutine>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "test_macros.h"
+
+#if !DBUS_CXX_HAS_COROUTINES
+#error "These tests need to be built with coroutine support"
+#endif
+
+static std::shared_ptr<DBus::Dispatcher> dispatch;
+
+/*
+ * The simplest coroutine there is: it starts straight away, and
+ * cleans up after itself when it is done.
+ */
+struct Task {
+    struct promise_type {
+        Task get_return_object() { return Task(); }
+        std::suspend_never initial_suspend() noexcept { return std::suspend_never(); }
+        std::suspend_never final_suspend() noexcept { return std::suspend_never(); }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+struct CallCounts {
+    std::atomic<int> done{ 0 };
+    std::atomic<int> failures{ 0 };
+    std::atomic<int> errors{ 0 };
+};
+
+static double add( double a, double b ) {
+    return a + b;
+}
+
+/* The method proxy only works while the object proxy that it is on still exists */
+static std::shared_ptr<DBus::ObjectProxy> object_proxy;
+
+static std::shared_ptr<DBus::MethodProxy<double( double, double )>> create_add_proxy( const std::string& method_name ) {
+    std::shared_ptr<DBus::Connection> server = dispatch->create_connection( DBus::BusType::SESSION );
+    std::shared_ptr<DBus::Connection> conn = dispatch->create_connection( DBus::BusType::SESSION );
+
+    if( server->request_name( "dbuscxx.test.coroutine" ) != DBus::RequestNameResponse::PrimaryOwner ) {
+        return std::shared_ptr<DBus::MethodProxy<double( double, double )>>();
+    }
+
+    std::shared_ptr<DBus::Object> object = server->create_object( "/test/coroutine", DBus::ThreadForCalling::DispatcherThread );
+    object->create_method<double( double, double )>( "dbuscxx.test.coroutine", "add", sigc::ptr_fun( add ) );
+
+    object_proxy = conn->create_object_proxy( "dbuscxx.test.coroutine", "/test/coroutine" );
+
+    return object_proxy->create_method<double( double, double )>( "dbuscxx.test.coroutine", method_name );
+}
+
+static Task add_numbers( std::shared_ptr<DBus::MethodProxy<double( double, double )>> method, int start, CallCounts* counts ) {
+    for( int x = start; x < start + 10; x++ ) {
+        double result = co_await method->async( x, 1 );
+
+        if( result != x + 1 ) {
+            counts->failures++;
+        }
+    }
+
+    counts->done++;
+}
+
+static Task add_with_error( std::shared_ptr<DBus::MethodProxy<double( double, double )>> method, CallCounts* counts ) {
+    try {
+        co_await method->async( 1, 1 );
+        counts->failures++;
+    } catch( const DBus::Error& ) {
+        counts->errors++;
+    }
+
+    counts->done++;
+}
+
+static Task add_on_executor( std::shared_ptr<DBus::MethodProxy<double( double, double )>> method,
+                             DBus::CallExecutor executor,
+                             std::thread::id expectedThread,
+                             CallCounts* counts ) {
+    for( int x = 0; x < 10; x++ ) {
+        double result = co_await method->async( executor, x, 2 );
+
+        if( result != x + 2 || std::this_thread::get_id() != expectedThread ) {
+            counts->failures++;
+        }
+    }
+
+    counts->done++;
+}
+
+static bool wait_for_done( CallCounts* counts, int expected ) {
+    for( int x = 0; x < 1000 && counts->done.load() < expected; x++ ) {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    }
+
+    return counts->done.load() == expected;
+}
+
+bool coroutine_many_calls() {
+    std::shared_ptr<DBus::MethodProxy<double( double, double )>> method = create_add_proxy( "add" );
+    CallCounts counts;
+    const int numCoroutines = 100;
+
+    TEST_ASSERT_RET_FAIL( method );
+
+    // All of these are in flight at once, without a thread for each one
+    for( int x = 0; x < numCoroutines; x++ ) {
+        add_numbers( method, x * 10, &counts );
+    }
+
+    TEST_ASSERT_RET_FAIL( wait_for_done( &counts, numCoroutines ) );
+    TEST_EQUALS_RET_FAIL( counts.failures.load(), 0 );
+
+    return true;
+}
+
+bool coroutine_error() {
+    std::shared_ptr<DBus::MethodProxy<double( double, double )>> method = create_add_proxy( "doesNotExist" );
+    CallCounts counts;
+
+    TEST_ASSERT_RET_FAIL( method );
+
+    add_with_error( method, &counts );
+
+    TEST_ASSERT_RET_FAIL( wait_for_done( &counts, 1 ) );
+    TEST_EQUALS_RET_FAIL( counts.errors.load(), 1 );
+    TEST_EQUALS_RET_FAIL( counts.failures.load(), 0 );
+
+    return true;
+}
+
+bool coroutine_executor() {
+    std::shared_ptr<DBus::MethodProxy<double( double, double )>> method = create_add_proxy( "add" );
+    CallCounts counts;
+    std::mutex queueLock;
+    std::deque<std::function<void()>> queue;
+
+    TEST_ASSERT_RET_FAIL( method );
+
+    DBus::CallExecutor executor = [&queueLock, &queue]( std::function<void()> fn ) {
+        std::unique_lock<std::mutex> lock( queueLock );
+        queue.push_back( fn );
+    };
+
+    add_on_executor( method, executor, std::this_thread::get_id(), &counts );
+
+    // Resume the coroutine on this thread whenever a reply has come in
+    for( int x = 0; x < 1000 && counts.done.load() == 0; x++ ) {
+        std::function<void()> fn;
+
+        {
+            std::unique_lock<std::mutex> lock( queueLock );
+
+            if( !queue.empty() ) {
+                fn = queue.front();
+                queue.pop_front();
+            }
+        }
+
+        if( fn ) {
+            fn();
+        } else {
+            std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+        }
+    }
+
+    TEST_EQUALS_RET_FAIL( counts.done.load(), 1 );
+    TEST_EQUALS_RET_FAIL( counts.failures.load(), 0 );
+
+    return true;
+}
+
+#define ADD_TEST(name) do{ if( test_name == STRINGIFY(name) ){ \
+            ret = coroutine_##name();\
+        } \
+    } while( 0 )
+
+int main( int argc, char** argv ) {
+    if( argc < 1 ) {
+        return 1;
+    }
+
+    std::string test_name = argv[1];
+    bool ret = false;
+
+    DBus::set_logging_function( DBus::log_std_err );
+    DBus::set_log_level( SL_INFO );
+    dispatch = DBus::StandaloneDispatcher::create();
+
+    ADD_TEST( many_calls );
+    ADD_TEST( error );
+    ADD_TEST( executor );
+
+    return !ret;
+}
@@ -41,6 +41,7 @@ static std::shared_ptr<DBus::MethodProxy<void( std::shared_ptr<DBus::FileDescrip
 static std::shared_ptr<DBus::Object> object;
 static std::shared_ptr<DBus::Method<std::shared_ptr<DBus::FileDescriptor>()>> fd_return_method;
 static std::shared_ptr<DBus::Method<void( std::shared_ptr<DBus::FileDescriptor> )>> fd_set_method;
+static std::shared_ptr<DBus::Method<void( std::shared_ptr<DBus::FileDescriptor>, int )>> fd_set_numbered_method;
 
 void write_to_fd( int fd ) {
     std::this_thread::sleep_for( std::chrono::milliseconds( 250 ) );
@@ -61,6 +62,12 @@ void set_filedescriptor( std::shared_ptr<DBus::FileDescriptor> fd ) {
     std::async( std::launch::async, write_to_fd, fd->descriptor() ).wait();
 }
 
+// Server Function
+void set_numbered_filedescriptor( std::shared_ptr<DBus::FileDescriptor> fd, int number ) {
+    std::string daString = "This is message " + std::to_string( number );
+    ::write( fd->descriptor(), daString.c_str(), daString.length() );
+}
+
 // Client Function
 bool filedescriptor_send() {
     char bytes[ 64 ];
@@ -102,6 +109,50 @@ bool filedescriptor_get() {
     return str.compare( "This is a message" ) == 0;
 }
 
+// Client function
+bool filedescriptor_send_multiple() {
+    const int numMessages = 5;
+    int multiPipes[ numMessages ][ 2 ];
+
+    /*
+     * Send several messages with FDs back-to-back, so that the server is
+     * likely to receive more than one of them with a single read.  Each FD
+     * must end up with the message that it was sent with.
+     */
+    for( int x = 0; x < numMessages; x++ ) {
+        if( pipe( multiPipes[ x ] ) < 0 ) {
+            std::cerr << "Can't create pipe" << std::endl;
+            exit( 1 );
+        }
+
+        std::shared_ptr<DBus::CallMessage> msg =
+            DBus::CallMessage::create( "dbuscxx.test", "/fdtest", "foo.what", "set_numbered_filedescriptor" );
+        msg->set_no_reply();
+        *msg << DBus::FileDescriptor::create( multiPipes[ x ][ 1 ] ) << x;
+        conn->send( msg );
+    }
+
+    for( int x = 0; x < numMessages; x++ ) {
+        char bytes[ 64 ];
+        int bytesGot = ::read( multiPipes[ x ][ 0 ], bytes, 63 );
+
+        if( bytesGot < 0 ) {
+            std::cerr << "Unable to read: " << strerror( errno ) << std::endl;
+            return false;
+        }
+
+        bytes[ bytesGot ] = 0;
+        std::string str( bytes );
+
+        if( str != "This is message " + std::to_string( x ) ) {
+            std::cerr << "Pipe " << x << " got '" << str << "'" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
 void client_setup() {
     proxy = conn->create_object_proxy( "dbuscxx.test", "/fdtest" );
 
@@ -122,6 +173,7 @@ void server_setup() {
     object = conn->create_object( "/fdtest", DBus::ThreadForCalling::DispatcherThread );
     fd_return_method = object->create_method<std::shared_ptr<DBus::FileDescriptor>()>( "foo.what", "get_filedescriptor", sigc::ptr_fun( get_filedescriptor ) );
     fd_set_method = object->create_method<void( std::shared_ptr<DBus::FileDescriptor> )>( "foo.what", "set_filedescriptor", sigc::ptr_fun( set_filedescriptor ) );
+    fd_set_numbered_method = object->create_method<void( std::shared_ptr<DBus::FileDescriptor>, int )>( "foo.what", "set_numbered_filedescriptor", sigc::ptr_fun( set_numbered_filedescriptor ) );
 }
 
 #define ADD_TEST(name) do{ if( test_name == STRINGIFY(name) ){ \
@@ -147,6 +199,7 @@ int main( int argc, char** argv ) {
         client_setup();
         ADD_TEST( send );
         ADD_TEST( get );
+        ADD_TEST( send_multiple );
     } else {
         server_setup();
         ret = true;
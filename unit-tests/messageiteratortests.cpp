@@ -18,10 +18,13 @@
  *   You should have received a copy of the GNU General Public License     *
  *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
  ***************************************************************************/
+#include <atomic>
 #include <cstring>
 #include <unistd.h>
 #include <dbus-cxx.h>
+#include <dbus-cxx/byteswap.h>
 #include <iostream>
+#include <thread>
 
 #include "test_macros.h"
 
@@ -1666,6 +1669,291 @@ bool variant_inside_variant(){
     return true;
 }
 
+bool call_message_append_extract_iterator_zero_copy() {
+    std::vector<uint8_t> bytes( 16384 );
+    std::vector<uint8_t> extracted;
+    std::vector<uint8_t> serialized;
+    std::string str;
+
+    for( size_t x = 0; x < bytes.size(); x++ ) {
+        bytes[ x ] = x & 0xFF;
+    }
+
+    std::shared_ptr<DBus::CallMessage> msg = DBus::CallMessage::create( "/org/freedesktop/DBus", "method" );
+    msg << bytes << std::string( "after the bytes" );
+    msg->serialize_to_vector( &serialized, 5 );
+
+    std::shared_ptr<uint8_t> data( new uint8_t[ serialized.size() ], std::default_delete<uint8_t[]>() );
+    std::memcpy( data.get(), serialized.data(), serialized.size() );
+    std::weak_ptr<uint8_t> weakData = data;
+
+    std::shared_ptr<DBus::Message> received = DBus::Message::create_from_data( data, serialized.size() );
+    data.reset();
+
+    // The message reads its body out of the data, so it must keep it alive
+    TEST_EQUALS_RET_FAIL( weakData.expired(), false );
+
+    received >> extracted >> str;
+    TEST_ASSERT_RET_FAIL( extracted == bytes );
+    TEST_EQUALS_RET_FAIL( str, "after the bytes" );
+
+    received.reset();
+
+    return TEST_EQUALS( weakData.expired(), true );
+}
+
+template <typename T>
+static bool check_inline_variant( T value ) {
+    std::vector<uint8_t> expected;
+    DBus::Marshaling marshal( &expected, DBus::default_endianess() );
+    marshal.marshal( value );
+
+    DBus::Variant var( value );
+    TEST_EQUALS_RET_FAIL( var.marshaled_size(), expected.size() );
+    TEST_ASSERT_RET_FAIL( std::equal( expected.begin(), expected.end(), var.marshaled_data() ) );
+    TEST_ASSERT_RET_FAIL( *var.marshaled() == expected );
+    TEST_ASSERT_RET_FAIL( static_cast<T>( var ) == value );
+
+    DBus::Variant copy( var );
+    TEST_ASSERT_RET_FAIL( copy == var );
+    DBus::Variant moved( std::move( copy ) );
+    TEST_ASSERT_RET_FAIL( moved == var );
+    TEST_ASSERT_RET_FAIL( static_cast<T>( moved ) == value );
+
+    return true;
+}
+
+bool call_message_append_extract_iterator_inline_variants() {
+    DBus::Endianess original = DBus::default_endianess();
+
+    for( DBus::Endianess endian : { DBus::Endianess::Big, DBus::Endianess::Little } ) {
+        DBus::set_default_endianess( endian );
+
+        TEST_ASSERT_RET_FAIL( check_inline_variant<uint8_t>( 0xA5 ) );
+        TEST_ASSERT_RET_FAIL( check_inline_variant<bool>( true ) );
+        TEST_ASSERT_RET_FAIL( check_inline_variant<int16_t>( -1234 ) );
+        TEST_ASSERT_RET_FAIL( check_inline_variant<uint16_t>( 0xBEEF ) );
+        TEST_ASSERT_RET_FAIL( check_inline_variant<int32_t>( -123456 ) );
+        TEST_ASSERT_RET_FAIL( check_inline_variant<uint32_t>( 0xDEADBEEF ) );
+        TEST_ASSERT_RET_FAIL( check_inline_variant<int64_t>( -1234567890123LL ) );
+        TEST_ASSERT_RET_FAIL( check_inline_variant<uint64_t>( 0x0123456789ABCDEFULL ) );
+        TEST_ASSERT_RET_FAIL( check_inline_variant<double>( -3.14159 ) );
+        TEST_ASSERT_RET_FAIL( check_inline_variant<std::string>( "" ) );
+        TEST_ASSERT_RET_FAIL( check_inline_variant<std::string>( "short" ) );
+        TEST_ASSERT_RET_FAIL( check_inline_variant<std::string>( "a string that is far too long to fit inline" ) );
+        TEST_ASSERT_RET_FAIL( check_inline_variant<DBus::Path>( DBus::Path( "/org/freedesktop/DBus" ) ) );
+        TEST_ASSERT_RET_FAIL( check_inline_variant<DBus::Signature>( DBus::Signature( "a{sv}" ) ) );
+    }
+
+    DBus::set_default_endianess( original );
+
+    // Small variants still go through a message correctly
+    std::map<std::string, DBus::Variant> themap;
+    themap[ "byte" ] = DBus::Variant( static_cast<uint8_t>( 7 ) );
+    themap[ "path" ] = DBus::Variant( DBus::Path( "/some/path" ) );
+    themap[ "long" ] = DBus::Variant( std::string( 64, 'x' ) );
+
+    std::shared_ptr<DBus::CallMessage> msg = DBus::CallMessage::create( "/org/freedesktop/DBus", "method" );
+    msg << themap;
+
+    std::map<std::string, DBus::Variant> extracted = msg->begin();
+    TEST_ASSERT_RET_FAIL( extracted == themap );
+    TEST_EQUALS_RET_FAIL( extracted[ "byte" ].to_uint8(), 7 );
+    TEST_EQUALS_RET_FAIL( extracted[ "path" ].to_path(), "/some/path" );
+    TEST_EQUALS_RET_FAIL( extracted[ "long" ].to_string(), std::string( 64, 'x' ) );
+    TEST_EQUALS_RET_FAIL( extracted[ "path" ].signature().str(), "o" );
+
+    return true;
+}
+
+template <typename T>
+static bool check_fixed_array( std::vector<T> values ) {
+    // What the array looks like when it is marshaled one element at a time
+    std::vector<uint8_t> expected;
+    DBus::Marshaling marshal( &expected, DBus::default_endianess() );
+    marshal.marshal( static_cast<uint8_t>( 0x55 ) );
+    marshal.marshal( static_cast<uint32_t>( values.size() * sizeof( T ) ) );
+    marshal.align( sizeof( T ) );
+    for( T value : values ) {
+        marshal.marshal( value );
+    }
+    marshal.marshal( static_cast<uint8_t>( 0xAA ) );
+
+    std::shared_ptr<DBus::CallMessage> msg = DBus::CallMessage::create( "/org/freedesktop/DBus", "method" );
+    msg << static_cast<uint8_t>( 0x55 ) << values << static_cast<uint8_t>( 0xAA );
+    // The body is at the very end of the serialized message
+    std::vector<uint8_t> serialized;
+    msg->serialize_to_vector( &serialized, 1 );
+    TEST_ASSERT_RET_FAIL( serialized.size() > expected.size() );
+    TEST_ASSERT_RET_FAIL( std::equal( expected.begin(), expected.end(), serialized.end() - expected.size() ) );
+
+    std::vector<T> extracted;
+    uint8_t before = 0;
+    uint8_t after = 0;
+    DBus::MessageIterator iter( msg );
+    iter >> before >> extracted >> after;
+
+    TEST_EQUALS_RET_FAIL( before, 0x55 );
+    TEST_ASSERT_RET_FAIL( extracted == values );
+    TEST_EQUALS_RET_FAIL( after, 0xAA );
+
+    return true;
+}
+
+bool call_message_append_extract_iterator_inline_variant_threads() {
+    std::vector<uint8_t> expected;
+    DBus::Marshaling marshal( &expected, DBus::default_endianess() );
+    marshal.marshal( static_cast<uint32_t>( 0xDEADBEEF ) );
+
+    // Every thread copies the inline data out at the same time
+    for( int round = 0; round < 100; round++ ) {
+        const DBus::Variant var( static_cast<uint32_t>( 0xDEADBEEF ) );
+        std::atomic<int> matched( 0 );
+        std::vector<std::thread> threads;
+
+        for( int x = 0; x < 4; x++ ) {
+            threads.emplace_back( [&var, &expected, &matched](){
+                if( *var.marshaled() == expected ) {
+                    matched++;
+                }
+            } );
+        }
+
+        for( std::thread& t : threads ) {
+            t.join();
+        }
+
+        TEST_EQUALS_RET_FAIL( matched.load(), 4 );
+    }
+
+    return true;
+}
+
+bool call_message_append_extract_iterator_fixed_arrays() {
+    DBus::Endianess original = DBus::default_endianess();
+    std::vector<uint8_t> bytes( 100000 );
+
+    // Long enough to go through the vectorized byte swapping, with some left over
+    std::vector<int16_t> shorts( 1001 );
+    std::vector<uint32_t> ints( 1001 );
+    std::vector<uint64_t> longs( 1001 );
+    std::vector<double> doubles( 1001 );
+
+    for( size_t x = 0; x < bytes.size(); x++ ) {
+        bytes[ x ] = x * 7;
+    }
+
+    for( size_t x = 0; x < ints.size(); x++ ) {
+        shorts[ x ] = x * -31;
+        ints[ x ] = x * 0x01020304;
+        longs[ x ] = x * 0x0102030405060708ULL;
+        doubles[ x ] = x * 1.25;
+    }
+
+    for( DBus::Endianess endian : { DBus::Endianess::Big, DBus::Endianess::Little } ) {
+        DBus::set_default_endianess( endian );
+
+        TEST_ASSERT_RET_FAIL( check_fixed_array<uint8_t>( bytes ) );
+        TEST_ASSERT_RET_FAIL( check_fixed_array<int16_t>( { -1, 2, -300, 0x7FFF } ) );
+        TEST_ASSERT_RET_FAIL( check_fixed_array<uint16_t>( { 1, 0xBEEF, 0xFF00 } ) );
+        TEST_ASSERT_RET_FAIL( check_fixed_array<int32_t>( { -5, 0x12345678, 0 } ) );
+        TEST_ASSERT_RET_FAIL( check_fixed_array<uint32_t>( { 0xDEADBEEF, 1, 2, 3, 4 } ) );
+        TEST_ASSERT_RET_FAIL( check_fixed_array<int64_t>( { -1234567890123LL, 42 } ) );
+        TEST_ASSERT_RET_FAIL( check_fixed_array<uint64_t>( { 0x0123456789ABCDEFULL } ) );
+        TEST_ASSERT_RET_FAIL( check_fixed_array<double>( { 1.5, -2.25, 1e300 } ) );
+        TEST_ASSERT_RET_FAIL( check_fixed_array<uint64_t>( {} ) );
+        TEST_ASSERT_RET_FAIL( check_fixed_array<double>( {} ) );
+        TEST_ASSERT_RET_FAIL( check_fixed_array<int16_t>( shorts ) );
+        TEST_ASSERT_RET_FAIL( check_fixed_array<uint32_t>( ints ) );
+        TEST_ASSERT_RET_FAIL( check_fixed_array<uint64_t>( longs ) );
+        TEST_ASSERT_RET_FAIL( check_fixed_array<double>( doubles ) );
+    }
+
+    DBus::set_default_endianess( original );
+
+    return true;
+}
+
+bool call_message_append_extract_iterator_views() {
+    DBus::Endianess original = DBus::default_endianess();
+    std::vector<uint8_t> bytes = { 1, 2, 3, 4, 5 };
+    std::vector<int32_t> ints = { -1, 0x12345678, 42 };
+
+    DBus::set_default_endianess( DBus::priv::host_endianess() );
+
+    std::shared_ptr<DBus::CallMessage> msg = DBus::CallMessage::create( "/org/freedesktop/DBus", "method" );
+    msg << std::string( "key" ) << DBus::Path( "/some/path" ) << DBus::Signature( "a{sv}" ) << bytes << ints;
+
+    std::string_view str;
+    std::string_view path;
+    std::string_view sig;
+    DBus::ArrayView<uint8_t> bytesView;
+    DBus::ArrayView<int32_t> intsView;
+    DBus::MessageIterator iter( msg );
+    iter >> str >> path >> sig >> bytesView >> intsView;
+
+    TEST_ASSERT_RET_FAIL( str == "key" );
+    TEST_ASSERT_RET_FAIL( path == "/some/path" );
+    TEST_ASSERT_RET_FAIL( sig == "a{sv}" );
+    TEST_ASSERT_RET_FAIL( bytesView.to_vector() == bytes );
+    TEST_ASSERT_RET_FAIL( intsView.to_vector() == ints );
+
+    // The views point into the message itself; nothing is copied
+    DBus::MessageIterator iter2( msg );
+    TEST_ASSERT_RET_FAIL( iter2.get_string_view().data() == str.data() );
+
+    // Arrays in the other byte order can't be used in place
+    DBus::set_default_endianess( DBus::priv::host_endianess() == DBus::Endianess::Big ?
+                                 DBus::Endianess::Little : DBus::Endianess::Big );
+    std::shared_ptr<DBus::CallMessage> swapped = DBus::CallMessage::create( "/org/freedesktop/DBus", "method" );
+    swapped << bytes << ints;
+    DBus::set_default_endianess( original );
+
+    DBus::MessageIterator iter3( swapped );
+    iter3 >> bytesView;
+    TEST_ASSERT_RET_FAIL( bytesView.to_vector() == bytes );
+
+    bool threw = false;
+    try {
+        iter3 >> intsView;
+    } catch( DBus::ErrorInvalidTypecast& ) {
+        threw = true;
+    }
+    TEST_ASSERT_RET_FAIL( threw );
+
+    // A message read out of a buffer in place can have its arrays anywhere
+    DBus::set_default_endianess( DBus::priv::host_endianess() );
+    std::shared_ptr<DBus::CallMessage> aligned = DBus::CallMessage::create( "/org/freedesktop/DBus", "method" );
+    std::vector<uint8_t> marshaled;
+    aligned << ints << std::string( "after" );
+    TEST_ASSERT_RET_FAIL( aligned->serialize_to_vector( &marshaled, 5 ) );
+    DBus::set_default_endianess( original );
+
+    std::shared_ptr<uint8_t> buffer( new uint8_t[ marshaled.size() + 1 ], std::default_delete<uint8_t[]>() );
+    std::copy( marshaled.begin(), marshaled.end(), buffer.get() + 1 );
+    std::shared_ptr<const uint8_t> oddData( buffer, buffer.get() + 1 );
+    std::shared_ptr<DBus::Message> misaligned = DBus::Message::create_from_data( oddData, marshaled.size() );
+    TEST_ASSERT_RET_FAIL( misaligned );
+
+    DBus::MessageIterator iter4( misaligned );
+    threw = false;
+    try {
+        iter4 >> intsView;
+    } catch( DBus::ErrorInvalidTypecast& ) {
+        threw = true;
+    }
+    TEST_ASSERT_RET_FAIL( threw );
+
+    // Nothing was consumed, so the array can still be copied out
+    std::vector<int32_t> copied;
+    std::string after;
+    iter4 >> copied >> after;
+    TEST_ASSERT_RET_FAIL( copied == ints );
+    TEST_ASSERT_RET_FAIL( after == "after" );
+
+    return true;
+}
+
 int test_array_of_dict(){
     std::shared_ptr<DBus::ReturnMessage> retmsg = DBus::ReturnMessage::create();
 
@@ -1743,6 +2031,11 @@ int main( int argc, char** argv ) {
     ADD_TEST( complex_variants3 );
     ADD_TEST( variant_deep );
     ADD_TEST( variant_array );
+    ADD_TEST( zero_copy );
+    ADD_TEST( inline_variants );
+    ADD_TEST( inline_variant_threads );
+    ADD_TEST( fixed_arrays );
+    ADD_TEST( views );
 
     ADD_TEST2( bool );
     ADD_TEST2( byte );
@@ -0,0 +1,249 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ *                                                                         *
+ *   The dbus-cxx library is free software; you can redistribute it and/or *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The dbus-cxx library is distributed in the hope that it will be       *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#include <dbus-cxx.h>
+#include <algorithm>
+#include <memory_resource>
+
+#include "test_macros.h"
+
+bool message_lazy_headers() {
+    std::vector<uint8_t> serialized;
+    std::vector<uint8_t> reserialized;
+    int value = 0;
+
+    std::shared_ptr<DBus::SignalMessage> msg = DBus::SignalMessage::create( "/some/path", "some.interface", "Member" );
+    msg->set_destination( "some.destination" );
+    msg << 42;
+    msg->serialize_to_vector( &serialized, 7 );
+
+    std::shared_ptr<DBus::Message> received = DBus::Message::create_from_data( serialized.data(), serialized.size() );
+
+    // The headers are decoded later, so they must not depend on the data we passed in
+    std::fill( serialized.begin(), serialized.end(), 0 );
+
+    TEST_ASSERT_RET_FAIL( received->type() == DBus::MessageType::SIGNAL );
+    std::shared_ptr<DBus::SignalMessage> signal = std::static_pointer_cast<DBus::SignalMessage>( received );
+    TEST_EQUALS_RET_FAIL( signal->member(), "Member" );
+    TEST_EQUALS_RET_FAIL( signal->path(), "/some/path" );
+    TEST_EQUALS_RET_FAIL( signal->interface_name(), "some.interface" );
+    TEST_EQUALS_RET_FAIL( signal->destination(), "some.destination" );
+    TEST_EQUALS_RET_FAIL( signal->signature(), "i" );
+    TEST_EQUALS_RET_FAIL( signal->serial(), 7u );
+    TEST_ASSERT_RET_FAIL( signal->header_field( DBus::MessageHeaderFields::Sender ).type() == DBus::DataType::INVALID );
+
+    received >> value;
+    TEST_EQUALS_RET_FAIL( value, 42 );
+
+    // A field that was never looked at still has to make it back out
+    serialized.clear();
+    msg->serialize_to_vector( &serialized, 8 );
+    std::shared_ptr<DBus::Message> received2 = DBus::Message::create_from_data( serialized.data(), serialized.size() );
+    received2->set_header_field( DBus::MessageHeaderFields::Member, DBus::Variant( std::string( "Other" ) ) );
+    received2->serialize_to_vector( &reserialized, 8 );
+
+    std::shared_ptr<DBus::Message> received3 = DBus::Message::create_from_data( reserialized.data(), reserialized.size() );
+    TEST_EQUALS_RET_FAIL( received3->header_field( DBus::MessageHeaderFields::Member ).to_string(), "Other" );
+    TEST_EQUALS_RET_FAIL( received3->header_field( DBus::MessageHeaderFields::Path ).to_path(), "/some/path" );
+    TEST_EQUALS_RET_FAIL( received3->destination(), "some.destination" );
+
+    return true;
+}
+
+bool message_signal_prototype() {
+    std::shared_ptr<DBus::SignalMessage> prototype = DBus::SignalMessage::create( "/some/path", "some.interface", "Member" );
+    prototype->set_destination( "some.destination" );
+
+    for( int x = 0; x < 3; x++ ) {
+        std::vector<uint8_t> expected;
+        std::vector<uint8_t> fromPrototype;
+
+        std::shared_ptr<DBus::SignalMessage> normal = DBus::SignalMessage::create( "/some/path", "some.interface", "Member" );
+        normal->set_destination( "some.destination" );
+        normal << x << std::string( "value" );
+        normal->serialize_to_vector( &expected, 10 + x );
+
+        std::shared_ptr<DBus::SignalMessage> signal = DBus::SignalMessage::create( prototype );
+        signal << x << std::string( "value" );
+        TEST_EQUALS_RET_FAIL( signal->member(), "Member" );
+        TEST_EQUALS_RET_FAIL( signal->destination(), "some.destination" );
+        signal->serialize_to_vector( &fromPrototype, 10 + x );
+
+        // Sending the same signal again must come out exactly the same as building it by hand
+        TEST_ASSERT_RET_FAIL( expected == fromPrototype );
+    }
+
+    // A different body signature gets its own header
+    std::vector<uint8_t> expected;
+    std::vector<uint8_t> fromPrototype;
+    std::shared_ptr<DBus::SignalMessage> normal = DBus::SignalMessage::create( "/some/path", "some.interface", "Member" );
+    normal->set_destination( "some.destination" );
+    normal << 1.5;
+    normal->serialize_to_vector( &expected, 20 );
+
+    std::shared_ptr<DBus::SignalMessage> signal = DBus::SignalMessage::create( prototype );
+    signal << 1.5;
+    signal->serialize_to_vector( &fromPrototype, 20 );
+    TEST_ASSERT_RET_FAIL( expected == fromPrototype );
+
+    // Changing the header of one signal does not change the prototype
+    signal->set_member( "Other" );
+    TEST_EQUALS_RET_FAIL( signal->member(), "Other" );
+    TEST_EQUALS_RET_FAIL( signal->path(), "/some/path" );
+    TEST_EQUALS_RET_FAIL( prototype->member(), "Member" );
+
+    fromPrototype.clear();
+    signal->serialize_to_vector( &fromPrototype, 20 );
+    std::shared_ptr<DBus::Message> received = DBus::Message::create_from_data( fromPrototype.data(), fromPrototype.size() );
+    TEST_EQUALS_RET_FAIL( std::static_pointer_cast<DBus::SignalMessage>( received )->member(), "Other" );
+
+    return true;
+}
+
+/* Counts how much memory is taken from it, getting the memory from the heap */
+class CountingResource : public std::pmr::memory_resource {
+public:
+    size_t allocations = 0;
+
+private:
+    void* do_allocate( size_t bytes, size_t alignment ) override {
+        allocations++;
+        return std::pmr::new_delete_resource()->allocate( bytes, alignment );
+    }
+
+    void do_deallocate( void* p, size_t bytes, size_t alignment ) override {
+        std::pmr::new_delete_resource()->deallocate( p, bytes, alignment );
+    }
+
+    bool do_is_equal( const std::pmr::memory_resource& other ) const noexcept override {
+        return this == &other;
+    }
+};
+
+bool message_pmr() {
+    CountingResource messageResource;
+    CountingResource dataResource;
+    std::pmr::string str( "a string that is too long to be stored inline", &dataResource );
+    std::pmr::vector<int32_t> ints( { 1, -2, 3 }, &dataResource );
+    std::pmr::vector<std::pmr::string> strings( &dataResource );
+    std::pmr::map<std::pmr::string, int32_t> dict( &dataResource );
+
+    strings.emplace_back( "first" );
+    strings.emplace_back( "second" );
+    dict.emplace( "one", 1 );
+    dict.emplace( "two", 2 );
+
+    std::shared_ptr<DBus::CallMessage> msg = DBus::CallMessage::create( "/org/freedesktop/DBus", "method" );
+    msg->set_memory_resource( &messageResource );
+    TEST_ASSERT_RET_FAIL( msg->memory_resource() == &messageResource );
+
+    msg << str << ints << strings << dict;
+    TEST_EQUALS_RET_FAIL( msg->signature().str(), std::string( "saiasa{si}" ) );
+    TEST_ASSERT_RET_FAIL( messageResource.allocations > 0 );
+
+    CountingResource extractResource;
+    std::pmr::string extractedStr( &extractResource );
+    std::pmr::vector<int32_t> extractedInts( &extractResource );
+    std::pmr::vector<std::pmr::string> extractedStrings( &extractResource );
+    std::pmr::map<std::pmr::string, int32_t> extractedDict( &extractResource );
+
+    msg >> extractedStr >> extractedInts >> extractedStrings >> extractedDict;
+
+    TEST_ASSERT_RET_FAIL( extractedStr == str );
+    TEST_ASSERT_RET_FAIL( extractedInts == ints );
+    TEST_ASSERT_RET_FAIL( extractedStrings == strings );
+    TEST_ASSERT_RET_FAIL( extractedDict == dict );
+    TEST_ASSERT_RET_FAIL( extractedStrings[ 1 ].get_allocator().resource() == &extractResource );
+    TEST_ASSERT_RET_FAIL( extractResource.allocations > 0 );
+
+    // The message is the same as one made on the heap
+    std::shared_ptr<DBus::CallMessage> heapMsg = DBus::CallMessage::create( "/org/freedesktop/DBus", "method" );
+    heapMsg << std::string( str ) << std::vector<int32_t>( ints.begin(), ints.end() )
+            << std::vector<std::string>{ "first", "second" }
+            << std::map<std::string, int32_t>{ { "one", 1 }, { "two", 2 } };
+
+    std::vector<uint8_t> serialized;
+    std::vector<uint8_t> heapSerialized;
+    msg->serialize_to_vector( &serialized, 1 );
+    heapMsg->serialize_to_vector( &heapSerialized, 1 );
+    TEST_ASSERT_RET_FAIL( serialized == heapSerialized );
+
+    return true;
+}
+
+bool message_pooled_messages() {
+    std::vector<uint8_t> expected;
+    std::vector<uint8_t> serialized;
+
+    {
+        std::shared_ptr<DBus::CallMessage> fresh = DBus::CallMessage::create( "/path", "method" );
+        fresh << std::string( "value" );
+        fresh->serialize_to_vector( &expected, 5 );
+    }
+
+    for( int x = 0; x < 10; x++ ) {
+        // These are recycled into the message after them; nothing must carry over
+        std::shared_ptr<DBus::SignalMessage> signal =
+            DBus::SignalMessage::create( "/other/path", "org.example.Interface", "Signal" );
+        signal->set_destination( "org.example.destination" );
+        signal << std::vector<int32_t>( 1000, x ) << std::string( "big" );
+        signal.reset();
+
+        std::shared_ptr<DBus::CallMessage> msg = DBus::CallMessage::create( "/path", "method" );
+        TEST_EQUALS_RET_FAIL( msg->signature().str(), std::string() );
+        TEST_EQUALS_RET_FAIL( msg->destination(), std::string() );
+        TEST_EQUALS_RET_FAIL( msg->flags(), 0 );
+        TEST_EQUALS_RET_FAIL( msg->serial(), 0u );
+
+        msg << std::string( "value" );
+        serialized.clear();
+        msg->serialize_to_vector( &serialized, 5 );
+        TEST_ASSERT_RET_FAIL( serialized == expected );
+
+        std::string value;
+        msg >> value;
+        TEST_EQUALS_RET_FAIL( value, std::string( "value" ) );
+    }
+
+    return true;
+}
+
+#define ADD_TEST(name) do{ if( test_name == STRINGIFY(name) ){ \
+            ret = message_##name();\
+        } \
+    } while( 0 )
+
+int main( int argc, char** argv ) {
+    if( argc < 2 ) {
+        return 1;
+    }
+
+    std::string test_name(argv[1]);
+    bool ret = false;
+
+    DBus::set_logging_function( DBus::log_std_err );
+    DBus::set_log_level( SL_TRACE );
+
+    ADD_TEST( lazy_headers );
+    ADD_TEST( signal_prototype );
+    ADD_TEST( pmr );
+    ADD_TEST( pooled_messages );
+
+    return !ret;
+}
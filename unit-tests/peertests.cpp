@@ -0,0 +1,399 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+// SPDX-License-Identifier: LGPL-3.0-or-later OR BSD-3-Clause
+/***************************************************************************
+ *   Copyright (C) 2020 by Robert Middleton                                *
+ *   robert.middleton@rm5248.com                                           *
+ *                                                                         *
+ *   This file is part of the dbus-cxx library.                            *
+ *                                                                         *
+ *   The dbus-cxx library is free software; you can redistribute it and/or *
+ *   modify it under the terms of the GNU General Public License           *
+ *   version 3 as published by the Free Software Foundation.               *
+ *                                                                         *
+ *   The dbus-cxx library is distributed in the hope that it will be       *
+ *   useful, but WITHOUT ANY WARRANTY; without even the implied warranty   *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU   *
+ *   General Public License for more details.                              *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+#include <dbus-cxx.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "test_macros.h"
+
+static std::shared_ptr<DBus::Dispatcher> dispatch;
+static std::atomic<int> signal_rx( 0 );
+
+static int add( int a, int b ) {
+    return a + b;
+}
+
+static void sigHandle( int value ) {
+    signal_rx += value;
+}
+
+static std::string test_address() {
+    return "unix:abstract=dbuscxx-peer-test-" + std::to_string( getpid() );
+}
+
+/**
+ * Connect a client to the server, returning the client and the server side
+ * connections.  Both of them are added to our dispatcher.
+ */
+static std::tuple<std::shared_ptr<DBus::Connection>, std::shared_ptr<DBus::Connection>>
+connect_to_server( std::shared_ptr<DBus::Server> server ) {
+    std::shared_ptr<DBus::Connection> serverConn;
+    std::thread acceptThread( [&serverConn, server]() {
+        serverConn = server->accept();
+    } );
+
+    std::shared_ptr<DBus::Connection> clientConn = DBus::Connection::create_peer( server->address() );
+    acceptThread.join();
+
+    if( !clientConn->is_valid() || !serverConn || !serverConn->is_valid() ) {
+        return std::make_tuple( std::shared_ptr<DBus::Connection>(), std::shared_ptr<DBus::Connection>() );
+    }
+
+    dispatch->add_connection( clientConn );
+    dispatch->add_connection( serverConn );
+
+    return std::make_tuple( clientConn, serverConn );
+}
+
+bool peer_connect() {
+    std::shared_ptr<DBus::Server> server = DBus::Server::create( test_address() );
+    TEST_ASSERT_RET_FAIL( server->is_valid() );
+    TEST_ASSERT_RET_FAIL( server->address().find( ",guid=" ) != std::string::npos );
+
+    auto [client, serverConn] = connect_to_server( server );
+    TEST_ASSERT_RET_FAIL( client );
+    TEST_ASSERT_RET_FAIL( client->is_peer_to_peer() );
+    TEST_ASSERT_RET_FAIL( serverConn->is_peer_to_peer() );
+    TEST_ASSERT_RET_FAIL( client->is_registered() );
+    TEST_ASSERT_RET_FAIL( client->unique_name().empty() );
+
+    return true;
+}
+
+bool peer_method_call() {
+    std::shared_ptr<DBus::Server> server = DBus::Server::create( test_address() );
+    auto [client, serverConn] = connect_to_server( server );
+    TEST_ASSERT_RET_FAIL( client );
+
+    std::shared_ptr<DBus::Object> obj = serverConn->create_object( "/test", DBus::ThreadForCalling::DispatcherThread );
+    obj->create_method<int( int, int )>( "dbuscxx.peer", "add", sigc::ptr_fun( add ) );
+
+    std::shared_ptr<DBus::ObjectProxy> proxy = client->create_object_proxy( "/test" );
+    std::shared_ptr<DBus::MethodProxy<int( int, int )>> method =
+        proxy->create_method<int( int, int )>( "dbuscxx.peer", "add" );
+
+    for( int x = 0; x < 100; x++ ) {
+        TEST_EQUALS_RET_FAIL( ( *method )( x, 5 ), x + 5 );
+    }
+
+    return true;
+}
+
+bool peer_signal_txrx() {
+    std::shared_ptr<DBus::Server> server = DBus::Server::create( test_address() );
+    auto [client, serverConn] = connect_to_server( server );
+    TEST_ASSERT_RET_FAIL( client );
+
+    std::shared_ptr<DBus::SignalProxy<void(int)>> proxy = client->create_free_signal_proxy<void(int)>(
+                DBus::MatchRuleBuilder::create()
+                .set_path( "/test/signal" )
+                .set_interface( "dbuscxx.peer" )
+                .set_member( "Value" )
+                .as_signal_match(),
+                DBus::ThreadForCalling::DispatcherThread );
+    proxy->connect( sigc::ptr_fun( sigHandle ) );
+
+    std::shared_ptr<DBus::Signal<void(int)>> signal =
+        serverConn->create_free_signal<void(int)>( "/test/signal", "dbuscxx.peer", "Value" );
+
+    for( int x = 1; x <= 10; x++ ) {
+        signal->emit( x );
+    }
+
+    for( int waited = 0; waited < 100 && signal_rx < 55; waited++ ) {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    }
+
+    TEST_EQUALS_RET_FAIL( signal_rx, 55 );
+
+    return true;
+}
+
+bool peer_no_bus_names() {
+    std::shared_ptr<DBus::Server> server = DBus::Server::create( test_address() );
+    auto [client, serverConn] = connect_to_server( server );
+    TEST_ASSERT_RET_FAIL( client );
+
+    try {
+        client->request_name( "dbuscxx.peer.name" );
+    } catch( DBus::ErrorNotSupported& ) {
+        return true;
+    }
+
+    return false;
+}
+
+bool peer_path_address() {
+    std::string path = "/tmp/dbuscxx-peer-test-" + std::to_string( getpid() );
+    struct stat statbuf;
+
+    {
+        std::shared_ptr<DBus::Server> server = DBus::Server::create( "unix:path=" + path );
+        TEST_ASSERT_RET_FAIL( server->is_valid() );
+        TEST_ASSERT_RET_FAIL( stat( path.c_str(), &statbuf ) == 0 );
+
+        auto [client, serverConn] = connect_to_server( server );
+        TEST_ASSERT_RET_FAIL( client );
+    }
+
+    // The socket goes away with the server
+    TEST_ASSERT_RET_FAIL( stat( path.c_str(), &statbuf ) < 0 );
+
+    return true;
+}
+
+bool peer_address_in_use() {
+    std::shared_ptr<DBus::Server> server = DBus::Server::create( test_address() );
+    std::shared_ptr<DBus::Server> server2 = DBus::Server::create( test_address() );
+
+    TEST_ASSERT_RET_FAIL( server->is_valid() );
+    TEST_ASSERT_RET_FAIL( !server2->is_valid() );
+
+    return true;
+}
+
+bool peer_async_disconnect() {
+    std::shared_ptr<DBus::Server> server = DBus::Server::create( test_address() );
+    TEST_ASSERT_RET_FAIL( server->is_valid() );
+
+    // The server side is never dispatched, so it never answers our calls
+    std::shared_ptr<DBus::Connection> serverConn;
+    std::thread acceptThread( [&serverConn, server]() {
+        serverConn = server->accept();
+    } );
+    std::shared_ptr<DBus::Connection> client = DBus::Connection::create_peer( server->address() );
+    acceptThread.join();
+
+    TEST_ASSERT_RET_FAIL( client->is_valid() );
+    TEST_ASSERT_RET_FAIL( serverConn );
+    dispatch->add_connection( client );
+
+    std::shared_ptr<DBus::CallMessage> callmsg =
+        DBus::CallMessage::create( "/test", "dbuscxx.peer", "add" );
+    *callmsg << 1 << 2;
+    std::shared_ptr<DBus::PendingCall> pending =
+        client->send_with_reply_async_notimeout( callmsg, []( std::shared_ptr<DBus::Message> ) {} );
+    TEST_ASSERT_RET_FAIL( pending );
+
+    // Wait for the call to make it out before hanging up
+    for( int waited = 0; waited < 100 && client->has_messages_to_send(); waited++ ) {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    }
+
+    serverConn.reset();
+
+    // Once the other side is gone, the call can never complete normally
+    std::shared_ptr<DBus::Message> reply = pending->wait();
+    TEST_ASSERT_RET_FAIL( reply );
+    TEST_ASSERT_RET_FAIL( reply->type() == DBus::MessageType::ERROR );
+    TEST_EQUALS_RET_FAIL( std::static_pointer_cast<DBus::ErrorMessage>( reply )->name(), DBUSCXX_ERROR_DISCONNECTED );
+
+    // The same goes for calls that are still pending when we go away
+    std::shared_ptr<DBus::Connection> serverConn2;
+    std::thread acceptThread2( [&serverConn2, server]() {
+        serverConn2 = server->accept();
+    } );
+    std::shared_ptr<DBus::Connection> client2 = DBus::Connection::create_peer( server->address() );
+    std::shared_ptr<DBus::PendingCall> pending2;
+    acceptThread2.join();
+
+    if( client2->is_valid() ) {
+        pending2 = client2->send_with_reply_async_notimeout( callmsg, []( std::shared_ptr<DBus::Message> ) {} );
+    }
+
+    TEST_ASSERT_RET_FAIL( pending2 );
+    client2.reset();
+    TEST_ASSERT_RET_FAIL( pending2->is_completed() );
+    reply = pending2->reply();
+    TEST_ASSERT_RET_FAIL( reply && reply->type() == DBus::MessageType::ERROR );
+
+    return true;
+}
+
+/**
+ * Connect to the server without the library, so that we can misbehave.
+ *
+ * @param address The test_address() that the server is listening on
+ * @return The socket, or -1 on error
+ */
+static int connect_raw( const std::string& address ) {
+    std::string abstractName = address.substr( strlen( "unix:abstract=" ) );
+    struct sockaddr_un addr;
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sun_family = AF_UNIX;
+    memcpy( addr.sun_path + 1, abstractName.c_str(), abstractName.size() );
+
+    int fd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+
+    if( fd < 0 ) {
+        return -1;
+    }
+
+    if( connect( fd, reinterpret_cast<struct sockaddr*>( &addr ),
+            offsetof( struct sockaddr_un, sun_path ) + 1 + abstractName.size() ) < 0 ) {
+        close( fd );
+        return -1;
+    }
+
+    return fd;
+}
+
+bool peer_stalled_client() {
+    std::shared_ptr<DBus::Server> server = DBus::Server::create( test_address() );
+    TEST_ASSERT_RET_FAIL( server->is_valid() );
+    server->set_authentication_timeout( 500 );
+
+    // Start to authenticate, and then stop
+    int staller = connect_raw( test_address() );
+    TEST_ASSERT_RET_FAIL( staller >= 0 );
+    TEST_ASSERT_RET_FAIL( write( staller, "\0AUTH EXT", 10 ) == 10 );
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::shared_ptr<DBus::Connection> stalledConn = server->accept();
+    std::chrono::steady_clock::duration taken = std::chrono::steady_clock::now() - start;
+    close( staller );
+
+    TEST_ASSERT_RET_FAIL( !stalledConn );
+    TEST_ASSERT_RET_FAIL( taken < std::chrono::seconds( 5 ) );
+
+    // The server still takes clients that do authenticate
+    auto [client, serverConn] = connect_to_server( server );
+    TEST_ASSERT_RET_FAIL( client );
+
+    return true;
+}
+
+bool peer_stalled_client_doesnt_block() {
+    std::shared_ptr<DBus::Server> server = DBus::Server::create( test_address() );
+    TEST_ASSERT_RET_FAIL( server->is_valid() );
+    server->set_authentication_timeout( 10000 );
+
+    // This one connects first, but never finishes authenticating
+    int staller = connect_raw( test_address() );
+    TEST_ASSERT_RET_FAIL( staller >= 0 );
+    TEST_ASSERT_RET_FAIL( write( staller, "\0AUTH EXT", 10 ) == 10 );
+
+    // A client that does authenticate gets in without waiting for it
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    auto [client, serverConn] = connect_to_server( server );
+    std::chrono::steady_clock::duration taken = std::chrono::steady_clock::now() - start;
+    close( staller );
+
+    TEST_ASSERT_RET_FAIL( client );
+    TEST_ASSERT_RET_FAIL( taken < std::chrono::seconds( 5 ) );
+
+    return true;
+}
+
+bool peer_foreign_user() {
+    if( getuid() != 0 ) {
+        // We need to be able to connect as somebody else
+        return true;
+    }
+
+    // The child has a different pid, and so a different test_address()
+    std::string address = test_address();
+    std::shared_ptr<DBus::Server> server = DBus::Server::create( address );
+    TEST_ASSERT_RET_FAIL( server->is_valid() );
+
+    std::shared_ptr<DBus::Connection> serverConn;
+    std::thread acceptThread( [&serverConn, server]() {
+        serverConn = server->accept();
+    } );
+
+    pid_t child = fork();
+
+    if( child == 0 ) {
+        // Connect as nobody, and wait to be disconnected without saying anything
+        char buffer;
+        struct pollfd pollfd;
+
+        if( setuid( 65534 ) < 0 ) {
+            _exit( 2 );
+        }
+
+        pollfd.fd = connect_raw( address );
+        pollfd.events = POLLIN;
+
+        if( pollfd.fd < 0 || poll( &pollfd, 1, 5000 ) != 1 ) {
+            _exit( 3 );
+        }
+
+        _exit( read( pollfd.fd, &buffer, 1 ) == 0 ? 0 : 4 );
+    }
+
+    int childStatus = -1;
+    waitpid( child, &childStatus, 0 );
+
+    if( !WIFEXITED( childStatus ) || WEXITSTATUS( childStatus ) != 0 ) {
+        // The child may never have connected; hang up on accept() ourselves
+        close( connect_raw( address ) );
+    }
+
+    acceptThread.join();
+
+    TEST_ASSERT_RET_FAIL( child > 0 );
+    TEST_ASSERT_RET_FAIL( WIFEXITED( childStatus ) );
+    TEST_EQUALS_RET_FAIL( WEXITSTATUS( childStatus ), 0 );
+    TEST_ASSERT_RET_FAIL( !serverConn );
+
+    return true;
+}
+
+#define ADD_TEST(name) do{ if( test_name == STRINGIFY(name) ){ \
+            ret = peer_##name();\
+        } \
+    } while( 0 )
+
+int main( int argc, char** argv ) {
+    if( argc < 1 ) {
+        return 1;
+    }
+
+    std::string test_name = argv[1];
+    bool ret = false;
+
+    DBus::set_logging_function( DBus::log_std_err );
+    DBus::set_log_level( SL_TRACE );
+
+    dispatch = DBus::StandaloneDispatcher::create();
+
+    ADD_TEST( connect );
+    ADD_TEST( method_call );
+    ADD_TEST( signal_txrx );
+    ADD_TEST( no_bus_names );
+    ADD_TEST( path_address );
+    ADD_TEST( address_in_use );
+    ADD_TEST( stalled_client );
+    ADD_TEST( stalled_client_doesnt_block );
+    ADD_TEST( foreign_user );
+    ADD_TEST( async_disconnect );
+
+    return !ret;
+}
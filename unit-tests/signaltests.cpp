@@ -19,6 +19,8 @@
  *   along with this software. If not see <http://www.gnu.org/licenses/>.  *
  ***************************************************************************/
 #include <dbus-cxx.h>
+#include <atomic>
+#include <mutex>
 #include <thread>
 #include <unistd.h>
 #include <iostream>
@@ -28,6 +30,13 @@
 static std::shared_ptr<DBus::Dispatcher> dispatch;
 static std::string signal_value;
 static int num_rx = 0;
+static std::vector<uint32_t> burst_values;
+static std::vector<std::vector<uint8_t>> large_values;
+static std::atomic<int> many_rx( 0 );
+static std::atomic<uint32_t> congestion_rx( 0 );
+static std::mutex congestion_lock;
+static std::vector<bool> congestion_changes;
+static std::shared_ptr<DBus::Signal<void(bool)>> congestion_report;
 
 void sigHandle( std::string value ) {
     signal_value = value;
@@ -37,6 +46,18 @@ void voidSigHandle() {
     num_rx++;
 }
 
+void burstSigHandle( uint32_t value ) {
+    burst_values.push_back( value );
+}
+
+void largeSigHandle( std::vector<uint8_t> value ) {
+    large_values.push_back( value );
+}
+
+void manySigHandle( uint32_t ) {
+    many_rx++;
+}
+
 bool signal_create() {
     std::shared_ptr<DBus::Connection> conn = dispatch->create_connection( DBus::BusType::SESSION );
 
@@ -206,6 +227,242 @@ bool signal_remove_handler() {
     return true;
 }
 
+bool signal_burst_txrx() {
+    std::shared_ptr<DBus::Connection> conn = dispatch->create_connection( DBus::BusType::SESSION );
+    const uint32_t num_signals = 500;
+
+    std::shared_ptr<DBus::Signal<void(uint32_t)>> signal = conn->create_free_signal<void(uint32_t)>( "/test/signal", "test.signal.type", "Burst" );
+    std::shared_ptr<DBus::SignalProxy<void(uint32_t)>> proxy = conn->create_free_signal_proxy<void(uint32_t)>(
+                DBus::MatchRuleBuilder::create()
+                .set_path( "/test/signal" )
+                .set_interface( "test.signal.type" )
+                .set_member( "Burst" )
+                .as_signal_match(),
+                DBus::ThreadForCalling::DispatcherThread );
+
+    proxy->connect( sigc::ptr_fun( burstSigHandle ) );
+
+    // Queue up all of the signals at once so that they get written out together
+    for( uint32_t x = 0; x < num_signals; x++ ) {
+        signal->emit( x );
+    }
+
+    std::this_thread::sleep_for( std::chrono::seconds( 2 ) );
+
+    TEST_EQUALS_RET_FAIL( burst_values.size(), num_signals );
+
+    for( uint32_t x = 0; x < num_signals; x++ ) {
+        TEST_EQUALS_RET_FAIL( burst_values[ x ], x );
+    }
+
+    return true;
+}
+
+bool signal_multithread_burst_txrx() {
+    std::shared_ptr<DBus::Connection> conn = dispatch->create_connection( DBus::BusType::SESSION );
+    const uint32_t num_threads = 4;
+    const uint32_t num_signals = 250;
+    std::vector<std::thread> threads;
+    std::vector<uint32_t> next_expected( num_threads, 0 );
+
+    std::shared_ptr<DBus::Signal<void(uint32_t)>> signal = conn->create_free_signal<void(uint32_t)>( "/test/signal", "test.signal.type", "Burst" );
+    std::shared_ptr<DBus::SignalProxy<void(uint32_t)>> proxy = conn->create_free_signal_proxy<void(uint32_t)>(
+                DBus::MatchRuleBuilder::create()
+                .set_path( "/test/signal" )
+                .set_interface( "test.signal.type" )
+                .set_member( "Burst" )
+                .as_signal_match(),
+                DBus::ThreadForCalling::DispatcherThread );
+
+    proxy->connect( sigc::ptr_fun( burstSigHandle ) );
+
+    DBus::set_log_level( SL_INFO );
+
+    // Several threads sending at once; each thread's signals must stay in order
+    for( uint32_t t = 0; t < num_threads; t++ ) {
+        threads.push_back( std::thread( [signal, t, num_signals]() {
+            for( uint32_t x = 0; x < num_signals; x++ ) {
+                signal->emit( ( t << 16 ) | x );
+            }
+        } ) );
+    }
+
+    for( std::thread& thr : threads ) {
+        thr.join();
+    }
+
+    for( int waited = 0; waited < 100 && burst_values.size() < num_threads * num_signals; waited++ ) {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+    }
+
+    TEST_EQUALS_RET_FAIL( burst_values.size(), num_threads * num_signals );
+
+    for( uint32_t value : burst_values ) {
+        uint32_t thread_num = value >> 16;
+
+        TEST_ASSERT_RET_FAIL( thread_num < num_threads );
+        TEST_EQUALS_RET_FAIL( ( value & 0xFFFF ), next_expected[ thread_num ] );
+        next_expected[ thread_num ]++;
+    }
+
+    return true;
+}
+
+static std::vector<uint8_t> large_signal_data( uint32_t num ) {
+    std::vector<uint8_t> data( ( num * 7919 ) % 12000 + 1 );
+
+    for( size_t x = 0; x < data.size(); x++ ) {
+        data[ x ] = ( x + num ) & 0xFF;
+    }
+
+    return data;
+}
+
+bool signal_large_txrx() {
+    std::shared_ptr<DBus::Connection> conn = dispatch->create_connection( DBus::BusType::SESSION );
+    const uint32_t num_signals = 40;
+
+    std::shared_ptr<DBus::Signal<void(std::vector<uint8_t>)>> signal = conn->create_free_signal<void(std::vector<uint8_t>)>( "/test/signal", "test.signal.type", "Large" );
+    std::shared_ptr<DBus::SignalProxy<void(std::vector<uint8_t>)>> proxy = conn->create_free_signal_proxy<void(std::vector<uint8_t>)>(
+                DBus::MatchRuleBuilder::create()
+                .set_path( "/test/signal" )
+                .set_interface( "test.signal.type" )
+                .set_member( "Large" )
+                .as_signal_match(),
+                DBus::ThreadForCalling::DispatcherThread );
+
+    proxy->connect( sigc::ptr_fun( largeSigHandle ) );
+
+    // Tracing every byte of the arrays is far too slow for this much data
+    DBus::set_log_level( SL_INFO );
+
+    // A mix of sizes, so that messages are split across reads of the receive buffer
+    for( uint32_t x = 0; x < num_signals; x++ ) {
+        signal->emit( large_signal_data( x ) );
+    }
+
+    // Give the dispatcher plenty of time when the machine is busy
+    for( int waited = 0; waited < 100 && large_values.size() < num_signals; waited++ ) {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+    }
+
+    TEST_EQUALS_RET_FAIL( large_values.size(), num_signals );
+
+    for( uint32_t x = 0; x < num_signals; x++ ) {
+        TEST_ASSERT_RET_FAIL( large_values[ x ] == large_signal_data( x ) );
+    }
+
+    return true;
+}
+
+bool signal_many_connections() {
+    const int num_connections = 32;
+    const uint32_t num_signals = 10;
+    std::vector<std::shared_ptr<DBus::Connection>> connections;
+    std::vector<std::shared_ptr<DBus::SignalProxy<void(uint32_t)>>> proxies;
+
+    // All of these connections share the one dispatcher thread
+    for( int x = 0; x < num_connections; x++ ) {
+        std::shared_ptr<DBus::Connection> conn = dispatch->create_connection( DBus::BusType::SESSION );
+        TEST_ASSERT_RET_FAIL( conn );
+
+        std::shared_ptr<DBus::SignalProxy<void(uint32_t)>> proxy = conn->create_free_signal_proxy<void(uint32_t)>(
+                    DBus::MatchRuleBuilder::create()
+                    .set_path( "/test/signal" )
+                    .set_interface( "test.signal.type" )
+                    .set_member( "Many" )
+                    .as_signal_match(),
+                    DBus::ThreadForCalling::DispatcherThread );
+        proxy->connect( sigc::ptr_fun( manySigHandle ) );
+
+        connections.push_back( conn );
+        proxies.push_back( proxy );
+    }
+
+    std::shared_ptr<DBus::Signal<void(uint32_t)>> signal =
+        connections[ 0 ]->create_free_signal<void(uint32_t)>( "/test/signal", "test.signal.type", "Many" );
+
+    DBus::set_log_level( SL_INFO );
+
+    for( uint32_t x = 0; x < num_signals; x++ ) {
+        signal->emit( x );
+    }
+
+    for( int waited = 0; waited < 100 && many_rx < static_cast<int>( num_connections * num_signals ); waited++ ) {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+    }
+
+    TEST_EQUALS_RET_FAIL( many_rx, static_cast<int>( num_connections * num_signals ) );
+
+    return true;
+}
+
+void congestionSigHandle( std::string data ) {
+    // Only count the signals that made it through the buffering in one piece
+    if( data == std::string( 512 * 1024, 'c' ) ) {
+        congestion_rx++;
+    }
+}
+
+void congestionChanged( bool congested ) {
+    {
+        std::scoped_lock lock( congestion_lock );
+        congestion_changes.push_back( congested );
+    }
+
+    // Nothing may be locked while this is emitted, so we can send from here
+    congestion_report->emit( congested );
+}
+
+bool signal_congestion_txrx() {
+    std::shared_ptr<DBus::Connection> conn = dispatch->create_connection( DBus::BusType::SESSION );
+    const uint32_t num_signals = 8;
+    const std::string data( 512 * 1024, 'c' );
+
+    std::shared_ptr<DBus::Signal<void(std::string)>> signal = conn->create_free_signal<void(std::string)>( "/test/signal", "test.signal.type", "Congestion" );
+    std::shared_ptr<DBus::SignalProxy<void(std::string)>> proxy = conn->create_free_signal_proxy<void(std::string)>(
+                DBus::MatchRuleBuilder::create()
+                .set_path( "/test/signal" )
+                .set_interface( "test.signal.type" )
+                .set_member( "Congestion" )
+                .as_signal_match(),
+                DBus::ThreadForCalling::DispatcherThread );
+
+    proxy->connect( sigc::ptr_fun( congestionSigHandle ) );
+    congestion_report = conn->create_free_signal<void(bool)>( "/test/signal", "test.signal.type", "CongestionChanged" );
+    conn->set_outgoing_watermarks( 64 * 1024, 16 * 1024 );
+    conn->signal_outgoing_congestion().connect( sigc::ptr_fun( congestionChanged ) );
+
+    // Hexdumping this much data is far too slow, even if it is not logged
+    DBus::set_logging_function( nullptr );
+
+    // Each of these is more than the socket will take at once, so they have to be buffered
+    for( uint32_t x = 0; x < num_signals; x++ ) {
+        signal->emit( data );
+    }
+
+    for( int waited = 0; waited < 100 && congestion_rx < num_signals; waited++ ) {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+    }
+
+    TEST_EQUALS_RET_FAIL( congestion_rx, num_signals );
+    TEST_ASSERT_RET_FAIL( !conn->is_outgoing_congested() );
+
+    std::scoped_lock lock( congestion_lock );
+
+    // We must have become congested, and every change must be the opposite of the last one.
+    // The io_uring transport always writes everything, so it never gets congested.
+    if( DBus::default_transport_backend() == DBus::TransportBackend::Socket ) {
+        TEST_ASSERT_RET_FAIL( congestion_changes.size() >= 2 );
+    }
+
+    for( size_t x = 0; x < congestion_changes.size(); x++ ) {
+        TEST_ASSERT_RET_FAIL( congestion_changes[ x ] == ( ( x % 2 ) == 0 ) );
+    }
+
+    return true;
+}
+
 #define ADD_TEST(name) do{ if( test_name == STRINGIFY(name) ){ \
             ret = signal_##name();\
         } \
@@ -232,6 +489,11 @@ int main( int argc, char** argv ) {
     ADD_TEST( member_match_only );
     ADD_TEST( multiple_handlers );
     ADD_TEST( remove_handler );
+    ADD_TEST( burst_txrx );
+    ADD_TEST( multithread_burst_txrx );
+    ADD_TEST( large_txrx );
+    ADD_TEST( many_connections );
+    ADD_TEST( congestion_txrx );
 
     return !ret;
 }
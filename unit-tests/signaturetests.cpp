@@ -19,7 +19,9 @@
  ***************************************************************************/
 #include <dbus-cxx.h>
 #include <unistd.h>
+#include <atomic>
 #include <iostream>
+#include <thread>
 
 #include "test_macros.h"
 
@@ -383,6 +385,67 @@ bool signature_double_struct() {
     return true;
 }
 
+bool signature_interned() {
+    std::vector<std::thread> threads;
+    std::atomic<int> failures( 0 );
+
+    // Parse the same signatures from many threads at once
+    for( int x = 0; x < 4; x++ ) {
+        threads.emplace_back( [&failures]() {
+            for( int y = 0; y < 1000; y++ ) {
+                DBus::Signature sig( "a{sa(iv)}" );
+                DBus::Signature bad( "a{sa(iv" );
+
+                if( !sig.is_valid() || bad.is_valid() || sig.begin().signature() != "a{sa(iv)}" ) {
+                    failures++;
+                }
+            }
+        } );
+    }
+
+    for( std::thread& thr : threads ) {
+        thr.join();
+    }
+
+    TEST_EQUALS_RET_FAIL( failures.load(), 0 );
+
+    // Signatures made separately from the same string share the same parsed tree
+    DBus::Signature first( std::string( "(ia{sv})" ) );
+    DBus::Signature second;
+    second = "(ia{sv})";
+    TEST_ASSERT_RET_FAIL( first.begin() == second.begin() );
+
+    DBus::SignatureIterator it = second.begin().recurse();
+    TEST_EQUALS_RET_FAIL( it.signature(), std::string( "ia{sv}" ) );
+    it.next();
+    TEST_ASSERT_RET_FAIL( it.is_dict() );
+    TEST_EQUALS_RET_FAIL( it.recurse().signature(), std::string( "{sv}" ) );
+
+    return true;
+}
+
+bool signature_static_signature() {
+    constexpr auto mapSig = DBus::signature<std::map<std::string, std::vector<int32_t>>>();
+    static_assert( mapSig.view() == "a{sai}", "Map signature is built at compile time" );
+    static_assert( DBus::signature<std::tuple<uint8_t, DBus::Path, std::vector<DBus::Variant>>>().view() == "(yoav)",
+                   "Struct signature is built at compile time" );
+    static_assert( DBus::signature<std::vector<std::tuple<uint32_t, std::string>>>().size() == 5,
+                   "Array of structs has the right length" );
+
+    // The runtime signatures are the same
+    std::map<std::string, std::vector<int32_t>> map;
+    std::tuple<bool, std::map<uint64_t, double>> tup;
+    std::map<std::string, std::string> dict;
+    TEST_EQUALS_RET_FAIL( DBus::signature( map ), std::string( "a{sai}" ) );
+    TEST_EQUALS_RET_FAIL( DBus::signature( tup ), std::string( "(ba{td})" ) );
+    TEST_EQUALS_RET_FAIL( DBus::signature_dict_data( dict ), std::string( "{ss}" ) );
+    TEST_EQUALS_RET_FAIL( ( DBus::priv::dbus_signature<int16_t, std::vector<std::string>, DBus::Signature>().dbus_sig() ),
+                          std::string( "nasg" ) );
+    TEST_EQUALS_RET_FAIL( std::string( mapSig.c_str() ), mapSig.str() );
+
+    return true;
+}
+
 #define ADD_TEST(name) do{ if( test_name == STRINGIFY(name) ){ \
             ret = signature_##name();\
         } \
@@ -415,6 +478,8 @@ int main( int argc, char** argv ) {
     ADD_TEST( single_type1 );
     ADD_TEST( single_type2 );
     ADD_TEST( double_struct );
+    ADD_TEST( static_signature );
+    ADD_TEST( interned );
 
     std::cout << "Test case \"" + test_name + "\" " + (ret ? "PASSED" : "FAIL") << std::endl;
     return !ret;